@@ -34,6 +34,7 @@
 #include <vector>
 #include <memory>
 #include <chrono>
+#include <algorithm>
 
 #include <donut/core/vfs/VFS.h>
 #include <donut/core/log.h>
@@ -83,6 +84,21 @@ using namespace donut::render;
 static bool g_PrintSceneGraph = false;
 
 #include "Compute_cb.h"  // requires donut::math
+#include "VRSDeferredLighting_cb.h"
+#include "NasCapture.h"
+#include "GpuProfiler.h"
+#include "RateHistogram.h"
+#include "Benchmark.h"
+#include "CameraPath.h"
+#include "PipelineCache.h"
+
+#include <nas/BudgetController.h>
+#include <nas/ErrorScalers.h>
+#include <nas/RateStatistics.h>
+#include <nas/WaveEmulation.h>
+
+// The rate shaders interpolate ErrorScalerTable.h, the CPU pipeline nas::c_ErrorScalerTable
+static_assert(nas::ShaderErrorScalersMatch(), "ErrorScalerTable.h is out of date, regenerate it with nas_benchmark -write-error-scalers");
 
 // NVIDIA Adaptive Shading (NAS) feature and algorithm demo
 // NAS/VRS-related functions should be identifiable by function name
@@ -98,20 +114,35 @@ public:
     nvrhi::TextureHandle TemporalFeedback2;
     nvrhi::TextureHandle AmbientOcclusion;
     nvrhi::TextureHandle m_VRSRateSurface;
+    nvrhi::TextureHandle m_VRSCoarseRateSurface;  // m_VRSRateSurface made coarser, for passes with a Coarsened policy
     nvrhi::TextureHandle m_NASDataSurface;
+    nvrhi::TextureHandle m_NASTileSignatures;   // incremental NAS: what each rate was computed from
+    nvrhi::TextureHandle m_NASUnsmoothedRates;  // rate pass output, kept across frames by incremental NAS
+    nvrhi::TextureHandle m_NASSmoothingTemp;    // rates and row flags between the separable smoothing passes
+    nvrhi::TextureHandle m_NASMotionVectors;    // MotionVectors of the previous frame with the object motion, single-sample
 
     nvrhi::HeapHandle Heap;
 
     std::shared_ptr<FramebufferFactory> ForwardFramebuffer;
+    std::shared_ptr<FramebufferFactory> ForwardCoarseFramebuffer;   // ForwardFramebuffer with the coarsened rate surface
+    std::shared_ptr<FramebufferFactory> GBufferCoarseFramebuffer;   // GBufferFramebuffer with the coarsened rate surface
     std::shared_ptr<FramebufferFactory> HdrFramebuffer;
     std::shared_ptr<FramebufferFactory> LdrFramebuffer;
     std::shared_ptr<FramebufferFactory> ResolvedFramebuffer;
     std::shared_ptr<FramebufferFactory> MaterialIDFramebuffer;
     std::shared_ptr<FramebufferFactory> DepthPrePassFramebuffer;
 
-    uint2 m_VRSSurfaceSize;
+    uint2 m_VRSSurfaceSize;     // tiles of the render size, the surfaces have the tiles of the full size
     uint m_VRSTileSize;
 
+    // The passes render to the top left m_RenderSize pixels of the render targets, which are
+    // allocated once for the largest size and kept while the render size changes
+    uint2 m_RenderSize;
+
+    // Without shading rate images the rate surface only drives VRSDeferredLighting.hlsl, at this tile size
+    bool m_VRSEmulated = false;
+    static constexpr uint c_EmulatedVRSTileSize = 16;
+
     void Init(
         nvrhi::IDevice* device,
         dm::uint2 size,
@@ -160,10 +191,14 @@ public:
         desc.debugName = "TemporalFeedback2";
         TemporalFeedback2 = device->createTexture(desc);
 
+        // Kept in a state the async NAS data pass on the compute queue can read without a barrier,
+        // compute command lists cannot transition render targets
         desc.format = nvrhi::Format::SRGBA8_UNORM;
         desc.isUAV = false;
+        desc.initialState = nvrhi::ResourceStates::ShaderResource;
         desc.debugName = "LdrColor";
         LdrColor = device->createTexture(desc);
+        desc.initialState = nvrhi::ResourceStates::RenderTarget;
 
         desc.format = nvrhi::Format::R8_UNORM;
         desc.isUAV = true;
@@ -172,15 +207,26 @@ public:
 
         // NAS/VRS surfaces
         {
-            nvrhi::VariableRateShadingFeatureInfo info = {};
-            bool vrsSupported = device->queryFeatureSupport(nvrhi::Feature::VariableRateShading, &info, sizeof(info));
-            if (!vrsSupported)
+            if (m_VRSEmulated)
             {
-                log::fatal("VRS is not supported by the device.");
+                m_VRSTileSize = c_EmulatedVRSTileSize;
             }
+            else
+            {
+                nvrhi::VariableRateShadingFeatureInfo info = {};
+                bool vrsSupported = device->queryFeatureSupport(nvrhi::Feature::VariableRateShading, &info, sizeof(info));
+                if (!vrsSupported)
+                {
+                    log::fatal("VRS is not supported by the device.");
+                }
 
-            m_VRSTileSize = info.shadingRateImageTileSize;
-            m_VRSSurfaceSize = uint2((size.x + m_VRSTileSize - 1) / m_VRSTileSize, (size.y + m_VRSTileSize - 1) / m_VRSTileSize);
+                m_VRSTileSize = info.shadingRateImageTileSize;
+                if (m_VRSTileSize != 8 && m_VRSTileSize != 16 && m_VRSTileSize != 32)
+                {
+                    log::fatal("Unsupported VRS tile size %u, the NAS shaders are built for 8, 16 and 32.", m_VRSTileSize);
+                }
+            }
+            SetRenderSize(size);
 
             nvrhi::TextureDesc desc;
             desc.width = m_VRSSurfaceSize.x;
@@ -193,14 +239,36 @@ public:
             desc.initialState = nvrhi::ResourceStates::UnorderedAccess;
             desc.arraySize = 1;
             desc.isUAV = true;
-            desc.isShadingRateSurface = true;
+            desc.isShadingRateSurface = !m_VRSEmulated;
             desc.format = nvrhi::Format::R8_UINT;
 
             m_VRSRateSurface = device->createTexture(desc);
+            m_VRSCoarseRateSurface = device->createTexture(desc);
 
             desc.isShadingRateSurface = false;
+            m_NASUnsmoothedRates = device->createTexture(desc);
+            m_NASSmoothingTemp = device->createTexture(desc);
+
             desc.format = nvrhi::Format::RG16_FLOAT;
             m_NASDataSurface = device->createTexture(desc);
+
+            desc.format = nvrhi::Format::RGBA32_UINT;
+            m_NASTileSignatures = device->createTexture(desc);
+        }
+
+        // Copied from MotionVectors once the G-buffer fill has written the object motion, for the
+        // MOTION_SOURCE rate passes of the next frame
+        {
+            nvrhi::TextureDesc motionDesc = MotionVectors->getDesc();
+            motionDesc.sampleCount = 1;
+            motionDesc.dimension = nvrhi::TextureDimension::Texture2D;
+            motionDesc.isRenderTarget = false;
+            motionDesc.isVirtual = false;
+            motionDesc.useClearValue = false;
+            motionDesc.keepInitialState = true;
+            motionDesc.initialState = nvrhi::ResourceStates::ShaderResource;
+            motionDesc.debugName = "NASMotionVectors";
+            m_NASMotionVectors = device->createTexture(motionDesc);
         }
 
         if (desc.isVirtual)
@@ -215,7 +283,11 @@ public:
                 LdrColor,
                 AmbientOcclusion,
                 m_VRSRateSurface,
-                m_NASDataSurface
+                m_VRSCoarseRateSurface,
+                m_NASDataSurface,
+                m_NASTileSignatures,
+                m_NASUnsmoothedRates,
+                m_NASSmoothingTemp
             };
 
             for (auto texture : textures)
@@ -244,9 +316,26 @@ public:
             }
         }
 
+        // Emulated VRS has no rate images to attach, the coarse framebuffers are the same as the others
+        nvrhi::ITexture* rateImage = m_VRSEmulated ? nullptr : m_VRSRateSurface.Get();
+        nvrhi::ITexture* coarseRateImage = m_VRSEmulated ? nullptr : m_VRSCoarseRateSurface.Get();
+
         ForwardFramebuffer = std::make_shared<FramebufferFactory>(device);
         ForwardFramebuffer->RenderTargets = { HdrColor };
         ForwardFramebuffer->DepthTarget = Depth;
+        ForwardFramebuffer->ShadingRateSurface = rateImage;
+
+        ForwardCoarseFramebuffer = std::make_shared<FramebufferFactory>(device);
+        ForwardCoarseFramebuffer->RenderTargets = { HdrColor };
+        ForwardCoarseFramebuffer->DepthTarget = Depth;
+        ForwardCoarseFramebuffer->ShadingRateSurface = coarseRateImage;
+
+        GBufferFramebuffer->ShadingRateSurface = rateImage;
+
+        GBufferCoarseFramebuffer = std::make_shared<FramebufferFactory>(device);
+        GBufferCoarseFramebuffer->RenderTargets = GBufferFramebuffer->RenderTargets;
+        GBufferCoarseFramebuffer->DepthTarget = GBufferFramebuffer->DepthTarget;
+        GBufferCoarseFramebuffer->ShadingRateSurface = coarseRateImage;
 
         HdrFramebuffer = std::make_shared<FramebufferFactory>(device);
         HdrFramebuffer->RenderTargets = { HdrColor };
@@ -265,14 +354,20 @@ public:
         DepthPrePassFramebuffer->DepthTarget = Depth;
     }
 
-    [[nodiscard]] bool IsUpdateRequired(uint2 size, uint sampleCount) const
+    // Whether the render targets can hold a frame of this size without being recreated
+    [[nodiscard]] bool CanRender(uint2 size, uint sampleCount) const
     {
-        if (any(m_Size != size) || m_SampleCount != sampleCount)
-            return true;
+        return m_SampleCount == sampleCount && size.x <= m_Size.x && size.y <= m_Size.y;
+    }
 
-        return false;
+    void SetRenderSize(uint2 size)
+    {
+        m_RenderSize = uint2(std::min(size.x, m_Size.x), std::min(size.y, m_Size.y));
+        m_VRSSurfaceSize = uint2((m_RenderSize.x + m_VRSTileSize - 1) / m_VRSTileSize, (m_RenderSize.y + m_VRSTileSize - 1) / m_VRSTileSize);
     }
 
+    [[nodiscard]] uint2 GetRenderSize() const { return m_RenderSize; }
+
     void Clear(nvrhi::ICommandList* commandList) override
     {
         GBufferRenderTargets::Clear(commandList);
@@ -290,6 +385,31 @@ enum class AntiAliasingMode
     MSAA_8X
 };
 
+// Rate surface a pass shades with
+enum class ShadingRateSource
+{
+    NAS,
+    Coarsened   // the NAS rates, ShadingRateCoarseningBias steps coarser (CoarsenShadingRate.hlsl)
+};
+
+// Tile motion of the NAS rate pass, the MOTION_SOURCE permutations of ComputeShadingRate.hlsl
+enum class NASMotionSource
+{
+    Reprojection,       // the tile center at the tile's min depth, camera motion only
+    AverageMotion,      // average over the tile of the motion vector buffer
+    MaxMotion           // max over the tile of the motion vector buffer
+};
+
+// How a pass uses VRS, applied by FeatureDemo::ApplyShadingRatePolicy. The image combiner
+// combines passRate with the rate of the surface.
+struct ShadingRatePolicy
+{
+    bool                                enabled = false;
+    ShadingRateSource                   source = ShadingRateSource::NAS;
+    nvrhi::ShadingRateCombiner          combiner = nvrhi::ShadingRateCombiner::Override;
+    nvrhi::VariableShadingRate          passRate = nvrhi::VariableShadingRate::e1x1;
+};
+
 struct UIData
 {
     bool                                ShowUI = true;
@@ -304,6 +424,7 @@ struct UIData
     enum AntiAliasingMode               AntiAliasingMode = AntiAliasingMode::TEMPORAL;
     enum TemporalAntiAliasingJitter     TemporalAntiAliasingJitter = TemporalAntiAliasingJitter::MSAA;
     bool                                EnableVsync = true;
+    float                               ResolutionScale = 1.f;  // render size relative to the window, scaled up by the final blit
     bool                                ShaderReloadRequested = false;
     bool                                EnableProceduralSky = true;
     bool                                EnableBloom = true;
@@ -320,9 +441,40 @@ struct UIData
     bool                                EnableNAS = true;
     bool                                EnableShadingRateVis = false;
     float                               NASErrorSensitivity = 0.07f;
+    bool                                EnableNASBudget = false;  // NASErrorSensitivity and the opaque rate floor from nas::BudgetController
+    nas::BudgetControllerSettings       NASBudget;
     float                               NASMotionSensitivity = 0.5f;
     float                               NASBrightnessSensitivity = 0.1f;
+    nas::ErrorMetric                    NASErrorMetric = nas::ErrorMetric::Max;
     bool                                EnableShadingRateSurfaceSmoothing = true;
+    int                                 ShadingRateSmoothingRadius = 1;
+    bool                                SeparableShadingRateSmoothing = false;
+    bool                                UseFusedNASKernel = false;
+    bool                                UseAsyncNASData = true;  // NAS data on the compute queue, when the device has one
+    bool                                UseIncrementalNAS = false;
+    float                               NASMotionTolerance = 0.f;
+    float                               NASErrorTolerance = 0.f;    // fraction of the error sensitivity
+    NASMotionSource                     MotionSource = NASMotionSource::Reprojection;
+    bool                                ShareStereoNASError = false;
+    ShadingRatePolicy                   OpaqueShadingRatePolicy = { true };
+    ShadingRatePolicy                   SkyShadingRatePolicy;
+    ShadingRatePolicy                   TransparentShadingRatePolicy = { false, ShadingRateSource::Coarsened };
+    int                                 ShadingRateCoarseningBias = 1;
+    bool                                UseVRSDeferredLighting = true;
+    bool                                EmulateVRS = false;  // no hardware VRS, also set when the device lacks it
+    float                               VRSLightingDepthThreshold = 0.02f;
+    float                               VRSLightingNormalThreshold = 0.9f;
+    bool                                EnableRateStatistics = true;
+    bool                                LogRateStatistics = false;
+    bool                                EnableNASCapture = false;
+    std::string                         NASCaptureFileName = "nas_capture.nascap";
+    std::string                         ProfileFileName = "gpu_profile";  // .csv and .json are appended
+    bool                                RecordCameraPath = false;
+    bool                                ReplayCameraPath = false;
+    std::string                         CameraPathFileName = "camera_path.txt";
+    float                               CameraPathTimeStep = 1.f / 60.f;  // of the replay
+    bool                                RunBenchmark = false;
+    Benchmark::Settings                 BenchmarkSettings;
     bool                                DisplayShadowMap = false;
     bool                                UseThirdPersonCamera = false;
     bool                                EnableAnimations = false;
@@ -387,6 +539,9 @@ private:
     std::shared_ptr<IView>              m_ViewPrevious;
     
     nvrhi::CommandListHandle            m_CommandList;
+    nvrhi::CommandListHandle            m_PrePassCommandList;   // graphics work before the async NAS data is waited for
+    nvrhi::CommandListHandle            m_NASCommandList;       // compute queue, null without one
+    uint64_t                            m_LastGraphicsInstance = 0;  // last submission of the frame, which writes LdrColor
     bool                                m_PreviousViewsValid = false;
     FirstPersonCamera                   m_FirstPersonCamera;
     ThirdPersonCamera                   m_ThirdPersonCamera;
@@ -407,19 +562,62 @@ private:
     
     UIData&                             m_ui;
 
-    nvrhi::TimerQueryHandle             m_tqDepthPrePass;
-    nvrhi::TimerQueryHandle             m_tqForwardOpaque;
-    nvrhi::TimerQueryHandle             m_tqForwardSky;
-    nvrhi::TimerQueryHandle             m_tqForwardTransparent;
-    nvrhi::TimerQueryHandle             m_tqMotionVector;
+    std::unique_ptr<GpuProfiler>        m_Profiler;
+
+    static constexpr uint32_t           c_RateStatisticsLogInterval = 60;  // frames
+
+    // GPU time of the passes with a shading rate policy, averaged separately with NAS off [0] and on [1]
+    enum PolicyPass { PolicyPassOpaque, PolicyPassSky, PolicyPassTransparent, PolicyPassCount };
+    float                               m_PolicyPassTimeMs[2][PolicyPassCount] = {};
 
     ComputePass                         m_NASDataPass;
+    nas::ErrorMetric                    m_NASDataErrorMetric = nas::ErrorMetric::Max;
     ComputePass                         m_ShadingRatePass;
     ComputePass                         m_ShadingRateSmoothPass;
+    ComputePass                         m_ShadingRateSmoothVerticalPass;  // second pass of the separable version
+    int                                 m_ShadingRateSmoothRadius = 0;
+    NASMotionSource                     m_ShadingRateMotionSource = NASMotionSource::Reprojection;
+    bool                                m_NASMotionVectorsValid = false;  // m_NASMotionVectors holds the last frame's complete motion
+    bool                                m_ShadingRateSmoothSeparable = false;
+    ComputePass                         m_FusedNASPass;
+    nas::ErrorMetric                    m_FusedNASErrorMetric = nas::ErrorMetric::Max;
+    int                                 m_FusedNASSmoothRadius = 0;     // 0 without smoothing
+    NASMotionSource                     m_FusedNASMotionSource = NASMotionSource::Reprojection;
+    ComputePass                         m_NASChangeDetectionPass;
+    ComputePass                         m_IncrementalShadingRatePass;
+    ComputePass                         m_StereoShadingRatePass;
+    nvrhi::BufferHandle                 m_NASStereoConstants;  // per-view constants of m_StereoShadingRatePass
+    ComputePass                         m_VRSDeferredLightingPass;
+    nvrhi::BufferHandle                 m_VRSLitPixelCount;  // written by m_VRSDeferredLightingPass
+    nvrhi::BufferHandle                 m_NASSurfaceConstants;  // smoothing and rate visualization, written once per frame
+    ComputePass                         m_CoarsenShadingRatePass;
+    int                                 m_CoarsenShadingRateBias = 0;
+    ShadingRateSource                   m_SkyPassSource = ShadingRateSource::NAS;
+    nvrhi::SamplerHandle                m_ShadowComparisonSampler;
     FullscreenPass                      m_VRSRateVisPass;
+    std::unique_ptr<NasCapture>         m_NasCapture;
+    std::unique_ptr<RateHistogram>      m_RateHistogram;
+    nas::BudgetController               m_NASBudgetController;
+    bool                                m_NASBudgetActive = false;
+    std::unique_ptr<PipelineCache>      m_PipelineCache;
+    uint32_t                            m_PassSampleCount = 0;  // of the render targets the geometry passes were created for
+    uint32_t                            m_RateStatisticsLogFrame = 0;
+    std::unique_ptr<Benchmark>          m_Benchmark;
+    CameraPathRecorder                  m_CameraPathRecorder;
+    CameraPath                          m_CameraPath;  // replayed, or by every benchmark configuration
+    uint32_t                            m_CameraPathFrame = 0;
+    bool                                m_CameraPathReplaying = false;
+    float                               m_BenchmarkFrameTime = 0.f;  // measured, Animate gets the fixed time step
 
     nvrhi::SamplerHandle                m_BilinearSampler;
 
+    // Incremental NAS: dirty tile list and the indirect dispatch arguments it produces
+    nvrhi::BufferHandle                 m_NASDirtyTiles;
+    nvrhi::BufferHandle                 m_NASIncrementalArgs;
+    bool                                m_NASHistoryValid = false;
+    float                               m_NASHistoryErrorSensitivity = 0.f;
+    float                               m_NASHistoryMotionSensitivity = 0.f;
+
 public:
 
     FeatureDemo(DeviceManager* deviceManager, UIData& ui, const std::string& sceneName)
@@ -452,6 +650,47 @@ public:
 
         m_ShaderFactory = std::make_shared<ShaderFactory>(GetDevice(), m_RootFs, "/shaders");
         m_CommonPasses = std::make_shared<CommonRenderPasses>(GetDevice(), m_ShaderFactory);
+        m_NasCapture = std::make_unique<NasCapture>(GetDevice(), m_ShaderFactory);
+        m_RateHistogram = std::make_unique<RateHistogram>(GetDevice(), m_ShaderFactory);
+        m_PipelineCache = std::make_unique<PipelineCache>(GetDevice());
+
+        nvrhi::BufferDesc surfaceConstantsDesc;
+        surfaceConstantsDesc.byteSize = sizeof(NASSurfaceConstants);
+        surfaceConstantsDesc.debugName = "NASSurfaceConstants";
+        surfaceConstantsDesc.isConstantBuffer = true;
+        surfaceConstantsDesc.isVolatile = true;
+        surfaceConstantsDesc.maxVersions = engine::c_MaxRenderPassConstantBufferVersions;
+        m_NASSurfaceConstants = GetDevice()->createBuffer(surfaceConstantsDesc);
+        m_Profiler = std::make_unique<GpuProfiler>(GetDevice());
+
+        // Without shading rate images, NAS still runs and the VRS deferred lighting pass shades at its rates
+        nvrhi::VariableRateShadingFeatureInfo vrsInfo = {};
+        if (!m_ui.EmulateVRS && !GetDevice()->queryFeatureSupport(nvrhi::Feature::VariableRateShading, &vrsInfo, sizeof(vrsInfo)))
+        {
+            log::warning("VRS is not supported by the device, emulating it in the deferred lighting pass.");
+            m_ui.EmulateVRS = true;
+        }
+        // The shading mode stays as selected; only the VRS deferred lighting pass emulates the coarse shading
+        if (m_ui.EmulateVRS && !UsesVRSDeferredLighting())
+        {
+            log::warning("Emulated VRS only shades at the NAS rates in the VRS deferred lighting pass, which needs "
+                "deferred shading without light probes. The %s path runs at full rate.", GetOpaqueShadingPathName());
+        }
+
+        if (m_ui.RunBenchmark)
+        {
+            // A camera path replaces the sweep, every configuration replays all of its frames
+            if (!m_ui.BenchmarkSettings.cameraPathFileName.empty())
+            {
+                if (!m_CameraPath.Load(m_ui.BenchmarkSettings.cameraPathFileName))
+                {
+                    log::fatal("Cannot load the benchmark camera path %s", m_ui.BenchmarkSettings.cameraPathFileName.c_str());
+                }
+                m_ui.BenchmarkSettings.measuredFrames = m_CameraPath.GetFrameCount();
+            }
+
+            m_Benchmark = std::make_unique<Benchmark>(m_ui.BenchmarkSettings);
+        }
 
         m_OpaqueDrawStrategy = std::make_shared<InstancedOpaqueDrawStrategy>();
         m_TransparentDrawStrategy = std::make_shared<TransparentDrawStrategy>();
@@ -469,6 +708,11 @@ public:
         m_ShadowDepthPass->Init(*m_ShaderFactory, shadowDepthParams);
 
         m_CommandList = GetDevice()->createCommandList();
+        m_PrePassCommandList = GetDevice()->createCommandList();
+        if (GetDevice()->queryFeatureSupport(nvrhi::Feature::ComputeQueue))
+        {
+            m_NASCommandList = GetDevice()->createCommandList(nvrhi::CommandListParameters().setQueueType(nvrhi::CommandQueue::Compute));
+        }
 
         m_FirstPersonCamera.SetMoveSpeed(3.0f);
         m_ThirdPersonCamera.SetMoveSpeed(3.0f);
@@ -484,12 +728,6 @@ public:
         m_EnvironmentMap = m_TextureCache->LoadTextureFromFileDeferred(mediaPath / "environment/space.dds", true);
 
         CreateLightProbes(4);
-
-        m_tqDepthPrePass = GetDevice()->createTimerQuery();
-        m_tqForwardOpaque = GetDevice()->createTimerQuery();
-        m_tqForwardSky = GetDevice()->createTimerQuery();
-        m_tqForwardTransparent = GetDevice()->createTimerQuery();
-        m_tqMotionVector = GetDevice()->createTimerQuery();
     }
 
 	std::shared_ptr<vfs::IFileSystem> GetRootFs() const
@@ -607,7 +845,20 @@ public:
 
     virtual void Animate(float fElapsedTimeSeconds) override
     { 
-        if (!m_ui.ActiveSceneCamera)
+        if (m_Benchmark)
+        {
+            m_BenchmarkFrameTime = fElapsedTimeSeconds;
+            fElapsedTimeSeconds = m_Benchmark->GetTimeStep();
+        }
+
+        UpdateCameraPath();
+        if (m_CameraPathReplaying)
+        {
+            fElapsedTimeSeconds = m_ui.CameraPathTimeStep;
+        }
+
+        // The benchmark script and camera path replays move the camera themselves
+        if (!m_ui.ActiveSceneCamera && !(m_Benchmark && m_Benchmark->IsStarted()) && !m_CameraPathReplaying)
         {
             if (m_ui.UseThirdPersonCamera)
                 GetActiveCamera().Animate(fElapsedTimeSeconds);
@@ -618,18 +869,118 @@ public:
         if(m_ToneMappingPass)
             m_ToneMappingPass->AdvanceFrame(fElapsedTimeSeconds);
         
-        if (IsSceneLoaded() && m_ui.EnableAnimations)
+        if (m_CameraPathReplaying)
+        {
+            ApplyCameraPathFrame(m_CameraPath.GetFrame(m_CameraPathFrame++));
+        }
+        else if (IsSceneLoaded() && m_ui.EnableAnimations)
+        {
+            // Every benchmark configuration starts the animations over, the script starts with this frame
+            if (m_Benchmark)
+                m_WallclockTime = m_Benchmark->GetAnimationTime();
+            else
+                m_WallclockTime += fElapsedTimeSeconds;
+            ApplyAnimations();
+        }
+
+        if (m_CameraPathRecorder.IsActive())
+        {
+            m_CameraPathRecorder.RecordFrame(GetCameraPathFrame());
+        }
+    }
+
+    void ApplyAnimations()
+    {
+        for (const auto& anim : m_Scene->GetSceneGraph()->GetAnimations())
+        {
+            float duration = anim->GetDuration();
+            float integral;
+            float animationTime = std::modf(m_WallclockTime / duration, &integral) * duration;
+            (void)anim->Apply(animationTime);
+        }
+    }
+
+    // Starts and stops recording and replay as the UI asks, once the scene is loaded
+    void UpdateCameraPath()
+    {
+        if (!IsSceneLoaded())
+            return;
+
+        if (m_ui.RecordCameraPath != m_CameraPathRecorder.IsActive())
+        {
+            if (!m_ui.RecordCameraPath)
+                m_CameraPathRecorder.End();
+            else if (!m_CameraPathRecorder.Begin(m_ui.CameraPathFileName))
+                m_ui.RecordCameraPath = false;
+        }
+
+        if (m_ui.ReplayCameraPath != m_CameraPathReplaying)
+        {
+            m_CameraPathReplaying = m_ui.ReplayCameraPath && m_CameraPath.Load(m_ui.CameraPathFileName);
+            m_ui.ReplayCameraPath = m_CameraPathReplaying;
+            m_CameraPathFrame = 0;
+        }
+
+        // The last frame has been rendered, the camera stays where the path ends
+        if (m_CameraPathReplaying && m_CameraPathFrame == m_CameraPath.GetFrameCount())
+        {
+            log::info("Camera path replay finished, %u frames", m_CameraPathFrame);
+            m_CameraPathReplaying = false;
+            m_ui.ReplayCameraPath = false;
+        }
+    }
+
+    // The camera and animation state of this frame, for recording
+    CameraPathFrame GetCameraPathFrame() const
+    {
+        CameraPathFrame frame;
+        if (m_ui.ActiveSceneCamera)
+        {
+            dm::affine3 viewToWorld = m_ui.ActiveSceneCamera->GetViewToWorldMatrix();
+            frame.position = viewToWorld.m_translation;
+            frame.direction = viewToWorld.m_linear.row2;
+            frame.up = viewToWorld.m_linear.row1;
+            frame.sceneCamera = m_ui.ActiveSceneCamera->GetName();
+        }
+        else
         {
-            m_WallclockTime += fElapsedTimeSeconds;
+            const BaseCamera& camera = GetActiveCamera();
+            frame.position = camera.GetPosition();
+            frame.direction = camera.GetDir();
+            frame.up = camera.GetUp();
+        }
+        frame.verticalFov = m_CameraVerticalFov;
+        frame.animate = m_ui.EnableAnimations;
+        frame.animationTime = m_WallclockTime;
+        return frame;
+    }
 
-            for (const auto& anim : m_Scene->GetSceneGraph()->GetAnimations())
+    // A scene camera that the scene does not have is replaced by the free camera at its recorded pose
+    void ApplyCameraPathFrame(const CameraPathFrame& frame)
+    {
+        m_ui.ActiveSceneCamera.reset();
+        m_ui.UseThirdPersonCamera = false;
+        if (!frame.sceneCamera.empty())
+        {
+            for (const auto& camera : m_Scene->GetSceneGraph()->GetCameras())
             {
-                float duration = anim->GetDuration();
-                float integral;
-                float animationTime = std::modf(m_WallclockTime / duration, &integral) * duration;
-                (void)anim->Apply(animationTime);
+                if (camera->GetName() == frame.sceneCamera)
+                {
+                    m_ui.ActiveSceneCamera = camera;
+                    break;
+                }
             }
         }
+
+        m_FirstPersonCamera.LookAt(frame.position, frame.position + frame.direction, frame.up);
+        m_CameraVerticalFov = frame.verticalFov;
+
+        m_ui.EnableAnimations = frame.animate;
+        if (frame.animate)
+        {
+            m_WallclockTime = frame.animationTime;
+            ApplyAnimations();
+        }
     }
 
 
@@ -758,7 +1109,7 @@ public:
 
     bool SetupView()
     {
-        float2 renderTargetSize = float2(m_RenderTargets->GetSize());
+        float2 renderTargetSize = float2(m_RenderTargets->GetRenderSize());
 
         if (m_TemporalAntiAliasingPass)
             m_TemporalAntiAliasingPass->SetJitter(m_ui.TemporalAntiAliasingJitter);
@@ -855,83 +1206,178 @@ public:
         return topologyChanged;
     }
 
-    void CreateRenderPasses(bool& exposureResetRequired)
+    // What changed since the passes were created. Each pass is rebuilt only when one of its inputs did,
+    // the others keep their pipelines.
+    struct PassInputChanges
     {
-        uint32_t motionVectorStencilMask = 0x01;
+        bool shaders = false;       // first frame or shader reload
+        bool renderTargets = false; // resize or sample count
+        bool renderSize = false;    // resolution scale or a window size the targets still fit
+        bool viewTopology = false;  // see SetupView
+    };
 
-        ForwardShadingPass::CreateParameters ForwardParams;
-        ForwardParams.trackLiveness = false;
-        m_ForwardPass = std::make_unique<ForwardShadingPass>(GetDevice(), m_CommonPasses);
-        m_ForwardPass->Init(*m_ShaderFactory, ForwardParams);
+    void CreateRenderPasses(bool& exposureResetRequired, const PassInputChanges& changes)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        m_PipelineCache->TakeStatistics();
+
+        uint32_t motionVectorStencilMask = 0x01;
 
-        DepthPass::CreateParameters DepthParams;
-        DepthParams.trackLiveness = false;
-        m_DepthPrePass = std::make_unique<DepthPass>(GetDevice(), m_CommonPasses);
-        m_DepthPrePass->Init(*m_ShaderFactory, DepthParams);
+        // The geometry passes create their pipelines for the framebuffer of the first frame they draw
+        bool sampleCountChanged = m_RenderTargets->GetSampleCount() != m_PassSampleCount;
+        bool geometryPasses = changes.shaders || sampleCountChanged;
+        bool targetPasses = changes.shaders || changes.renderTargets || changes.renderSize || changes.viewTopology;
+        bool nasPasses = changes.shaders || changes.renderTargets;
 
-        GBufferFillPass::CreateParameters GBufferParams;
-        GBufferParams.enableMotionVectors = true;
-        GBufferParams.stencilWriteMask = motionVectorStencilMask;
-        m_GBufferPass = std::make_unique<GBufferFillPass>(GetDevice(), m_CommonPasses);
-        m_GBufferPass->Init(*m_ShaderFactory, GBufferParams);
+        if (geometryPasses)
+        {
+            m_PassSampleCount = m_RenderTargets->GetSampleCount();
 
-        GBufferParams.enableMotionVectors = false;
-        m_MaterialIDPass = std::make_unique<MaterialIDPass>(GetDevice(), m_CommonPasses);
-        m_MaterialIDPass->Init(*m_ShaderFactory, GBufferParams);
+            ForwardShadingPass::CreateParameters ForwardParams;
+            ForwardParams.trackLiveness = false;
+            m_ForwardPass = std::make_unique<ForwardShadingPass>(GetDevice(), m_CommonPasses);
+            m_ForwardPass->Init(*m_ShaderFactory, ForwardParams);
 
-        m_PixelReadbackPass = std::make_unique<PixelReadbackPass>(GetDevice(), m_ShaderFactory, m_RenderTargets->MaterialIDs, nvrhi::Format::RGBA32_UINT);
+            DepthPass::CreateParameters DepthParams;
+            DepthParams.trackLiveness = false;
+            m_DepthPrePass = std::make_unique<DepthPass>(GetDevice(), m_CommonPasses);
+            m_DepthPrePass->Init(*m_ShaderFactory, DepthParams);
 
-        m_DeferredLightingPass = std::make_unique<DeferredLightingPass>(GetDevice(), m_CommonPasses);
-        m_DeferredLightingPass->Init(m_ShaderFactory);
+            GBufferFillPass::CreateParameters GBufferParams;
+            GBufferParams.enableMotionVectors = true;
+            GBufferParams.stencilWriteMask = motionVectorStencilMask;
+            m_GBufferPass = std::make_unique<GBufferFillPass>(GetDevice(), m_CommonPasses);
+            m_GBufferPass->Init(*m_ShaderFactory, GBufferParams);
 
-        m_SkyPass = std::make_unique<SkyPass>(GetDevice(), m_ShaderFactory, m_CommonPasses, m_RenderTargets->ForwardFramebuffer, *m_View);
+            GBufferParams.enableMotionVectors = false;
+            m_MaterialIDPass = std::make_unique<MaterialIDPass>(GetDevice(), m_CommonPasses);
+            m_MaterialIDPass->Init(*m_ShaderFactory, GBufferParams);
+        }
 
+        if (changes.shaders)
         {
-            TemporalAntiAliasingPass::CreateParameters taaParams;
-            taaParams.sourceDepth = m_RenderTargets->Depth;
-            taaParams.motionVectors = m_RenderTargets->MotionVectors;
-            taaParams.unresolvedColor = m_RenderTargets->HdrColor;
-            taaParams.resolvedColor = m_RenderTargets->ResolvedColor;
-            taaParams.feedback1 = m_RenderTargets->TemporalFeedback1;
-            taaParams.feedback2 = m_RenderTargets->TemporalFeedback2;
-            taaParams.motionVectorStencilMask = motionVectorStencilMask;
-            taaParams.useCatmullRomFilter = true;
+            m_DeferredLightingPass = std::make_unique<DeferredLightingPass>(GetDevice(), m_CommonPasses);
+            m_DeferredLightingPass->Init(m_ShaderFactory);
 
-            m_TemporalAntiAliasingPass = std::make_unique<TemporalAntiAliasingPass>(GetDevice(), m_ShaderFactory, m_CommonPasses, *m_View, taaParams);
+            m_LightProbePass = std::make_shared<LightProbeProcessingPass>(GetDevice(), m_ShaderFactory, m_CommonPasses);
         }
-
-        if (m_RenderTargets->GetSampleCount() == 1)
+        else if (changes.renderTargets)
         {
-            m_SsaoPass = std::make_unique<SsaoPass>(GetDevice(), m_ShaderFactory, m_CommonPasses, m_RenderTargets->Depth, m_RenderTargets->GBufferNormals, m_RenderTargets->AmbientOcclusion);
+            // Its binding sets hold the previous G-buffer
+            m_DeferredLightingPass->ResetBindingCache();
         }
 
-        m_LightProbePass = std::make_shared<LightProbeProcessingPass>(GetDevice(), m_ShaderFactory, m_CommonPasses);
+        if (targetPasses)
+        {
+            m_PixelReadbackPass = std::make_unique<PixelReadbackPass>(GetDevice(), m_ShaderFactory, m_RenderTargets->MaterialIDs, nvrhi::Format::RGBA32_UINT);
+
+            CreateSkyPass();
 
-        nvrhi::BufferHandle exposureBuffer = nullptr;
-        if (m_ToneMappingPass)
-            exposureBuffer = m_ToneMappingPass->GetExposureBuffer();
-        else
-            exposureResetRequired = true;
+            {
+                TemporalAntiAliasingPass::CreateParameters taaParams;
+                taaParams.sourceDepth = m_RenderTargets->Depth;
+                taaParams.motionVectors = m_RenderTargets->MotionVectors;
+                taaParams.unresolvedColor = m_RenderTargets->HdrColor;
+                taaParams.resolvedColor = m_RenderTargets->ResolvedColor;
+                taaParams.feedback1 = m_RenderTargets->TemporalFeedback1;
+                taaParams.feedback2 = m_RenderTargets->TemporalFeedback2;
+                taaParams.motionVectorStencilMask = motionVectorStencilMask;
+                taaParams.useCatmullRomFilter = true;
+
+                m_TemporalAntiAliasingPass = std::make_unique<TemporalAntiAliasingPass>(GetDevice(), m_ShaderFactory, m_CommonPasses, *m_View, taaParams);
+            }
 
-        ToneMappingPass::CreateParameters toneMappingParams;
-        toneMappingParams.exposureBufferOverride = exposureBuffer;
-        m_ToneMappingPass = std::make_unique<ToneMappingPass>(GetDevice(), m_ShaderFactory, m_CommonPasses, m_RenderTargets->LdrFramebuffer, *m_View, toneMappingParams);
+            m_SsaoPass = nullptr;
+            if (m_RenderTargets->GetSampleCount() == 1)
+            {
+                m_SsaoPass = std::make_unique<SsaoPass>(GetDevice(), m_ShaderFactory, m_CommonPasses, m_RenderTargets->Depth, m_RenderTargets->GBufferNormals, m_RenderTargets->AmbientOcclusion);
+            }
 
-        m_BloomPass = std::make_unique<BloomPass>(GetDevice(), m_ShaderFactory, m_CommonPasses, m_RenderTargets->ResolvedFramebuffer, *m_View);
+            nvrhi::BufferHandle exposureBuffer = nullptr;
+            if (m_ToneMappingPass)
+                exposureBuffer = m_ToneMappingPass->GetExposureBuffer();
+            else
+                exposureResetRequired = true;
 
-        m_PreviousViewsValid = false;
+            ToneMappingPass::CreateParameters toneMappingParams;
+            toneMappingParams.exposureBufferOverride = exposureBuffer;
+            m_ToneMappingPass = std::make_unique<ToneMappingPass>(GetDevice(), m_ShaderFactory, m_CommonPasses, m_RenderTargets->LdrFramebuffer, *m_View, toneMappingParams);
+
+            m_BloomPass = std::make_unique<BloomPass>(GetDevice(), m_ShaderFactory, m_CommonPasses, m_RenderTargets->ResolvedFramebuffer, *m_View);
+
+            m_PreviousViewsValid = false;
+            m_NASHistoryValid = false;
+            m_NASMotionVectorsValid = false;
+        }
+
+        // The NAS passes do not depend on the view, their pipelines come from the cache and only
+        // their binding sets are new after a resize
+        if (nasPasses)
+        {
+            InitNASDataPass();
+            InitShadingRatePass();
+            InitStereoShadingRatePass();
+            InitVRSRateVisPass();
+            InitShadingRateSmoothPass();
+            InitFusedNASPass();
+            InitIncrementalNASPasses();
+            InitVRSDeferredLightingPass();
+            InitCoarsenShadingRatePass();
+        }
+
+        auto end = std::chrono::high_resolution_clock::now();
+        PipelineCache::Statistics cacheStatistics = m_PipelineCache->TakeStatistics();
+        log::info("Render passes rebuilt in %.1f ms (geometry %s, targets %s, NAS %s), "
+            "pipeline cache %u hits, %u misses created in %.1f ms",
+            std::chrono::duration<double, std::milli>(end - start).count(),
+            geometryPasses ? "yes" : "no", targetPasses ? "yes" : "no", nasPasses ? "yes" : "no",
+            cacheStatistics.hits, cacheStatistics.misses, cacheStatistics.missMilliseconds);
+    }
 
-        InitNASDataPass();
-        InitShadingRatePass();
-        InitVRSRateVisPass();
-        InitShadingRateSmoothPass();
+    // The sky pass keeps the framebuffer it is created with, so it is rebuilt when its policy source changes
+    void CreateSkyPass()
+    {
+        m_SkyPassSource = m_ui.SkyShadingRatePolicy.source;
+        const std::shared_ptr<FramebufferFactory>& framebuffer = (m_SkyPassSource == ShadingRateSource::Coarsened)
+            ? m_RenderTargets->ForwardCoarseFramebuffer
+            : m_RenderTargets->ForwardFramebuffer;
+        m_SkyPass = std::make_unique<SkyPass>(GetDevice(), m_ShaderFactory, m_CommonPasses, framebuffer, *m_View);
     }
 
     // NAS-related functions begin here
+    // The NAS shaders are specialized for the VRS tile size of the device
+    std::vector<ShaderMacro> GetTileSizeDefines() const
+    {
+        return { ShaderMacro("TILE_SIZE", std::to_string(m_RenderTargets->m_VRSTileSize)) };
+    }
+
+    // ComputeNASData reduces with wave intrinsics when the device runs a fixed wave size of 32 or 64
+    // and with groupshared memory otherwise
+    nas::ReductionVariant SelectNASReductionVariant()
+    {
+        nvrhi::WaveLaneCountMinMaxFeatureInfo waveInfo = {};
+        if (!GetDevice()->queryFeatureSupport(nvrhi::Feature::WaveLaneCountMinMax, &waveInfo, sizeof(waveInfo)))
+        {
+            log::info("Wave lane count unknown, using the groupshared NAS reduction");
+            return nas::ReductionVariant::Groupshared;
+        }
+
+        nas::ReductionVariant variant = nas::SelectReductionVariant(waveInfo.minWaveLaneCount, waveInfo.maxWaveLaneCount);
+        log::info("Wave lane count %u-%u, using the %s NAS reduction", waveInfo.minWaveLaneCount, waveInfo.maxWaveLaneCount,
+            nas::GetReductionVariantName(variant));
+        return variant;
+    }
+
     // Creating required pipeline state and resources for NAS
+    // Rebuilt when the error metric changes
     void InitNASDataPass()
     {
-        m_NASDataPass.Shader = m_ShaderFactory->CreateShader("app/ComputeNASData", "main_cs", nullptr, nvrhi::ShaderType::Compute);
+        m_NASDataErrorMetric = m_ui.NASErrorMetric;
+
+        std::vector<ShaderMacro> defines = GetTileSizeDefines();
+        defines.push_back(ShaderMacro("WAVE_SIZE", std::to_string(nas::GetReductionWaveSize(SelectNASReductionVariant()))));
+        defines.push_back(ShaderMacro("ERROR_METRIC", std::to_string(int(m_NASDataErrorMetric))));
+        m_NASDataPass.Shader = m_ShaderFactory->CreateShader("app/ComputeNASData", "main_cs", &defines, nvrhi::ShaderType::Compute);
         if (!m_NASDataPass.Shader)
         {
             log::fatal("Cannot compile VRS rate shader");
@@ -944,7 +1390,7 @@ public:
             nvrhi::BindingLayoutItem::Texture_UAV(0),
             nvrhi::BindingLayoutItem::Texture_SRV(0)
         };
-        m_NASDataPass.BindingLayout = GetDevice()->createBindingLayout(layoutDesc);
+        m_NASDataPass.BindingLayout = m_PipelineCache->GetBindingLayout(layoutDesc);
 
         nvrhi::BufferDesc constantBufferDesc;
         constantBufferDesc.byteSize = sizeof(ComputeNASDataConstants);
@@ -966,12 +1412,26 @@ public:
         psoDesc.CS = m_NASDataPass.Shader;
         psoDesc.bindingLayouts = { m_NASDataPass.BindingLayout };
 
-        m_NASDataPass.Pipeline = GetDevice()->createComputePipeline(psoDesc);
+        m_NASDataPass.Pipeline = m_PipelineCache->GetComputePipeline(psoDesc);
+    }
+
+    // The motion vector sources read the previous frame's motion vectors, see CopyNASMotionVectors,
+    // and fall back to reprojection until a complete frame of them exists
+    NASMotionSource GetMotionSource() const
+    {
+        return m_NASMotionVectorsValid ? m_ui.MotionSource : NASMotionSource::Reprojection;
     }
 
+    // Rebuilt when the motion source changes
     void InitShadingRatePass()
     {
-        m_ShadingRatePass.Shader = m_ShaderFactory->CreateShader("app/ComputeShadingRate", "main_cs", nullptr, nvrhi::ShaderType::Compute);
+        m_ShadingRateMotionSource = GetMotionSource();
+
+        std::vector<ShaderMacro> defines = GetTileSizeDefines();
+        defines.push_back(ShaderMacro("INCREMENTAL", "0"));
+        defines.push_back(ShaderMacro("STEREO", "0"));
+        defines.push_back(ShaderMacro("MOTION_SOURCE", std::to_string(int(m_ShadingRateMotionSource))));
+        m_ShadingRatePass.Shader = m_ShaderFactory->CreateShader("app/ComputeShadingRate", "main_cs", &defines, nvrhi::ShaderType::Compute);
         if (!m_ShadingRatePass.Shader)
         {
             log::fatal("Cannot compile VRS rate shader");
@@ -984,9 +1444,10 @@ public:
             nvrhi::BindingLayoutItem::Sampler(0),
             nvrhi::BindingLayoutItem::Texture_UAV(0),
             nvrhi::BindingLayoutItem::Texture_SRV(0),
-            nvrhi::BindingLayoutItem::Texture_SRV(1)
+            nvrhi::BindingLayoutItem::Texture_SRV(1),
+            nvrhi::BindingLayoutItem::Texture_SRV(2)
         };
-        m_ShadingRatePass.BindingLayout = GetDevice()->createBindingLayout(layoutDesc);
+        m_ShadingRatePass.BindingLayout = m_PipelineCache->GetBindingLayout(layoutDesc);
 
         nvrhi::BufferDesc constantBufferDesc;
         constantBufferDesc.byteSize = sizeof(AdaptiveShadingConstants);
@@ -1005,9 +1466,10 @@ public:
         bindingSetDesc.bindings = {
             nvrhi::BindingSetItem::ConstantBuffer(0, m_ShadingRatePass.ConstantBuffer),
             nvrhi::BindingSetItem::Sampler(0, m_BilinearSampler),
-            nvrhi::BindingSetItem::Texture_UAV(0, m_RenderTargets->m_VRSRateSurface),
+            nvrhi::BindingSetItem::Texture_UAV(0, m_RenderTargets->m_NASUnsmoothedRates),
             nvrhi::BindingSetItem::Texture_SRV(0, m_RenderTargets->Depth),
-            nvrhi::BindingSetItem::Texture_SRV(1, m_RenderTargets->m_NASDataSurface)
+            nvrhi::BindingSetItem::Texture_SRV(1, m_RenderTargets->m_NASDataSurface),
+            nvrhi::BindingSetItem::Texture_SRV(2, m_RenderTargets->m_NASMotionVectors)
         };
         m_ShadingRatePass.BindingSet = GetDevice()->createBindingSet(bindingSetDesc, m_ShadingRatePass.BindingLayout);
 
@@ -1015,14 +1477,19 @@ public:
         psoDesc.CS = m_ShadingRatePass.Shader;
         psoDesc.bindingLayouts = { m_ShadingRatePass.BindingLayout };
 
-        m_ShadingRatePass.Pipeline = GetDevice()->createComputePipeline(psoDesc);
+        m_ShadingRatePass.Pipeline = m_PipelineCache->GetComputePipeline(psoDesc);
 
     }
 
-    void InitShadingRateSmoothPass()
+    // ComputeShadingRate for all views of a StereoPlanarView in one dispatch, uses the sampler of InitShadingRatePass
+    void InitStereoShadingRatePass()
     {
-        m_ShadingRateSmoothPass.Shader = m_ShaderFactory->CreateShader("app/SmoothShadingRate", "main_cs", nullptr, nvrhi::ShaderType::Compute);
-        if (!m_ShadingRateSmoothPass.Shader)
+        std::vector<ShaderMacro> defines = GetTileSizeDefines();
+        defines.push_back(ShaderMacro("INCREMENTAL", "0"));
+        defines.push_back(ShaderMacro("STEREO", "1"));
+        defines.push_back(ShaderMacro("MOTION_SOURCE", "0"));
+        m_StereoShadingRatePass.Shader = m_ShaderFactory->CreateShader("app/ComputeShadingRate", "main_cs", &defines, nvrhi::ShaderType::Compute);
+        if (!m_StereoShadingRatePass.Shader)
         {
             log::fatal("Cannot compile VRS rate shader");
         }
@@ -1030,106 +1497,1061 @@ public:
         nvrhi::BindingLayoutDesc layoutDesc;
         layoutDesc.visibility = nvrhi::ShaderType::Compute;
         layoutDesc.bindings = {
+            nvrhi::BindingLayoutItem::VolatileConstantBuffer(0),
+            nvrhi::BindingLayoutItem::VolatileConstantBuffer(1),
+            nvrhi::BindingLayoutItem::Sampler(0),
             nvrhi::BindingLayoutItem::Texture_UAV(0),
+            nvrhi::BindingLayoutItem::Texture_SRV(0),
+            nvrhi::BindingLayoutItem::Texture_SRV(1)
         };
-        m_ShadingRateSmoothPass.BindingLayout = GetDevice()->createBindingLayout(layoutDesc);
+        m_StereoShadingRatePass.BindingLayout = m_PipelineCache->GetBindingLayout(layoutDesc);
+
+        nvrhi::BufferDesc constantBufferDesc;
+        constantBufferDesc.byteSize = sizeof(AdaptiveShadingConstants);
+        constantBufferDesc.debugName = "NASStereoRatePassConstants";
+        constantBufferDesc.isConstantBuffer = true;
+        constantBufferDesc.isVolatile = true;
+        constantBufferDesc.maxVersions = engine::c_MaxRenderPassConstantBufferVersions;
+        m_StereoShadingRatePass.ConstantBuffer = GetDevice()->createBuffer(constantBufferDesc);
+
+        constantBufferDesc.byteSize = sizeof(NASStereoConstants);
+        constantBufferDesc.debugName = "NASStereoConstants";
+        m_NASStereoConstants = GetDevice()->createBuffer(constantBufferDesc);
 
         nvrhi::BindingSetDesc bindingSetDesc;
         bindingSetDesc.bindings = {
-            nvrhi::BindingSetItem::Texture_UAV(0, m_RenderTargets->m_VRSRateSurface),
+            nvrhi::BindingSetItem::ConstantBuffer(0, m_StereoShadingRatePass.ConstantBuffer),
+            nvrhi::BindingSetItem::ConstantBuffer(1, m_NASStereoConstants),
+            nvrhi::BindingSetItem::Sampler(0, m_BilinearSampler),
+            nvrhi::BindingSetItem::Texture_UAV(0, m_RenderTargets->m_NASUnsmoothedRates),
+            nvrhi::BindingSetItem::Texture_SRV(0, m_RenderTargets->Depth),
+            nvrhi::BindingSetItem::Texture_SRV(1, m_RenderTargets->m_NASDataSurface)
         };
-        m_ShadingRateSmoothPass.BindingSet = GetDevice()->createBindingSet(bindingSetDesc, m_ShadingRateSmoothPass.BindingLayout);
+        m_StereoShadingRatePass.BindingSet = GetDevice()->createBindingSet(bindingSetDesc, m_StereoShadingRatePass.BindingLayout);
 
         nvrhi::ComputePipelineDesc psoDesc = {};
-        psoDesc.CS = m_ShadingRateSmoothPass.Shader;
-        psoDesc.bindingLayouts = { m_ShadingRateSmoothPass.BindingLayout };
-
-        m_ShadingRateSmoothPass.Pipeline = GetDevice()->createComputePipeline(psoDesc);
+        psoDesc.CS = m_StereoShadingRatePass.Shader;
+        psoDesc.bindingLayouts = { m_StereoShadingRatePass.BindingLayout };
 
+        m_StereoShadingRatePass.Pipeline = m_PipelineCache->GetComputePipeline(psoDesc);
     }
 
-    // Shading passes to calculate shading rate surface
-    void ComputeNASData()
+    // Smoothing reads the unsmoothed rates and writes the VRS surface, with SMOOTH_RADIUS and the
+    // single or two-pass version taken from the UI. Rebuilt when either of them changes.
+    void InitShadingRateSmoothPass()
     {
-        ComputeNASDataConstants NASDataPassConstants = {};
-        NASDataPassConstants.brightnessSensitivity = m_ui.NASBrightnessSensitivity;
-        m_CommandList->writeBuffer(m_NASDataPass.ConstantBuffer, &NASDataPassConstants, sizeof(NASDataPassConstants));
+        m_ShadingRateSmoothRadius = m_ui.ShadingRateSmoothingRadius;
+        m_ShadingRateSmoothSeparable = m_ui.SeparableShadingRateSmoothing;
 
-        nvrhi::ComputeState state;
-        state.pipeline = m_NASDataPass.Pipeline;
-        state.bindings = { m_NASDataPass.BindingSet };
-        m_CommandList->setComputeState(state);
+        nvrhi::BindingLayoutDesc layoutDesc;
+        layoutDesc.visibility = nvrhi::ShaderType::Compute;
+        layoutDesc.bindings = {
+            nvrhi::BindingLayoutItem::VolatileConstantBuffer(0),
+            nvrhi::BindingLayoutItem::Texture_SRV(0),
+            nvrhi::BindingLayoutItem::Texture_UAV(0)
+        };
+        nvrhi::BindingLayoutHandle bindingLayout = m_PipelineCache->GetBindingLayout(layoutDesc);
 
-        // Dispatch call to generate the VRS surface
-        m_CommandList->dispatch(m_RenderTargets->m_VRSSurfaceSize.x, m_RenderTargets->m_VRSSurfaceSize.y, 1);
+        auto initPass = [this, &bindingLayout](ComputePass& pass, int smoothPass, nvrhi::ITexture* input, nvrhi::ITexture* output)
+        {
+            const std::vector<ShaderMacro> defines = {
+                ShaderMacro("SMOOTH_RADIUS", std::to_string(m_ShadingRateSmoothRadius)),
+                ShaderMacro("SMOOTH_PASS", std::to_string(smoothPass))
+            };
+            pass.Shader = m_ShaderFactory->CreateShader("app/SmoothShadingRate", "main_cs", &defines, nvrhi::ShaderType::Compute);
+            if (!pass.Shader)
+            {
+                log::fatal("Cannot compile VRS rate shader");
+            }
+
+            pass.BindingLayout = bindingLayout;
+
+            nvrhi::BindingSetDesc bindingSetDesc;
+            bindingSetDesc.bindings = {
+                nvrhi::BindingSetItem::ConstantBuffer(0, m_NASSurfaceConstants),
+                nvrhi::BindingSetItem::Texture_SRV(0, input, nvrhi::Format::R8_UINT),
+                nvrhi::BindingSetItem::Texture_UAV(0, output)
+            };
+            pass.BindingSet = GetDevice()->createBindingSet(bindingSetDesc, pass.BindingLayout);
+
+            nvrhi::ComputePipelineDesc psoDesc = {};
+            psoDesc.CS = pass.Shader;
+            psoDesc.bindingLayouts = { pass.BindingLayout };
+
+            pass.Pipeline = m_PipelineCache->GetComputePipeline(psoDesc);
+        };
+
+        if (m_ShadingRateSmoothSeparable)
+        {
+            initPass(m_ShadingRateSmoothPass, 1, m_RenderTargets->m_NASUnsmoothedRates, m_RenderTargets->m_NASSmoothingTemp);
+            initPass(m_ShadingRateSmoothVerticalPass, 2, m_RenderTargets->m_NASSmoothingTemp, m_RenderTargets->m_VRSRateSurface);
+        }
+        else
+        {
+            initPass(m_ShadingRateSmoothPass, 0, m_RenderTargets->m_NASUnsmoothedRates, m_RenderTargets->m_VRSRateSurface);
+            m_ShadingRateSmoothVerticalPass = ComputePass();
+        }
     }
 
-    void ComputeVRSRateSurface()
+    // Single-dispatch alternative to the three passes above, with the same error metric, motion
+    // source and smoothing radius. Rebuilt when one of them changes.
+    void InitFusedNASPass()
     {
-        const IView* view = m_View->GetChildView(ViewType::PLANAR, 0); // TODO: support multiple views (VR)
-        const IView* viewPrevious = m_ViewPrevious->GetChildView(ViewType::PLANAR, 0);
-
-        nvrhi::ViewportState viewportState = view->GetViewportState();
-        nvrhi::ViewportState prevViewportState = viewPrevious->GetViewportState();
+        m_FusedNASErrorMetric = m_ui.NASErrorMetric;
+        m_FusedNASSmoothRadius = GetFusedNASSmoothRadius();
+        m_FusedNASMotionSource = GetMotionSource();
 
-        // This pass only works for planar, single-viewport views
-        assert(viewportState.viewports.size() == 1 && prevViewportState.viewports.size() == 1);
+        std::vector<ShaderMacro> defines = GetTileSizeDefines();
+        defines.push_back(ShaderMacro("ERROR_METRIC", std::to_string(int(m_FusedNASErrorMetric))));
+        defines.push_back(ShaderMacro("SMOOTH_RADIUS", std::to_string(m_FusedNASSmoothRadius)));
+        defines.push_back(ShaderMacro("MOTION_SOURCE", std::to_string(int(m_FusedNASMotionSource))));
+        m_FusedNASPass.Shader = m_ShaderFactory->CreateShader("app/FusedNAS", "main_cs", &defines, nvrhi::ShaderType::Compute);
+        if (!m_FusedNASPass.Shader)
+        {
+            log::fatal("Cannot compile VRS rate shader");
+        }
 
-        const nvrhi::Viewport& prevViewport = prevViewportState.viewports[0];
+        nvrhi::BindingLayoutDesc layoutDesc;
+        layoutDesc.visibility = nvrhi::ShaderType::Compute;
+        layoutDesc.bindings = {
+            nvrhi::BindingLayoutItem::VolatileConstantBuffer(0),
+            nvrhi::BindingLayoutItem::Texture_UAV(0),
+            nvrhi::BindingLayoutItem::Texture_SRV(0),
+            nvrhi::BindingLayoutItem::Texture_SRV(1),
+            nvrhi::BindingLayoutItem::Texture_SRV(2)
+        };
+        m_FusedNASPass.BindingLayout = m_PipelineCache->GetBindingLayout(layoutDesc);
 
-        AdaptiveShadingConstants ASRatePassConstants = {};
-        affine3 viewReprojection = inverse(view->GetViewMatrix()) * viewPrevious->GetViewMatrix();
-        ASRatePassConstants.reprojectionMatrix = inverse(view->GetProjectionMatrix(false)) * affineToHomogeneous(viewReprojection) * viewPrevious->GetProjectionMatrix(false);
-        ASRatePassConstants.previousViewOrigin = uint2(uint(floorf(prevViewport.minX)), uint(floorf(prevViewport.minY)));
-        ASRatePassConstants.previousViewSize = uint2(uint(floorf(prevViewport.width())), uint(floorf(prevViewport.height())));
-        ASRatePassConstants.sourceTextureSizeInv = float2(1.f / m_RenderTargets->GetSize().x, 1.f / m_RenderTargets->GetSize().y);
-        ASRatePassConstants.errorSensitivity = m_ui.NASErrorSensitivity;
-        ASRatePassConstants.motionSensitivity = m_ui.NASMotionSensitivity;
+        nvrhi::BufferDesc constantBufferDesc;
+        constantBufferDesc.byteSize = sizeof(FusedNASConstants);
+        constantBufferDesc.debugName = "FusedNASConstants";
+        constantBufferDesc.isConstantBuffer = true;
+        constantBufferDesc.isVolatile = true;
+        constantBufferDesc.maxVersions = engine::c_MaxRenderPassConstantBufferVersions;
+        m_FusedNASPass.ConstantBuffer = GetDevice()->createBuffer(constantBufferDesc);
 
-        m_CommandList->writeBuffer(m_ShadingRatePass.ConstantBuffer, &ASRatePassConstants, sizeof(ASRatePassConstants));
+        nvrhi::BindingSetDesc bindingSetDesc;
+        bindingSetDesc.bindings = {
+            nvrhi::BindingSetItem::ConstantBuffer(0, m_FusedNASPass.ConstantBuffer),
+            nvrhi::BindingSetItem::Texture_UAV(0, m_RenderTargets->m_VRSRateSurface),
+            nvrhi::BindingSetItem::Texture_SRV(0, m_RenderTargets->LdrColor, nvrhi::Format::SRGBA8_UNORM),
+            nvrhi::BindingSetItem::Texture_SRV(1, m_RenderTargets->Depth),
+            nvrhi::BindingSetItem::Texture_SRV(2, m_RenderTargets->m_NASMotionVectors)
+        };
+        m_FusedNASPass.BindingSet = GetDevice()->createBindingSet(bindingSetDesc, m_FusedNASPass.BindingLayout);
 
-        nvrhi::ComputeState state;
-        state.pipeline = m_ShadingRatePass.Pipeline;
-        state.bindings = { m_ShadingRatePass.BindingSet };
-        m_CommandList->setComputeState(state);
+        nvrhi::ComputePipelineDesc psoDesc = {};
+        psoDesc.CS = m_FusedNASPass.Shader;
+        psoDesc.bindingLayouts = { m_FusedNASPass.BindingLayout };
 
-        // Dispatch call to generate the VRS surface
-        m_CommandList->dispatch(m_RenderTargets->m_VRSSurfaceSize.x, m_RenderTargets->m_VRSSurfaceSize.y, 1);
+        m_FusedNASPass.Pipeline = m_PipelineCache->GetComputePipeline(psoDesc);
     }
 
-    void SmoothVRSRateSurface()
+    // Change detection and the indirect shading rate pass over the dirty tiles it finds,
+    // an alternative to ComputeVRSRateSurface
+    void InitIncrementalNASPasses()
     {
-        nvrhi::ComputeState state;
-        state.pipeline = m_ShadingRateSmoothPass.Pipeline;
-        state.bindings = { m_ShadingRateSmoothPass.BindingSet };
-        m_CommandList->setComputeState(state);
+        // All tiles of the surface, the render size may grow later
+        const nvrhi::TextureDesc& surfaceDesc = m_RenderTargets->m_VRSRateSurface->getDesc();
+        const uint2 surfaceSize = uint2(surfaceDesc.width, surfaceDesc.height);
+
+        nvrhi::BufferDesc dirtyTilesDesc;
+        dirtyTilesDesc.byteSize = (surfaceSize.x * surfaceSize.y + 1) * sizeof(uint);
+        dirtyTilesDesc.structStride = sizeof(uint);
+        dirtyTilesDesc.canHaveUAVs = true;
+        dirtyTilesDesc.debugName = "NASDirtyTiles";
+        dirtyTilesDesc.initialState = nvrhi::ResourceStates::UnorderedAccess;
+        dirtyTilesDesc.keepInitialState = true;
+        m_NASDirtyTiles = GetDevice()->createBuffer(dirtyTilesDesc);
+
+        nvrhi::BufferDesc argsDesc;
+        argsDesc.byteSize = 3 * sizeof(uint);
+        argsDesc.format = nvrhi::Format::R32_UINT;
+        argsDesc.canHaveUAVs = true;
+        argsDesc.canHaveTypedViews = true;
+        argsDesc.isDrawIndirectArgs = true;
+        argsDesc.debugName = "NASIncrementalArgs";
+        argsDesc.initialState = nvrhi::ResourceStates::IndirectArgument;
+        argsDesc.keepInitialState = true;
+        m_NASIncrementalArgs = GetDevice()->createBuffer(argsDesc);
+
+        {
+            const std::vector<ShaderMacro> defines = GetTileSizeDefines();
+            m_NASChangeDetectionPass.Shader = m_ShaderFactory->CreateShader("app/DetectNASChanges", "main_cs", &defines, nvrhi::ShaderType::Compute);
+            if (!m_NASChangeDetectionPass.Shader)
+            {
+                log::fatal("Cannot compile NAS change detection shader");
+            }
 
-        // Dispatch call to smooth the VRS surface
-        m_CommandList->dispatch((m_RenderTargets->m_VRSSurfaceSize.x + 15) / 16, (m_RenderTargets->m_VRSSurfaceSize.y + 15) / 16, 1);
-    }
+            nvrhi::BindingLayoutDesc layoutDesc;
+            layoutDesc.visibility = nvrhi::ShaderType::Compute;
+            layoutDesc.bindings = {
+                nvrhi::BindingLayoutItem::VolatileConstantBuffer(0),
+                nvrhi::BindingLayoutItem::Texture_UAV(0),
+                nvrhi::BindingLayoutItem::StructuredBuffer_UAV(1),
+                nvrhi::BindingLayoutItem::TypedBuffer_UAV(2),
+                nvrhi::BindingLayoutItem::Texture_SRV(0),
+                nvrhi::BindingLayoutItem::Texture_SRV(1)
+            };
+            m_NASChangeDetectionPass.BindingLayout = m_PipelineCache->GetBindingLayout(layoutDesc);
+
+            nvrhi::BufferDesc constantBufferDesc;
+            constantBufferDesc.byteSize = sizeof(NASChangeDetectionConstants);
+            constantBufferDesc.debugName = "NASChangeDetectionConstants";
+            constantBufferDesc.isConstantBuffer = true;
+            constantBufferDesc.isVolatile = true;
+            constantBufferDesc.maxVersions = engine::c_MaxRenderPassConstantBufferVersions;
+            m_NASChangeDetectionPass.ConstantBuffer = GetDevice()->createBuffer(constantBufferDesc);
+
+            nvrhi::BindingSetDesc bindingSetDesc;
+            bindingSetDesc.bindings = {
+                nvrhi::BindingSetItem::ConstantBuffer(0, m_NASChangeDetectionPass.ConstantBuffer),
+                nvrhi::BindingSetItem::Texture_UAV(0, m_RenderTargets->m_NASTileSignatures),
+                nvrhi::BindingSetItem::StructuredBuffer_UAV(1, m_NASDirtyTiles),
+                nvrhi::BindingSetItem::TypedBuffer_UAV(2, m_NASIncrementalArgs),
+                nvrhi::BindingSetItem::Texture_SRV(0, m_RenderTargets->Depth),
+                nvrhi::BindingSetItem::Texture_SRV(1, m_RenderTargets->m_NASDataSurface)
+            };
+            m_NASChangeDetectionPass.BindingSet = GetDevice()->createBindingSet(bindingSetDesc, m_NASChangeDetectionPass.BindingLayout);
 
-    // special pass to visualize/debug the shading rate surface
-    void InitVRSRateVisPass()
-    {
-        m_VRSRateVisPass.VS = m_ShaderFactory->CreateShader("app/ShadingRateVis", "main_vs", nullptr, nvrhi::ShaderType::Vertex);
-        m_VRSRateVisPass.PS = m_ShaderFactory->CreateShader("app/ShadingRateVis", "main_ps", nullptr, nvrhi::ShaderType::Pixel);
+            nvrhi::ComputePipelineDesc psoDesc = {};
+            psoDesc.CS = m_NASChangeDetectionPass.Shader;
+            psoDesc.bindingLayouts = { m_NASChangeDetectionPass.BindingLayout };
 
-        nvrhi::IFramebuffer* framebuffer = GetDeviceManager()->GetCurrentFramebuffer();
-        m_VRSRateVisPass.Framebuffer = framebuffer;
+            m_NASChangeDetectionPass.Pipeline = m_PipelineCache->GetComputePipeline(psoDesc);
+        }
 
-        nvrhi::BindingLayoutDesc layoutDesc;
+        {
+            std::vector<ShaderMacro> defines = GetTileSizeDefines();
+            defines.push_back(ShaderMacro("INCREMENTAL", "1"));
+            defines.push_back(ShaderMacro("STEREO", "0"));
+            defines.push_back(ShaderMacro("MOTION_SOURCE", "0"));
+            m_IncrementalShadingRatePass.Shader = m_ShaderFactory->CreateShader("app/ComputeShadingRate", "main_cs", &defines, nvrhi::ShaderType::Compute);
+            if (!m_IncrementalShadingRatePass.Shader)
+            {
+                log::fatal("Cannot compile VRS rate shader");
+            }
 
-        layoutDesc.visibility = nvrhi::ShaderType::Pixel;
-        layoutDesc.bindings = {
+            nvrhi::BindingLayoutDesc layoutDesc;
+            layoutDesc.visibility = nvrhi::ShaderType::Compute;
+            layoutDesc.bindings = {
+                nvrhi::BindingLayoutItem::VolatileConstantBuffer(0),
+                nvrhi::BindingLayoutItem::Texture_UAV(0),
+                nvrhi::BindingLayoutItem::StructuredBuffer_SRV(2),
+                nvrhi::BindingLayoutItem::Texture_SRV(3)
+            };
+            m_IncrementalShadingRatePass.BindingLayout = m_PipelineCache->GetBindingLayout(layoutDesc);
+
+            nvrhi::BufferDesc constantBufferDesc;
+            constantBufferDesc.byteSize = sizeof(AdaptiveShadingConstants);
+            constantBufferDesc.debugName = "NASIncrementalRatePassConstants";
+            constantBufferDesc.isConstantBuffer = true;
+            constantBufferDesc.isVolatile = true;
+            constantBufferDesc.maxVersions = engine::c_MaxRenderPassConstantBufferVersions;
+            m_IncrementalShadingRatePass.ConstantBuffer = GetDevice()->createBuffer(constantBufferDesc);
+
+            // Tiles that are not dirty keep the rate of an earlier frame in the unsmoothed surface.
+            // The NAS data comes from the signatures, sampled by DetectNASChanges.
+            nvrhi::BindingSetDesc bindingSetDesc;
+            bindingSetDesc.bindings = {
+                nvrhi::BindingSetItem::ConstantBuffer(0, m_IncrementalShadingRatePass.ConstantBuffer),
+                nvrhi::BindingSetItem::Texture_UAV(0, m_RenderTargets->m_NASUnsmoothedRates),
+                nvrhi::BindingSetItem::StructuredBuffer_SRV(2, m_NASDirtyTiles),
+                nvrhi::BindingSetItem::Texture_SRV(3, m_RenderTargets->m_NASTileSignatures)
+            };
+            m_IncrementalShadingRatePass.BindingSet = GetDevice()->createBindingSet(bindingSetDesc, m_IncrementalShadingRatePass.BindingLayout);
+
+            nvrhi::ComputePipelineDesc psoDesc = {};
+            psoDesc.CS = m_IncrementalShadingRatePass.Shader;
+            psoDesc.bindingLayouts = { m_IncrementalShadingRatePass.BindingLayout };
+
+            m_IncrementalShadingRatePass.Pipeline = m_PipelineCache->GetComputePipeline(psoDesc);
+        }
+    }
+
+    // Shading passes to calculate shading rate surface
+    // Only reads the previous frame's LdrColor, so it can run on the compute queue, see RecordAsyncNASData
+    void ComputeNASData(nvrhi::ICommandList* commandList)
+    {
+        if (m_ui.NASErrorMetric != m_NASDataErrorMetric)
+        {
+            InitNASDataPass();
+        }
+
+        GpuProfiler::Scope profilerScope(*m_Profiler, commandList, "NASData");
+
+        ComputeNASDataConstants NASDataPassConstants = {};
+        NASDataPassConstants.brightnessSensitivity = m_ui.NASBrightnessSensitivity;
+        commandList->writeBuffer(m_NASDataPass.ConstantBuffer, &NASDataPassConstants, sizeof(NASDataPassConstants));
+
+        nvrhi::ComputeState state;
+        state.pipeline = m_NASDataPass.Pipeline;
+        state.bindings = { m_NASDataPass.BindingSet };
+        commandList->setComputeState(state);
+
+        // Dispatch call to generate the VRS surface
+        uint2 dispatchSize = m_RenderTargets->m_VRSSurfaceSize;
+        if (IsStereo() && m_ui.ShareStereoNASError)
+        {
+            // Only the first view needs NAS data, the others sample it (see GetStereoShadingRateConstants)
+            uint2 viewOrigin, viewSize;
+            GetViewportRect(m_View->GetChildView(ViewType::PLANAR, 0), viewOrigin, viewSize);
+            const uint tileSize = m_RenderTargets->m_VRSTileSize;
+            dispatchSize.x = std::min(dispatchSize.x, (viewOrigin.x + viewSize.x + tileSize - 1) / tileSize);
+        }
+        commandList->dispatch(dispatchSize.x, dispatchSize.y, 1);
+    }
+
+    // The fused kernel computes the NAS data itself, after the prepass
+    bool UsesAsyncNASData()
+    {
+        return m_ui.EnableNAS && m_ui.UseAsyncNASData && m_NASCommandList && !(m_ui.UseFusedNASKernel && !IsStereo());
+    }
+
+    // Records the NAS data pass on the compute queue, submitted with the frame in SubmitFrame
+    void RecordAsyncNASData()
+    {
+        m_NASCommandList->open();
+        m_Profiler->BeginScope(m_NASCommandList, "AsyncCompute");
+        ComputeNASData(m_NASCommandList);
+        m_Profiler->EndScope(m_NASCommandList);
+        m_NASCommandList->close();
+    }
+
+    // Ends the command list of the work that does not depend on the NAS data and continues the
+    // frame on a second one, which the graphics queue only starts once the compute queue is
+    // done. NASWait measures the time the graphics queue waited for it.
+    void SplitFrameForAsyncNASData()
+    {
+        m_Profiler->BeginScope(m_CommandList, "NASWait");
+        m_CommandList->close();
+        std::swap(m_CommandList, m_PrePassCommandList);
+        m_CommandList->open();
+        m_Profiler->EndScope(m_CommandList);
+    }
+
+    // Both queues get the whole frame at once, so the compute queue runs the NAS data while the
+    // graphics queue renders the shadows, the prepass and the motion vectors. The NAS data reads
+    // LdrColor, so the compute queue waits for the previous frame; the graphics queue writes
+    // LdrColor again after the NAS wait, which covers the other direction.
+    void SubmitFrame(bool asyncNASData)
+    {
+        nvrhi::IDevice* device = GetDevice();
+
+        if (asyncNASData)
+        {
+            if (m_LastGraphicsInstance)
+                device->queueWaitForCommandList(nvrhi::CommandQueue::Compute, nvrhi::CommandQueue::Graphics, m_LastGraphicsInstance);
+            const uint64_t nasInstance = device->executeCommandList(m_NASCommandList, nvrhi::CommandQueue::Compute);
+
+            device->executeCommandList(m_PrePassCommandList);
+            device->queueWaitForCommandList(nvrhi::CommandQueue::Graphics, nvrhi::CommandQueue::Compute, nasInstance);
+        }
+
+        m_LastGraphicsInstance = device->executeCommandList(m_CommandList);
+    }
+
+    // The NAS passes only work for planar, single-viewport views
+    static void GetViewportRect(const IView* view, uint2& origin, uint2& size)
+    {
+        nvrhi::ViewportState viewportState = view->GetViewportState();
+        assert(viewportState.viewports.size() == 1);
+
+        const nvrhi::Viewport& viewport = viewportState.viewports[0];
+        origin = uint2(uint(floorf(viewport.minX)), uint(floorf(viewport.minY)));
+        size = uint2(uint(floorf(viewport.width())), uint(floorf(viewport.height())));
+    }
+
+    // From the clip space of view to the clip space of viewPrevious, which may be another eye
+    static float4x4 GetReprojectionMatrix(const IView* view, const IView* viewPrevious)
+    {
+        affine3 viewReprojection = inverse(view->GetViewMatrix()) * viewPrevious->GetViewMatrix();
+        return inverse(view->GetProjectionMatrix(false)) * affineToHomogeneous(viewReprojection) * viewPrevious->GetProjectionMatrix(false);
+    }
+
+    // Reprojection of the first view, the stereo pass only uses the sensitivities and the source size
+    AdaptiveShadingConstants GetShadingRateConstants() const
+    {
+        const IView* view = m_View->GetChildView(ViewType::PLANAR, 0);
+        const IView* viewPrevious = m_ViewPrevious->GetChildView(ViewType::PLANAR, 0);
+
+        AdaptiveShadingConstants ASRatePassConstants = {};
+        ASRatePassConstants.reprojectionMatrix = GetReprojectionMatrix(view, viewPrevious);
+        GetViewportRect(viewPrevious, ASRatePassConstants.previousViewOrigin, ASRatePassConstants.previousViewSize);
+        ASRatePassConstants.sourceTextureSizeInv = float2(1.f / m_RenderTargets->GetRenderSize().x, 1.f / m_RenderTargets->GetRenderSize().y);
+        ASRatePassConstants.tileCount = m_RenderTargets->m_VRSSurfaceSize;
+        ASRatePassConstants.errorSensitivity = m_ui.NASErrorSensitivity;
+        ASRatePassConstants.motionSensitivity = m_ui.NASMotionSensitivity;
+
+        return ASRatePassConstants;
+    }
+
+    void ComputeVRSRateSurface()
+    {
+        if (GetMotionSource() != m_ShadingRateMotionSource)
+        {
+            InitShadingRatePass();
+        }
+
+        GpuProfiler::Scope profilerScope(*m_Profiler, m_CommandList, "ShadingRate");
+
+        AdaptiveShadingConstants ASRatePassConstants = GetShadingRateConstants();
+        m_CommandList->writeBuffer(m_ShadingRatePass.ConstantBuffer, &ASRatePassConstants, sizeof(ASRatePassConstants));
+
+        nvrhi::ComputeState state;
+        state.pipeline = m_ShadingRatePass.Pipeline;
+        state.bindings = { m_ShadingRatePass.BindingSet };
+        m_CommandList->setComputeState(state);
+
+        // Dispatch call to generate the VRS surface
+        m_CommandList->dispatch(m_RenderTargets->m_VRSSurfaceSize.x, m_RenderTargets->m_VRSSurfaceSize.y, 1);
+    }
+
+    // Each view reprojects to its own previous frame for the motion. With shared error the NAS data
+    // is sampled in the previous frame of the first view instead, so the other eyes reuse its error.
+    NASStereoConstants GetStereoShadingRateConstants() const
+    {
+        NASStereoConstants stereoConstants = {};
+        stereoConstants.viewCount = std::min(m_View->GetNumChildViews(ViewType::PLANAR), uint32_t(NAS_MAX_VIEWS));
+        stereoConstants.clampToErrorView = m_ui.ShareStereoNASError ? 1 : 0;
+
+        for (uint viewIndex = 0; viewIndex < stereoConstants.viewCount; viewIndex++)
+        {
+            const IView* view = m_View->GetChildView(ViewType::PLANAR, viewIndex);
+            const IView* viewPrevious = m_ViewPrevious->GetChildView(ViewType::PLANAR, viewIndex);
+            const IView* errorViewPrevious = m_ui.ShareStereoNASError ? m_ViewPrevious->GetChildView(ViewType::PLANAR, 0) : viewPrevious;
+
+            NASViewConstants& viewConstants = stereoConstants.views[viewIndex];
+
+            uint2 viewOrigin, viewSize;
+            GetViewportRect(view, viewOrigin, viewSize);
+            viewConstants.viewOrigin = float2(float(viewOrigin.x), float(viewOrigin.y));
+            viewConstants.viewSizeInv = float2(1.f / viewSize.x, 1.f / viewSize.y);
+
+            viewConstants.reprojectionMatrix = GetReprojectionMatrix(view, viewPrevious);
+            GetViewportRect(viewPrevious, viewConstants.previousViewOrigin, viewConstants.previousViewSize);
+
+            viewConstants.errorReprojectionMatrix = GetReprojectionMatrix(view, errorViewPrevious);
+            GetViewportRect(errorViewPrevious, viewConstants.errorViewOrigin, viewConstants.errorViewSize);
+        }
+
+        return stereoConstants;
+    }
+
+    // ComputeVRSRateSurface over all views of a StereoPlanarView, one rate surface for both eyes
+    void ComputeVRSRateSurfaceStereo()
+    {
+        GpuProfiler::Scope profilerScope(*m_Profiler, m_CommandList, "ShadingRateStereo");
+
+        AdaptiveShadingConstants ASRatePassConstants = GetShadingRateConstants();
+        NASStereoConstants stereoConstants = GetStereoShadingRateConstants();
+        m_CommandList->writeBuffer(m_StereoShadingRatePass.ConstantBuffer, &ASRatePassConstants, sizeof(ASRatePassConstants));
+        m_CommandList->writeBuffer(m_NASStereoConstants, &stereoConstants, sizeof(stereoConstants));
+
+        nvrhi::ComputeState state;
+        state.pipeline = m_StereoShadingRatePass.Pipeline;
+        state.bindings = { m_StereoShadingRatePass.BindingSet };
+        m_CommandList->setComputeState(state);
+
+        m_CommandList->dispatch(m_RenderTargets->m_VRSSurfaceSize.x, m_RenderTargets->m_VRSSurfaceSize.y, 1);
+    }
+
+    // Compute deferred lighting that lights one pixel per coarse pixel of the VRS surface,
+    // an alternative to DeferredLightingPass when NAS is on
+    void InitVRSDeferredLightingPass()
+    {
+        const std::vector<ShaderMacro> defines = GetTileSizeDefines();
+        m_VRSDeferredLightingPass.Shader = m_ShaderFactory->CreateShader("app/VRSDeferredLighting", "main_cs", &defines, nvrhi::ShaderType::Compute);
+        if (!m_VRSDeferredLightingPass.Shader)
+        {
+            log::fatal("Cannot compile VRS deferred lighting shader");
+        }
+
+        nvrhi::BindingLayoutDesc layoutDesc;
+        layoutDesc.visibility = nvrhi::ShaderType::Compute;
+        layoutDesc.bindings = {
+            nvrhi::BindingLayoutItem::VolatileConstantBuffer(0),
+            nvrhi::BindingLayoutItem::Sampler(0),
+            nvrhi::BindingLayoutItem::Texture_UAV(0),
+            nvrhi::BindingLayoutItem::StructuredBuffer_UAV(1),
+            nvrhi::BindingLayoutItem::Texture_SRV(0),
+            nvrhi::BindingLayoutItem::Texture_SRV(1),
+            nvrhi::BindingLayoutItem::Texture_SRV(2),
+            nvrhi::BindingLayoutItem::Texture_SRV(3),
+            nvrhi::BindingLayoutItem::Texture_SRV(4),
+            nvrhi::BindingLayoutItem::Texture_SRV(5),
+            nvrhi::BindingLayoutItem::Texture_SRV(6),
+            nvrhi::BindingLayoutItem::Texture_SRV(7)
+        };
+        m_VRSDeferredLightingPass.BindingLayout = m_PipelineCache->GetBindingLayout(layoutDesc);
+
+        nvrhi::BufferDesc constantBufferDesc;
+        constantBufferDesc.byteSize = sizeof(VRSDeferredLightingConstants);
+        constantBufferDesc.debugName = "VRSDeferredLightingConstants";
+        constantBufferDesc.isConstantBuffer = true;
+        constantBufferDesc.isVolatile = true;
+        constantBufferDesc.maxVersions = engine::c_MaxRenderPassConstantBufferVersions;
+        m_VRSDeferredLightingPass.ConstantBuffer = GetDevice()->createBuffer(constantBufferDesc);
+
+        nvrhi::BufferDesc counterDesc;
+        counterDesc.byteSize = sizeof(uint32_t);
+        counterDesc.structStride = sizeof(uint32_t);
+        counterDesc.canHaveUAVs = true;
+        counterDesc.debugName = "VRSLitPixelCount";
+        counterDesc.initialState = nvrhi::ResourceStates::UnorderedAccess;
+        counterDesc.keepInitialState = true;
+        m_VRSLitPixelCount = GetDevice()->createBuffer(counterDesc);
+
+        nvrhi::SamplerDesc samplerDesc;
+        samplerDesc.setAllAddressModes(nvrhi::SamplerAddressMode::Border);
+        samplerDesc.setBorderColor(nvrhi::Color(1.f));
+        samplerDesc.setReductionType(nvrhi::SamplerReductionType::Comparison);
+        m_ShadowComparisonSampler = GetDevice()->createSampler(samplerDesc);
+
+        // HdrColor has no UAV with MSAA, where DeferredLightingPass is used
+        m_VRSDeferredLightingPass.BindingSet = nullptr;
+        if (!m_RenderTargets->HdrColor->getDesc().isUAV)
+        {
+            return;
+        }
+
+        nvrhi::BindingSetDesc bindingSetDesc;
+        bindingSetDesc.bindings = {
+            nvrhi::BindingSetItem::ConstantBuffer(0, m_VRSDeferredLightingPass.ConstantBuffer),
+            nvrhi::BindingSetItem::Sampler(0, m_ShadowComparisonSampler),
+            nvrhi::BindingSetItem::Texture_UAV(0, m_RenderTargets->HdrColor),
+            nvrhi::BindingSetItem::StructuredBuffer_UAV(1, m_VRSLitPixelCount),
+            nvrhi::BindingSetItem::Texture_SRV(0, m_RenderTargets->Depth),
+            nvrhi::BindingSetItem::Texture_SRV(1, m_RenderTargets->GBufferDiffuse),
+            nvrhi::BindingSetItem::Texture_SRV(2, m_RenderTargets->GBufferSpecular),
+            nvrhi::BindingSetItem::Texture_SRV(3, m_RenderTargets->GBufferNormals),
+            nvrhi::BindingSetItem::Texture_SRV(4, m_RenderTargets->GBufferEmissive),
+            nvrhi::BindingSetItem::Texture_SRV(5, m_RenderTargets->AmbientOcclusion),
+            nvrhi::BindingSetItem::Texture_SRV(6, m_ShadowMap->GetTexture()),
+            nvrhi::BindingSetItem::Texture_SRV(7, m_RenderTargets->m_VRSRateSurface, nvrhi::Format::R8_UINT)
+        };
+        m_VRSDeferredLightingPass.BindingSet = GetDevice()->createBindingSet(bindingSetDesc, m_VRSDeferredLightingPass.BindingLayout);
+
+        nvrhi::ComputePipelineDesc psoDesc = {};
+        psoDesc.CS = m_VRSDeferredLightingPass.Shader;
+        psoDesc.bindingLayouts = { m_VRSDeferredLightingPass.BindingLayout };
+
+        m_VRSDeferredLightingPass.Pipeline = m_PipelineCache->GetComputePipeline(psoDesc);
+    }
+
+    // Only lights with the shadow map bound by InitVRSDeferredLightingPass get shadows, which in this
+    // sample are all of them. Light probes are not supported, DeferredLightingPass handles those.
+    void RenderVRSDeferredLighting(bool enableAmbientOcclusion)
+    {
+        VRSDeferredLightingConstants constants = {};
+        constants.shadowMapTextureSize = float2(m_ShadowMap->GetTextureSize());
+        constants.enableAmbientOcclusion = enableAmbientOcclusion ? 1 : 0;
+        constants.ambientColorTop = float4(m_AmbientTop, 0.f);
+        constants.ambientColorBottom = float4(m_AmbientBottom, 0.f);
+        constants.depthThreshold = m_ui.VRSLightingDepthThreshold;
+        constants.normalThreshold = m_ui.VRSLightingNormalThreshold;
+
+        uint numShadows = 0;
+        for (const auto& light : m_Scene->GetSceneGraph()->GetLights())
+        {
+            // Lights past VRS_DEFERRED_MAX_LIGHTS are ignored
+            if (constants.numLights == VRS_DEFERRED_MAX_LIGHTS)
+                break;
+
+            LightConstants& lightConstants = constants.lights[constants.numLights++];
+            light->FillLightConstants(lightConstants);
+            lightConstants.shadowCascades = int4(-1);
+
+            if (light->shadowMap && light->shadowMap->GetTexture() == m_ShadowMap->GetTexture())
+            {
+                const uint numCascades = std::min(uint(light->shadowMap->GetNumberOfCascades()), 4u);
+                for (uint cascade = 0; cascade < numCascades && numShadows < VRS_DEFERRED_MAX_SHADOWS; cascade++)
+                {
+                    light->shadowMap->GetCascade(cascade)->FillShadowConstants(constants.shadows[numShadows]);
+                    lightConstants.shadowCascades[cascade] = int(numShadows++);
+                }
+                lightConstants.outOfBoundsShadow = light->shadowMap->IsLitOutOfBounds() ? 1.f : 0.f;
+            }
+        }
+
+        const uint32_t zero = 0;
+        m_CommandList->writeBuffer(m_VRSLitPixelCount, &zero, sizeof(zero));
+
+        nvrhi::ComputeState state;
+        state.pipeline = m_VRSDeferredLightingPass.Pipeline;
+        state.bindings = { m_VRSDeferredLightingPass.BindingSet };
+
+        // One dispatch per view, the groups are aligned to the render target
+        for (uint viewIndex = 0; viewIndex < m_View->GetNumChildViews(ViewType::PLANAR); viewIndex++)
+        {
+            const IView* view = m_View->GetChildView(ViewType::PLANAR, viewIndex);
+            view->FillPlanarViewConstants(constants.view);
+
+            uint2 viewOrigin, viewSize;
+            GetViewportRect(view, viewOrigin, viewSize);
+            constants.viewOrigin = int2(int(viewOrigin.x), int(viewOrigin.y));
+            constants.viewSize = int2(int(viewSize.x), int(viewSize.y));
+            m_CommandList->writeBuffer(m_VRSDeferredLightingPass.ConstantBuffer, &constants, sizeof(constants));
+            m_CommandList->setComputeState(state);
+
+            const uint2 firstGroup = viewOrigin / uint(VRS_DEFERRED_GROUP_SIZE);
+            const uint2 lastGroup = (viewOrigin + viewSize - 1u) / uint(VRS_DEFERRED_GROUP_SIZE);
+            m_CommandList->dispatch(lastGroup.x - firstGroup.x + 1, lastGroup.y - firstGroup.y + 1, 1);
+        }
+    }
+
+    // Coarsened rate surface for the passes whose policy selects it, rebuilt when the bias changes
+    void InitCoarsenShadingRatePass()
+    {
+        m_CoarsenShadingRateBias = m_ui.ShadingRateCoarseningBias;
+
+        const std::vector<ShaderMacro> defines = { ShaderMacro("COARSENING_BIAS", std::to_string(m_CoarsenShadingRateBias)) };
+        m_CoarsenShadingRatePass.Shader = m_ShaderFactory->CreateShader("app/CoarsenShadingRate", "main_cs", &defines, nvrhi::ShaderType::Compute);
+        if (!m_CoarsenShadingRatePass.Shader)
+        {
+            log::fatal("Cannot compile VRS rate shader");
+        }
+
+        nvrhi::BindingLayoutDesc layoutDesc;
+        layoutDesc.visibility = nvrhi::ShaderType::Compute;
+        layoutDesc.bindings = {
+            nvrhi::BindingLayoutItem::Texture_UAV(0),
+            nvrhi::BindingLayoutItem::Texture_SRV(0)
+        };
+        m_CoarsenShadingRatePass.BindingLayout = m_PipelineCache->GetBindingLayout(layoutDesc);
+
+        nvrhi::BindingSetDesc bindingSetDesc;
+        bindingSetDesc.bindings = {
+            nvrhi::BindingSetItem::Texture_UAV(0, m_RenderTargets->m_VRSCoarseRateSurface),
+            nvrhi::BindingSetItem::Texture_SRV(0, m_RenderTargets->m_VRSRateSurface, nvrhi::Format::R8_UINT)
+        };
+        m_CoarsenShadingRatePass.BindingSet = GetDevice()->createBindingSet(bindingSetDesc, m_CoarsenShadingRatePass.BindingLayout);
+
+        nvrhi::ComputePipelineDesc psoDesc = {};
+        psoDesc.CS = m_CoarsenShadingRatePass.Shader;
+        psoDesc.bindingLayouts = { m_CoarsenShadingRatePass.BindingLayout };
+
+        m_CoarsenShadingRatePass.Pipeline = m_PipelineCache->GetComputePipeline(psoDesc);
+    }
+
+    bool IsCoarsenedSurfaceUsed() const
+    {
+        for (const ShadingRatePolicy* policy : { &m_ui.OpaqueShadingRatePolicy, &m_ui.SkyShadingRatePolicy, &m_ui.TransparentShadingRatePolicy })
+        {
+            if (policy->enabled && policy->source == ShadingRateSource::Coarsened)
+                return true;
+        }
+        return false;
+    }
+
+    void CoarsenVRSRateSurface()
+    {
+        if (m_ui.ShadingRateCoarseningBias != m_CoarsenShadingRateBias)
+        {
+            InitCoarsenShadingRatePass();
+        }
+
+        GpuProfiler::Scope profilerScope(*m_Profiler, m_CommandList, "Coarsen");
+
+        nvrhi::ComputeState state;
+        state.pipeline = m_CoarsenShadingRatePass.Pipeline;
+        state.bindings = { m_CoarsenShadingRatePass.BindingSet };
+        m_CommandList->setComputeState(state);
+
+        m_CommandList->dispatch((m_RenderTargets->m_VRSSurfaceSize.x + 15) / 16, (m_RenderTargets->m_VRSSurfaceSize.y + 15) / 16, 1);
+    }
+
+    // VRS state of a pass, full rate when NAS is off. The rate surface comes from the framebuffer,
+    // see GetPolicyFramebuffer.
+    void ApplyShadingRatePolicy(const ShadingRatePolicy& policy)
+    {
+        if (m_ui.EnableNAS && policy.enabled && !m_ui.EmulateVRS)
+        {
+            SetVariableRateShadingState(nvrhi::VariableRateShadingState().setEnabled(true).setShadingRate(policy.passRate).setImageCombiner(policy.combiner));
+        }
+        else
+        {
+            SetVariableRateShadingState(nvrhi::VariableRateShadingState().setEnabled(false));
+        }
+    }
+
+    static FramebufferFactory& GetPolicyFramebuffer(const ShadingRatePolicy& policy, FramebufferFactory& framebuffer, FramebufferFactory& coarseFramebuffer)
+    {
+        return (policy.source == ShadingRateSource::Coarsened) ? coarseFramebuffer : framebuffer;
+    }
+
+    // RenderCompositeView at the rates of a pass policy, later passes run at full rate again
+    void RenderCompositeViewWithPolicy(
+        const ShadingRatePolicy& policy,
+        FramebufferFactory& framebuffer,
+        FramebufferFactory& coarseFramebuffer,
+        IDrawStrategy& drawStrategy,
+        IGeometryPass& pass,
+        GeometryPassContext& passContext,
+        const char* passEvent,
+        bool materialEvents)
+    {
+        ApplyShadingRatePolicy(policy);
+
+        RenderCompositeView(m_CommandList,
+            m_View.get(), m_ViewPrevious.get(),
+            GetPolicyFramebuffer(policy, framebuffer, coarseFramebuffer),
+            m_Scene->GetSceneGraph()->GetRootNode(),
+            drawStrategy,
+            pass,
+            passContext,
+            passEvent,
+            materialEvents);
+
+        SetVariableRateShadingState(nvrhi::VariableRateShadingState().setEnabled(false));
+    }
+
+    // Applies to every child view, the rate surface covers all of them
+    void SetVariableRateShadingState(const nvrhi::VariableRateShadingState& state)
+    {
+        if (IsStereo())
+        {
+            std::shared_ptr<StereoPlanarView> stereoView = std::dynamic_pointer_cast<StereoPlanarView, IView>(m_View);
+            stereoView->LeftView.SetVariableRateShadingState(state);
+            stereoView->RightView.SetVariableRateShadingState(state);
+        }
+        else
+        {
+            std::shared_ptr<PlanarView> planarView = std::dynamic_pointer_cast<PlanarView, IView>(m_View);
+            planarView->SetVariableRateShadingState(state);
+        }
+    }
+
+    void SmoothVRSRateSurface()
+    {
+        if (m_ui.ShadingRateSmoothingRadius != m_ShadingRateSmoothRadius || m_ui.SeparableShadingRateSmoothing != m_ShadingRateSmoothSeparable)
+        {
+            InitShadingRateSmoothPass();
+        }
+
+        nvrhi::ComputeState state;
+        state.pipeline = m_ShadingRateSmoothPass.Pipeline;
+        state.bindings = { m_ShadingRateSmoothPass.BindingSet };
+        m_CommandList->setComputeState(state);
+
+        // Dispatch call to smooth the VRS surface
+        m_Profiler->BeginScope(m_CommandList, m_ShadingRateSmoothSeparable ? "SmoothRows" : "Smooth");
+        m_CommandList->dispatch((m_RenderTargets->m_VRSSurfaceSize.x + 15) / 16, (m_RenderTargets->m_VRSSurfaceSize.y + 15) / 16, 1);
+        m_Profiler->EndScope(m_CommandList);
+
+        if (m_ShadingRateSmoothSeparable)
+        {
+            state.pipeline = m_ShadingRateSmoothVerticalPass.Pipeline;
+            state.bindings = { m_ShadingRateSmoothVerticalPass.BindingSet };
+            m_CommandList->setComputeState(state);
+
+            m_Profiler->BeginScope(m_CommandList, "SmoothColumns");
+            m_CommandList->dispatch((m_RenderTargets->m_VRSSurfaceSize.x + 15) / 16, (m_RenderTargets->m_VRSSurfaceSize.y + 15) / 16, 1);
+            m_Profiler->EndScope(m_CommandList);
+        }
+    }
+
+    // ComputeVRSRateSurface for the tiles whose signature changed, all other tiles keep their rate
+    void ComputeVRSRateSurfaceIncremental()
+    {
+        NASChangeDetectionConstants ChangeDetectionConstants = {};
+        ChangeDetectionConstants.shadingRate = GetShadingRateConstants();
+        ChangeDetectionConstants.motionTolerance = m_ui.NASMotionTolerance;
+        ChangeDetectionConstants.errorTolerance = m_ui.NASErrorTolerance;
+
+        // The signatures do not cover the sensitivities, so changing them recomputes every tile
+        const bool sensitivityChanged =
+            m_NASHistoryErrorSensitivity != m_ui.NASErrorSensitivity ||
+            m_NASHistoryMotionSensitivity != m_ui.NASMotionSensitivity;
+        ChangeDetectionConstants.forceDirty = (!m_NASHistoryValid || sensitivityChanged) ? 1 : 0;
+        m_CommandList->writeBuffer(m_NASChangeDetectionPass.ConstantBuffer, &ChangeDetectionConstants, sizeof(ChangeDetectionConstants));
+        m_CommandList->writeBuffer(m_IncrementalShadingRatePass.ConstantBuffer, &ChangeDetectionConstants.shadingRate, sizeof(ChangeDetectionConstants.shadingRate));
+
+        // Empty dirty tile list: zero groups of one by one
+        const uint emptyArgs[3] = { 0, 1, 1 };
+        const uint dirtyTileCount = 0;
+        m_CommandList->writeBuffer(m_NASIncrementalArgs, emptyArgs, sizeof(emptyArgs));
+        m_CommandList->writeBuffer(m_NASDirtyTiles, &dirtyTileCount, sizeof(dirtyTileCount));
+
+        nvrhi::ComputeState state;
+        state.pipeline = m_NASChangeDetectionPass.Pipeline;
+        state.bindings = { m_NASChangeDetectionPass.BindingSet };
+        m_CommandList->setComputeState(state);
+
+        m_Profiler->BeginScope(m_CommandList, "DetectChanges");
+        m_CommandList->dispatch(m_RenderTargets->m_VRSSurfaceSize.x, m_RenderTargets->m_VRSSurfaceSize.y, 1);
+        m_Profiler->EndScope(m_CommandList);
+
+        state.pipeline = m_IncrementalShadingRatePass.Pipeline;
+        state.bindings = { m_IncrementalShadingRatePass.BindingSet };
+        state.indirectParams = m_NASIncrementalArgs;
+        m_CommandList->setComputeState(state);
+
+        m_Profiler->BeginScope(m_CommandList, "ShadingRateIncremental");
+        m_CommandList->dispatchIndirect(0);
+        m_Profiler->EndScope(m_CommandList);
+
+        m_NASHistoryValid = true;
+        m_NASHistoryErrorSensitivity = m_ui.NASErrorSensitivity;
+        m_NASHistoryMotionSensitivity = m_ui.NASMotionSensitivity;
+    }
+
+    // The VRS deferred lighting pass replaces the regular one when NAS is on
+    bool UsesVRSDeferredLighting() const
+    {
+        return m_ui.UseDeferredShading && m_ui.UseVRSDeferredLighting && !m_ui.EnableLightProbe;
+    }
+
+    // The pass that shades the opaque geometry at the NAS rates, as reported by the benchmark
+    const char* GetOpaqueShadingPathName() const
+    {
+        if (!m_ui.UseDeferredShading)
+            return "forward";
+        return UsesVRSDeferredLighting() ? "vrsDeferredLighting" : "deferred";
+    }
+
+    int GetFusedNASSmoothRadius() const
+    {
+        return m_ui.EnableShadingRateSurfaceSmoothing ? m_ui.ShadingRateSmoothingRadius : 0;
+    }
+
+    // NAS data, shading rate and smoothing in one dispatch, without the intermediate NAS data surface
+    void ComputeVRSRateSurfaceFused()
+    {
+        if (m_ui.NASErrorMetric != m_FusedNASErrorMetric || GetFusedNASSmoothRadius() != m_FusedNASSmoothRadius
+            || GetMotionSource() != m_FusedNASMotionSource)
+        {
+            InitFusedNASPass();
+        }
+
+        GpuProfiler::Scope profilerScope(*m_Profiler, m_CommandList, "FusedNAS");
+
+        FusedNASConstants FusedPassConstants = {};
+        FusedPassConstants.shadingRate = GetShadingRateConstants();
+        FusedPassConstants.brightnessSensitivity = m_ui.NASBrightnessSensitivity;
+        m_CommandList->writeBuffer(m_FusedNASPass.ConstantBuffer, &FusedPassConstants, sizeof(FusedPassConstants));
+
+        nvrhi::ComputeState state;
+        state.pipeline = m_FusedNASPass.Pipeline;
+        state.bindings = { m_FusedNASPass.BindingSet };
+        m_CommandList->setComputeState(state);
+
+        m_CommandList->dispatch(
+            (m_RenderTargets->m_VRSSurfaceSize.x + FUSED_NAS_GROUP_TILES - 1) / FUSED_NAS_GROUP_TILES,
+            (m_RenderTargets->m_VRSSurfaceSize.y + FUSED_NAS_GROUP_TILES - 1) / FUSED_NAS_GROUP_TILES, 1);
+    }
+
+    // Only the planar rate pass and the fused pass read the motion vectors, see ComputeVRSRateSurface.
+    // Only the G-buffer fill writes object motion, forward shading and MSAA have camera motion at most,
+    // and only TAA keeps the previous view the motion is relative to.
+    bool UsesNASMotionVectors()
+    {
+        return m_ui.EnableNAS && (m_ui.UseFusedNASKernel || !m_ui.UseIncrementalNAS) && !IsStereo()
+            && m_ui.MotionSource != NASMotionSource::Reprojection
+            && m_ui.UseDeferredShading && m_ui.AntiAliasingMode == AntiAliasingMode::TEMPORAL
+            && m_RenderTargets->GetSampleCount() == 1;
+    }
+
+    // Keeps the motion vectors of this frame, now with the object motion of the G-buffer fill, for
+    // the rate pass of the next frame. Its NAS data is from this frame too, so both lag by a frame.
+    void CopyNASMotionVectors()
+    {
+        m_NASMotionVectorsValid = m_PreviousViewsValid && UsesNASMotionVectors();
+        if (!m_NASMotionVectorsValid)
+            return;
+
+        GpuProfiler::Scope profilerScope(*m_Profiler, m_CommandList, "CopyMotionVectors");
+        m_CommandList->copyTexture(m_RenderTargets->m_NASMotionVectors, nvrhi::TextureSlice(), m_RenderTargets->MotionVectors, nvrhi::TextureSlice());
+    }
+
+    // Rate counts of the VRS surface, see RateHistogram. The NAS error and motion histograms are
+    // skipped when their inputs are not from this frame.
+    void RecordRateHistogram()
+    {
+        GpuProfiler::Scope profilerScope(*m_Profiler, m_CommandList, "RateHistogram");
+
+        // The fused pass does not write the NAS data, and shared stereo error only computes it for the first view
+        const bool nasDataValid = !(m_ui.UseFusedNASKernel && !IsStereo()) && !(IsStereo() && m_ui.ShareStereoNASError);
+        // Motion vectors are only rendered with a valid previous view, and not resolved for MSAA
+        const bool motionValid = m_PreviousViewsValid && m_RenderTargets->GetSampleCount() == 1;
+
+        m_RateHistogram->Record(m_CommandList,
+            m_RenderTargets->m_VRSRateSurface,
+            nasDataValid ? m_RenderTargets->m_NASDataSurface.Get() : nullptr,
+            motionValid ? m_RenderTargets->MotionVectors.Get() : nullptr,
+            m_RenderTargets->GetRenderSize().x, m_RenderTargets->GetRenderSize().y,
+            m_RenderTargets->m_VRSTileSize,
+            m_ui.NASErrorSensitivity,
+            GetFrameIndex());
+    }
+
+    void LogRateStatistics()
+    {
+        const RateHistogram::Result& result = m_RateHistogram->GetResult();
+        if (!m_ui.LogRateStatistics || result.frameIndex - m_RateStatisticsLogFrame < c_RateStatisticsLogInterval)
+            return;
+
+        m_RateStatisticsLogFrame = result.frameIndex;
+        log::info("Frame %u: %.1f%% of pixels coarse-shaded, %.1f%% of invocations saved (%llu of %llu)",
+            result.frameIndex,
+            result.rates.GetCoarseFraction() * 100.0,
+            result.rates.GetSavedFraction() * 100.0,
+            (unsigned long long)result.rates.GetInvocationsSaved(),
+            (unsigned long long)result.rates.pixels);
+    }
+
+    // Applies the configuration and camera pose of the benchmark script to this frame
+    void BeginBenchmarkFrame(bool profilerResolved)
+    {
+        GpuProfiler::ScopeStats frameStats;
+        if (profilerResolved && m_Profiler->GetStats("Frame", frameStats) && frameStats.current)
+        {
+            m_Benchmark->RecordGpuTime(m_Profiler->GetResolvedFrameIndex(), frameStats.lastMs);
+        }
+
+        if (!m_Benchmark->IsStarted())
+        {
+            // The sweep starts at the camera the scene was loaded with
+            auto perspectiveCamera = std::dynamic_pointer_cast<PerspectiveCamera>(m_ui.ActiveSceneCamera);
+            if (perspectiveCamera)
+                m_CameraVerticalFov = dm::degrees(perspectiveCamera->verticalFov);
+
+            CopyActiveCameraToFirstPerson();
+            m_ui.ActiveSceneCamera.reset();
+            m_ui.UseThirdPersonCamera = false;
+
+            m_Benchmark->Begin(m_FirstPersonCamera.GetPosition(), m_FirstPersonCamera.GetDir(), GetFrameIndex());
+        }
+
+        const Benchmark::Configuration& configuration = m_Benchmark->GetConfiguration();
+        m_ui.EnableNAS = configuration.enableNAS;
+        if (configuration.enableNAS)
+            m_ui.NASErrorSensitivity = configuration.errorSensitivity;
+        m_ui.EnableRateStatistics = true;
+        m_ui.EnableShadingRateVis = false;
+
+        if (!m_Benchmark->GetSettings().cameraPathFileName.empty())
+        {
+            ApplyCameraPathFrame(m_CameraPath.GetFrame(std::min(m_Benchmark->GetSweepFrame(), m_CameraPath.GetFrameCount() - 1)));
+        }
+        else
+        {
+            float3 position, direction;
+            m_Benchmark->GetCameraPose(position, direction);
+            m_FirstPersonCamera.LookAt(position, position + direction);
+        }
+    }
+
+    // Feeds the opaque pass time of the last resolved frame to the budget controller, which sets
+    // the error sensitivity. The benchmark sets its own sensitivities, so it turns the controller off.
+    void UpdateNASBudget(bool profilerResolved)
+    {
+        if (!m_ui.EnableNAS || !m_ui.EnableNASBudget || m_Benchmark)
+        {
+            m_NASBudgetActive = false;
+            return;
+        }
+
+        // Emulated VRS has no pass rate to floor
+        nas::BudgetControllerSettings settings = m_ui.NASBudget;
+        settings.enableRateFloor = settings.enableRateFloor && !m_ui.EmulateVRS;
+        m_NASBudgetController.SetSettings(settings);
+
+        if (!m_NASBudgetActive)
+        {
+            m_NASBudgetController.Reset(m_ui.NASErrorSensitivity);
+            m_NASBudgetActive = true;
+        }
+
+        GpuProfiler::ScopeStats opaqueStats;
+        if (profilerResolved && m_Profiler->GetStats("Frame/Opaque", opaqueStats) && opaqueStats.current)
+            m_NASBudgetController.Update(opaqueStats.lastMs);
+
+        m_ui.NASErrorSensitivity = m_NASBudgetController.GetErrorSensitivity();
+    }
+
+    // The opaque policy under the rate floor of the budget controller: the floor becomes the pass
+    // rate and the Max combiner keeps the coarser of it and the surface rate. Only a policy that
+    // shades at the surface rate is floored, other combiners are left as configured.
+    ShadingRatePolicy GetOpaqueShadingRatePolicy() const
+    {
+        ShadingRatePolicy policy = m_ui.OpaqueShadingRatePolicy;
+        if (!m_NASBudgetActive || policy.combiner != nvrhi::ShadingRateCombiner::Override)
+            return policy;
+
+        switch (m_NASBudgetController.GetRateFloor())
+        {
+        case nas::ShadingRate_2x1: policy.passRate = nvrhi::VariableShadingRate::e2x1; break;
+        case nas::ShadingRate_2x2: policy.passRate = nvrhi::VariableShadingRate::e2x2; break;
+        case nas::ShadingRate_2x4: policy.passRate = nvrhi::VariableShadingRate::e2x4; break;
+        default: return policy;
+        }
+        policy.combiner = nvrhi::ShadingRateCombiner::Max;
+        return policy;
+    }
+
+    // Writes the results and closes the window once the script is done
+    void EndBenchmarkFrame(float cpuMs)
+    {
+        m_Benchmark->EndFrame(cpuMs, m_BenchmarkFrameTime * 1e3f);
+        if (!m_Benchmark->IsFinished())
+            return;
+
+        int width, height;
+        GetDeviceManager()->GetWindowDimensions(width, height);
+        m_Benchmark->WriteJson(m_Benchmark->GetSettings().outputFileName, GetCurrentSceneName(), uint32_t(width), uint32_t(height),
+            m_ui.EmulateVRS, GetOpaqueShadingPathName(), m_ui.EnableLightProbe);
+        m_Benchmark.reset();
+
+        glfwSetWindowShouldClose(GetDeviceManager()->GetWindow(), GLFW_TRUE);
+    }
+
+    void UpdateNASCapture()
+    {
+        if (m_ui.EnableNASCapture != m_NasCapture->IsActive())
+        {
+            if (!m_ui.EnableNASCapture)
+                m_NasCapture->End();
+            else if (!m_NasCapture->Begin(m_ui.NASCaptureFileName))
+                m_ui.EnableNASCapture = false;
+        }
+
+        if (!m_NasCapture->IsActive() || !m_PreviousViewsValid || IsStereo())
+            return;
+
+        ComputeNASDataConstants NASDataPassConstants = {};
+        NASDataPassConstants.brightnessSensitivity = m_ui.NASBrightnessSensitivity;
+
+        m_NasCapture->CaptureFrame(m_CommandList, m_RenderTargets->LdrColor, m_RenderTargets->Depth,
+            m_RenderTargets->GetRenderSize().x, m_RenderTargets->GetRenderSize().y,
+            NASDataPassConstants, GetShadingRateConstants());
+    }
+
+    // special pass to visualize/debug the shading rate surface
+    void InitVRSRateVisPass()
+    {
+        m_VRSRateVisPass.VS = m_ShaderFactory->CreateShader("app/ShadingRateVis", "main_vs", nullptr, nvrhi::ShaderType::Vertex);
+        const std::vector<ShaderMacro> defines = GetTileSizeDefines();
+        m_VRSRateVisPass.PS = m_ShaderFactory->CreateShader("app/ShadingRateVis", "main_ps", &defines, nvrhi::ShaderType::Pixel);
+
+        nvrhi::IFramebuffer* framebuffer = GetDeviceManager()->GetCurrentFramebuffer();
+        m_VRSRateVisPass.Framebuffer = framebuffer;
+
+        nvrhi::BindingLayoutDesc layoutDesc;
+
+        layoutDesc.visibility = nvrhi::ShaderType::Pixel;
+        layoutDesc.bindings = {
+            nvrhi::BindingLayoutItem::VolatileConstantBuffer(0),
             nvrhi::BindingLayoutItem::Texture_SRV(0),
             nvrhi::BindingLayoutItem::Texture_SRV(1)
         };
 
-        m_VRSRateVisPass.BindingLayout = GetDevice()->createBindingLayout(layoutDesc);
+        m_VRSRateVisPass.BindingLayout = m_PipelineCache->GetBindingLayout(layoutDesc);
 
         nvrhi::BindingSetDesc bindingDesc;
 
         bindingDesc.bindings = {
+            nvrhi::BindingSetItem::ConstantBuffer(0, m_NASSurfaceConstants),
             nvrhi::BindingSetItem::Texture_SRV(0, m_RenderTargets->m_VRSRateSurface, nvrhi::Format::R8_UINT),
             nvrhi::BindingSetItem::Texture_SRV(1, m_RenderTargets->MotionVectors, nvrhi::Format::RG16_FLOAT)
         };
@@ -1189,11 +2611,25 @@ public:
 
     virtual void RenderScene(nvrhi::IFramebuffer* framebuffer) override
     {
-        GetDevice()->resetTimerQuery(m_tqDepthPrePass);
-        GetDevice()->resetTimerQuery(m_tqForwardOpaque);
-        GetDevice()->resetTimerQuery(m_tqForwardSky);
-        GetDevice()->resetTimerQuery(m_tqForwardTransparent);
-        GetDevice()->resetTimerQuery(m_tqMotionVector);
+        const auto cpuStartTime = std::chrono::high_resolution_clock::now();
+
+        const uint32_t resolvedFrameCount = m_Profiler->GetResolvedFrameCount();
+        m_Profiler->BeginFrame(GetFrameIndex());
+
+        if (m_RateHistogram->Update())
+        {
+            LogRateStatistics();
+
+            if (m_Benchmark)
+                m_Benchmark->RecordRates(m_RateHistogram->GetResult());
+        }
+
+        if (m_Benchmark)
+        {
+            BeginBenchmarkFrame(m_Profiler->GetResolvedFrameCount() != resolvedFrameCount);
+        }
+
+        UpdateNASBudget(m_Profiler->GetResolvedFrameCount() != resolvedFrameCount);
 
         int windowWidth, windowHeight;
         GetDeviceManager()->GetWindowDimensions(windowWidth, windowHeight);
@@ -1208,6 +2644,13 @@ public:
             uint width = windowWidth;
             uint height = windowHeight;
 
+            // The render targets are allocated for the window and rendered to at the scaled size,
+            // so changing the scale or shrinking the window does not recreate them
+            float resolutionScale = std::clamp(m_ui.ResolutionScale, 0.25f, 1.f);
+            uint2 renderSize = uint2(
+                std::max(uint(float(width) * resolutionScale + 0.5f), 1u),
+                std::max(uint(float(height) * resolutionScale + 0.5f), 1u));
+
             uint sampleCount = 1;
             switch (m_ui.AntiAliasingMode)
             {
@@ -1217,41 +2660,69 @@ public:
             default:;
             }
 
-            bool needNewPasses = false;
+            PassInputChanges passChanges;
+            passChanges.shaders = !m_ForwardPass;
 
-            if (!m_RenderTargets || m_RenderTargets->IsUpdateRequired(uint2(width, height), sampleCount))
+            if (!m_RenderTargets || !m_RenderTargets->CanRender(uint2(width, height), sampleCount))
             {
                 m_RenderTargets = nullptr;
                 m_BindingCache.Clear();
                 m_RenderTargets = std::make_unique<RenderTargets>();
+                m_RenderTargets->m_VRSEmulated = m_ui.EmulateVRS;
                 m_RenderTargets->Init(GetDevice(), uint2(width, height), sampleCount, true, true);
                 
-                needNewPasses = true;
+                passChanges.renderTargets = true;
+            }
+
+            // The passes sized from the view, such as the bloom chain, are recreated for the new size,
+            // which also drops the TAA and incremental NAS history
+            if (any(renderSize != m_RenderTargets->GetRenderSize()))
+            {
+                m_RenderTargets->SetRenderSize(renderSize);
+                passChanges.renderSize = true;
             }
 
             if (SetupView())
             {
-                needNewPasses = true;
+                passChanges.viewTopology = true;
             }
 
             if (m_ui.ShaderReloadRequested)
             {
                 m_ShaderFactory->ClearCache();
-                needNewPasses = true;
+                m_PipelineCache->Clear();
+                passChanges.shaders = true;
             }
 
-            if(needNewPasses)
+            if (passChanges.shaders || passChanges.renderTargets || passChanges.renderSize || passChanges.viewTopology)
             {
-                CreateRenderPasses(exposureResetRequired);
+                CreateRenderPasses(exposureResetRequired, passChanges);
             }
 
             m_ui.ShaderReloadRequested = false;
         }
 
+        const bool asyncNASData = UsesAsyncNASData();
+        if (asyncNASData)
+        {
+            RecordAsyncNASData();
+        }
+
         m_CommandList->open();
 
+        // Every pass below runs in a profiler scope, see GpuProfiler
+        m_Profiler->BeginScope(m_CommandList, "Frame");
+
         m_Scene->RefreshBuffers(m_CommandList, GetFrameIndex());
 
+        const uint2 renderSize = m_RenderTargets->GetRenderSize();
+        const float2 windowToRenderScale = float2(renderSize) / float2(float(windowWidth), float(windowHeight));
+
+        NASSurfaceConstants surfaceConstants = {};
+        surfaceConstants.tileCount = m_RenderTargets->m_VRSSurfaceSize;
+        surfaceConstants.windowToRenderScale = windowToRenderScale;
+        m_CommandList->writeBuffer(m_NASSurfaceConstants, &surfaceConstants, sizeof(surfaceConstants));
+
         nvrhi::ITexture* framebufferTexture = framebuffer->getDesc().colorAttachments[0].texture;
         m_CommandList->clearTextureFloat(framebufferTexture, nvrhi::AllSubresources, nvrhi::Color(0.f));
 
@@ -1270,6 +2741,8 @@ public:
             float zRange = length(sceneBounds.diagonal()) * 0.5f;
             m_ShadowMap->SetupForPlanarViewStable(*m_SunLight, projectionFrustum, viewMatrixInv, maxShadowDistance, zRange, zRange, m_ui.CsmExponent);
 
+            m_Profiler->BeginScope(m_CommandList, "Shadows");
+
             m_ShadowMap->Clear(m_CommandList);
 
             DepthPass::Context context;
@@ -1283,6 +2756,8 @@ public:
                 context,
                 "ShadowMap",
                 m_ui.EnableMaterialEvents);
+
+            m_Profiler->EndScope(m_CommandList);
         }
         else
         {
@@ -1307,7 +2782,7 @@ public:
 
         DepthPass::Context depthPrePassContext;
 
-        m_CommandList->beginTimerQuery(m_tqDepthPrePass);
+        m_Profiler->BeginScope(m_CommandList, "DepthPrePass");
         RenderCompositeView(m_CommandList,
             m_View.get(), m_ViewPrevious.get(),
             *m_RenderTargets->DepthPrePassFramebuffer,
@@ -1317,26 +2792,87 @@ public:
             depthPrePassContext,
             "DepthOnly",
             m_ui.EnableMaterialEvents);
-        m_CommandList->endTimerQuery(m_tqDepthPrePass);
+        m_Profiler->EndScope(m_CommandList);
 
-        m_CommandList->beginTimerQuery(m_tqMotionVector);
+        // Camera motion of every pixel, the G-buffer fill adds the object motion later in the frame
+        m_Profiler->BeginScope(m_CommandList, "MotionVectors");
         if (m_PreviousViewsValid)
         {
             m_TemporalAntiAliasingPass->RenderMotionVectors(m_CommandList, *m_View, *m_ViewPrevious);
         }
-        m_CommandList->endTimerQuery(m_tqMotionVector);
+        m_Profiler->EndScope(m_CommandList);
+
+        if (asyncNASData)
+        {
+            SplitFrameForAsyncNASData();
+        }
 
-        // After motion vectors are ready, we can compute the VRS shading rate surface
+        // After motion vectors are ready, we can compute the VRS shading rate surface.
+        // The fused and incremental passes are single-view, stereo uses the separate passes.
         if (m_ui.EnableNAS)
         {
-            ComputeNASData();
-            ComputeVRSRateSurface();
+            m_Profiler->BeginScope(m_CommandList, "NAS");
+        }
+
+        if (m_ui.EnableNAS && m_ui.UseFusedNASKernel && !IsStereo())
+        {
+            ComputeVRSRateSurfaceFused();
+        }
+        else if (m_ui.EnableNAS)
+        {
+            if (!asyncNASData)
+            {
+                ComputeNASData(m_CommandList);
+            }
+            if (IsStereo())
+            {
+                ComputeVRSRateSurfaceStereo();
+            }
+            else if (m_ui.UseIncrementalNAS)
+            {
+                ComputeVRSRateSurfaceIncremental();
+            }
+            else
+            {
+                ComputeVRSRateSurface();
+            }
             if (m_ui.EnableShadingRateSurfaceSmoothing)
             {
                 SmoothVRSRateSurface();
             }
+            else
+            {
+                GpuProfiler::Scope profilerScope(*m_Profiler, m_CommandList, "CopyRates");
+                m_CommandList->copyTexture(m_RenderTargets->m_VRSRateSurface, nvrhi::TextureSlice(), m_RenderTargets->m_NASUnsmoothedRates, nvrhi::TextureSlice());
+            }
+        }
+
+        if (m_ui.EnableNAS && IsCoarsenedSurfaceUsed())
+        {
+            CoarsenVRSRateSurface();
+        }
+
+        if (m_ui.EnableNAS && m_ui.EnableRateStatistics)
+        {
+            RecordRateHistogram();
+        }
+
+        if (m_ui.EnableNAS)
+        {
+            m_Profiler->EndScope(m_CommandList);
+        }
+
+        // The tile signatures are only kept up to date while the incremental passes run
+        if (!m_ui.EnableNAS || m_ui.UseFusedNASKernel || !m_ui.UseIncrementalNAS || IsStereo())
+        {
+            m_NASHistoryValid = false;
         }
 
+        // LdrColor still holds the previous frame here, which is what the NAS passes consume
+        m_Profiler->BeginScope(m_CommandList, "NASCapture");
+        UpdateNASCapture();
+        m_Profiler->EndScope(m_CommandList);
+
         if (exposureResetRequired)
             m_ToneMappingPass->ResetExposure(m_CommandList, 0.5f);
 
@@ -1347,38 +2883,28 @@ public:
             m_ForwardPass->PrepareLights(forwardContext, m_CommandList, m_Scene->GetSceneGraph()->GetLights(), m_AmbientTop, m_AmbientBottom, lightProbes);
         }
 
-        // Enable the VRS rate surface, all future draw calls will be affected by the VRS rates
-        if (!IsStereo())
-        {
-            std::shared_ptr<PlanarView> planarView = std::dynamic_pointer_cast<PlanarView, IView>(m_View);
-            if (m_ui.EnableNAS)
-            {
-                planarView->SetVariableRateShadingState(nvrhi::VariableRateShadingState().setEnabled(true).setShadingRate(nvrhi::VariableShadingRate::e1x1).setImageCombiner(nvrhi::ShadingRateCombiner::Override));
-            }
-            else
-            {
-                planarView->SetVariableRateShadingState(nvrhi::VariableRateShadingState().setEnabled(false));
-            }
-        }
-        
-        m_CommandList->beginTimerQuery(m_tqForwardOpaque);
+        // The opaque, sky and transparent passes each shade at the rates of their policy
+        const ShadingRatePolicy opaqueShadingRatePolicy = GetOpaqueShadingRatePolicy();
+        m_Profiler->BeginScope(m_CommandList, "Opaque");
         if (m_ui.UseDeferredShading)
         {
             GBufferFillPass::Context gbufferContext;
 
-            RenderCompositeView(m_CommandList,
-                m_View.get(), m_ViewPrevious.get(),
+            m_Profiler->BeginScope(m_CommandList, "GBufferFill");
+            RenderCompositeViewWithPolicy(opaqueShadingRatePolicy,
                 *m_RenderTargets->GBufferFramebuffer,
-                m_Scene->GetSceneGraph()->GetRootNode(),
+                *m_RenderTargets->GBufferCoarseFramebuffer,
                 *m_OpaqueDrawStrategy,
                 *m_GBufferPass,
                 gbufferContext,
                 "GBufferFill",
                 m_ui.EnableMaterialEvents);
+            m_Profiler->EndScope(m_CommandList);
 
             nvrhi::ITexture* ambientOcclusionTarget = nullptr;
             if (m_ui.EnableSsao && m_SsaoPass)
             {
+                GpuProfiler::Scope profilerScope(*m_Profiler, m_CommandList, "SSAO");
                 m_SsaoPass->Render(m_CommandList, m_ui.SsaoParameters, *m_View);
                 ambientOcclusionTarget = m_RenderTargets->AmbientOcclusion;
             }
@@ -1392,29 +2918,33 @@ public:
             deferredInputs.lightProbes = m_ui.EnableLightProbe ? &m_LightProbes : nullptr;
             deferredInputs.output = m_RenderTargets->HdrColor;
 
-            m_DeferredLightingPass->Render(m_CommandList, *m_View, deferredInputs);
+            // The coarse pixels of the G-buffer fill are lit once, unless light probes need the full pass
+            m_Profiler->BeginScope(m_CommandList, "DeferredLighting");
+            if (m_ui.EnableNAS && UsesVRSDeferredLighting() && m_VRSDeferredLightingPass.BindingSet)
+            {
+                RenderVRSDeferredLighting(deferredInputs.ambientOcclusion != nullptr);
+                m_RateHistogram->RecordLitPixels(m_CommandList, m_VRSLitPixelCount);
+            }
+            else
+            {
+                m_DeferredLightingPass->Render(m_CommandList, *m_View, deferredInputs);
+            }
+            m_Profiler->EndScope(m_CommandList);
         }
         else
         {
-            RenderCompositeView(m_CommandList,
-                m_View.get(), m_ViewPrevious.get(),
+            RenderCompositeViewWithPolicy(opaqueShadingRatePolicy,
                 *m_RenderTargets->ForwardFramebuffer,
-                m_Scene->GetSceneGraph()->GetRootNode(),
+                *m_RenderTargets->ForwardCoarseFramebuffer,
                 *m_OpaqueDrawStrategy,
                 *m_ForwardPass,
                 forwardContext,
                 "ForwardOpaque",
                 m_ui.EnableMaterialEvents);
         }
-        m_CommandList->endTimerQuery(m_tqForwardOpaque);
+        m_Profiler->EndScope(m_CommandList);
 
-        // Disable VRS rate surface, future draw calls will run at full rate.  For NAS, we want VRS to affect main forward rendering pass only.
-        if (m_ui.EnableNAS && !IsStereo())
-        {
-            //UnbindVRSRateSurface();
-            std::shared_ptr<PlanarView> planarView = std::dynamic_pointer_cast<PlanarView, IView>(m_View);
-            planarView->SetVariableRateShadingState(nvrhi::VariableRateShadingState().setEnabled(false));
-        }
+        CopyNASMotionVectors();
 
         if (m_Pick)
         {
@@ -1443,44 +2973,52 @@ public:
                     "MaterialID - Translucent");
             }
 
-            m_PixelReadbackPass->Capture(m_CommandList, m_PickPosition);
+            m_PixelReadbackPass->Capture(m_CommandList, uint2(float2(m_PickPosition) * windowToRenderScale));
+        }
+
+        if (m_ui.SkyShadingRatePolicy.source != m_SkyPassSource)
+        {
+            CreateSkyPass();
         }
 
-        m_CommandList->beginTimerQuery(m_tqForwardSky);
+        m_Profiler->BeginScope(m_CommandList, "Sky");
+        ApplyShadingRatePolicy(m_ui.SkyShadingRatePolicy);
         if (m_EnvironmentMapPass && !m_ui.EnableProceduralSky)
             m_EnvironmentMapPass->Render(m_CommandList, *m_View);
         else
             m_SkyPass->Render(m_CommandList, *m_View, *m_SunLight, m_ui.SkyParams);
-        m_CommandList->endTimerQuery(m_tqForwardSky);
+        SetVariableRateShadingState(nvrhi::VariableRateShadingState().setEnabled(false));
+        m_Profiler->EndScope(m_CommandList);
 
+        m_Profiler->BeginScope(m_CommandList, "Transparent");
         if (m_ui.EnableTranslucency)
         {
-            RenderCompositeView(m_CommandList,
-                m_View.get(), m_ViewPrevious.get(),
+            RenderCompositeViewWithPolicy(m_ui.TransparentShadingRatePolicy,
                 *m_RenderTargets->ForwardFramebuffer,
-                m_Scene->GetSceneGraph()->GetRootNode(),
+                *m_RenderTargets->ForwardCoarseFramebuffer,
                 *m_TransparentDrawStrategy,
                 *m_ForwardPass,
                 forwardContext,
                 "ForwardTransparent",
                 m_ui.EnableMaterialEvents);
         }
+        m_Profiler->EndScope(m_CommandList);
 
         nvrhi::ITexture* finalHdrColor = m_RenderTargets->HdrColor;
 
         if (m_ui.AntiAliasingMode == AntiAliasingMode::TEMPORAL)
         {
-            if (m_PreviousViewsValid)
-            {
-                m_TemporalAntiAliasingPass->RenderMotionVectors(m_CommandList, *m_View, *m_ViewPrevious);
-            }
-
+            // The motion vectors of the camera were rendered before NAS, and the G-buffer fill has
+            // since written those of the objects it marked in the stencil
+            m_Profiler->BeginScope(m_CommandList, "TAA");
             m_TemporalAntiAliasingPass->TemporalResolve(m_CommandList, m_ui.TemporalAntiAliasingParams, m_PreviousViewsValid, *m_View, m_PreviousViewsValid ? *m_ViewPrevious : *m_View);
+            m_Profiler->EndScope(m_CommandList);
 
             finalHdrColor = m_RenderTargets->ResolvedColor;
 
             if (m_ui.EnableBloom)
             {
+                GpuProfiler::Scope profilerScope(*m_Profiler, m_CommandList, "Bloom");
                 m_BloomPass->Render(m_CommandList, m_RenderTargets->ResolvedFramebuffer, *m_View, m_RenderTargets->ResolvedColor, m_ui.BloomSigma, m_ui.BloomAlpha);
             }
             m_PreviousViewsValid = true;
@@ -1491,6 +3029,7 @@ public:
 
             if (m_RenderTargets->GetSampleCount() > 1)
             {
+                GpuProfiler::Scope profilerScope(*m_Profiler, m_CommandList, "MSAAResolve");
                 m_CommandList->resolveTexture(m_RenderTargets->ResolvedColor, nvrhi::AllSubresources, m_RenderTargets->HdrColor, nvrhi::AllSubresources);
                 finalHdrColor = m_RenderTargets->ResolvedColor;
                 finalHdrFramebuffer = m_RenderTargets->ResolvedFramebuffer;
@@ -1498,6 +3037,7 @@ public:
 
             if (m_ui.EnableBloom)
             {
+                GpuProfiler::Scope profilerScope(*m_Profiler, m_CommandList, "Bloom");
                 m_BloomPass->Render(m_CommandList, finalHdrFramebuffer, *m_View, finalHdrColor, m_ui.BloomSigma, m_ui.BloomAlpha);
             }
 
@@ -1510,12 +3050,27 @@ public:
             toneMappingParams.eyeAdaptationSpeedUp = 0.f;
             toneMappingParams.eyeAdaptationSpeedDown = 0.f;
         }
+        m_Profiler->BeginScope(m_CommandList, "ToneMapping");
         m_ToneMappingPass->SimpleRender(m_CommandList, toneMappingParams, *m_View, finalHdrColor);
+        m_Profiler->EndScope(m_CommandList);
+
+        // Scales the render size up to the window
+        m_Profiler->BeginScope(m_CommandList, "Blit");
+        {
+            const float2 sourceExtent = float2(renderSize) / float2(m_RenderTargets->GetSize());
 
-        m_CommonPasses->BlitTexture(m_CommandList, framebuffer, m_RenderTargets->LdrColor, &m_BindingCache);
+            engine::BlitParameters blitParams;
+            blitParams.targetFramebuffer = framebuffer;
+            blitParams.targetViewport = windowViewport;
+            blitParams.sourceTexture = m_RenderTargets->LdrColor;
+            blitParams.sourceBox = box2(float2(0.f), sourceExtent);
+            m_CommonPasses->BlitTexture(m_CommandList, blitParams, &m_BindingCache);
+        }
+        m_Profiler->EndScope(m_CommandList);
 
         if (m_ui.EnableNAS && m_ui.EnableShadingRateVis)
         {
+            GpuProfiler::Scope profilerScope(*m_Profiler, m_CommandList, "RateVisualization");
             RenderVRSRateVisualization(framebuffer);
         }
 
@@ -1539,8 +3094,16 @@ public:
             }
         }
 
+        m_Profiler->EndScope(m_CommandList);
+
         m_CommandList->close();
-        GetDevice()->executeCommandList(m_CommandList);
+        SubmitFrame(asyncNASData);
+        m_RateHistogram->Submit();
+
+        if (m_Benchmark)
+        {
+            EndBenchmarkFrame(std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - cpuStartTime).count());
+        }
 
         if (!m_ui.ScreenshotFileName.empty())
         {
@@ -1601,6 +3164,26 @@ public:
         return m_LightProbes;
     }
 
+    const NasCapture& GetNasCapture() const
+    {
+        return *m_NasCapture;
+    }
+
+    const CameraPathRecorder& GetCameraPathRecorder() const
+    {
+        return m_CameraPathRecorder;
+    }
+
+    const RateHistogram& GetRateHistogram() const
+    {
+        return *m_RateHistogram;
+    }
+
+    GpuProfiler& GetProfiler()
+    {
+        return *m_Profiler;
+    }
+
     void CreateLightProbes(uint32_t numProbes)
     {
         nvrhi::DeviceHandle device = GetDeviceManager()->GetDevice();
@@ -1809,6 +3392,218 @@ public:
     }
 
 protected:
+    // Source, combiner and pass rate of one pass, see ShadingRatePolicy
+    static void ShadingRatePolicyUI(const char* passName, ShadingRatePolicy& policy)
+    {
+        static const nvrhi::ShadingRateCombiner combiners[] = {
+            nvrhi::ShadingRateCombiner::Passthrough,
+            nvrhi::ShadingRateCombiner::Override,
+            nvrhi::ShadingRateCombiner::Min,
+            nvrhi::ShadingRateCombiner::Max,
+            nvrhi::ShadingRateCombiner::ApplyRelative
+        };
+        static const char* combinerNames = "Pass Rate\0Surface\0Min\0Max\0Relative\0";
+        static const nvrhi::VariableShadingRate passRates[] = {
+            nvrhi::VariableShadingRate::e1x1,
+            nvrhi::VariableShadingRate::e1x2,
+            nvrhi::VariableShadingRate::e2x1,
+            nvrhi::VariableShadingRate::e2x2,
+            nvrhi::VariableShadingRate::e2x4,
+            nvrhi::VariableShadingRate::e4x2
+        };
+        static const char* passRateNames = "1x1\0" "1x2\0" "2x1\0" "2x2\0" "2x4\0" "4x2\0";
+
+        ImGui::PushID(passName);
+        ImGui::Checkbox(passName, &policy.enabled);
+        if (policy.enabled)
+        {
+            ImGui::Indent();
+
+            int source = int(policy.source);
+            ImGui::Combo("Rate Surface", &source, "NAS\0Coarsened\0");
+            policy.source = ShadingRateSource(source);
+
+            int combiner = int(std::find(std::begin(combiners), std::end(combiners), policy.combiner) - std::begin(combiners));
+            ImGui::Combo("Combiner", &combiner, combinerNames);
+            policy.combiner = combiners[combiner % std::size(combiners)];
+
+            int passRate = int(std::find(std::begin(passRates), std::end(passRates), policy.passRate) - std::begin(passRates));
+            ImGui::Combo("Pass Rate", &passRate, passRateNames);
+            policy.passRate = passRates[passRate % std::size(passRates)];
+
+            ImGui::Unindent();
+        }
+        ImGui::PopID();
+    }
+
+    // The NAS data pass on the compute queue against the graphics queue. The graphics queue only
+    // waits for the part of the async pass that did not overlap its own work before the rate pass.
+    void AsyncNASDataUI()
+    {
+        if (!m_app->m_NASCommandList)
+        {
+            ImGui::TextDisabled("(no compute queue)");
+            return;
+        }
+
+        const GpuProfiler& profiler = m_app->GetProfiler();
+        GpuProfiler::ScopeStats asyncStats, waitStats, serialStats;
+        if (m_ui.UseAsyncNASData && profiler.GetStats("AsyncCompute/NASData", asyncStats) && asyncStats.current
+            && profiler.GetStats("Frame/NASWait", waitStats) && waitStats.current && asyncStats.avgMs > 0.f)
+        {
+            const float hiddenMs = std::max(asyncStats.avgMs - waitStats.avgMs, 0.f);
+            ImGui::Text("Compute %.3f ms, graphics waited %.3f ms (%.0f%% overlapped)",
+                asyncStats.avgMs, waitStats.avgMs, hiddenMs / asyncStats.avgMs * 100.f);
+        }
+        if (profiler.GetStats("Frame/NAS/NASData", serialStats) && serialStats.sampleCount)
+        {
+            ImGui::Text("Graphics queue NAS data %.3f ms", serialStats.avgMs);
+        }
+    }
+
+    // GPU time of the passes with a policy, kept for NAS on and off so the fill cost can be compared
+    void PolicyPassCostUI()
+    {
+        static const char* passNames[FeatureDemo::PolicyPassCount] = { "Opaque", "Sky", "Transparent" };
+
+        // The profiler resolves a few frames late, a sample may belong to the other NAS setting
+        // for those frames after a toggle
+        float* passTimes = m_app->m_PolicyPassTimeMs[m_ui.EnableNAS ? 1 : 0];
+        for (int pass = 0; pass < FeatureDemo::PolicyPassCount; pass++)
+        {
+            GpuProfiler::ScopeStats stats;
+            if (!m_app->GetProfiler().GetStats(std::string("Frame/") + passNames[pass], stats) || !stats.current)
+                continue;
+
+            const float timeMs = stats.lastMs;
+            passTimes[pass] = (passTimes[pass] == 0.f) ? timeMs : passTimes[pass] * 0.95f + timeMs * 0.05f;
+        }
+
+        ImGui::Text("%-12s %8s %8s", "Fill cost", "NAS on", "NAS off");
+        for (int pass = 0; pass < FeatureDemo::PolicyPassCount; pass++)
+        {
+            ImGui::Text("%-12s %5.2f ms %5.2f ms", passNames[pass], m_app->m_PolicyPassTimeMs[1][pass], m_app->m_PolicyPassTimeMs[0][pass]);
+        }
+    }
+
+    // Target and clamps of the budget controller, which drives the error sensitivity above
+    void NASBudgetUI()
+    {
+        nas::BudgetControllerSettings& settings = m_ui.NASBudget;
+
+        ImGui::Indent();
+        ImGui::DragFloat("Opaque Target (ms)", &settings.targetMs, 0.05f, 0.1f, 50.f);
+        ImGui::DragFloat("Tolerance", &settings.tolerance, 0.005f, 0.01f, 0.5f);
+        ImGui::DragFloatRange2("Sensitivity Clamps", &settings.minErrorSensitivity, &settings.maxErrorSensitivity, 0.001f, 0.001f, 0.5f);
+        ImGui::Checkbox("Rate Floor", &settings.enableRateFloor);
+        if (settings.enableRateFloor)
+        {
+            // The coarsest floor, from the second entry of nas::c_RateFloors on
+            int maxFloor = int(std::find(std::begin(nas::c_RateFloors) + 1, std::end(nas::c_RateFloors), settings.maxRateFloor) - std::begin(nas::c_RateFloors)) - 1;
+            ImGui::SameLine();
+            ImGui::Combo("Max Floor", &maxFloor, "2x1\0" "2x2\0" "2x4\0");
+            settings.maxRateFloor = nas::c_RateFloors[std::min(maxFloor + 1, int(std::size(nas::c_RateFloors)) - 1)];
+            if (m_ui.EmulateVRS)
+                ImGui::TextDisabled("(emulated VRS: no rate floor)");
+        }
+
+        const nas::BudgetController& controller = m_app->m_NASBudgetController;
+        if (m_app->m_NASBudgetActive && controller.GetFilteredTimeMs() > 0.f)
+        {
+            ImGui::Text("Opaque %.2f ms, floor %s%s", controller.GetFilteredTimeMs(),
+                nas::GetShadingRateName(controller.GetRateFloor()), controller.IsSettled() ? ", settled" : "");
+        }
+        ImGui::Unindent();
+    }
+
+    // Rolling statistics of the GPU profiler scopes, the scopes that did not run in the last
+    // resolved frame are greyed out
+    void GpuProfilerUI()
+    {
+        GpuProfiler& profiler = m_app->GetProfiler();
+
+        ImGui::Columns(5, "GpuProfiler", false);
+        ImGui::SetColumnWidth(0, 190.f);
+        ImGui::Text("Scope"); ImGui::NextColumn();
+        ImGui::Text("Last"); ImGui::NextColumn();
+        ImGui::Text("Min"); ImGui::NextColumn();
+        ImGui::Text("Avg"); ImGui::NextColumn();
+        ImGui::Text("P99"); ImGui::NextColumn();
+
+        for (const GpuProfiler::ScopeStats& stats : profiler.GetStats())
+        {
+            const ImVec4 color = ImGui::GetStyleColorVec4(stats.current ? ImGuiCol_Text : ImGuiCol_TextDisabled);
+            ImGui::TextColored(color, "%*s%s", int(stats.depth * 2), "", stats.name.c_str()); ImGui::NextColumn();
+            ImGui::TextColored(color, "%.3f", stats.lastMs); ImGui::NextColumn();
+            ImGui::TextColored(color, "%.3f", stats.minMs); ImGui::NextColumn();
+            ImGui::TextColored(color, "%.3f", stats.avgMs); ImGui::NextColumn();
+            ImGui::TextColored(color, "%.3f", stats.p99Ms); ImGui::NextColumn();
+        }
+        ImGui::Columns(1);
+
+        ImGui::Text("ms over the last %u samples, %u samples dropped", GpuProfiler::c_HistorySize, profiler.GetDroppedSampleCount());
+        if (ImGui::Button("Clear History"))
+            profiler.ClearHistory();
+        ImGui::SameLine();
+        if (ImGui::Button("Export CSV"))
+            profiler.WriteCsv(m_ui.ProfileFileName + ".csv");
+        ImGui::SameLine();
+        if (ImGui::Button("Export JSON"))
+            profiler.WriteJson(m_ui.ProfileFileName + ".json");
+    }
+
+    // Shading rate statistics of the last frame the GPU finished
+    void RateStatisticsUI()
+    {
+        const RateHistogram& histogram = m_app->GetRateHistogram();
+        if (!histogram.HasResult())
+        {
+            ImGui::TextDisabled("Waiting for the GPU");
+            return;
+        }
+
+        const RateHistogram::Result& result = histogram.GetResult();
+        const nas::RateStatistics& rates = result.rates;
+        ImGui::Text("Coarse-shaded pixels %.1f%%", rates.GetCoarseFraction() * 100.0);
+        ImGui::Text("Invocations saved %.1f%% (%.2f M)", rates.GetSavedFraction() * 100.0, double(rates.GetInvocationsSaved()) * 1e-6);
+        if (result.litPixelsValid && rates.pixels)
+        {
+            // Measured, coarse pixels with depth or normal edges are lit per pixel
+            const double litFraction = double(result.litPixels) / double(rates.pixels);
+            ImGui::Text("Lighting saved %.1f%% (%.2f M lit)", (1.0 - litFraction) * 100.0, double(result.litPixels) * 1e-6);
+        }
+
+        uint32_t tileCount = 0;
+        for (uint32_t count : rates.tileCounts)
+            tileCount += count;
+
+        for (nas::ShadingRate rate : nas::c_ShadingRates)
+        {
+            const float fraction = tileCount ? float(rates.tileCounts[rate]) / float(tileCount) : 0.f;
+            char label[32];
+            snprintf(label, std::size(label), "%s %.1f%%", nas::GetShadingRateName(rate), fraction * 100.f);
+            ImGui::ProgressBar(fraction, ImVec2(-1.f, 0.f), label);
+        }
+
+        float buckets[RateHistogram::c_BucketCount];
+        if (result.motionValid)
+        {
+            std::copy(std::begin(result.motionBuckets), std::end(result.motionBuckets), buckets);
+            ImGui::PlotHistogram("Motion", buckets, RateHistogram::c_BucketCount, 0, "<0.5 px ... >32 px", 0.f, FLT_MAX, ImVec2(0.f, 40.f));
+        }
+        if (result.errorValid)
+        {
+            std::copy(std::begin(result.errorBuckets), std::end(result.errorBuckets), buckets);
+            ImGui::PlotHistogram("Error", buckets, RateHistogram::c_BucketCount, 0, "<1/8 ... >8x sensitivity", 0.f, FLT_MAX, ImVec2(0.f, 40.f));
+        }
+
+        if (histogram.GetSkippedFrameCount())
+        {
+            ImGui::TextDisabled("%u frames skipped, readback busy", histogram.GetSkippedFrameCount());
+        }
+        ImGui::Checkbox("Log Rate Statistics", &m_ui.LogRateStatistics);
+    }
+
     virtual void buildUI(void) override
     {
         if (!m_ui.ShowUI)
@@ -1846,11 +3641,11 @@ protected:
         double frameTime = GetDeviceManager()->GetAverageFrameTimeSeconds();
         if (frameTime > 0.0)
             ImGui::Text("%.3f ms/frame (%.1f FPS)", frameTime * 1e3, 1.0 / frameTime);
-        ImGui::Text("DepthPrePass %.1f ms", GetDeviceManager()->GetDevice()->getTimerQueryTime(m_app->m_tqDepthPrePass) * 1e3);
-        ImGui::Text("Forward %.1f ms", GetDeviceManager()->GetDevice()->getTimerQueryTime(m_app->m_tqForwardOpaque) * 1e3);
-        ImGui::Text("MVec %.1f ms", GetDeviceManager()->GetDevice()->getTimerQueryTime(m_app->m_tqMotionVector) * 1e3);
-        ImGui::Text("Sky %.1f ms", GetDeviceManager()->GetDevice()->getTimerQueryTime(m_app->m_tqForwardSky) * 1e3);
-        ImGui::Text("Transp %.1f ms", GetDeviceManager()->GetDevice()->getTimerQueryTime(m_app->m_tqForwardTransparent) * 1e3);
+        if (ImGui::CollapsingHeader("GPU Times", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            GpuProfilerUI();
+        }
+        PolicyPassCostUI();
 
         const std::string currentScene = m_app->GetCurrentSceneName();
         if (ImGui::BeginCombo("Scene", currentScene.c_str()))
@@ -1901,8 +3696,17 @@ protected:
             }
             ImGui::EndCombo();
         }
+
+        ImGui::Checkbox("Record Camera Path", &m_ui.RecordCameraPath);
+        if (m_ui.RecordCameraPath)
+        {
+            ImGui::SameLine();
+            ImGui::Text("(%u frames)", m_app->GetCameraPathRecorder().GetFrameCount());
+        }
+        ImGui::Checkbox("Replay Camera Path", &m_ui.ReplayCameraPath);
         
         ImGui::Combo("AA Mode", (int*)&m_ui.AntiAliasingMode, "None\0TemporalAA\0MSAA 2x\0MSAA 4x\0MSAA 8x\0");
+        ImGui::SliderFloat("Resolution Scale", &m_ui.ResolutionScale, 0.25f, 1.f);
         ImGui::Combo("TAA Camera Jitter", (int*)&m_ui.TemporalAntiAliasingJitter, "MSAA\0Halton\0R2\0White Noise\0");
         
         ImGui::SliderFloat("Ambient Intensity", &m_ui.AmbientIntensity, 0.f, 1.f);
@@ -1937,9 +3741,96 @@ protected:
         
         ImGui::Separator();
         ImGui::Checkbox("Enable NAS", &m_ui.EnableNAS);
+        if (m_ui.EmulateVRS)
+        {
+            ImGui::SameLine();
+            ImGui::TextDisabled(m_app->UsesVRSDeferredLighting() ? "(emulated VRS: deferred lighting only)"
+                : "(emulated VRS: needs VRS Deferred Lighting without light probes)");
+        }
         ImGui::Checkbox("Enable Shading Rate Vis", &m_ui.EnableShadingRateVis);
         ImGui::Checkbox("Enable SR Surface Smoothing", &m_ui.EnableShadingRateSurfaceSmoothing);
+        if (m_ui.EnableShadingRateSurfaceSmoothing)
+        {
+            ImGui::SliderInt("Smoothing Radius", &m_ui.ShadingRateSmoothingRadius, 1, 3);
+            if (!m_ui.UseFusedNASKernel)
+            {
+                // The fused kernel smooths its groupshared rates in one step
+                ImGui::Checkbox("Separable Smoothing", &m_ui.SeparableShadingRateSmoothing);
+            }
+        }
+        ImGui::Checkbox("Use Fused NAS Kernel", &m_ui.UseFusedNASKernel);
+
+        // L2 and percentile errors are lower than the max, so they select coarser rates at the same error sensitivity
+        int errorMetric = int(m_ui.NASErrorMetric);
+        ImGui::Combo("Error Metric", &errorMetric, "Max Derivative\0L2 (RMS)\0Percentile\0");
+        m_ui.NASErrorMetric = nas::ErrorMetric(errorMetric);
+
+        if ((m_ui.UseFusedNASKernel || !m_ui.UseIncrementalNAS) && !m_ui.Stereo && m_ui.UseDeferredShading
+            && m_ui.AntiAliasingMode == AntiAliasingMode::TEMPORAL)
+        {
+            // The incremental and stereo passes always reproject the tile center, only
+            // the G-buffer fill writes object motion and only TAA keeps the previous view
+            int motionSource = int(m_ui.MotionSource);
+            ImGui::Combo("Tile Motion", &motionSource, "Reprojection\0Average Motion Vector\0Max Motion Vector\0");
+            m_ui.MotionSource = NASMotionSource(motionSource);
+        }
+        ImGui::Checkbox("Incremental NAS", &m_ui.UseIncrementalNAS);
+        if (m_ui.UseIncrementalNAS)
+        {
+            ImGui::DragFloat("Motion Tolerance (px)", &m_ui.NASMotionTolerance, 0.05f, 0.f, 4.f);
+            ImGui::DragFloat("Error Tolerance", &m_ui.NASErrorTolerance, 0.005f, 0.f, 0.5f);
+        }
+        if (!m_ui.UseFusedNASKernel || m_ui.Stereo)
+        {
+            ImGui::Checkbox("Async NAS Data", &m_ui.UseAsyncNASData);
+            AsyncNASDataUI();
+        }
+        if (m_ui.UseDeferredShading)
+        {
+            ImGui::Checkbox("VRS Deferred Lighting", &m_ui.UseVRSDeferredLighting);
+            if (m_ui.UseVRSDeferredLighting)
+            {
+                if (m_ui.EnableLightProbe)
+                {
+                    ImGui::SameLine();
+                    ImGui::TextDisabled("(off with light probes)");
+                }
+                ImGui::DragFloat("Coarse Lighting Depth Threshold", &m_ui.VRSLightingDepthThreshold, 0.001f, 0.f, 1.f);
+                ImGui::DragFloat("Coarse Lighting Normal Threshold", &m_ui.VRSLightingNormalThreshold, 0.01f, -1.f, 1.f);
+            }
+        }
+        if (m_ui.Stereo)
+        {
+            // The right eye samples the left eye's NAS data, which is then only computed for the left half
+            ImGui::Checkbox("Share Stereo NAS Error", &m_ui.ShareStereoNASError);
+        }
+        if (ImGui::CollapsingHeader("Pass Shading Rates"))
+        {
+            ShadingRatePolicyUI("Opaque VRS", m_ui.OpaqueShadingRatePolicy);
+            ShadingRatePolicyUI("Sky VRS", m_ui.SkyShadingRatePolicy);
+            ShadingRatePolicyUI("Transparent VRS", m_ui.TransparentShadingRatePolicy);
+            ImGui::SliderInt("Coarsening Bias", &m_ui.ShadingRateCoarseningBias, 1, 2);
+        }
+        if (ImGui::CollapsingHeader("Shading Rate Statistics"))
+        {
+            ImGui::Checkbox("Enable Rate Statistics", &m_ui.EnableRateStatistics);
+            if (m_ui.EnableNAS && m_ui.EnableRateStatistics)
+            {
+                RateStatisticsUI();
+            }
+        }
+        ImGui::Checkbox("Capture NAS Inputs", &m_ui.EnableNASCapture);
+        if (m_ui.EnableNASCapture)
+        {
+            ImGui::SameLine();
+            ImGui::Text("(%u frames)", m_app->GetNasCapture().GetFrameCount());
+        }
         ImGui::DragFloat("Error Sensitivity", &m_ui.NASErrorSensitivity, 0.001f, 0.001f, 0.2f);
+        ImGui::Checkbox("NAS Budget Controller", &m_ui.EnableNASBudget);
+        if (m_ui.EnableNASBudget)
+        {
+            NASBudgetUI();
+        }
         ImGui::DragFloat("Brightness Sensitivity", &m_ui.NASBrightnessSensitivity, 0.01f, 0.01f, 0.2f);
         ImGui::DragFloat("Motion Sensitivity", &m_ui.NASMotionSensitivity, 0.05f, 0.00f, 2.f);
         ImGui::Separator();
@@ -2015,7 +3906,7 @@ protected:
     }
 };
 
-bool ProcessCommandLine(int argc, const char* const* argv, DeviceCreationParameters& deviceParams, std::string& sceneName)
+bool ProcessCommandLine(int argc, const char* const* argv, DeviceCreationParameters& deviceParams, std::string& sceneName, UIData& ui)
 {
     for (int i = 1; i < argc; i++)
     {
@@ -2044,12 +3935,101 @@ bool ProcessCommandLine(int argc, const char* const* argv, DeviceCreationParamet
         {
             g_PrintSceneGraph = true;
         }
+        else if (!strcmp(argv[i], "-nas-capture") && i + 1 < argc)
+        {
+            ui.NASCaptureFileName = argv[++i];
+            ui.EnableNASCapture = true;
+        }
+        else if (!strcmp(argv[i], "-profile-file") && i + 1 < argc)
+        {
+            ui.ProfileFileName = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-emulate-vrs"))
+        {
+            ui.EmulateVRS = true;
+        }
+        else if (!strcmp(argv[i], "-resolution-scale") && i + 1 < argc)
+        {
+            ui.ResolutionScale = std::clamp(float(atof(argv[++i])), 0.25f, 1.f);
+        }
+        else if (!strcmp(argv[i], "-nas-budget") && i + 1 < argc)
+        {
+            ui.EnableNASBudget = true;
+            ui.NASBudget.targetMs = std::max(float(atof(argv[++i])), 0.1f);
+        }
+        else if (!strcmp(argv[i], "-no-async-nas"))
+        {
+            ui.UseAsyncNASData = false;
+        }
+        else if (!strcmp(argv[i], "-nas-rate-floor"))
+        {
+            ui.NASBudget.enableRateFloor = true;
+        }
+        else if (!strcmp(argv[i], "-record-path") && i + 1 < argc)
+        {
+            ui.CameraPathFileName = argv[++i];
+            ui.RecordCameraPath = true;
+        }
+        else if (!strcmp(argv[i], "-replay-path") && i + 1 < argc)
+        {
+            ui.CameraPathFileName = argv[++i];
+            ui.ReplayCameraPath = true;
+        }
+        else if (!strcmp(argv[i], "-replay-timestep") && i + 1 < argc)
+        {
+            ui.CameraPathTimeStep = std::stof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-benchmark-path") && i + 1 < argc)
+        {
+            ui.BenchmarkSettings.cameraPathFileName = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-benchmark"))
+        {
+            ui.RunBenchmark = true;
+        }
+        else if (!strcmp(argv[i], "-benchmark-configs") && i + 1 < argc)
+        {
+            if (!Benchmark::ParseConfigurations(argv[++i], ui.BenchmarkSettings.configurations))
+                return false;
+        }
+        else if (!strcmp(argv[i], "-benchmark-frames") && i + 1 < argc)
+        {
+            if (!Benchmark::ParseFrameCount(argv[++i], "-benchmark-frames", ui.BenchmarkSettings.measuredFrames))
+                return false;
+        }
+        else if (!strcmp(argv[i], "-benchmark-warmup") && i + 1 < argc)
+        {
+            if (!Benchmark::ParseFrameCount(argv[++i], "-benchmark-warmup", ui.BenchmarkSettings.warmupFrames))
+                return false;
+        }
+        else if (!strcmp(argv[i], "-benchmark-timestep") && i + 1 < argc)
+        {
+            ui.BenchmarkSettings.timeStep = std::stof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-benchmark-output") && i + 1 < argc)
+        {
+            ui.BenchmarkSettings.outputFileName = argv[++i];
+        }
         else if (argv[i][0] != '-')
         {
             sceneName = argv[i];
         }
     }
 
+    if (ui.RunBenchmark)
+    {
+        if (ui.BenchmarkSettings.measuredFrames == 0 || !(ui.BenchmarkSettings.timeStep > 0.f))
+        {
+            log::error("The benchmark needs at least one measured frame and a positive time step");
+            return false;
+        }
+
+        // Present as fast as possible, and no UI in the measured frames
+        deviceParams.vsyncEnabled = false;
+        ui.EnableVsync = false;
+        ui.ShowUI = false;
+    }
+
     return true;
 }
 
@@ -2072,9 +4052,11 @@ int main(int __argc, const char* const* __argv)
     deviceParams.swapChainBufferCount = 2;
     deviceParams.startFullscreen = false;
     deviceParams.vsyncEnabled = true;
+    deviceParams.enableComputeQueue = true;    // async NAS data, see FeatureDemo::SubmitFrame
 
+    UIData uiData;
     std::string sceneName;
-    if (!ProcessCommandLine(__argc, __argv, deviceParams, sceneName))
+    if (!ProcessCommandLine(__argc, __argv, deviceParams, sceneName, uiData))
     {
         log::error("Failed to process the command line.");
         return 1;
@@ -2092,8 +4074,6 @@ int main(int __argc, const char* const* __argv)
 	}
 
     {
-        UIData uiData;
-
         std::shared_ptr<FeatureDemo> demo = std::make_shared<FeatureDemo>(deviceManager, uiData, sceneName);
         std::shared_ptr<UIRenderer> gui = std::make_shared<UIRenderer>(deviceManager, demo, uiData);
 
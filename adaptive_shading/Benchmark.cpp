@@ -0,0 +1,368 @@
+//----------------------------------------------------------------------------------
+// File:        Benchmark.cpp
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include "Benchmark.h"
+
+#include <donut/core/log.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+
+using namespace donut;
+using namespace donut::math;
+
+// The camera turns at a constant rate and nods up and down, so that every configuration sees
+// the same mix of static and moving tiles
+static constexpr float c_SweepYawRate = 30.f * PI_f / 180.f;      // per second
+static constexpr float c_SweepPitchAmplitude = 10.f * PI_f / 180.f;
+static constexpr float c_SweepPitchPeriod = 8.f;                  // seconds
+static constexpr float c_MaxPitch = 80.f * PI_f / 180.f;
+
+bool Benchmark::ParseConfigurations(const char* list, std::vector<Configuration>& configurations)
+{
+    configurations.clear();
+
+    std::string remaining = list;
+    while (!remaining.empty())
+    {
+        const size_t comma = remaining.find(',');
+        const std::string item = remaining.substr(0, comma);
+        remaining = (comma == std::string::npos) ? std::string() : remaining.substr(comma + 1);
+
+        Configuration configuration;
+        if (item == "off")
+        {
+            configuration.name = "nas_off";
+        }
+        else
+        {
+            char* end = nullptr;
+            configuration.errorSensitivity = strtof(item.c_str(), &end);
+            if (item.empty() || *end != 0 || !(configuration.errorSensitivity > 0.f))
+            {
+                log::error("Invalid benchmark configuration '%s', expected 'off' or a positive error sensitivity", item.c_str());
+                return false;
+            }
+            configuration.enableNAS = true;
+            configuration.name = "nas_" + item;
+        }
+        configurations.push_back(configuration);
+    }
+
+    return !configurations.empty();
+}
+
+bool Benchmark::ParseFrameCount(const char* text, const char* option, uint32_t& count)
+{
+    // strtoul accepts a sign and wraps negative numbers around, so only digits are let through
+    char* end = nullptr;
+    const unsigned long value = (*text >= '0' && *text <= '9') ? strtoul(text, &end, 10) : 0;
+    if (!end || *end != 0 || value > c_MaxFrames)
+    {
+        log::error("Invalid %s '%s', expected a frame count of 0 to %u", option, text, c_MaxFrames);
+        return false;
+    }
+
+    count = uint32_t(value);
+    return true;
+}
+
+Benchmark::Benchmark(Settings settings)
+    : m_Settings(std::move(settings))
+{
+    if (m_Settings.configurations.empty())
+    {
+        ParseConfigurations("off,0.07", m_Settings.configurations);
+    }
+}
+
+uint32_t Benchmark::GetTotalFrameCount() const
+{
+    return GetFramesPerConfiguration() * uint32_t(m_Settings.configurations.size()) + c_DrainFrames;
+}
+
+void Benchmark::Begin(const float3& position, const float3& direction, uint32_t frameIndex)
+{
+    m_Started = true;
+    m_FirstFrameIndex = frameIndex;
+    m_Frame = 0;
+    m_StartPosition = position;
+    m_StartYaw = atan2f(direction.x, direction.z);
+    m_StartPitch = asinf(clamp(direction.y / length(direction), -1.f, 1.f));
+    m_Frames.assign(GetTotalFrameCount(), FrameRecord());
+
+    log::info("Benchmark: %u configurations, %u warm-up and %u measured frames each",
+        uint32_t(m_Settings.configurations.size()), m_Settings.warmupFrames, m_Settings.measuredFrames);
+}
+
+const Benchmark::Configuration& Benchmark::GetConfiguration() const
+{
+    // The drain frames at the end keep the last configuration
+    const uint32_t index = std::min(m_Frame / GetFramesPerConfiguration(), uint32_t(m_Settings.configurations.size()) - 1);
+    return m_Settings.configurations[index];
+}
+
+uint32_t Benchmark::GetConfigurationFrame() const
+{
+    // The drain frames continue the last configuration
+    const uint32_t index = std::min(m_Frame / GetFramesPerConfiguration(), uint32_t(m_Settings.configurations.size()) - 1);
+    return m_Frame - index * GetFramesPerConfiguration();
+}
+
+uint32_t Benchmark::GetSweepFrame() const
+{
+    // Warm-up frames stay at the start pose
+    const uint32_t frameInConfiguration = GetConfigurationFrame();
+    return (frameInConfiguration > m_Settings.warmupFrames) ? frameInConfiguration - m_Settings.warmupFrames : 0;
+}
+
+float Benchmark::GetAnimationTime() const
+{
+    return float(GetConfigurationFrame()) * m_Settings.timeStep;
+}
+
+void Benchmark::GetCameraPose(float3& position, float3& direction) const
+{
+    const float time = float(GetSweepFrame()) * m_Settings.timeStep;
+
+    const float yaw = m_StartYaw + c_SweepYawRate * time;
+    const float pitch = clamp(m_StartPitch + c_SweepPitchAmplitude * sinf(2.f * PI_f * time / c_SweepPitchPeriod), -c_MaxPitch, c_MaxPitch);
+
+    position = m_StartPosition;
+    direction = float3(cosf(pitch) * sinf(yaw), sinf(pitch), cosf(pitch) * cosf(yaw));
+}
+
+void Benchmark::EndFrame(float cpuMs, float frameMs)
+{
+    if (!m_Started || IsFinished())
+        return;
+
+    FrameRecord& frame = m_Frames[m_Frame];
+    frame.cpuMs = cpuMs;
+    frame.frameMs = frameMs;
+
+    m_Frame++;
+
+    if (m_Frame % GetFramesPerConfiguration() == 0 && m_Frame / GetFramesPerConfiguration() < m_Settings.configurations.size())
+    {
+        log::info("Benchmark: %s", GetConfiguration().name.c_str());
+    }
+}
+
+Benchmark::FrameRecord* Benchmark::FindFrame(uint32_t frameIndex)
+{
+    // Frames from before Begin wrap around to large numbers
+    const uint32_t frame = frameIndex - m_FirstFrameIndex;
+    if (!m_Started || frame >= m_Frame)
+        return nullptr;
+    return &m_Frames[frame];
+}
+
+void Benchmark::RecordGpuTime(uint32_t frameIndex, float gpuMs)
+{
+    if (FrameRecord* frame = FindFrame(frameIndex))
+    {
+        frame->gpuMs = gpuMs;
+        frame->gpuValid = true;
+    }
+}
+
+void Benchmark::RecordRates(const RateHistogram::Result& result)
+{
+    if (FrameRecord* frame = FindFrame(result.frameIndex))
+    {
+        frame->rates = result.rates;
+        frame->ratesValid = true;
+        frame->litPixels = result.litPixels;
+        frame->litPixelsValid = result.litPixelsValid;
+    }
+}
+
+// File paths can contain backslashes on Windows
+static std::string EscapeJson(const std::string& text)
+{
+    std::string escaped;
+    for (char c : text)
+    {
+        if (c == '\\' || c == '"')
+            escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+// Nearest rank, like GpuProfiler
+static float Percentile(std::vector<float> samples, double fraction)
+{
+    if (samples.empty())
+        return 0.f;
+
+    const size_t rank = size_t(std::ceil(fraction * double(samples.size()))) - 1;
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+    return samples[rank];
+}
+
+static void WriteTimeStats(FILE* file, const char* name, const std::vector<float>& samples, const char* separator)
+{
+    double sum = 0.0;
+    for (float sample : samples)
+        sum += sample;
+    const double average = samples.empty() ? 0.0 : sum / double(samples.size());
+
+    fprintf(file, "      \"%s\": { \"samples\": %u, \"avg\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f }%s\n",
+        name, uint32_t(samples.size()), average,
+        Percentile(samples, 0.50), Percentile(samples, 0.95), Percentile(samples, 0.99), separator);
+}
+
+void Benchmark::WriteConfiguration(FILE* file, uint32_t configurationIndex) const
+{
+    const Configuration& configuration = m_Settings.configurations[configurationIndex];
+    const uint32_t firstFrame = configurationIndex * GetFramesPerConfiguration() + m_Settings.warmupFrames;
+    const uint32_t endFrame = firstFrame + m_Settings.measuredFrames;
+
+    std::vector<float> cpuTimes, frameTimes, gpuTimes;
+    nas::RateStatistics rates;
+    uint32_t rateFrames = 0;
+    uint64_t litPixels = 0;
+    uint64_t litFramePixels = 0;
+    for (uint32_t index = firstFrame; index < endFrame; index++)
+    {
+        const FrameRecord& frame = m_Frames[index];
+        cpuTimes.push_back(frame.cpuMs);
+        frameTimes.push_back(frame.frameMs);
+        if (frame.gpuValid)
+            gpuTimes.push_back(frame.gpuMs);
+        if (frame.ratesValid)
+        {
+            rates.Accumulate(frame.rates);
+            rateFrames++;
+        }
+        if (frame.ratesValid && frame.litPixelsValid)
+        {
+            litPixels += frame.litPixels;
+            litFramePixels += frame.rates.pixels;
+        }
+    }
+
+    fprintf(file, "    {\n");
+    fprintf(file, "      \"name\": \"%s\",\n", configuration.name.c_str());
+    fprintf(file, "      \"nas\": %s,\n", configuration.enableNAS ? "true" : "false");
+    fprintf(file, "      \"errorSensitivity\": %.4f,\n", configuration.errorSensitivity);
+    WriteTimeStats(file, "cpuMs", cpuTimes, ",");
+    WriteTimeStats(file, "frameMs", frameTimes, ",");
+    WriteTimeStats(file, "gpuMs", gpuTimes, ",");
+
+    // Rate counts are only read back when the histogram has a free buffer, and without NAS all tiles are 1x1
+    uint64_t tileCount = 0;
+    for (uint8_t rate : nas::c_ShadingRates)
+        tileCount += rates.tileCounts[rate];
+
+    fprintf(file, "      \"rates\": {\n");
+    fprintf(file, "        \"frames\": %u,\n", rateFrames);
+    fprintf(file, "        \"coarseFraction\": %.6f,\n", rates.GetCoarseFraction());
+    fprintf(file, "        \"savedFraction\": %.6f,\n", rates.GetSavedFraction());
+    // Measured by the VRS deferred lighting pass, the only savings with emulated VRS
+    if (litFramePixels)
+        fprintf(file, "        \"lightingSavedFraction\": %.6f,\n", 1.0 - double(litPixels) / double(litFramePixels));
+    else
+        fprintf(file, "        \"lightingSavedFraction\": null,\n");
+    fprintf(file, "        \"tiles\": {");
+    for (size_t index = 0; index < std::size(nas::c_ShadingRates); index++)
+    {
+        const uint8_t rate = nas::c_ShadingRates[index];
+        fprintf(file, " \"%s\": %.6f%s", nas::GetShadingRateName(rate),
+            tileCount ? double(rates.tileCounts[rate]) / double(tileCount) : 0.0,
+            (index + 1 < std::size(nas::c_ShadingRates)) ? "," : " }\n");
+    }
+    fprintf(file, "      },\n");
+
+    // Frames whose GPU time or rates were not read back have null entries
+    fprintf(file, "      \"frames\": [\n");
+    for (uint32_t index = firstFrame; index < endFrame; index++)
+    {
+        const FrameRecord& frame = m_Frames[index];
+        fprintf(file, "        { \"cpuMs\": %.4f, \"frameMs\": %.4f, ", frame.cpuMs, frame.frameMs);
+        if (frame.gpuValid)
+            fprintf(file, "\"gpuMs\": %.4f, ", frame.gpuMs);
+        else
+            fprintf(file, "\"gpuMs\": null, ");
+        if (frame.ratesValid)
+            fprintf(file, "\"savedFraction\": %.6f }", frame.rates.GetSavedFraction());
+        else
+            fprintf(file, "\"savedFraction\": null }");
+        fprintf(file, "%s\n", (index + 1 < endFrame) ? "," : "");
+    }
+    fprintf(file, "      ]\n");
+    fprintf(file, "    }");
+}
+
+bool Benchmark::WriteJson(const std::filesystem::path& fileName, const std::string& sceneName, uint32_t width, uint32_t height,
+    bool emulatedVRS, const char* shadingPath, bool lightProbe) const
+{
+    FILE* file = fopen(fileName.generic_string().c_str(), "w");
+    if (!file)
+    {
+        log::error("Cannot create %s", fileName.generic_string().c_str());
+        return false;
+    }
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"version\": 1,\n");
+    fprintf(file, "  \"scene\": \"%s\",\n", EscapeJson(sceneName).c_str());
+    if (m_Settings.cameraPathFileName.empty())
+        fprintf(file, "  \"cameraPath\": null,\n");
+    else
+        fprintf(file, "  \"cameraPath\": \"%s\",\n", EscapeJson(m_Settings.cameraPathFileName).c_str());
+    fprintf(file, "  \"width\": %u,\n", width);
+    fprintf(file, "  \"height\": %u,\n", height);
+    fprintf(file, "  \"vrs\": \"%s\",\n", emulatedVRS ? "emulated" : "hardware");
+    fprintf(file, "  \"shadingPath\": \"%s\",\n", shadingPath);
+    fprintf(file, "  \"lightProbe\": %s,\n", lightProbe ? "true" : "false");
+    fprintf(file, "  \"timeStep\": %.6f,\n", m_Settings.timeStep);
+    fprintf(file, "  \"warmupFrames\": %u,\n", m_Settings.warmupFrames);
+    fprintf(file, "  \"measuredFrames\": %u,\n", m_Settings.measuredFrames);
+    fprintf(file, "  \"configurations\": [\n");
+    for (uint32_t index = 0; index < uint32_t(m_Settings.configurations.size()); index++)
+    {
+        WriteConfiguration(file, index);
+        fprintf(file, "%s\n", (index + 1 < m_Settings.configurations.size()) ? "," : "");
+    }
+    fprintf(file, "  ]\n");
+    fprintf(file, "}\n");
+
+    fclose(file);
+    log::info("Benchmark results written to %s", fileName.generic_string().c_str());
+    return true;
+}
@@ -0,0 +1,144 @@
+//----------------------------------------------------------------------------------
+// File:        Benchmark.h
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#pragma once
+
+#include "RateHistogram.h"
+
+#include <donut/core/math/math.h>
+#include <nas/RateStatistics.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Scripted benchmark run, see the -benchmark option. Every configuration renders the same camera
+// sweep with a fixed time step: warm-up frames at the start pose, then the measured frames while
+// the camera turns around its start position. The GPU times and rate counts of a frame arrive
+// a few frames after it was rendered, so the script renders a few more frames at the end before
+// it is finished.
+class Benchmark
+{
+public:
+    struct Configuration
+    {
+        std::string name;
+        bool enableNAS = false;
+        float errorSensitivity = 0.f;
+    };
+
+    struct Settings
+    {
+        std::vector<Configuration> configurations;
+        uint32_t warmupFrames = 60;
+        uint32_t measuredFrames = 600;
+        float timeStep = 1.f / 60.f;
+        std::string outputFileName = "benchmark.json";
+        std::string cameraPathFileName;     // replayed by the application instead of the sweep
+    };
+
+    // Comma-separated NAS error sensitivities, "off" is a run without NAS, e.g. "off,0.035,0.07"
+    static bool ParseConfigurations(const char* list, std::vector<Configuration>& configurations);
+
+    // A frame count of -benchmark-frames or -benchmark-warmup, a decimal number up to c_MaxFrames
+    static bool ParseFrameCount(const char* text, const char* option, uint32_t& count);
+
+    // Largest warm-up or measured frame count, keeps the frame records of a run small and the frame numbers in range
+    static constexpr uint32_t c_MaxFrames = 1000000;
+
+    explicit Benchmark(Settings settings);
+
+    // Starts the script at the given camera pose, frameIndex is the frame about to be rendered
+    void Begin(const donut::math::float3& position, const donut::math::float3& direction, uint32_t frameIndex);
+
+    [[nodiscard]] bool IsStarted() const { return m_Started; }
+    [[nodiscard]] bool IsFinished() const { return m_Started && m_Frame >= GetTotalFrameCount(); }
+    [[nodiscard]] float GetTimeStep() const { return m_Settings.timeStep; }
+    [[nodiscard]] const Settings& GetSettings() const { return m_Settings; }
+
+    // Configuration and camera pose of the frame about to be rendered
+    [[nodiscard]] const Configuration& GetConfiguration() const;
+    void GetCameraPose(donut::math::float3& position, donut::math::float3& direction) const;
+
+    // Measured frames since the start of the configuration, 0 in the warm-up
+    [[nodiscard]] uint32_t GetSweepFrame() const;
+
+    // Animation time of the frame about to be rendered. It restarts with every configuration,
+    // warm-up included, so all of them render the same animation.
+    [[nodiscard]] float GetAnimationTime() const;
+
+    // Ends the frame about to be rendered. frameMs is the time since the previous frame started,
+    // cpuMs the time the frame took to record and submit.
+    void EndFrame(float cpuMs, float frameMs);
+
+    // Results of earlier frames, by the frame index that was passed to Begin plus the frame number
+    void RecordGpuTime(uint32_t frameIndex, float gpuMs);
+    void RecordRates(const RateHistogram::Result& result);
+
+    // shadingPath names the pass that shades the opaque geometry at the NAS rates
+    bool WriteJson(const std::filesystem::path& fileName, const std::string& sceneName, uint32_t width, uint32_t height,
+        bool emulatedVRS, const char* shadingPath, bool lightProbe) const;
+
+private:
+    // Covers the frames in flight of GpuProfiler and RateHistogram
+    static constexpr uint32_t c_DrainFrames = 8;
+
+    struct FrameRecord
+    {
+        float cpuMs = 0.f;
+        float frameMs = 0.f;
+        float gpuMs = 0.f;
+        bool gpuValid = false;
+        nas::RateStatistics rates;
+        bool ratesValid = false;
+        uint32_t litPixels = 0;
+        bool litPixelsValid = false;
+    };
+
+    [[nodiscard]] uint32_t GetFramesPerConfiguration() const { return m_Settings.warmupFrames + m_Settings.measuredFrames; }
+    [[nodiscard]] uint32_t GetTotalFrameCount() const;
+    [[nodiscard]] uint32_t GetConfigurationFrame() const;  // frames since the start of the configuration
+    FrameRecord* FindFrame(uint32_t frameIndex);
+    void WriteConfiguration(FILE* file, uint32_t configurationIndex) const;
+
+    Settings m_Settings;
+
+    bool m_Started = false;
+    uint32_t m_FirstFrameIndex = 0;
+    uint32_t m_Frame = 0;
+    donut::math::float3 m_StartPosition = donut::math::float3(0.f);
+    float m_StartYaw = 0.f;
+    float m_StartPitch = 0.f;
+
+    std::vector<FrameRecord> m_Frames;
+};
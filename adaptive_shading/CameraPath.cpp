@@ -0,0 +1,194 @@
+//----------------------------------------------------------------------------------
+// File:        CameraPath.cpp
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include "CameraPath.h"
+
+#include <donut/core/log.h>
+
+#include <fstream>
+#include <sstream>
+
+using namespace donut;
+using namespace donut::math;
+
+static constexpr int c_FileVersion = 1;
+
+bool CameraPath::Load(const std::filesystem::path& fileName)
+{
+    m_Frames.clear();
+
+    std::ifstream file(fileName);
+    if (!file)
+    {
+        log::error("Cannot open %s", fileName.generic_string().c_str());
+        return false;
+    }
+
+    std::string line;
+    std::string sceneCamera;
+    uint32_t lineNumber = 0;
+    bool headerFound = false;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty())
+            continue;
+
+        std::istringstream stream(line);
+        std::string keyword;
+        stream >> keyword;
+
+        if (!headerFound)
+        {
+            int version = 0;
+            if (keyword != "camera_path" || !(stream >> version) || version != c_FileVersion)
+            {
+                log::error("%s is not a version %d camera path", fileName.generic_string().c_str(), c_FileVersion);
+                return false;
+            }
+            headerFound = true;
+        }
+        else if (keyword == "camera")
+        {
+            // The name is the rest of the line, scene camera names can contain spaces
+            const size_t nameStart = line.find_first_not_of(' ', keyword.size());
+            sceneCamera = (nameStart == std::string::npos) ? std::string() : line.substr(nameStart);
+            if (sceneCamera == "-")
+                sceneCamera.clear();
+        }
+        else if (keyword == "frame")
+        {
+            CameraPathFrame frame;
+            frame.sceneCamera = sceneCamera;
+
+            std::string animationTime;
+            stream >> animationTime;
+            frame.animate = animationTime != "-";
+            if (frame.animate)
+            {
+                char* end = nullptr;
+                frame.animationTime = strtof(animationTime.c_str(), &end);
+                if (*end != 0)
+                    stream.setstate(std::ios::failbit);
+            }
+
+            stream >> frame.position.x >> frame.position.y >> frame.position.z
+                >> frame.direction.x >> frame.direction.y >> frame.direction.z
+                >> frame.up.x >> frame.up.y >> frame.up.z
+                >> frame.verticalFov;
+            if (stream.fail())
+            {
+                log::error("%s: line %u: invalid frame", fileName.generic_string().c_str(), lineNumber);
+                m_Frames.clear();
+                return false;
+            }
+
+            m_Frames.push_back(frame);
+        }
+        else
+        {
+            log::error("%s: line %u: unknown keyword '%s'", fileName.generic_string().c_str(), lineNumber, keyword.c_str());
+            m_Frames.clear();
+            return false;
+        }
+    }
+
+    if (m_Frames.empty())
+    {
+        log::error("%s contains no frames", fileName.generic_string().c_str());
+        return false;
+    }
+
+    log::info("Camera path loaded: %s, %u frames", fileName.generic_string().c_str(), GetFrameCount());
+    return true;
+}
+
+CameraPathRecorder::~CameraPathRecorder()
+{
+    End();
+}
+
+bool CameraPathRecorder::Begin(const std::filesystem::path& fileName)
+{
+    End();
+
+    m_File = fopen(fileName.generic_string().c_str(), "w");
+    if (!m_File)
+    {
+        log::error("Cannot create %s", fileName.generic_string().c_str());
+        return false;
+    }
+
+    fprintf(m_File, "camera_path %d\n", c_FileVersion);
+    m_FileName = fileName;
+    m_SceneCamera.clear();
+    m_FrameCount = 0;
+    log::info("Camera path recording started: %s", fileName.generic_string().c_str());
+    return true;
+}
+
+void CameraPathRecorder::End()
+{
+    if (!m_File)
+        return;
+
+    fclose(m_File);
+    m_File = nullptr;
+    log::info("Camera path recording finished, %u frames written to %s", m_FrameCount, m_FileName.generic_string().c_str());
+}
+
+void CameraPathRecorder::RecordFrame(const CameraPathFrame& frame)
+{
+    if (!m_File)
+        return;
+
+    if (frame.sceneCamera != m_SceneCamera)
+    {
+        fprintf(m_File, "camera %s\n", frame.sceneCamera.empty() ? "-" : frame.sceneCamera.c_str());
+        m_SceneCamera = frame.sceneCamera;
+    }
+
+    if (frame.animate)
+        fprintf(m_File, "frame %.9g", frame.animationTime);
+    else
+        fprintf(m_File, "frame -");
+
+    fprintf(m_File, " %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g\n",
+        frame.position.x, frame.position.y, frame.position.z,
+        frame.direction.x, frame.direction.y, frame.direction.z,
+        frame.up.x, frame.up.y, frame.up.z,
+        frame.verticalFov);
+
+    m_FrameCount++;
+}
@@ -0,0 +1,93 @@
+//----------------------------------------------------------------------------------
+// File:        CameraPath.h
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#pragma once
+
+#include <donut/core/math/math.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Camera path file, one text line per frame:
+//
+//   camera_path 1
+//   camera <name>       the following frames look through this scene camera, "camera -" for the free camera
+//   frame <animation time, "-" when animations are off> <position xyz> <direction xyz> <up xyz> <vertical fov>
+//
+// Floats are written with 9 significant digits, which reads back the same bits, so replays of a
+// recording see the same viewpoints.
+struct CameraPathFrame
+{
+    donut::math::float3 position = donut::math::float3(0.f);
+    donut::math::float3 direction = donut::math::float3(0.f, 0.f, 1.f);
+    donut::math::float3 up = donut::math::float3(0.f, 1.f, 0.f);
+    float verticalFov = 60.f;       // degrees, of the free camera
+    bool animate = false;
+    float animationTime = 0.f;
+    std::string sceneCamera;        // empty for the free camera
+};
+
+class CameraPath
+{
+public:
+    bool Load(const std::filesystem::path& fileName);
+
+    [[nodiscard]] bool IsEmpty() const { return m_Frames.empty(); }
+    [[nodiscard]] uint32_t GetFrameCount() const { return uint32_t(m_Frames.size()); }
+    [[nodiscard]] const CameraPathFrame& GetFrame(uint32_t index) const { return m_Frames[index]; }
+
+private:
+    std::vector<CameraPathFrame> m_Frames;
+};
+
+// Writes the frames to the file as they are recorded
+class CameraPathRecorder
+{
+public:
+    ~CameraPathRecorder();
+
+    bool Begin(const std::filesystem::path& fileName);
+    void End();
+
+    [[nodiscard]] bool IsActive() const { return m_File != nullptr; }
+    [[nodiscard]] uint32_t GetFrameCount() const { return m_FrameCount; }
+
+    void RecordFrame(const CameraPathFrame& frame);
+
+private:
+    FILE* m_File = nullptr;
+    std::filesystem::path m_FileName;
+    std::string m_SceneCamera;
+    uint32_t m_FrameCount = 0;
+};
@@ -0,0 +1,35 @@
+
+// Derives a rate surface for passes that tolerate lower quality than the opaque pass:
+// every rate is COARSENING_BIAS steps coarser in X and in Y.
+
+#ifndef COARSENING_BIAS
+#define COARSENING_BIAS 1
+#endif
+
+Texture2D<uint> inputRates : register(t0);
+RWTexture2D<uint> outputRates : register(u0);
+
+[numthreads(16, 16, 1)]
+void main_cs(uint3 DispatchThreadID : SV_DispatchThreadID)
+{
+    uint surfaceWidth, surfaceHeight;
+    inputRates.GetDimensions(surfaceWidth, surfaceHeight);
+
+    // out-of-bounds check
+    if (DispatchThreadID.x >= surfaceWidth || DispatchThreadID.y >= surfaceHeight)
+        return;
+
+    // log2 of the coarse pixel size, X in bits 2-3 and Y in bits 0-1 of the D3D shading rate
+    uint rate = inputRates[DispatchThreadID.xy];
+    uint2 log2Size = uint2((rate >> 2) & 0x3, rate & 0x3);
+    uint2 coarseLog2Size = min(log2Size + COARSENING_BIAS, 2);
+
+    // Disable 4x4 shading rate like ComputeShadingRate.hlsl, keeping 4x in the coarser direction.
+    // 4x1 and 1x4 cannot occur, both directions are at least 2x here.
+    if (all(coarseLog2Size == 2))
+    {
+        coarseLog2Size = (log2Size.x >= log2Size.y) ? uint2(2, 1) : uint2(1, 2);
+    }
+
+    outputRates[DispatchThreadID.xy] = (coarseLog2Size.x << 2) | coarseLog2Size.y;
+}
@@ -8,83 +8,90 @@ cbuffer ComputeNasDataPassCB : register(b0)
     ComputeNASDataConstants ComputeNASDataParams;
 };
 
-float RgbToLuminance(float3 color)
-{
-    return dot(color, float3(0.299, 0.587, 0.114));
-}
+// VRS tile size of the device, one shader permutation per supported size (8, 16 or 32)
+#ifndef TILE_SIZE
+#define TILE_SIZE 16
+#endif
 
-// Use a single wave threadgroup to leverage wave intrinsics
-[numthreads(8, 4, 1)]
-void main_cs(uint3 DispatchThreadID : SV_DispatchThreadID, uint3 GroupThreadID : SV_GroupThreadID, uint3 GroupID : SV_GroupID)
-{
-    // Block of 8x4 threads (each thread is a block of 2x4 pixels)
-    // Each block is responsible for loading data from a 16x16 pixel tile
-    uint2 localID = GroupThreadID.xy;
-    localID <<= uint2(1, 2);
+// Reduction variant, selected from the wave size reported by the device:
+// 32 or 64 reduce with wave intrinsics and require exactly that lane count,
+// 0 reduces in groupshared memory only and works with any (or a variable) wave size.
+#ifndef WAVE_SIZE
+#define WAVE_SIZE 0
+#endif
 
-    // Tile global location
-    uint2 tileOffset = GroupID.xy << 4;
+// One tile per group
+#define NAS_REDUCTION_TILES 1
+#include "NASCommon.hlsli"
 
-    // Global block coordinates
-    int3 blockBaseCoord = int3(tileOffset + localID, 0);
+#if WAVE_SIZE > 0
+// Threads are assigned to waves in SV_GroupIndex order
+#define WAVES_PER_GROUP ((GROUP_THREADS + WAVE_SIZE - 1) / WAVE_SIZE)
+groupshared float3 gs_WaveResults[WAVES_PER_GROUP];
+#endif
 
-    // Fetch color (final post-AA) data
-    // l0.x  l0.y
-    // l0.z  l0.w  l2.x
-    // l1.x  l1.y
-    // l1.z  l1.w  l2.y
-    //		 l2.z
-    float4 l0;
-    l0.x = RgbToLuminance(prevFrameColors.Load(blockBaseCoord, int2(0, 0)).xyz);
-    l0.y = RgbToLuminance(prevFrameColors.Load(blockBaseCoord, int2(1, 0)).xyz);
-    l0.z = RgbToLuminance(prevFrameColors.Load(blockBaseCoord, int2(0, 1)).xyz);
-    l0.w = RgbToLuminance(prevFrameColors.Load(blockBaseCoord, int2(1, 1)).xyz);
+// Reduces the per-thread (block luma, error x, error y) over the group, the result is valid in thread 0.
+// The max errors do not depend on the order, so every variant produces the same max and percentile
+// errors. The luma sum, and the squared derivatives of the L2 metric, only match up to floating
+// point reordering: HLSL does not define the order of WaveActiveSum. The CPU emulator
+// (nas/WaveEmulation.h) models it with the pairwise order of the groupshared variant, so the
+// variants only agree bit for bit there.
+float3 ReduceGroup(float3 value, uint groupIndex)
+{
+#if WAVE_SIZE > 0
+#if ERROR_METRIC == NAS_ERROR_METRIC_L2
+    float3 result = WaveActiveSum(value);
+#else
+    float3 result = float3(WaveActiveSum(value.x), WaveActiveMax(value.y), WaveActiveMax(value.z));
+#endif
 
-    float4 l1;
-    l1.x = RgbToLuminance(prevFrameColors.Load(blockBaseCoord, int2(0, 2)).xyz);
-    l1.y = RgbToLuminance(prevFrameColors.Load(blockBaseCoord, int2(1, 2)).xyz);
-    l1.z = RgbToLuminance(prevFrameColors.Load(blockBaseCoord, int2(0, 3)).xyz);
-    l1.w = RgbToLuminance(prevFrameColors.Load(blockBaseCoord, int2(1, 3)).xyz);
+#if WAVES_PER_GROUP > 1
+    // 32x32 tiles: combine the results of the waves of the group
+    if (WaveIsFirstLane())
+    {
+        gs_WaveResults[groupIndex / WAVE_SIZE] = result;
+    }
+    GroupMemoryBarrierWithGroupSync();
 
-    float3 l2;
-    l2.x = RgbToLuminance(prevFrameColors.Load(blockBaseCoord, int2(2, 1)).xyz);
-    l2.y = RgbToLuminance(prevFrameColors.Load(blockBaseCoord, int2(2, 3)).xyz);
-    l2.z = RgbToLuminance(prevFrameColors.Load(blockBaseCoord, int2(1, 4)).xyz);
+    if (groupIndex == 0)
+    {
+        [unroll]
+        for (uint stride = 1; stride < WAVES_PER_GROUP; stride *= 2)
+        {
+            [unroll]
+            for (uint wave = 0; wave + stride < WAVES_PER_GROUP; wave += 2 * stride)
+            {
+                gs_WaveResults[wave] = CombineResults(gs_WaveResults[wave], gs_WaveResults[wave + stride]);
+            }
+        }
+        result = gs_WaveResults[0];
+    }
+#endif
 
-    // Derivatives X
-    float4 a = float4(l0.y, l2.x, l1.y, l2.y);
-    float4 b = float4(l0.x, l0.w, l1.x, l1.w);
-    float4 dx = abs(a - b);
+    return result;
+#else
+    return ReduceTile(value, groupIndex);
+#endif
+}
 
-    // Derivatives Y
-    a = float4(l0.z, l1.y, l1.z, l2.z);
-    b = float4(l0.x, l0.w, l1.x, l1.w);
-    float4 dy = abs(a - b);
+[numthreads(GROUP_SIZE_X, GROUP_SIZE_Y, 1)]
+void main_cs(uint3 DispatchThreadID : SV_DispatchThreadID, uint3 GroupThreadID : SV_GroupThreadID, uint3 GroupID : SV_GroupID, uint GroupIndex : SV_GroupIndex)
+{
+    // Block of GROUP_SIZE_X x GROUP_SIZE_Y threads (each thread is a block of 2x4 pixels)
+    // Each block is responsible for loading data from a TILE_SIZE x TILE_SIZE pixel tile
+    int2 blockBaseCoord = int2(GroupID.xy * TILE_SIZE + (GroupThreadID.xy << uint2(1, 2)));
 
-    // Compute block average luma (8 total samples)
-    float4 sumAB = l0 + l1;
-    float avgLuma = (sumAB.x + sumAB.y + sumAB.z + sumAB.w) / 8;
-    avgLuma = WaveActiveSum(avgLuma) / WaveGetLaneCount() + ComputeNASDataParams.brightnessSensitivity;
+    BlockNasData block = EvaluateBlock(prevFrameColors, blockBaseCoord);
 
-    // Compute maximum partial derivative of all 16x16 pixels (256 total)
-    // one thread works on 2x4 pixels, one wave has 32 threads, 2x4x32 = 256
-    // this approach is more "sensitive" to individual outliers in a tile, since it takes the max instead of the average
-    float maxDx = max(max(dx.x, dx.y), max(dx.z, dx.w));
-    float maxDy = max(max(dy.x, dy.y), max(dy.z, dy.w));
-    float errX = WaveActiveMax(maxDx);
-    float errY = WaveActiveMax(maxDy);
+    // Maximum partial derivative of the block, reduced to the maximum of all pixels in the tile,
+    // or the mean squared derivative of the block, summed over the group for the L2 metric
+    float2 blockError = BlockError(block);
 
-    /*
-    // Alternative: compute block error using L2 norm; this is the original approach from the paper
-    // (Note: errorSensitivity threshold needs to be reduced to get similar quality)
-    float sumDxSq = dot(dx * dx, float4(1.0, 1.0, 1.0, 1.0)) / 4.0;
-    float sumDySq = dot(dy * dy, float4(1.0, 1.0, 1.0, 1.0)) / 4.0;
-    float errX = sqrt(WaveActiveSum(sumDxSq) / WaveGetLaneCount());
-    float errY = sqrt(WaveActiveSum(sumDySq) / WaveGetLaneCount());
-    */
+    float3 tileResult = ReduceGroup(float3(block.avgLuma, blockError), GroupIndex);
+    float2 tileError = FinishTileError(tileResult, blockError, GroupIndex);
 
     if (all(GroupThreadID.xy == 0))
     {
-        nasDataSurface[GroupID.xy] = float2(errX, errY) / abs(avgLuma);
+        nasDataSurface[GroupID.xy] = TileNasData(tileError, tileResult.x, ComputeNASDataParams.brightnessSensitivity);
     }
-}
\ No newline at end of file
+}
@@ -1,6 +1,7 @@
 #pragma pack_matrix(row_major)
 
 #include "Compute_cb.h"
+#include "NASCommon.hlsli"
 
 cbuffer ShadingRatePassCB : register(b0)
 {
@@ -9,15 +10,155 @@ cbuffer ShadingRatePassCB : register(b0)
 
 
 RWTexture2D<uint> vrsSurface : register(u0);
-Texture2D<float> gBufferDepth : register(t0);
 Texture2D<float2> nasDataSurface : register(t1);
 SamplerState s_Sampler : register(s0);
 
-groupshared uint groupMinDepth;
-
+// VRS tile size of the device, one shader permutation per supported size (8, 16 or 32)
+#ifndef TILE_SIZE
 #define TILE_SIZE 16
+#endif
+
+// INCREMENTAL=1 only recomputes the tiles listed by DetectNASChanges.hlsl, reusing the
+// reprojection and the sampled NAS data it stored in the tile signatures. vrsSurface then holds the rates of
+// earlier frames for all other tiles.
+#ifndef INCREMENTAL
+#define INCREMENTAL 0
+#endif
+
+// STEREO=1 covers all child views of a StereoPlanarView, side by side in one surface, in one
+// dispatch. Each tile uses the view that contains its center; the sensitivities and the source
+// size still come from ShadingRatePassParams, the reprojection from StereoParams.
+#ifndef STEREO
+#define STEREO 0
+#endif
+
+// Tile motion of the planar pass: 0 reprojects the tile center at the min depth of the tile with the
+// camera matrices, 1 and 2 take the average or the max motion over the tile from the motion vector
+// buffer, i.e. from every pixel instead of one point. The NAS data is then sampled at the tile
+// center moved by its motion vector.
+#ifndef MOTION_SOURCE
+#define MOTION_SOURCE 0
+#endif
+
+#if MOTION_SOURCE != 0 && (STEREO || INCREMENTAL)
+#error The motion vector sources are only implemented for the planar pass
+#endif
+
+// NAS data at a window position, filtered bilinearly and wrapping at the tiles of the render size.
+// When the surface has more tiles than that, i.e. with a render size below the render target
+// size, the sampler would wrap at the surface edges, so the filter is done with loads instead,
+// with the 8-bit weights of the sampler like FusedNAS.hlsl.
+float2 SampleNasData(float2 windowPos)
+{
+    float2 uv = windowPos * ShadingRatePassParams.sourceTextureSizeInv;
+
+    uint surfaceWidth, surfaceHeight;
+    nasDataSurface.GetDimensions(surfaceWidth, surfaceHeight);
+    float2 tileCount = float2(ShadingRatePassParams.tileCount);
+    if (all(ShadingRatePassParams.tileCount == uint2(surfaceWidth, surfaceHeight)))
+    {
+        return nasDataSurface.SampleLevel(s_Sampler, uv, 0);
+    }
+
+    int2 t0, t1;
+    float2 weight;
+    GetBilinearFootprint(uv, int2(tileCount), t0, t1, weight);
+
+    return BilinearFilter(
+        nasDataSurface.Load(int3(t0.x, t0.y, 0)), nasDataSurface.Load(int3(t1.x, t0.y, 0)),
+        nasDataSurface.Load(int3(t0.x, t1.y, 0)), nasDataSurface.Load(int3(t1.x, t1.y, 0)),
+        weight);
+}
+
+// Shading rate of a tile from its screen-space motion and the position its NAS data is sampled at
+uint ComputeTileShadingRate(float2 motion, float2 sampleWindowPos)
+{
+    return SelectShadingRate(SampleNasData(sampleWindowPos), motion,
+        ShadingRatePassParams.motionSensitivity, ShadingRatePassParams.errorSensitivity);
+}
+
+#if INCREMENTAL
+
+// Element 0 is the dirty tile count, followed by the tiles packed as x | (y << 16)
+StructuredBuffer<uint> dirtyTiles : register(t2);
+Texture2D<uint4> tileSignatures : register(t3);
+
+[numthreads(NAS_INCREMENTAL_GROUP_SIZE, 1, 1)]
+void main_cs(uint3 DispatchThreadID : SV_DispatchThreadID)
+{
+    if (DispatchThreadID.x >= dirtyTiles[0])
+    {
+        return;
+    }
+
+    uint packedTile = dirtyTiles[DispatchThreadID.x + 1];
+    uint2 tile = uint2(packedTile & 0xffff, packedTile >> 16);
+
+    float2 currWindowPos = (tile + 0.5) * TILE_SIZE;
+    uint4 signature = tileSignatures[tile];
+    float2 prevWindowPos = asfloat(signature.xy);
+
+    vrsSurface[tile] = SelectShadingRate(asfloat(signature.zw), prevWindowPos - currWindowPos,
+        ShadingRatePassParams.motionSensitivity, ShadingRatePassParams.errorSensitivity);
+}
+
+#else
+
+Texture2D<float> gBufferDepth : register(t0);
+
+#if STEREO
+
+cbuffer StereoCB : register(b1)
+{
+    NASStereoConstants StereoParams;
+};
+
+// The views are ordered left to right, a tile belongs to the last one starting at or before it
+NASViewConstants FindTileView(float2 windowPos)
+{
+    uint viewIndex = 0;
+    for (uint index = 1; index < StereoParams.viewCount; index++)
+    {
+        if (windowPos.x >= StereoParams.views[index].viewOrigin.x)
+        {
+            viewIndex = index;
+        }
+    }
+    return StereoParams.views[viewIndex];
+}
+
+// The motion comes from the previous frame of the tile's own view, the NAS data from the
+// previous frame of its error view. With shared error the right eye samples the left eye.
+uint ComputeStereoTileShadingRate(float2 currWindowPos, float depth)
+{
+    NASViewConstants view = FindTileView(currWindowPos);
 
-[numthreads(8, 4, 1)]
+    float2 viewPos = currWindowPos - view.viewOrigin;
+    float2 currUv = viewPos * view.viewSizeInv;
+
+    float2 prevWindowPos = ReprojectWindowPos(currUv, depth, view.reprojectionMatrix,
+        view.previousViewOrigin, view.previousViewSize, viewPos + view.previousViewOrigin);
+    float2 sampleWindowPos = ReprojectWindowPos(currUv, depth, view.errorReprojectionMatrix,
+        view.errorViewOrigin, view.errorViewSize, viewPos + view.errorViewOrigin);
+
+    if (StereoParams.clampToErrorView != 0)
+    {
+        // Keep the bilinear footprint on tiles of the error view, the others have no NAS data
+        float2 minPos = view.errorViewOrigin + 0.5 * TILE_SIZE;
+        float2 maxPos = max(minPos, float2(view.errorViewOrigin + view.errorViewSize) - 0.5 * TILE_SIZE);
+        sampleWindowPos = clamp(sampleWindowPos, minPos, maxPos);
+    }
+
+    return ComputeTileShadingRate(prevWindowPos - currWindowPos, sampleWindowPos);
+}
+
+#endif // STEREO
+
+#if MOTION_SOURCE == 0
+
+groupshared uint groupMinDepth;
+
+[numthreads(GROUP_SIZE_X, GROUP_SIZE_Y, 1)]
 void main_cs(uint3 DispatchThreadID : SV_DispatchThreadID, uint3 GroupThreadID : SV_GroupThreadID, uint3 GroupID : SV_GroupID)
 {
     uint screenWidth, screenHeight;
@@ -29,106 +170,88 @@ void main_cs(uint3 DispatchThreadID : SV_DispatchThreadID, uint3 GroupThreadID :
     }
     GroupMemoryBarrierWithGroupSync();
 
-    // Block of 8x4 threads (each thread is a block of 2x4 pixels)
-    // Each block is responsible for loading data from a 16x16 pixel tile
-    uint2 localID = GroupThreadID.xy;
-    localID <<= uint2(1, 2);
+    // Block of GROUP_SIZE_X x GROUP_SIZE_Y threads (each thread is a block of 2x4 pixels)
+    // Each block is responsible for loading data from a TILE_SIZE x TILE_SIZE pixel tile
+    int2 blockBaseCoord = int2(GroupID.xy * TILE_SIZE + (GroupThreadID.xy << uint2(1, 2)));
 
-    // Tile global location
-    uint2 tileOffset = GroupID.xy << 4;
-
-    // Global block coordinates
-    int3 blockBaseCoord = int3(tileOffset + localID, 0);
-
-    // Sample depth in the 2x4 block of each thread
-    // sparsely sampling only four of the eight samples
-    float4 depth;
-    depth.x = gBufferDepth.Load(blockBaseCoord, int2(0, 0)).x;
-    depth.y = gBufferDepth.Load(blockBaseCoord, int2(1, 1)).x;
-    depth.z = gBufferDepth.Load(blockBaseCoord, int2(0, 2)).x;
-    depth.w = gBufferDepth.Load(blockBaseCoord, int2(1, 3)).x;
-
-    // Reduction: find block minimum depth (corresponding to largest motion in block)
-    depth.xy = min(depth.xy, depth.zw);
-    depth.x = min(depth.x, depth.y);
-    InterlockedMin(groupMinDepth, asuint(depth.x));
+    // Sample depth in the 2x4 block of each thread, sparsely sampling only four of the eight samples
+    InterlockedMin(groupMinDepth, asuint(LoadBlockMinDepth(gBufferDepth, blockBaseCoord)));
 
     GroupMemoryBarrierWithGroupSync();
 
     if (all(GroupThreadID.xy == 0))
     {
         // Compute motion vector by reconstructing and reprojecting clipPos of the tile center
-        // currWindowPos assumes only a single view, safe for non-stereo cases
         float2 currWindowPos = (GroupID.xy + 0.5) * TILE_SIZE;
+
+#if STEREO
+        vrsSurface[GroupID.xy] = ComputeStereoTileShadingRate(currWindowPos, asfloat(groupMinDepth));
+#else
+        // The view covers the render size
         float2 currUv = currWindowPos * ShadingRatePassParams.sourceTextureSizeInv;
 
-        float4 clipPos;
-        clipPos.x = currUv.x * 2 - 1;
-        clipPos.y = 1 - currUv.y * 2;
-        clipPos.z = asfloat(groupMinDepth);
-        clipPos.w = 1;
+        float2 prevWindowPos = ReprojectWindowPos(currUv, asfloat(groupMinDepth), ShadingRatePassParams.reprojectionMatrix,
+            ShadingRatePassParams.previousViewOrigin, ShadingRatePassParams.previousViewSize, currWindowPos);
 
-        float2 mVec = float2(0, 0);
-        float4 prevClipPos = mul(clipPos, ShadingRatePassParams.reprojectionMatrix);
+        vrsSurface[GroupID.xy] = ComputeTileShadingRate(prevWindowPos - currWindowPos, prevWindowPos);
+#endif
+    }
+}
 
-        float2 prevWindowPos = currWindowPos;
+#else // MOTION_SOURCE
 
-        if (prevClipPos.w > 0)
-        {
-            prevClipPos.xyz /= prevClipPos.w;
-            float2 prevUV;
-            prevUV.x = 0.5 + prevClipPos.x * 0.5;
-            prevUV.y = 0.5 - prevClipPos.y * 0.5;
+// The motion vectors of the previous frame, complete with the object motion of the G-buffer fill.
+// Like the NAS data they lag a frame, the tile is assumed to keep its motion.
+Texture2D<float2> motionVectors : register(t2);
 
-            prevWindowPos = prevUV * ShadingRatePassParams.previousViewSize + ShadingRatePassParams.previousViewOrigin;
-            mVec = prevWindowPos.xy - currWindowPos.xy;
-        }
+// [0, 1]: max abs motion in X and Y as float bits, which order like uints for non-negative values
+// [2, 3]: sum of the abs motion in X and Y, in 1/MOTION_SUM_SCALE pixels so the sum does not
+// depend on the order the waves add in
+groupshared uint groupMotion[4];
 
-        mVec = abs(mVec) * ShadingRatePassParams.motionSensitivity;
-
-        // Error scalers (equations from the I3D 2019 paper)
-        // bhv for half rate, bqv for quarter rate
-        float2 bhv = pow(1.0 / (1 + pow(1.05 * mVec, 3.1)), 0.35);
-        float2 bqv = 2.13 * pow(1.0 / (1 + pow(0.55 * mVec, 2.41)), 0.49);
-
-        // Sample block error data from NAS data pass and apply the error scalars
-        float2 diff = nasDataSurface.SampleLevel(s_Sampler, prevWindowPos * ShadingRatePassParams.sourceTextureSizeInv, 0).rg;
-        float2 diff2 = diff * bhv;
-        float2 diff4 = diff * bqv;
-
-        float threshold = ShadingRatePassParams.errorSensitivity;
-
-        /*
-            D3D12_SHADING_RATE_1X1	= 0,   // 0b0000
-            D3D12_SHADING_RATE_1X2	= 0x1, // 0b0001
-            D3D12_SHADING_RATE_2X1	= 0x4, // 0b0100
-            D3D12_SHADING_RATE_2X2	= 0x5, // 0b0101
-            D3D12_SHADING_RATE_2X4	= 0x6, // 0b0110
-            D3D12_SHADING_RATE_4X2	= 0x9, // 0b1001
-            D3D12_SHADING_RATE_4X4	= 0xa  // 0b1010
-        */
-
-        // Compute block shading rate based on if the error computation goes over the threshold
-        // shading rates in D3D are purposely designed to be able to combined, e.g. 2x1 | 1x2 = 2x2
-        uint ShadingRate = 0;
-        ShadingRate |= ((diff2.x >= threshold) ? 0 : ((diff4.x > threshold) ? 0x4 : 0x8));
-        ShadingRate |= ((diff2.y >= threshold) ? 0 : ((diff4.y > threshold) ? 0x1 : 0x2));
-
-        // Disable 4x4 shading rate (low quality, limited perf gain)
-        if (ShadingRate == 0xa)
-        {
-            ShadingRate = (diff2.x > diff2.y) ? 0x6 : 0x9; // use 2x4 or 4x2 based on directional gradient
-        }
-        // Disable 4x1 or 1x4 shading rate (unsupported)
-        else if (ShadingRate == 0x8)
-        {
-            ShadingRate = 0x4;
-        }
-        else if (ShadingRate == 0x2)
-        {
-            ShadingRate = 0x1;
-        }
+[numthreads(GROUP_SIZE_X, GROUP_SIZE_Y, 1)]
+void main_cs(uint3 GroupThreadID : SV_GroupThreadID, uint3 GroupID : SV_GroupID)
+{
+    if (all(GroupThreadID.xy == 0))
+    {
+        groupMotion[0] = 0;
+        groupMotion[1] = 0;
+        groupMotion[2] = 0;
+        groupMotion[3] = 0;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    int2 blockBaseCoord = int2(GroupID.xy * TILE_SIZE + (GroupThreadID.xy << uint2(1, 2)));
+
+    // Same sparse four of the eight pixels of the 2x4 block as the depth above
+    float2 blockMax;
+    uint2 blockSum;
+    LoadBlockMotion(motionVectors, blockBaseCoord, blockMax, blockSum);
+
+    float2 waveMax = WaveActiveMax(blockMax);
+    uint2 waveSum = WaveActiveSum(blockSum);
 
-        vrsSurface[GroupID.xy] = ShadingRate;
+    if (WaveIsFirstLane())
+    {
+        InterlockedMax(groupMotion[0], asuint(waveMax.x));
+        InterlockedMax(groupMotion[1], asuint(waveMax.y));
+        InterlockedAdd(groupMotion[2], waveSum.x);
+        InterlockedAdd(groupMotion[3], waveSum.y);
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    if (all(GroupThreadID.xy == 0))
+    {
+        float2 tileMotion = TileMotion(asfloat(uint2(groupMotion[0], groupMotion[1])), uint2(groupMotion[2], groupMotion[3]), MOTION_SOURCE);
+
+        // The NAS data is sampled where the tile center was in the previous frame, one frame of motion back
+        float2 currWindowPos = (GroupID.xy + 0.5) * TILE_SIZE;
+        float2 prevWindowPos = currWindowPos + motionVectors[uint2(currWindowPos)];
+
+        vrsSurface[GroupID.xy] = ComputeTileShadingRate(tileMotion, prevWindowPos);
     }
 }
+
+#endif // MOTION_SOURCE
+
+#endif // INCREMENTAL
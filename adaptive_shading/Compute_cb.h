@@ -7,14 +7,101 @@ struct ComputeNASDataConstants
     float brightnessSensitivity;
 };
 
+// Per-tile error of ComputeNASData.hlsl, the ERROR_METRIC permutations and nas::ErrorMetric
+#define NAS_ERROR_METRIC_MAX 0          // largest derivative of the tile
+#define NAS_ERROR_METRIC_L2 1           // root mean square of the derivatives
+#define NAS_ERROR_METRIC_PERCENTILE 2   // block maximum exceeded by 1/NAS_ERROR_PERCENTILE_DIVISOR of the blocks
+#define NAS_ERROR_PERCENTILE_DIVISOR 8
+
 struct AdaptiveShadingConstants
 {
     float4x4 reprojectionMatrix;
     uint2 previousViewOrigin;
     uint2 previousViewSize;
-    float2 sourceTextureSizeInv;
+    float2 sourceTextureSizeInv;        // of the render size, the part of the render targets in use
     float errorSensitivity;
     float motionSensitivity;
+    uint2 tileCount;                    // tiles of the render size, the NAS surfaces may have more (GPU passes only)
+    uint2 padding;
+};
+
+// Output tiles per FusedNAS.hlsl group in X and Y
+#define FUSED_NAS_GROUP_TILES 16
+
+// The smoothing radius, the error metric and the motion source are shader permutations
+struct FusedNASConstants
+{
+    AdaptiveShadingConstants shadingRate;
+    float brightnessSensitivity;
+    uint padding;
+};
+
+// Child views of a StereoPlanarView, which share one rate surface
+#define NAS_MAX_VIEWS 2
+
+// One view of the STEREO permutation of ComputeShadingRate.hlsl
+struct NASViewConstants
+{
+    float4x4 reprojectionMatrix;        // to the previous frame of this view, for the motion
+    float4x4 errorReprojectionMatrix;   // to the previous frame of the view whose NAS data is sampled
+    float2 viewOrigin;                  // current viewport in pixels
+    float2 viewSizeInv;
+    uint2 previousViewOrigin;
+    uint2 previousViewSize;
+    uint2 errorViewOrigin;              // previous viewport of the view whose NAS data is sampled
+    uint2 errorViewSize;
+};
+
+struct NASStereoConstants
+{
+    NASViewConstants views[NAS_MAX_VIEWS];
+    uint viewCount;
+    uint clampToErrorView;  // set when the NAS data only covers the sampled views
+};
+
+// Threads per group of the incremental ComputeShadingRate.hlsl pass, one thread per dirty tile
+#define NAS_INCREMENTAL_GROUP_SIZE 64
+
+struct NASChangeDetectionConstants
+{
+    AdaptiveShadingConstants shadingRate;
+    float motionTolerance;  // reprojected tile center movement in pixels that keeps a tile clean
+    float errorTolerance;   // sampled NAS data change that keeps a tile clean, in units of the error sensitivity
+    uint forceDirty;        // set when the previous rates are invalid, e.g. after a resize
+};
+
+// Smoothing and the rate visualization only cover the tiles of the render size
+struct NASSurfaceConstants
+{
+    uint2 tileCount;
+    float2 windowToRenderScale;     // rate visualization: render pixels per window pixel
+};
+
+// Layout of the ShadingRateHistogram.hlsl output, in uints. The counts match nas::RateStatistics.
+#define NAS_HISTOGRAM_GROUP_SIZE 8      // tiles per group in X and Y
+#define NAS_HISTOGRAM_BUCKETS 8
+#define NAS_HISTOGRAM_TILE_COUNTS 0     // 16 counters, indexed by rate code
+#define NAS_HISTOGRAM_PIXELS 16
+#define NAS_HISTOGRAM_INVOCATIONS 17
+#define NAS_HISTOGRAM_COARSE_PIXELS 18
+#define NAS_HISTOGRAM_LIT_PIXELS 19     // copied from the VRSDeferredLighting.hlsl counter, see RateHistogram::RecordLitPixels
+#define NAS_HISTOGRAM_MOTION 20         // NAS_HISTOGRAM_BUCKETS counters each
+#define NAS_HISTOGRAM_ERROR 28
+#define NAS_HISTOGRAM_SIZE 36
+
+// Bucket 1 holds tiles that move 0.5 to 1 pixels, bucket 0 anything slower, every further bucket
+// doubles the motion
+#define NAS_HISTOGRAM_MIN_MOTION 0.5
+// Bucket 4 holds tiles whose NAS error is 1 to 2 times the error sensitivity, every bucket doubles
+#define NAS_HISTOGRAM_ERROR_THRESHOLD_BUCKET 4
+
+struct NASHistogramConstants
+{
+    uint2 renderSize;
+    float errorSensitivity;
+    uint motionValid;       // the motion vectors are from this frame
+    uint errorValid;        // the NAS data surface is from this frame, i.e. NAS did not use the fused pass
+    uint3 padding;
 };
 
 #endif // COMPUTE_CB_H
\ No newline at end of file
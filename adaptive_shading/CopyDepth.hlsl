@@ -0,0 +1,17 @@
+// Copies the depth buffer into an R32_FLOAT texture that can be read back for NAS captures,
+// depth formats cannot be copied to staging textures in a portable way
+
+Texture2D<float> depthBuffer : register(t0);
+RWTexture2D<float> depthOutput : register(u0);
+
+[numthreads(16, 16, 1)]
+void main_cs(uint3 DispatchThreadID : SV_DispatchThreadID)
+{
+    uint width, height;
+    depthOutput.GetDimensions(width, height);
+
+    if (DispatchThreadID.x >= width || DispatchThreadID.y >= height)
+        return;
+
+    depthOutput[DispatchThreadID.xy] = depthBuffer[DispatchThreadID.xy];
+}
@@ -0,0 +1,105 @@
+#pragma pack_matrix(row_major)
+
+#include "Compute_cb.h"
+
+cbuffer ChangeDetectionCB : register(b0)
+{
+    NASChangeDetectionConstants ChangeDetectionParams;
+};
+
+// Per tile: reprojected tile center (asuint) in xy, the NAS data sampled at it (asuint) in zw.
+// The incremental ComputeShadingRate.hlsl pass computes the rate from these values.
+RWTexture2D<uint4> tileSignatures : register(u0);
+
+// Element 0 is the dirty tile count, followed by the tiles packed as x | (y << 16)
+RWStructuredBuffer<uint> dirtyTiles : register(u1);
+
+// Dispatch arguments of the incremental ComputeShadingRate.hlsl pass, reset to (0, 1, 1) every frame
+RWBuffer<uint> dispatchArgs : register(u2);
+
+Texture2D<float> gBufferDepth : register(t0);
+Texture2D<float2> nasDataSurface : register(t1);
+
+groupshared uint groupMinDepth;
+
+// VRS tile size of the device, one shader permutation per supported size (8, 16 or 32)
+#ifndef TILE_SIZE
+#define TILE_SIZE 16
+#endif
+
+#include "NASCommon.hlsli"
+
+// NAS data at uv, filtered with loads like ComputeShadingRate.hlsl does when the surface is larger
+// than the render size; there is no sampler here, and the stored value only needs to be consistent
+// from frame to frame
+float2 SampleNasData(float2 uv)
+{
+    int2 t0, t1;
+    float2 weight;
+    GetBilinearFootprint(uv, int2(ChangeDetectionParams.shadingRate.tileCount), t0, t1, weight);
+
+    return BilinearFilter(
+        nasDataSurface.Load(int3(t0.x, t0.y, 0)), nasDataSurface.Load(int3(t1.x, t0.y, 0)),
+        nasDataSurface.Load(int3(t0.x, t1.y, 0)), nasDataSurface.Load(int3(t1.x, t1.y, 0)),
+        weight);
+}
+
+// Finds the tiles whose shading rate inputs changed since their rate was last computed:
+// the tile center reprojected at its min depth, which covers depth and camera motion,
+// and the NAS data the shading rate pass samples at that position. Both are compared with a
+// tolerance, the NAS data relative to the error sensitivity that its rate thresholds scale with,
+// so the small changes TAA jitter causes every frame can keep a tile clean.
+[numthreads(GROUP_SIZE_X, GROUP_SIZE_Y, 1)]
+void main_cs(uint3 GroupThreadID : SV_GroupThreadID, uint3 GroupID : SV_GroupID)
+{
+    if (all(GroupThreadID.xy == 0))
+    {
+        groupMinDepth = asuint(1.0f);
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    // Sparse min depth, same samples as ComputeShadingRate.hlsl
+    int2 blockBaseCoord = int2(GroupID.xy * TILE_SIZE + (GroupThreadID.xy << uint2(1, 2)));
+    InterlockedMin(groupMinDepth, asuint(LoadBlockMinDepth(gBufferDepth, blockBaseCoord)));
+
+    GroupMemoryBarrierWithGroupSync();
+
+    if (any(GroupThreadID.xy != 0))
+    {
+        return;
+    }
+
+    AdaptiveShadingConstants params = ChangeDetectionParams.shadingRate;
+
+    float2 currWindowPos = (GroupID.xy + 0.5) * TILE_SIZE;
+    float2 currUv = currWindowPos * params.sourceTextureSizeInv;
+    float2 prevWindowPos = ReprojectWindowPos(currUv, asfloat(groupMinDepth), params.reprojectionMatrix,
+        params.previousViewOrigin, params.previousViewSize, currWindowPos);
+
+    float2 sampledError = SampleNasData(prevWindowPos * params.sourceTextureSizeInv);
+
+    uint4 signature = tileSignatures[GroupID.xy];
+    float errorTolerance = ChangeDetectionParams.errorTolerance * params.errorSensitivity;
+    bool dirty = ChangeDetectionParams.forceDirty != 0
+        || any(abs(asfloat(signature.zw) - sampledError) > errorTolerance)
+        || any(abs(asfloat(signature.xy) - prevWindowPos) > ChangeDetectionParams.motionTolerance);
+
+    if (!dirty)
+    {
+        return;
+    }
+
+    // Clean tiles keep the signature of the frame their rate was computed in, so slow changes
+    // below the tolerances still add up to a recompute
+    tileSignatures[GroupID.xy] = uint4(asuint(prevWindowPos), asuint(sampledError));
+
+    uint index;
+    InterlockedAdd(dirtyTiles[0], 1, index);
+    dirtyTiles[index + 1] = GroupID.x | (GroupID.y << 16);
+
+    // One more incremental group for every NAS_INCREMENTAL_GROUP_SIZE dirty tiles
+    if (index % NAS_INCREMENTAL_GROUP_SIZE == 0)
+    {
+        InterlockedAdd(dispatchArgs[0], 1);
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef ERROR_SCALER_TABLE_H
+#define ERROR_SCALER_TABLE_H
+
+// Error scalers of the rate selection, see nas/ErrorScalers.h. Entry i holds the scalers of the
+// scaled tile motion 1 / (1 - p)^2 - 1 with p = i / (NAS_ERROR_SCALER_ENTRIES - 1).
+// Generated by nas_benchmark -write-error-scalers, do not edit.
+
+#define NAS_ERROR_SCALER_ENTRIES 129
+
+#define NAS_HALF_RATE_SCALERS { \
+    1.0, 0.999998927, 0.999990523, 0.999965489, 0.999912679, 0.999818861, 0.999668896, 0.999445319, \
+    0.999128103, 0.998694479, 0.998118937, 0.997372568, 0.996423304, 0.995235384, 0.993769407, 0.991982222, \
+    0.989826918, 0.987252891, 0.9842062, 0.980629802, 0.976464391, 0.971648932, 0.966122031, 0.959823012, \
+    0.952693462, 0.944679081, 0.935731411, 0.925810039, 0.914884329, 0.902935386, 0.889957547, 0.875959575, \
+    0.86096555, 0.845014513, 0.828160405, 0.81047076, 0.79202497, 0.772912204, 0.753229022, 0.733076632, \
+    0.71255821, 0.691776574, 0.670831919, 0.649819553, 0.628828883, 0.607941866, 0.587232471, 0.566766202, \
+    0.546600044, 0.526782632, 0.507354736, 0.488349408, 0.469793081, 0.451705813, 0.434102237, 0.416992009, \
+    0.400380611, 0.384269893, 0.368658632, 0.353543043, 0.338917196, 0.324773461, 0.311102808, 0.297895193, \
+    0.28513974, 0.272824943, 0.260938972, 0.249469727, 0.238404945, 0.22773245, 0.217440099, 0.207515895, \
+    0.197948083, 0.188725159, 0.179835886, 0.171269387, 0.163015082, 0.15506275, 0.14740251, 0.140024841, \
+    0.132920578, 0.126080915, 0.119497381, 0.11316184, 0.107066497, 0.101203874, 0.0955667943, 0.0901483968, \
+    0.084942095, 0.0799416006, 0.0751408786, 0.0705341473, 0.0661159009, 0.061880827, 0.0578238741, 0.0539401881, \
+    0.0502251312, 0.0466742478, 0.0432832837, 0.0400481522, 0.0369649455, 0.034029901, 0.0312394239, 0.0285900515, \
+    0.0260784626, 0.0237014648, 0.021455979, 0.0193390455, 0.0173478052, 0.0154794967, 0.013731447, 0.0121010635, \
+    0.0105858268, 0.00918327738, 0.00789101142, 0.0067066662, 0.00562790828, 0.00465242099, 0.00377788558, 0.00300196465, \
+    0.00232227426, 0.00173635327, 0.00124162005, 0.000835311483, 0.000514392392, 0.000275407656, 0.000114212628, 2.53742219e-05, \
+    0.0 }
+
+#define NAS_QUARTER_RATE_SCALERS { \
+    2.13000011, 2.12998867, 2.12993836, 2.12983131, 2.12965274, 2.12938762, 2.12902117, 2.12853813, \
+    2.12792206, 2.12715578, 2.12622118, 2.12509871, 2.12376738, 2.12220573, 2.12038946, 2.118294, \
+    2.11589193, 2.11315513, 2.11005306, 2.10655355, 2.10262227, 2.09822369, 2.09331942, 2.08786964, \
+    2.08183289, 2.07516551, 2.06782246, 2.05975676, 2.0509212, 2.0412662, 2.03074265, 2.01929998, \
+    2.0068891, 1.9934603, 1.978966, 1.96335983, 1.94659841, 1.92864156, 1.90945315, 1.88900208, \
+    1.86726284, 1.8442167, 1.81985235, 1.79416633, 1.76716399, 1.73886013, 1.70927906, 1.67845511, \
+    1.6464324, 1.61326528, 1.57901716, 1.5437609, 1.5075773, 1.47055483, 1.43278837, 1.39437795, \
+    1.35542774, 1.31604445, 1.27633643, 1.23641205, 1.19637871, 1.15634131, 1.11640155, 1.07665706, \
+    1.03720021, 0.998117864, 0.959490538, 0.921392262, 0.88389051, 0.84704572, 0.810911477, 0.775534868, \
+    0.740956247, 0.707209885, 0.674324095, 0.642321587, 0.611219883, 0.581031859, 0.551765919, 0.523426592, \
+    0.496014774, 0.469528258, 0.443962008, 0.419308543, 0.395558268, 0.372699708, 0.350719929, 0.329604626, \
+    0.309338391, 0.289905071, 0.27128768, 0.253468812, 0.236430675, 0.22015518, 0.204624131, 0.189819261, \
+    0.175722346, 0.162315249, 0.149580002, 0.137498811, 0.126054168, 0.115228742, 0.105005562, 0.0953679159, \
+    0.0862993971, 0.0777838975, 0.0698056296, 0.0623490661, 0.0553989708, 0.048940368, 0.0429585055, 0.0374388434, \
+    0.0323670134, 0.0277287811, 0.0235100035, 0.0196965765, 0.0162743758, 0.0132291829, 0.0105465986, 0.00821194425, \
+    0.00621012831, 0.00452548079, 0.00314153708, 0.00204073754, 0.00120399066, 0.000609991199, 0.000234031686, 4.55206136e-05, \
+    0.0 }
+
+#endif // ERROR_SCALER_TABLE_H
@@ -0,0 +1,24 @@
+#include "ErrorScalerTable.h"
+
+// Error scalers of the rate selection (equations from the I3D 2019 paper), interpolated from the
+// table nas/ErrorScalers.h builds at compile time instead of evaluating two pow chains per tile.
+// The table is indexed by p = 1 - 1 / sqrt(1 + m) of the scaled motion m, so it covers any motion
+// and has more entries toward large motion, where the scalers approach zero.
+
+static const float c_HalfRateScalers[NAS_ERROR_SCALER_ENTRIES] = NAS_HALF_RATE_SCALERS;
+static const float c_QuarterRateScalers[NAS_ERROR_SCALER_ENTRIES] = NAS_QUARTER_RATE_SCALERS;
+
+// bhv for half rate, bqv for quarter rate, per direction of the scaled tile motion mVec
+void GetErrorScalers(float2 mVec, out float2 bhv, out float2 bqv)
+{
+    float2 position = (1 - rsqrt(1 + mVec)) * (NAS_ERROR_SCALER_ENTRIES - 1);
+    uint2 index = min(uint2(position), uint2(NAS_ERROR_SCALER_ENTRIES - 2, NAS_ERROR_SCALER_ENTRIES - 2));
+    float2 weight = position - float2(index);
+
+    [unroll]
+    for (uint i = 0; i < 2; i++)
+    {
+        bhv[i] = lerp(c_HalfRateScalers[index[i]], c_HalfRateScalers[index[i] + 1], weight[i]);
+        bqv[i] = lerp(c_QuarterRateScalers[index[i]], c_QuarterRateScalers[index[i] + 1], weight[i]);
+    }
+}
@@ -0,0 +1,228 @@
+#pragma pack_matrix(row_major)
+
+#include "Compute_cb.h"
+
+// Single-dispatch version of ComputeNASData, ComputeShadingRate and SmoothShadingRate.
+//
+// Each group produces FUSED_NAS_GROUP_TILES^2 shading rates. It computes the NAS data of the
+// tiles its rates sample from into groupshared memory instead of reading m_NASDataSurface,
+// then the rates of its tiles plus a halo of SMOOTH_RADIUS tiles, and finally smooths the output
+// tiles using the halo, so no UAV barriers or intermediate surfaces are needed.
+// The NAS data is rounded to 16-bit floats and filtered with 8-bit weights to match the
+// RG16_FLOAT surface and the bilinear sampler of the three-pass version. The per-tile steps come
+// from NASCommon.hlsli, the same code the separate passes run.
+
+cbuffer FusedNASPassCB : register(b0)
+{
+    FusedNASConstants FusedNASParams;
+};
+
+RWTexture2D<uint> vrsSurface : register(u0);
+Texture2D<float4> prevFrameColors : register(t0);
+Texture2D<float> gBufferDepth : register(t1);
+// The previous frame's motion vectors of the MOTION_SOURCE permutations, see ComputeShadingRate.hlsl
+Texture2D<float2> motionVectors : register(t2);
+
+#ifndef TILE_SIZE
+#define TILE_SIZE 16
+#endif
+
+// Smoothing radius like SmoothShadingRate.hlsl, 0 disables the smoothing
+#ifndef SMOOTH_RADIUS
+#define SMOOTH_RADIUS 1
+#endif
+
+// Tile motion like the planar ComputeShadingRate.hlsl pass
+#ifndef MOTION_SOURCE
+#define MOTION_SOURCE 0
+#endif
+
+#define GROUP_TILES FUSED_NAS_GROUP_TILES
+#define GROUP_THREADS_TOTAL 256
+// Each worker is a thread block of one tile with one thread per 2x4 pixel block,
+// like a group of the separate passes; 256 threads per group for every tile size
+#define WORKERS (GROUP_THREADS_TOTAL / ((TILE_SIZE / 2) * (TILE_SIZE / 4)))
+#define NAS_REDUCTION_TILES WORKERS
+#include "NASCommon.hlsli"
+
+// Rates of the output tiles plus the smoothing halo
+#define RATE_TILES (GROUP_TILES + 2 * SMOOTH_RADIUS)
+// NAS data under the bilinear footprint of those rates for motion below one tile. Larger motion
+// samples the edge of the cache, see FetchNasData.
+#define CACHE_TILES (RATE_TILES + 2)
+#define CACHE_ITERATIONS ((CACHE_TILES * CACHE_TILES + WORKERS - 1) / WORKERS)
+#define RATE_ITERATIONS ((RATE_TILES * RATE_TILES + WORKERS - 1) / WORKERS)
+
+groupshared float2 gs_NasData[CACHE_TILES * CACHE_TILES];
+groupshared uint gs_Rates[RATE_TILES * RATE_TILES];
+#if MOTION_SOURCE == 0
+// Min depth of the rate tiles as float bits, which order like uints for non-negative values
+groupshared uint gs_TileDepth[RATE_TILES * RATE_TILES];
+#else
+// Per rate tile: max abs motion in X and Y as float bits, and the fixed point sums of the abs motion
+groupshared uint gs_TileMotion[RATE_TILES * RATE_TILES * 4];
+#endif
+
+int2 WrapTile(int2 tile, int2 tileCount)
+{
+    return ((tile % tileCount) + tileCount) % tileCount;
+}
+
+// tile is wrapped into the surface, the cache holds the wrapped tiles around cacheOrigin.
+// Tiles outside of the cache, under a footprint moved by more than a tile, are clamped to its edge.
+// That bounds the cost of fast motion, which selects coarse rates through the error scalers anyway;
+// the rates then differ from the three-pass version only for such tiles and their smoothed neighbors.
+float2 FetchNasData(int2 tile, int2 cacheOrigin, int2 tileCount)
+{
+    int2 local = tile - cacheOrigin;
+    local.x += (local.x < 0) ? tileCount.x : ((local.x >= CACHE_TILES) ? -tileCount.x : 0);
+    local.y += (local.y < 0) ? tileCount.y : ((local.y >= CACHE_TILES) ? -tileCount.y : 0);
+    local = clamp(local, 0, CACHE_TILES - 1);
+
+    return gs_NasData[local.y * CACHE_TILES + local.x];
+}
+
+float2 SampleNasData(float2 uv, int2 cacheOrigin, int2 tileCount)
+{
+    int2 t0, t1;
+    float2 weight;
+    GetBilinearFootprint(uv, tileCount, t0, t1, weight);
+
+    return BilinearFilter(
+        FetchNasData(int2(t0.x, t0.y), cacheOrigin, tileCount), FetchNasData(int2(t1.x, t0.y), cacheOrigin, tileCount),
+        FetchNasData(int2(t0.x, t1.y), cacheOrigin, tileCount), FetchNasData(int2(t1.x, t1.y), cacheOrigin, tileCount),
+        weight);
+}
+
+// Shading rate of the rate tile at rateIndex, from the depth or motion its blocks reduced
+uint ComputeTileRate(int2 tile, uint rateIndex, int2 cacheOrigin, int2 tileCount)
+{
+    AdaptiveShadingConstants params = FusedNASParams.shadingRate;
+
+    float2 currWindowPos = (tile + 0.5) * TILE_SIZE;
+
+#if MOTION_SOURCE == 0
+    float2 currUv = currWindowPos * params.sourceTextureSizeInv;
+    float2 prevWindowPos = ReprojectWindowPos(currUv, asfloat(gs_TileDepth[rateIndex]), params.reprojectionMatrix,
+        params.previousViewOrigin, params.previousViewSize, currWindowPos);
+    float2 motion = prevWindowPos - currWindowPos;
+#else
+    uint motionIndex = rateIndex * 4;
+    float2 motion = TileMotion(asfloat(uint2(gs_TileMotion[motionIndex], gs_TileMotion[motionIndex + 1])),
+        uint2(gs_TileMotion[motionIndex + 2], gs_TileMotion[motionIndex + 3]), MOTION_SOURCE);
+    float2 prevWindowPos = currWindowPos + motionVectors[uint2(currWindowPos)];
+#endif
+
+    float2 diff = SampleNasData(prevWindowPos * params.sourceTextureSizeInv, cacheOrigin, tileCount);
+    return SelectShadingRate(diff, motion, params.motionSensitivity, params.errorSensitivity);
+}
+
+[numthreads(GROUP_SIZE_X, GROUP_SIZE_Y, WORKERS)]
+void main_cs(uint3 GroupThreadID : SV_GroupThreadID, uint GroupIndex : SV_GroupIndex, uint3 GroupID : SV_GroupID)
+{
+    // The surface may have more tiles than the render size
+    int2 tileCount = int2(FusedNASParams.shadingRate.tileCount);
+
+    uint worker = GroupThreadID.z;
+    uint lane = GroupThreadID.y * GROUP_SIZE_X + GroupThreadID.x;
+    int2 blockOffset = int2(GroupThreadID.xy << uint2(1, 2));
+
+    int2 outputOrigin = int2(GroupID.xy) * GROUP_TILES;
+    int2 rateOrigin = outputOrigin - SMOOTH_RADIUS;
+    int2 cacheOrigin = rateOrigin - 1;
+
+    // Cleared before the first barrier of the cache loop, read after it
+    for (uint clearIndex = GroupIndex; clearIndex < RATE_TILES * RATE_TILES; clearIndex += GROUP_THREADS_TOTAL)
+    {
+#if MOTION_SOURCE == 0
+        gs_TileDepth[clearIndex] = asuint(1.0f);
+#else
+        gs_TileMotion[clearIndex * 4 + 0] = 0;
+        gs_TileMotion[clearIndex * 4 + 1] = 0;
+        gs_TileMotion[clearIndex * 4 + 2] = 0;
+        gs_TileMotion[clearIndex * 4 + 3] = 0;
+#endif
+    }
+
+    // NAS data of the cached tiles, one tile per worker and iteration, reduced in parallel like the
+    // groupshared variant of ComputeNASData. The last iteration may leave workers idle; they still
+    // take part in the barriers.
+    for (uint cacheIteration = 0; cacheIteration < CACHE_ITERATIONS; cacheIteration++)
+    {
+        uint cacheIndex = cacheIteration * WORKERS + worker;
+        bool active = cacheIndex < CACHE_TILES * CACHE_TILES;
+
+        int2 tile = WrapTile(cacheOrigin + int2(cacheIndex % CACHE_TILES, cacheIndex / CACHE_TILES), tileCount);
+        BlockNasData block = EvaluateBlock(prevFrameColors, tile * TILE_SIZE + blockOffset);
+        float2 blockError = BlockError(block);
+
+        float3 tileResult = ReduceTile(float3(block.avgLuma, blockError), GroupIndex);
+        float2 tileError = FinishTileError(tileResult, blockError, GroupIndex);
+
+        if (active && lane == 0)
+        {
+            float2 nasData = TileNasData(tileError, tileResult.x, FusedNASParams.brightnessSensitivity);
+            gs_NasData[cacheIndex] = f16tof32(f32tof16(nasData));
+        }
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    // Depth or motion of the rate tiles, reduced with atomics into a slot per tile
+    for (uint rateIteration = 0; rateIteration < RATE_ITERATIONS; rateIteration++)
+    {
+        uint rateIndex = rateIteration * WORKERS + worker;
+        int2 tile = rateOrigin + int2(rateIndex % RATE_TILES, rateIndex / RATE_TILES);
+
+        if (rateIndex < RATE_TILES * RATE_TILES && all(tile >= 0) && all(tile < tileCount))
+        {
+            int2 blockBaseCoord = tile * TILE_SIZE + blockOffset;
+#if MOTION_SOURCE == 0
+            InterlockedMin(gs_TileDepth[rateIndex], asuint(LoadBlockMinDepth(gBufferDepth, blockBaseCoord)));
+#else
+            float2 blockMax;
+            uint2 blockSum;
+            LoadBlockMotion(motionVectors, blockBaseCoord, blockMax, blockSum);
+            InterlockedMax(gs_TileMotion[rateIndex * 4 + 0], asuint(blockMax.x));
+            InterlockedMax(gs_TileMotion[rateIndex * 4 + 1], asuint(blockMax.y));
+            InterlockedAdd(gs_TileMotion[rateIndex * 4 + 2], blockSum.x);
+            InterlockedAdd(gs_TileMotion[rateIndex * 4 + 3], blockSum.y);
+#endif
+        }
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    // Shading rates of the output tiles and the halo, one tile per thread
+    for (uint rateTile = GroupIndex; rateTile < RATE_TILES * RATE_TILES; rateTile += GROUP_THREADS_TOTAL)
+    {
+        int2 tile = rateOrigin + int2(rateTile % RATE_TILES, rateTile / RATE_TILES);
+
+        // Tiles outside of the surface read as 1x1, like out-of-bounds loads of the smoothing pass
+        bool insideSurface = all(tile >= 0) && all(tile < tileCount);
+        gs_Rates[rateTile] = insideSurface ? ComputeTileRate(tile, rateTile, cacheOrigin, tileCount) : 0;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    // Smoothing of the output tiles, reading the unsmoothed rates of the neighbors
+    for (uint outputTile = GroupIndex; outputTile < GROUP_TILES * GROUP_TILES; outputTile += GROUP_THREADS_TOTAL)
+    {
+        int2 local = int2(outputTile % GROUP_TILES, outputTile / GROUP_TILES);
+        int2 tile = outputOrigin + local;
+
+        if (all(tile < tileCount))
+        {
+            int center = (local.y + SMOOTH_RADIUS) * RATE_TILES + (local.x + SMOOTH_RADIUS);
+            uint flags = 0;
+
+            [unroll]
+            for (int offset = 1; offset <= SMOOTH_RADIUS; offset++)
+            {
+                flags |= NeighborFlags(gs_Rates[center - offset]);
+                flags |= NeighborFlags(gs_Rates[center + offset]);
+                flags |= NeighborFlags(gs_Rates[center - offset * RATE_TILES]);
+                flags |= NeighborFlags(gs_Rates[center + offset * RATE_TILES]);
+            }
+
+            vrsSurface[tile] = ApplySmoothingFlags(gs_Rates[center], flags);
+        }
+    }
+}
@@ -0,0 +1,288 @@
+//----------------------------------------------------------------------------------
+// File:        GpuProfiler.cpp
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include "GpuProfiler.h"
+
+#include <donut/core/log.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace donut;
+
+GpuProfiler::GpuProfiler(nvrhi::IDevice* device)
+    : m_Device(device)
+{
+}
+
+void GpuProfiler::BeginFrame(uint32_t frameIndex)
+{
+    assert(m_OpenScopes.empty());
+    m_OpenScopes.clear();
+
+    m_CurrentFrame = (m_CurrentFrame + 1) % c_FramesInFlight;
+    FrameQueries& frame = m_Frames[m_CurrentFrame];
+
+    if (!frame.records.empty())
+    {
+        ResolveFrame(frame);
+    }
+
+    for (uint32_t index = 0; index < frame.usedQueries; index++)
+    {
+        m_Device->resetTimerQuery(frame.queries[index]);
+    }
+    frame.usedQueries = 0;
+    frame.records.clear();
+    frame.frameIndex = frameIndex;
+}
+
+void GpuProfiler::ResolveFrame(FrameQueries& frame)
+{
+    // A scope can run several times per frame, its sample is the sum
+    std::vector<float> frameTimes(m_Scopes.size(), 0.f);
+    std::vector<bool> measured(m_Scopes.size(), false);
+    std::vector<bool> dropped(m_Scopes.size(), false);
+
+    for (const QueryRecord& record : frame.records)
+    {
+        nvrhi::ITimerQuery* query = frame.queries[record.query];
+        if (m_Device->pollTimerQuery(query))
+        {
+            frameTimes[record.scope] += m_Device->getTimerQueryTime(query) * 1e3f;
+            measured[record.scope] = true;
+        }
+        else
+        {
+            dropped[record.scope] = true;
+        }
+    }
+
+    m_ResolvedFrameCount++;
+    m_ResolvedFrameIndex = frame.frameIndex;
+
+    for (uint32_t scopeIndex = 0; scopeIndex < uint32_t(m_Scopes.size()); scopeIndex++)
+    {
+        if (dropped[scopeIndex])
+        {
+            m_DroppedSampleCount++;
+            continue;
+        }
+        if (!measured[scopeIndex])
+            continue;
+
+        ScopeHistory& scope = m_Scopes[scopeIndex];
+        scope.samples[scope.nextSample] = frameTimes[scopeIndex];
+        scope.nextSample = (scope.nextSample + 1) % c_HistorySize;
+        scope.sampleCount = std::min(scope.sampleCount + 1, c_HistorySize);
+        scope.lastResolvedFrame = m_ResolvedFrameCount;
+    }
+}
+
+uint32_t GpuProfiler::FindOrAddScope(const std::string& path, const char* name)
+{
+    for (uint32_t scopeIndex = 0; scopeIndex < uint32_t(m_Scopes.size()); scopeIndex++)
+    {
+        if (m_Scopes[scopeIndex].path == path)
+            return scopeIndex;
+    }
+
+    const uint32_t scopeIndex = uint32_t(m_Scopes.size());
+    ScopeHistory& scope = m_Scopes.emplace_back();
+    scope.path = path;
+    scope.name = name;
+    scope.depth = uint32_t(m_OpenScopes.size());
+
+    auto position = m_DisplayOrder.end();
+    if (!m_OpenScopes.empty())
+    {
+        const std::string parentPrefix = m_OpenScopes.back().path + "/";
+        position = std::find_if(m_DisplayOrder.begin(), m_DisplayOrder.end(),
+            [this, &parentPrefix](uint32_t index) { return m_Scopes[index].path + "/" == parentPrefix; });
+        assert(position != m_DisplayOrder.end());
+        ++position;
+        while (position != m_DisplayOrder.end() && m_Scopes[*position].path.compare(0, parentPrefix.size(), parentPrefix) == 0)
+            ++position;
+    }
+    m_DisplayOrder.insert(position, scopeIndex);
+
+    return scopeIndex;
+}
+
+void GpuProfiler::BeginScope(nvrhi::ICommandList* commandList, const char* name)
+{
+    std::string path = m_OpenScopes.empty() ? std::string(name) : m_OpenScopes.back().path + "/" + name;
+    const uint32_t scopeIndex = FindOrAddScope(path, name);
+
+    FrameQueries& frame = m_Frames[m_CurrentFrame];
+    if (frame.usedQueries == frame.queries.size())
+    {
+        frame.queries.push_back(m_Device->createTimerQuery());
+    }
+
+    const uint32_t queryIndex = frame.usedQueries++;
+    m_OpenScopes.push_back({ std::move(path), uint32_t(frame.records.size()) });
+    frame.records.push_back({ scopeIndex, queryIndex });
+
+    commandList->beginTimerQuery(frame.queries[queryIndex]);
+}
+
+void GpuProfiler::EndScope(nvrhi::ICommandList* commandList)
+{
+    assert(!m_OpenScopes.empty());
+    if (m_OpenScopes.empty())
+        return;
+
+    const FrameQueries& frame = m_Frames[m_CurrentFrame];
+    const QueryRecord& record = frame.records[m_OpenScopes.back().record];
+    commandList->endTimerQuery(frame.queries[record.query]);
+
+    m_OpenScopes.pop_back();
+}
+
+void GpuProfiler::ClearHistory()
+{
+    for (ScopeHistory& scope : m_Scopes)
+    {
+        scope.sampleCount = 0;
+        scope.nextSample = 0;
+    }
+    m_DroppedSampleCount = 0;
+}
+
+GpuProfiler::ScopeStats GpuProfiler::ComputeStats(const ScopeHistory& scope) const
+{
+    ScopeStats stats;
+    stats.path = scope.path;
+    stats.name = scope.name;
+    stats.depth = scope.depth;
+    stats.sampleCount = scope.sampleCount;
+    stats.current = scope.sampleCount != 0 && scope.lastResolvedFrame == m_ResolvedFrameCount;
+
+    if (scope.sampleCount == 0)
+        return stats;
+
+    stats.lastMs = scope.samples[(scope.nextSample + c_HistorySize - 1) % c_HistorySize];
+
+    std::vector<float> samples(scope.samples, scope.samples + scope.sampleCount);
+    double sum = 0.0;
+    for (float sample : samples)
+        sum += sample;
+    stats.avgMs = float(sum / samples.size());
+    stats.minMs = *std::min_element(samples.begin(), samples.end());
+
+    // Nearest rank: the smallest sample that is not below 99% of the samples
+    const size_t rank = size_t(std::ceil(0.99 * double(samples.size()))) - 1;
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+    stats.p99Ms = samples[rank];
+
+    return stats;
+}
+
+std::vector<GpuProfiler::ScopeStats> GpuProfiler::GetStats() const
+{
+    std::vector<ScopeStats> stats;
+    stats.reserve(m_DisplayOrder.size());
+    for (uint32_t scopeIndex : m_DisplayOrder)
+    {
+        stats.push_back(ComputeStats(m_Scopes[scopeIndex]));
+    }
+    return stats;
+}
+
+bool GpuProfiler::GetStats(const std::string& path, ScopeStats& stats) const
+{
+    for (const ScopeHistory& scope : m_Scopes)
+    {
+        if (scope.path == path)
+        {
+            stats = ComputeStats(scope);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool GpuProfiler::WriteCsv(const std::filesystem::path& fileName) const
+{
+    FILE* file = fopen(fileName.generic_string().c_str(), "w");
+    if (!file)
+    {
+        log::error("Cannot create %s", fileName.generic_string().c_str());
+        return false;
+    }
+
+    fprintf(file, "scope,depth,samples,last_ms,min_ms,avg_ms,p99_ms\n");
+    for (const ScopeStats& stats : GetStats())
+    {
+        fprintf(file, "%s,%u,%u,%.4f,%.4f,%.4f,%.4f\n", stats.path.c_str(), stats.depth, stats.sampleCount,
+            stats.lastMs, stats.minMs, stats.avgMs, stats.p99Ms);
+    }
+
+    fclose(file);
+    log::info("GPU profile written to %s", fileName.generic_string().c_str());
+    return true;
+}
+
+bool GpuProfiler::WriteJson(const std::filesystem::path& fileName) const
+{
+    FILE* file = fopen(fileName.generic_string().c_str(), "w");
+    if (!file)
+    {
+        log::error("Cannot create %s", fileName.generic_string().c_str());
+        return false;
+    }
+
+    const std::vector<ScopeStats> allStats = GetStats();
+
+    // Scope names are identifiers chosen by the application, they need no escaping
+    fprintf(file, "{\n");
+    fprintf(file, "  \"version\": 1,\n");
+    fprintf(file, "  \"historySize\": %u,\n", c_HistorySize);
+    fprintf(file, "  \"resolvedFrames\": %u,\n", m_ResolvedFrameCount);
+    fprintf(file, "  \"droppedSamples\": %u,\n", m_DroppedSampleCount);
+    fprintf(file, "  \"scopes\": [\n");
+    for (size_t index = 0; index < allStats.size(); index++)
+    {
+        const ScopeStats& stats = allStats[index];
+        fprintf(file, "    { \"path\": \"%s\", \"depth\": %u, \"samples\": %u, \"lastMs\": %.4f, \"minMs\": %.4f, \"avgMs\": %.4f, \"p99Ms\": %.4f }%s\n",
+            stats.path.c_str(), stats.depth, stats.sampleCount, stats.lastMs, stats.minMs, stats.avgMs, stats.p99Ms,
+            (index + 1 < allStats.size()) ? "," : "");
+    }
+    fprintf(file, "  ]\n");
+    fprintf(file, "}\n");
+
+    fclose(file);
+    log::info("GPU profile written to %s", fileName.generic_string().c_str());
+    return true;
+}
@@ -0,0 +1,158 @@
+//----------------------------------------------------------------------------------
+// File:        GpuProfiler.h
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#pragma once
+
+#include <nvrhi/nvrhi.h>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// GPU timing of nested scopes, e.g. "Frame/NAS/ShadingRate". Every scope brackets its commands
+// with a timer query. The queries of a frame are read c_FramesInFlight frames later, when the GPU
+// is done with them, so that the profiler never waits for the GPU. Queries that are still not
+// ready at that point are dropped.
+class GpuProfiler
+{
+public:
+    static constexpr uint32_t c_FramesInFlight = 4;
+    static constexpr uint32_t c_HistorySize = 128;
+
+    struct ScopeStats
+    {
+        std::string path;
+        std::string name;
+        uint32_t depth = 0;
+        uint32_t sampleCount = 0;
+        bool current = false;       // measured in the last resolved frame
+        float lastMs = 0.f;
+        float minMs = 0.f;
+        float avgMs = 0.f;
+        float p99Ms = 0.f;
+    };
+
+    explicit GpuProfiler(nvrhi::IDevice* device);
+
+    // Reads the timings of the oldest frame in flight and starts recording frame frameIndex
+    void BeginFrame(uint32_t frameIndex);
+
+    void BeginScope(nvrhi::ICommandList* commandList, const char* name);
+    void EndScope(nvrhi::ICommandList* commandList);
+
+    // Forgets the timings, the scopes stay in the list
+    void ClearHistory();
+
+    // Over the last c_HistorySize frames in which the scope ran, parents before their children
+    [[nodiscard]] std::vector<ScopeStats> GetStats() const;
+    [[nodiscard]] bool GetStats(const std::string& path, ScopeStats& stats) const;
+
+    [[nodiscard]] uint32_t GetResolvedFrameCount() const { return m_ResolvedFrameCount; }
+    [[nodiscard]] uint32_t GetResolvedFrameIndex() const { return m_ResolvedFrameIndex; }   // of the last resolved frame
+    [[nodiscard]] uint32_t GetDroppedSampleCount() const { return m_DroppedSampleCount; }
+
+    bool WriteCsv(const std::filesystem::path& fileName) const;
+    bool WriteJson(const std::filesystem::path& fileName) const;
+
+    class Scope
+    {
+    public:
+        Scope(GpuProfiler& profiler, nvrhi::ICommandList* commandList, const char* name)
+            : m_Profiler(profiler)
+            , m_CommandList(commandList)
+        {
+            m_Profiler.BeginScope(m_CommandList, name);
+        }
+
+        ~Scope()
+        {
+            m_Profiler.EndScope(m_CommandList);
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        GpuProfiler& m_Profiler;
+        nvrhi::ICommandList* m_CommandList;
+    };
+
+private:
+    struct ScopeHistory
+    {
+        std::string path;
+        std::string name;
+        uint32_t depth = 0;
+        float samples[c_HistorySize] = {};
+        uint32_t sampleCount = 0;
+        uint32_t nextSample = 0;
+        uint32_t lastResolvedFrame = 0;
+    };
+
+    struct QueryRecord
+    {
+        uint32_t scope;
+        uint32_t query;
+    };
+
+    struct FrameQueries
+    {
+        std::vector<nvrhi::TimerQueryHandle> queries;
+        std::vector<QueryRecord> records;
+        uint32_t usedQueries = 0;
+        uint32_t frameIndex = 0;
+    };
+
+    uint32_t FindOrAddScope(const std::string& path, const char* name);
+    void ResolveFrame(FrameQueries& frame);
+    ScopeStats ComputeStats(const ScopeHistory& scope) const;
+
+    nvrhi::DeviceHandle m_Device;
+
+    FrameQueries m_Frames[c_FramesInFlight];
+    uint32_t m_CurrentFrame = 0;
+    uint32_t m_ResolvedFrameCount = 0;
+    uint32_t m_ResolvedFrameIndex = 0;
+    uint32_t m_DroppedSampleCount = 0;
+
+    // Indexed by the scope of the QueryRecord. The display order lists parents before their
+    // children, a new scope goes after the last descendant of its parent.
+    std::vector<ScopeHistory> m_Scopes;
+    std::vector<uint32_t> m_DisplayOrder;
+
+    struct OpenScope
+    {
+        std::string path;
+        uint32_t record;
+    };
+    std::vector<OpenScope> m_OpenScopes;
+};
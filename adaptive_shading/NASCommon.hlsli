@@ -0,0 +1,369 @@
+#include "ErrorScalers.hlsli"
+
+// Building blocks of the NAS passes, shared by ComputeNASData.hlsl, ComputeShadingRate.hlsl,
+// SmoothShadingRate.hlsl and FusedNAS.hlsl so the fused kernel computes exactly what the
+// separate passes compute. nas_cpu/src/NasTile.h holds the CPU versions.
+//
+// Expects Compute_cb.h to be included. TILE_SIZE and ERROR_METRIC select the tile size and the
+// per-tile error; NAS_REDUCTION_TILES, when defined, is the number of tiles a group reduces at once
+// and declares the groupshared memory of ReduceTile and FinishTileError.
+
+// One thread per 2x4 pixel block of the tile
+#define GROUP_SIZE_X (TILE_SIZE / 2)
+#define GROUP_SIZE_Y (TILE_SIZE / 4)
+#define GROUP_THREADS (GROUP_SIZE_X * GROUP_SIZE_Y)
+
+// Per-tile error, one of the NAS_ERROR_METRIC_* values of Compute_cb.h:
+// max takes the largest derivative of the tile, which is sensitive to single outliers;
+// L2 the root mean square of all derivatives, the original approach from the paper (it is
+// lower than the max, so the error sensitivity needs to be reduced to get similar quality);
+// percentile the largest derivative of the block that 1/NAS_ERROR_PERCENTILE_DIVISOR of the
+// blocks of the tile exceed, which ignores isolated outliers.
+#ifndef ERROR_METRIC
+#define ERROR_METRIC NAS_ERROR_METRIC_MAX
+#endif
+
+// Weights of the bilinear NAS data filter, the sub-texel precision of the sampler
+#define FILTER_WEIGHT_SCALE 256.0
+
+// Motion above this many pixels per frame is clamped, which keeps the fixed point sum in range
+#define MAX_MOTION 4096.0
+#define MOTION_SUM_SCALE 64.0
+
+// Neighbor flags of the smoothing, bits 4 and 5 above the 4-bit shading rate
+#define FLAG_X1 0x10
+#define FLAG_Y1 0x20
+#define RATE_MASK 0xf
+
+float RgbToLuminance(float3 color)
+{
+    return dot(color, float3(0.299, 0.587, 0.114));
+}
+
+struct BlockNasData
+{
+    float avgLuma;
+    float2 maxDerivative;
+    float2 meanSqDerivative;    // for the L2 metric
+};
+
+// Derivatives and average luma of the 2x4 pixel block of one thread, from the final post-AA color
+BlockNasData EvaluateBlock(Texture2D<float4> colors, int2 blockBaseCoord)
+{
+    int3 coord = int3(blockBaseCoord, 0);
+
+    // l0.x  l0.y
+    // l0.z  l0.w  l2.x
+    // l1.x  l1.y
+    // l1.z  l1.w  l2.y
+    //		 l2.z
+    float4 l0;
+    l0.x = RgbToLuminance(colors.Load(coord, int2(0, 0)).xyz);
+    l0.y = RgbToLuminance(colors.Load(coord, int2(1, 0)).xyz);
+    l0.z = RgbToLuminance(colors.Load(coord, int2(0, 1)).xyz);
+    l0.w = RgbToLuminance(colors.Load(coord, int2(1, 1)).xyz);
+
+    float4 l1;
+    l1.x = RgbToLuminance(colors.Load(coord, int2(0, 2)).xyz);
+    l1.y = RgbToLuminance(colors.Load(coord, int2(1, 2)).xyz);
+    l1.z = RgbToLuminance(colors.Load(coord, int2(0, 3)).xyz);
+    l1.w = RgbToLuminance(colors.Load(coord, int2(1, 3)).xyz);
+
+    float3 l2;
+    l2.x = RgbToLuminance(colors.Load(coord, int2(2, 1)).xyz);
+    l2.y = RgbToLuminance(colors.Load(coord, int2(2, 3)).xyz);
+    l2.z = RgbToLuminance(colors.Load(coord, int2(1, 4)).xyz);
+
+    // Derivatives X
+    float4 a = float4(l0.y, l2.x, l1.y, l2.y);
+    float4 b = float4(l0.x, l0.w, l1.x, l1.w);
+    float4 dx = abs(a - b);
+
+    // Derivatives Y
+    a = float4(l0.z, l1.y, l1.z, l2.z);
+    b = float4(l0.x, l0.w, l1.x, l1.w);
+    float4 dy = abs(a - b);
+
+    BlockNasData block;
+
+    // Block average luma (8 total samples)
+    float4 sumAB = l0 + l1;
+    block.avgLuma = (sumAB.x + sumAB.y + sumAB.z + sumAB.w) / 8;
+
+    block.maxDerivative = float2(max(max(dx.x, dx.y), max(dx.z, dx.w)), max(max(dy.x, dy.y), max(dy.z, dy.w)));
+    block.meanSqDerivative = float2(dot(dx, dx), dot(dy, dy)) / 4;
+    return block;
+}
+
+// The error of a block that is reduced over the tile: the mean squared derivatives for the L2
+// metric, the maximum derivatives otherwise
+float2 BlockError(BlockNasData block)
+{
+#if ERROR_METRIC == NAS_ERROR_METRIC_L2
+    return block.meanSqDerivative;
+#else
+    return block.maxDerivative;
+#endif
+}
+
+// (luma sum, error x, error y) of two partial results. The errors are the max derivatives,
+// or the sums of the squared derivatives for the L2 metric.
+float3 CombineResults(float3 a, float3 b)
+{
+#if ERROR_METRIC == NAS_ERROR_METRIC_L2
+    return a + b;
+#else
+    return float3(a.x + b.x, max(a.y, b.y), max(a.z, b.z));
+#endif
+}
+
+#ifdef NAS_REDUCTION_TILES
+
+groupshared float3 gs_Reduction[NAS_REDUCTION_TILES * GROUP_THREADS];
+
+#if ERROR_METRIC == NAS_ERROR_METRIC_PERCENTILE
+#define PERCENTILE_RANK (GROUP_THREADS / NAS_ERROR_PERCENTILE_DIVISOR)
+groupshared float2 gs_BlockErrors[NAS_REDUCTION_TILES * GROUP_THREADS];
+groupshared float2 gs_PercentileError[NAS_REDUCTION_TILES];
+#endif
+
+// Reduces the per-thread (block luma, error x, error y) over each run of GROUP_THREADS threads
+// in SV_GroupIndex order, i.e. over the blocks of one tile, and returns the result of the run in
+// all of its threads. Neighbors are added first and then the stride doubles. All threads of the
+// group must call it; the result is valid until the next call.
+float3 ReduceTile(float3 value, uint groupIndex)
+{
+    uint lane = groupIndex % GROUP_THREADS;
+
+    gs_Reduction[groupIndex] = value;
+    GroupMemoryBarrierWithGroupSync();
+
+    [unroll]
+    for (uint stride = 1; stride < GROUP_THREADS; stride *= 2)
+    {
+        if ((lane & (2 * stride - 1)) == 0)
+        {
+            gs_Reduction[groupIndex] = CombineResults(gs_Reduction[groupIndex], gs_Reduction[groupIndex + stride]);
+        }
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    return gs_Reduction[groupIndex - lane];
+}
+
+#if ERROR_METRIC == NAS_ERROR_METRIC_PERCENTILE
+// The PERCENTILE_RANK-th largest of the block errors of the run, in descending order from 0, valid in
+// all its threads. Every thread counts the errors above its own; ties are broken by the thread index,
+// so exactly one thread per direction has the rank. Needs GROUP_THREADS loads per thread, at most 128.
+float2 SelectPercentile(float2 value, uint groupIndex)
+{
+    uint lane = groupIndex % GROUP_THREADS;
+    uint runStart = groupIndex - lane;
+    uint run = groupIndex / GROUP_THREADS;
+
+    gs_BlockErrors[groupIndex] = value;
+    GroupMemoryBarrierWithGroupSync();
+
+    uint2 rank = 0;
+    for (uint i = 0; i < GROUP_THREADS; i++)
+    {
+        float2 other = gs_BlockErrors[runStart + i];
+        rank.x += (other.x > value.x || (other.x == value.x && i < lane)) ? 1 : 0;
+        rank.y += (other.y > value.y || (other.y == value.y && i < lane)) ? 1 : 0;
+    }
+
+    if (rank.x == PERCENTILE_RANK)
+    {
+        gs_PercentileError[run].x = value.x;
+    }
+    if (rank.y == PERCENTILE_RANK)
+    {
+        gs_PercentileError[run].y = value.y;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    return gs_PercentileError[run];
+}
+#endif
+
+#endif // NAS_REDUCTION_TILES
+
+// Tile error from the reduced (luma sum, error x, error y) of the tile. The percentile metric
+// selects from the block errors of the run instead, and must be called by all threads of the group.
+float2 FinishTileError(float3 tileResult, float2 blockError, uint groupIndex)
+{
+#if ERROR_METRIC == NAS_ERROR_METRIC_L2
+    return sqrt(tileResult.yz / GROUP_THREADS);
+#elif ERROR_METRIC == NAS_ERROR_METRIC_PERCENTILE
+    return SelectPercentile(blockError, groupIndex);
+#else
+    return tileResult.yz;
+#endif
+}
+
+// NAS data of a tile: its error relative to the average luma
+float2 TileNasData(float2 tileError, float lumaSum, float brightnessSensitivity)
+{
+    // Lanes of the wave that are not part of the group are inactive, so divide by the group size
+    float avgLuma = lumaSum / GROUP_THREADS + brightnessSensitivity;
+    return tileError / abs(avgLuma);
+}
+
+// Sparse min depth of the 2x4 block of one thread, four of its eight pixels
+float LoadBlockMinDepth(Texture2D<float> depthTexture, int2 blockBaseCoord)
+{
+    int3 coord = int3(blockBaseCoord, 0);
+
+    float4 depth;
+    depth.x = depthTexture.Load(coord, int2(0, 0)).x;
+    depth.y = depthTexture.Load(coord, int2(1, 1)).x;
+    depth.z = depthTexture.Load(coord, int2(0, 2)).x;
+    depth.w = depthTexture.Load(coord, int2(1, 3)).x;
+
+    // Reduction: find block minimum depth (corresponding to largest motion in block)
+    depth.xy = min(depth.xy, depth.zw);
+    return min(depth.x, depth.y);
+}
+
+// Max and fixed point sum of the abs motion of the same sparse four pixels of the 2x4 block,
+// out-of-bounds loads return no motion
+void LoadBlockMotion(Texture2D<float2> motionVectors, int2 blockBaseCoord, out float2 maxMotion, out uint2 motionSum)
+{
+    int3 coord = int3(blockBaseCoord, 0);
+
+    float2 motion0 = min(abs(motionVectors.Load(coord, int2(0, 0))), MAX_MOTION);
+    float2 motion1 = min(abs(motionVectors.Load(coord, int2(1, 1))), MAX_MOTION);
+    float2 motion2 = min(abs(motionVectors.Load(coord, int2(0, 2))), MAX_MOTION);
+    float2 motion3 = min(abs(motionVectors.Load(coord, int2(1, 3))), MAX_MOTION);
+
+    maxMotion = max(max(motion0, motion1), max(motion2, motion3));
+    motionSum = uint2((motion0 + motion1 + motion2 + motion3) * MOTION_SUM_SCALE);
+}
+
+// Tile motion of the MOTION_SOURCE permutations from the max and the sum over all blocks of the tile
+float2 TileMotion(float2 maxMotion, uint2 motionSum, int motionSource)
+{
+    return (motionSource == 1) ? float2(motionSum) / (MOTION_SUM_SCALE * 4 * GROUP_THREADS) : maxMotion;
+}
+
+// Window position in the previous frame of the point at currUv and depth, or fallbackPos when it
+// was behind the previous camera
+float2 ReprojectWindowPos(float2 currUv, float depth, float4x4 reprojectionMatrix, uint2 previousViewOrigin, uint2 previousViewSize, float2 fallbackPos)
+{
+    float4 clipPos;
+    clipPos.x = currUv.x * 2 - 1;
+    clipPos.y = 1 - currUv.y * 2;
+    clipPos.z = depth;
+    clipPos.w = 1;
+
+    float4 prevClipPos = mul(clipPos, reprojectionMatrix);
+
+    if (prevClipPos.w > 0)
+    {
+        prevClipPos.xyz /= prevClipPos.w;
+        float2 prevUV;
+        prevUV.x = 0.5 + prevClipPos.x * 0.5;
+        prevUV.y = 0.5 - prevClipPos.y * 0.5;
+
+        return prevUV * previousViewSize + previousViewOrigin;
+    }
+
+    return fallbackPos;
+}
+
+// Texels and weights of a bilinear filter with a wrapping address mode at tileCount and
+// the 8-bit weights of the sampler
+void GetBilinearFootprint(float2 uv, int2 tileCount, out int2 t0, out int2 t1, out float2 weight)
+{
+    float2 texel = uv * tileCount - 0.5;
+    float2 base = floor(texel);
+    weight = round((texel - base) * FILTER_WEIGHT_SCALE) / FILTER_WEIGHT_SCALE;
+
+    float2 wrapped0 = base - floor(base / tileCount) * tileCount;
+    float2 wrapped1 = (base + 1) - floor((base + 1) / tileCount) * tileCount;
+    t0 = int2(min(uint2(max(wrapped0, 0)), uint2(tileCount - 1)));
+    t1 = int2(min(uint2(max(wrapped1, 0)), uint2(tileCount - 1)));
+}
+
+float2 BilinearFilter(float2 t00, float2 t10, float2 t01, float2 t11, float2 weight)
+{
+    float2 top = t00 + (t10 - t00) * weight.x;
+    float2 bottom = t01 + (t11 - t01) * weight.x;
+    return top + (bottom - top) * weight.y;
+}
+
+// Shading rate of a tile from the NAS data sampled at its previous position and its screen-space motion
+uint SelectShadingRate(float2 diff, float2 motion, float motionSensitivity, float errorSensitivity)
+{
+    float2 mVec = abs(motion) * motionSensitivity;
+
+    // Error scalers (equations from the I3D 2019 paper)
+    // bhv for half rate, bqv for quarter rate
+    float2 bhv, bqv;
+    GetErrorScalers(mVec, bhv, bqv);
+
+    float2 diff2 = diff * bhv;
+    float2 diff4 = diff * bqv;
+
+    float threshold = errorSensitivity;
+
+    /*
+        D3D12_SHADING_RATE_1X1	= 0,   // 0b0000
+        D3D12_SHADING_RATE_1X2	= 0x1, // 0b0001
+        D3D12_SHADING_RATE_2X1	= 0x4, // 0b0100
+        D3D12_SHADING_RATE_2X2	= 0x5, // 0b0101
+        D3D12_SHADING_RATE_2X4	= 0x6, // 0b0110
+        D3D12_SHADING_RATE_4X2	= 0x9, // 0b1001
+        D3D12_SHADING_RATE_4X4	= 0xa  // 0b1010
+    */
+
+    // Compute block shading rate based on if the error computation goes over the threshold
+    // shading rates in D3D are purposely designed to be able to combined, e.g. 2x1 | 1x2 = 2x2
+    uint ShadingRate = 0;
+    ShadingRate |= ((diff2.x >= threshold) ? 0 : ((diff4.x > threshold) ? 0x4 : 0x8));
+    ShadingRate |= ((diff2.y >= threshold) ? 0 : ((diff4.y > threshold) ? 0x1 : 0x2));
+
+    // Disable 4x4 shading rate (low quality, limited perf gain)
+    if (ShadingRate == 0xa)
+    {
+        ShadingRate = (diff2.x > diff2.y) ? 0x6 : 0x9; // use 2x4 or 4x2 based on directional gradient
+    }
+    // Disable 4x1 or 1x4 shading rate (unsupported)
+    else if (ShadingRate == 0x8)
+    {
+        ShadingRate = 0x4;
+    }
+    else if (ShadingRate == 0x2)
+    {
+        ShadingRate = 0x1;
+    }
+
+    return ShadingRate;
+}
+
+// Which of the center tile's 4x rates a neighbor with rate SR relaxes
+uint NeighborFlags(uint SR)
+{
+    return (((SR & 0x3) == 0) ? FLAG_X1 : 0) | (((SR & 0xc) == 0) ? FLAG_Y1 : 0);
+}
+
+// Lowers the 4x rates of a tile to 2x where NeighborFlags of the tiles around it found a 1x rate
+uint ApplySmoothingFlags(uint centerSR, uint flags)
+{
+    // Check all tiles that contain 4x shading rate in either X or Y
+    if (centerSR & 0xa)
+    {
+        // if an neighboring tile has 1x rate and current tile is 4x in X
+        if ((flags & FLAG_X1) && (centerSR & 0x8))
+        {
+            centerSR ^= 0xc;  // increase the X shading rate from 4x to 2x
+        }
+        // if an neighboring tile has 1x rate and current tile is 4x in Y
+        if ((flags & FLAG_Y1) && (centerSR & 0x2))
+        {
+            centerSR ^= 0x3;  // increase the Y shading rate from 4x to 2x
+        }
+    }
+
+    return centerSR;
+}
@@ -0,0 +1,233 @@
+//----------------------------------------------------------------------------------
+// File:        NasCapture.cpp
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include "NasCapture.h"
+
+#include <donut/core/log.h>
+#include <donut/engine/ShaderFactory.h>
+
+using namespace donut;
+using namespace donut::math;
+
+#include "Compute_cb.h"  // requires donut::math
+
+NasCapture::NasCapture(nvrhi::IDevice* device, std::shared_ptr<engine::ShaderFactory> shaderFactory)
+    : m_Device(device)
+    , m_ShaderFactory(shaderFactory)
+{
+}
+
+NasCapture::~NasCapture()
+{
+    End();
+}
+
+bool NasCapture::Begin(const std::filesystem::path& fileName)
+{
+    End();
+
+    if (!m_CopyDepthPipeline)
+    {
+        m_CopyDepthShader = m_ShaderFactory->CreateShader("app/CopyDepth", "main_cs", nullptr, nvrhi::ShaderType::Compute);
+        if (!m_CopyDepthShader)
+            return false;
+
+        nvrhi::BindingLayoutDesc layoutDesc;
+        layoutDesc.visibility = nvrhi::ShaderType::Compute;
+        layoutDesc.bindings = {
+            nvrhi::BindingLayoutItem::Texture_SRV(0),
+            nvrhi::BindingLayoutItem::Texture_UAV(0)
+        };
+        m_CopyDepthBindingLayout = m_Device->createBindingLayout(layoutDesc);
+
+        nvrhi::ComputePipelineDesc psoDesc;
+        psoDesc.CS = m_CopyDepthShader;
+        psoDesc.bindingLayouts = { m_CopyDepthBindingLayout };
+        m_CopyDepthPipeline = m_Device->createComputePipeline(psoDesc);
+    }
+
+    if (!m_Writer.Open(fileName))
+        return false;
+
+    m_FrameCounter = 0;
+    log::info("NAS capture started: %s", fileName.generic_string().c_str());
+    return true;
+}
+
+void NasCapture::End()
+{
+    if (!m_Writer.IsOpen())
+        return;
+
+    FlushFrames();
+
+    uint32_t frameCount = m_Writer.GetFrameCount();
+    if (m_Writer.Close())
+        log::info("NAS capture finished, %u frames written", frameCount);
+}
+
+void NasCapture::CreateResources(uint32_t width, uint32_t height)
+{
+    FlushFrames();
+
+    m_Width = width;
+    m_Height = height;
+    m_BoundDepth = nullptr;
+    m_CopyDepthBindingSet = nullptr;
+
+    nvrhi::TextureDesc desc;
+    desc.width = width;
+    desc.height = height;
+    desc.format = nvrhi::Format::R32_FLOAT;
+    desc.isUAV = true;
+    desc.initialState = nvrhi::ResourceStates::UnorderedAccess;
+    desc.keepInitialState = true;
+    desc.debugName = "NasCaptureDepth";
+    m_DepthCopy = m_Device->createTexture(desc);
+
+    for (PendingFrame& frame : m_Frames)
+    {
+        nvrhi::TextureDesc stagingDesc;
+        stagingDesc.width = width;
+        stagingDesc.height = height;
+        stagingDesc.initialState = nvrhi::ResourceStates::CopyDest;
+        stagingDesc.keepInitialState = true;
+
+        stagingDesc.format = nvrhi::Format::SRGBA8_UNORM;
+        stagingDesc.debugName = "NasCaptureColorStaging";
+        frame.colors = m_Device->createStagingTexture(stagingDesc, nvrhi::CpuAccessMode::Read);
+
+        stagingDesc.format = nvrhi::Format::R32_FLOAT;
+        stagingDesc.debugName = "NasCaptureDepthStaging";
+        frame.depth = m_Device->createStagingTexture(stagingDesc, nvrhi::CpuAccessMode::Read);
+    }
+}
+
+// Maps the staging textures of a frame and appends them to the file, waits for the GPU if the copies are not done yet
+void NasCapture::WriteFrame(PendingFrame& frame)
+{
+    if (!frame.pending)
+        return;
+
+    frame.pending = false;
+
+    size_t colorRowPitch = 0;
+    size_t depthRowPitch = 0;
+    const void* colors = m_Device->mapStagingTexture(frame.colors, nvrhi::TextureSlice(), nvrhi::CpuAccessMode::Read, &colorRowPitch);
+    const void* depth = m_Device->mapStagingTexture(frame.depth, nvrhi::TextureSlice(), nvrhi::CpuAccessMode::Read, &depthRowPitch);
+
+    if (colors && depth)
+    {
+        m_Writer.AppendFrame(frame.record,
+            nas::ColorView(static_cast<const nas::Rgba8*>(colors), m_Width, m_Height, colorRowPitch),
+            nas::DepthView(static_cast<const float*>(depth), m_Width, m_Height, depthRowPitch));
+    }
+    else
+    {
+        log::warning("NAS capture: cannot map the staging textures of frame %u", frame.record.frameIndex);
+    }
+
+    if (colors)
+        m_Device->unmapStagingTexture(frame.colors);
+    if (depth)
+        m_Device->unmapStagingTexture(frame.depth);
+}
+
+void NasCapture::FlushFrames()
+{
+    // Oldest frame first to keep the file in frame order
+    for (uint32_t i = 0; i < c_FramesInFlight; i++)
+    {
+        WriteFrame(m_Frames[(m_FrameCounter + i) % c_FramesInFlight]);
+    }
+}
+
+void NasCapture::CaptureFrame(
+    nvrhi::ICommandList* commandList,
+    nvrhi::ITexture* prevFrameColors,
+    nvrhi::ITexture* depth,
+    uint32_t width,
+    uint32_t height,
+    const ComputeNASDataConstants& dataConstants,
+    const AdaptiveShadingConstants& rateConstants)
+{
+    if (!m_Writer.IsOpen())
+        return;
+
+    const nvrhi::TextureDesc& depthDesc = depth->getDesc();
+    if (depthDesc.sampleCount != 1)
+    {
+        log::warning("NAS capture does not support MSAA depth buffers, stopping");
+        End();
+        return;
+    }
+
+    if (width != m_Width || height != m_Height)
+        CreateResources(width, height);
+
+    if (depth != m_BoundDepth)
+    {
+        nvrhi::BindingSetDesc bindingSetDesc;
+        bindingSetDesc.bindings = {
+            nvrhi::BindingSetItem::Texture_SRV(0, depth),
+            nvrhi::BindingSetItem::Texture_UAV(0, m_DepthCopy)
+        };
+        m_CopyDepthBindingSet = m_Device->createBindingSet(bindingSetDesc, m_CopyDepthBindingLayout);
+        m_BoundDepth = depth;
+    }
+
+    // Reuse the oldest slot of the ring, its copies were submitted c_FramesInFlight frames ago
+    PendingFrame& frame = m_Frames[m_FrameCounter % c_FramesInFlight];
+    WriteFrame(frame);
+
+    commandList->beginMarker("NAS Capture");
+
+    nvrhi::ComputeState state;
+    state.pipeline = m_CopyDepthPipeline;
+    state.bindings = { m_CopyDepthBindingSet };
+    commandList->setComputeState(state);
+    commandList->dispatch((m_Width + 15) / 16, (m_Height + 15) / 16, 1);
+
+    const nvrhi::TextureSlice renderSlice = nvrhi::TextureSlice().setWidth(m_Width).setHeight(m_Height);
+    commandList->copyTexture(frame.colors, nvrhi::TextureSlice(), prevFrameColors, renderSlice);
+    commandList->copyTexture(frame.depth, nvrhi::TextureSlice(), m_DepthCopy, nvrhi::TextureSlice());
+
+    commandList->endMarker();
+
+    frame.record = {};
+    frame.record.frameIndex = m_FrameCounter;
+    frame.record.colorEncoding = uint32_t(nas::ColorEncoding::Srgb);
+    nas::SetCaptureFrameConstants(frame.record, dataConstants, rateConstants);
+    frame.pending = true;
+
+    m_FrameCounter++;
+}
@@ -0,0 +1,106 @@
+//----------------------------------------------------------------------------------
+// File:        NasCapture.h
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#pragma once
+
+#include <nas/CaptureFile.h>
+#include <nvrhi/nvrhi.h>
+
+#include <filesystem>
+#include <memory>
+
+namespace donut::engine
+{
+    class ShaderFactory;
+}
+
+// Records the inputs of the NAS passes into a capture file (see nas/CaptureFile.h) for offline analysis.
+// The previous frame colors and the depth buffer are copied into a small ring of staging textures
+// and written to the file a few frames later, so that capturing does not stall the GPU.
+class NasCapture
+{
+public:
+    NasCapture(nvrhi::IDevice* device, std::shared_ptr<donut::engine::ShaderFactory> shaderFactory);
+    ~NasCapture();
+
+    bool Begin(const std::filesystem::path& fileName);
+
+    // Writes the frames that are still in flight and closes the file
+    void End();
+
+    [[nodiscard]] bool IsActive() const { return m_Writer.IsOpen(); }
+    [[nodiscard]] uint32_t GetFrameCount() const { return m_Writer.GetFrameCount(); }
+
+    // Records the copies of this frame's NAS inputs, the top left width x height pixels of the
+    // textures. Must be called before the color texture is overwritten by the current frame, i.e.
+    // where the NAS passes run.
+    void CaptureFrame(
+        nvrhi::ICommandList* commandList,
+        nvrhi::ITexture* prevFrameColors,
+        nvrhi::ITexture* depth,
+        uint32_t width,
+        uint32_t height,
+        const ComputeNASDataConstants& dataConstants,
+        const AdaptiveShadingConstants& rateConstants);
+
+private:
+    static constexpr uint32_t c_FramesInFlight = 3;
+
+    struct PendingFrame
+    {
+        nvrhi::StagingTextureHandle colors;
+        nvrhi::StagingTextureHandle depth;
+        nas::CaptureFrameRecord record = {};
+        bool pending = false;
+    };
+
+    void CreateResources(uint32_t width, uint32_t height);
+    void WriteFrame(PendingFrame& frame);
+    void FlushFrames();
+
+    nvrhi::DeviceHandle m_Device;
+    std::shared_ptr<donut::engine::ShaderFactory> m_ShaderFactory;
+
+    nvrhi::ShaderHandle m_CopyDepthShader;
+    nvrhi::BindingLayoutHandle m_CopyDepthBindingLayout;
+    nvrhi::BindingSetHandle m_CopyDepthBindingSet;
+    nvrhi::ComputePipelineHandle m_CopyDepthPipeline;
+    nvrhi::TextureHandle m_DepthCopy;
+    nvrhi::ITexture* m_BoundDepth = nullptr;
+
+    PendingFrame m_Frames[c_FramesInFlight];
+    uint32_t m_Width = 0;
+    uint32_t m_Height = 0;
+    uint32_t m_FrameCounter = 0;
+
+    nas::CaptureWriter m_Writer;
+};
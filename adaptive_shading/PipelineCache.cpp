@@ -0,0 +1,191 @@
+//----------------------------------------------------------------------------------
+// File:        PipelineCache.cpp
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include "PipelineCache.h"
+
+#include <chrono>
+#include <cstring>
+#include <string_view>
+
+PipelineCache::PipelineCache(nvrhi::IDevice* device)
+    : m_Device(device)
+{
+}
+
+size_t PipelineCache::HashShader(nvrhi::IShader* shader)
+{
+    const void* bytecode = nullptr;
+    size_t size = 0;
+    shader->getBytecode(&bytecode, &size);
+
+    size_t hash = std::hash<std::string_view>()(std::string_view(static_cast<const char*>(bytecode), size));
+    nvrhi::hash_combine(hash, shader->getDesc().entryName);
+    return hash;
+}
+
+size_t PipelineCache::HashBindingLayout(const nvrhi::BindingLayoutDesc& desc)
+{
+    size_t hash = 0;
+    nvrhi::hash_combine(hash, uint32_t(desc.visibility));
+    nvrhi::hash_combine(hash, desc.registerSpace);
+    nvrhi::hash_combine(hash, desc.registerSpaceIsDescriptorSet);
+    nvrhi::hash_combine(hash, desc.bindingOffsets.shaderResource);
+    nvrhi::hash_combine(hash, desc.bindingOffsets.sampler);
+    nvrhi::hash_combine(hash, desc.bindingOffsets.constantBuffer);
+    nvrhi::hash_combine(hash, desc.bindingOffsets.unorderedAccess);
+    for (const nvrhi::BindingLayoutItem& item : desc.bindings)
+    {
+        nvrhi::hash_combine(hash, item.slot);
+        nvrhi::hash_combine(hash, uint32_t(item.type));
+        nvrhi::hash_combine(hash, uint32_t(item.size));
+    }
+    return hash;
+}
+
+bool PipelineCache::ShadersMatch(nvrhi::IShader* a, nvrhi::IShader* b)
+{
+    if (a == b)
+        return true;
+
+    const void* bytecodeA = nullptr;
+    const void* bytecodeB = nullptr;
+    size_t sizeA = 0;
+    size_t sizeB = 0;
+    a->getBytecode(&bytecodeA, &sizeA);
+    b->getBytecode(&bytecodeB, &sizeB);
+
+    return sizeA == sizeB
+        && memcmp(bytecodeA, bytecodeB, sizeA) == 0
+        && a->getDesc().entryName == b->getDesc().entryName;
+}
+
+bool PipelineCache::BindingLayoutsMatch(const nvrhi::BindingLayoutDesc& a, const nvrhi::BindingLayoutDesc& b)
+{
+    if (a.visibility != b.visibility
+        || a.registerSpace != b.registerSpace
+        || a.registerSpaceIsDescriptorSet != b.registerSpaceIsDescriptorSet
+        || a.bindingOffsets.shaderResource != b.bindingOffsets.shaderResource
+        || a.bindingOffsets.sampler != b.bindingOffsets.sampler
+        || a.bindingOffsets.constantBuffer != b.bindingOffsets.constantBuffer
+        || a.bindingOffsets.unorderedAccess != b.bindingOffsets.unorderedAccess
+        || a.bindings.size() != b.bindings.size())
+    {
+        return false;
+    }
+
+    for (size_t index = 0; index < a.bindings.size(); index++)
+    {
+        const nvrhi::BindingLayoutItem& itemA = a.bindings[index];
+        const nvrhi::BindingLayoutItem& itemB = b.bindings[index];
+        if (itemA.slot != itemB.slot || itemA.type != itemB.type || itemA.size != itemB.size)
+            return false;
+    }
+    return true;
+}
+
+nvrhi::BindingLayoutHandle PipelineCache::GetBindingLayout(const nvrhi::BindingLayoutDesc& desc)
+{
+    const size_t key = HashBindingLayout(desc);
+
+    auto range = m_BindingLayouts.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (BindingLayoutsMatch(it->second.desc, desc))
+            return it->second.layout;
+    }
+
+    nvrhi::BindingLayoutHandle layout = m_Device->createBindingLayout(desc);
+    if (layout)
+    {
+        m_BindingLayouts.emplace(key, BindingLayoutEntry{ desc, layout });
+    }
+    return layout;
+}
+
+nvrhi::ComputePipelineHandle PipelineCache::GetComputePipeline(const nvrhi::ComputePipelineDesc& desc)
+{
+    size_t key = HashShader(desc.CS);
+    for (const nvrhi::BindingLayoutHandle& layout : desc.bindingLayouts)
+    {
+        nvrhi::hash_combine(key, layout.Get());
+    }
+
+    // Layouts come from GetBindingLayout, so equal layouts are the same object
+    auto layoutsMatch = [&desc](const nvrhi::BindingLayoutVector& layouts)
+    {
+        if (layouts.size() != desc.bindingLayouts.size())
+            return false;
+        for (size_t index = 0; index < layouts.size(); index++)
+        {
+            if (layouts[index].Get() != desc.bindingLayouts[index].Get())
+                return false;
+        }
+        return true;
+    };
+
+    auto range = m_ComputePipelines.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        const ComputePipelineEntry& entry = it->second;
+        if (layoutsMatch(entry.bindingLayouts) && ShadersMatch(entry.shader, desc.CS))
+        {
+            m_Statistics.hits++;
+            return entry.pipeline;
+        }
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    nvrhi::ComputePipelineHandle pipeline = m_Device->createComputePipeline(desc);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    m_Statistics.misses++;
+    m_Statistics.missMilliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+
+    if (pipeline)
+    {
+        m_ComputePipelines.emplace(key, ComputePipelineEntry{ desc.CS, desc.bindingLayouts, pipeline });
+    }
+    return pipeline;
+}
+
+void PipelineCache::Clear()
+{
+    m_BindingLayouts.clear();
+    m_ComputePipelines.clear();
+}
+
+PipelineCache::Statistics PipelineCache::TakeStatistics()
+{
+    Statistics statistics = m_Statistics;
+    m_Statistics = Statistics();
+    return statistics;
+}
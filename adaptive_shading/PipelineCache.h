@@ -0,0 +1,94 @@
+//----------------------------------------------------------------------------------
+// File:        PipelineCache.h
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#pragma once
+
+#include <nvrhi/nvrhi.h>
+
+#include <cstdint>
+#include <unordered_map>
+
+// Binding layouts and compute pipelines of the NAS and lighting passes, shared by every pass created
+// with the same description. Pipelines are keyed by the shader binary and their binding layouts, so
+// passes recreated after a resize or a setting change reuse the pipelines they had and only their
+// binding sets are new. Entries are found by hash and then compared with the full description, so a
+// hash collision is a miss rather than a wrong pipeline. Cleared when the shaders are reloaded.
+//
+// Not done: an on-disk cache. NVRHI does not expose the pipeline caches of the graphics APIs, so every
+// run creates its pipelines again.
+class PipelineCache
+{
+public:
+    struct Statistics
+    {
+        uint32_t hits = 0;
+        uint32_t misses = 0;
+        double missMilliseconds = 0.0;  // time spent creating the missed pipelines
+    };
+
+    explicit PipelineCache(nvrhi::IDevice* device);
+
+    nvrhi::BindingLayoutHandle GetBindingLayout(const nvrhi::BindingLayoutDesc& desc);
+    nvrhi::ComputePipelineHandle GetComputePipeline(const nvrhi::ComputePipelineDesc& desc);
+
+    void Clear();
+
+    // Counts since the last call, for the log of a pass rebuild
+    Statistics TakeStatistics();
+
+    [[nodiscard]] size_t GetPipelineCount() const { return m_ComputePipelines.size(); }
+
+private:
+    struct BindingLayoutEntry
+    {
+        nvrhi::BindingLayoutDesc desc;
+        nvrhi::BindingLayoutHandle layout;
+    };
+
+    // The shader and the layouts are held so their addresses and the bytecode stay valid for the comparison
+    struct ComputePipelineEntry
+    {
+        nvrhi::ShaderHandle shader;
+        nvrhi::BindingLayoutVector bindingLayouts;
+        nvrhi::ComputePipelineHandle pipeline;
+    };
+
+    static size_t HashShader(nvrhi::IShader* shader);
+    static size_t HashBindingLayout(const nvrhi::BindingLayoutDesc& desc);
+    static bool ShadersMatch(nvrhi::IShader* a, nvrhi::IShader* b);
+    static bool BindingLayoutsMatch(const nvrhi::BindingLayoutDesc& a, const nvrhi::BindingLayoutDesc& b);
+
+    nvrhi::DeviceHandle m_Device;
+    std::unordered_multimap<size_t, BindingLayoutEntry> m_BindingLayouts;
+    std::unordered_multimap<size_t, ComputePipelineEntry> m_ComputePipelines;
+    Statistics m_Statistics;
+};
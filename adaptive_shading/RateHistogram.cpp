@@ -0,0 +1,271 @@
+//----------------------------------------------------------------------------------
+// File:        RateHistogram.cpp
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include "RateHistogram.h"
+
+#include <donut/core/log.h>
+#include <donut/engine/CommonRenderPasses.h>
+#include <donut/engine/ShaderFactory.h>
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+
+using namespace donut;
+using namespace donut::math;
+
+#include "Compute_cb.h"  // requires donut::math
+
+static_assert(RateHistogram::c_BucketCount == NAS_HISTOGRAM_BUCKETS);
+
+RateHistogram::RateHistogram(nvrhi::IDevice* device, std::shared_ptr<engine::ShaderFactory> shaderFactory)
+    : m_Device(device)
+    , m_ShaderFactory(shaderFactory)
+{
+    nvrhi::BufferDesc countsDesc;
+    countsDesc.byteSize = NAS_HISTOGRAM_SIZE * sizeof(uint32_t);
+    countsDesc.structStride = sizeof(uint32_t);
+    countsDesc.canHaveUAVs = true;
+    countsDesc.debugName = "RateHistogram";
+    countsDesc.initialState = nvrhi::ResourceStates::UnorderedAccess;
+    countsDesc.keepInitialState = true;
+    m_Counts = m_Device->createBuffer(countsDesc);
+
+    nvrhi::BufferDesc constantBufferDesc;
+    constantBufferDesc.byteSize = sizeof(NASHistogramConstants);
+    constantBufferDesc.debugName = "NASHistogramConstants";
+    constantBufferDesc.isConstantBuffer = true;
+    constantBufferDesc.isVolatile = true;
+    constantBufferDesc.maxVersions = engine::c_MaxRenderPassConstantBufferVersions;
+    m_ConstantBuffer = m_Device->createBuffer(constantBufferDesc);
+
+    nvrhi::TextureDesc dummyDesc;
+    dummyDesc.width = 1;
+    dummyDesc.height = 1;
+    dummyDesc.format = nvrhi::Format::RG16_FLOAT;
+    dummyDesc.initialState = nvrhi::ResourceStates::ShaderResource;
+    dummyDesc.keepInitialState = true;
+    dummyDesc.debugName = "RateHistogramDummy";
+    m_DummyTexture = m_Device->createTexture(dummyDesc);
+
+    for (PendingFrame& frame : m_Frames)
+    {
+        nvrhi::BufferDesc stagingDesc;
+        stagingDesc.byteSize = NAS_HISTOGRAM_SIZE * sizeof(uint32_t);
+        stagingDesc.cpuAccess = nvrhi::CpuAccessMode::Read;
+        stagingDesc.debugName = "RateHistogramStaging";
+        stagingDesc.initialState = nvrhi::ResourceStates::CopyDest;
+        stagingDesc.keepInitialState = true;
+        frame.staging = m_Device->createBuffer(stagingDesc);
+        frame.query = m_Device->createEventQuery();
+    }
+}
+
+bool RateHistogram::CreatePipeline(uint32_t tileSize)
+{
+    m_TileSize = 0;
+    m_Pipeline = nullptr;
+    m_BindingSet = nullptr;
+
+    const std::vector<engine::ShaderMacro> defines = { engine::ShaderMacro("TILE_SIZE", std::to_string(tileSize)) };
+    m_Shader = m_ShaderFactory->CreateShader("app/ShadingRateHistogram", "main_cs", &defines, nvrhi::ShaderType::Compute);
+    if (!m_Shader)
+        return false;
+
+    nvrhi::BindingLayoutDesc layoutDesc;
+    layoutDesc.visibility = nvrhi::ShaderType::Compute;
+    layoutDesc.bindings = {
+        nvrhi::BindingLayoutItem::VolatileConstantBuffer(0),
+        nvrhi::BindingLayoutItem::Texture_SRV(0),
+        nvrhi::BindingLayoutItem::Texture_SRV(1),
+        nvrhi::BindingLayoutItem::Texture_SRV(2),
+        nvrhi::BindingLayoutItem::StructuredBuffer_UAV(0)
+    };
+    m_BindingLayout = m_Device->createBindingLayout(layoutDesc);
+
+    nvrhi::ComputePipelineDesc psoDesc;
+    psoDesc.CS = m_Shader;
+    psoDesc.bindingLayouts = { m_BindingLayout };
+    m_Pipeline = m_Device->createComputePipeline(psoDesc);
+
+    m_TileSize = tileSize;
+    return true;
+}
+
+void RateHistogram::ReadFrame(PendingFrame& frame)
+{
+    frame.pending = false;
+
+    const uint32_t* counts = static_cast<const uint32_t*>(m_Device->mapBuffer(frame.staging, nvrhi::CpuAccessMode::Read));
+    if (!counts)
+    {
+        log::warning("Rate histogram: cannot map the staging buffer of frame %u", frame.result.frameIndex);
+        return;
+    }
+
+    Result& result = frame.result;
+    for (uint32_t rate = 0; rate < 16; rate++)
+    {
+        result.rates.tileCounts[rate] = counts[NAS_HISTOGRAM_TILE_COUNTS + rate];
+    }
+    result.rates.pixels = counts[NAS_HISTOGRAM_PIXELS];
+    result.rates.invocations = counts[NAS_HISTOGRAM_INVOCATIONS];
+    result.rates.coarsePixels = counts[NAS_HISTOGRAM_COARSE_PIXELS];
+    if (result.litPixelsValid)
+        result.litPixels = counts[NAS_HISTOGRAM_LIT_PIXELS];
+    for (uint32_t bucket = 0; bucket < c_BucketCount; bucket++)
+    {
+        result.motionBuckets[bucket] = counts[NAS_HISTOGRAM_MOTION + bucket];
+        result.errorBuckets[bucket] = counts[NAS_HISTOGRAM_ERROR + bucket];
+    }
+
+    m_Device->unmapBuffer(frame.staging);
+
+    m_Result = result;
+    m_HasResult = true;
+}
+
+bool RateHistogram::Update()
+{
+    bool updated = false;
+
+    // Oldest frame first, the GPU finishes them in order
+    for (uint32_t i = 0; i < c_FramesInFlight; i++)
+    {
+        PendingFrame& frame = m_Frames[(m_NextFrame + i) % c_FramesInFlight];
+        if (!frame.pending)
+            continue;
+        if (!m_Device->pollEventQuery(frame.query))
+            break;
+
+        ReadFrame(frame);
+        updated = true;
+    }
+
+    return updated;
+}
+
+void RateHistogram::Record(
+    nvrhi::ICommandList* commandList,
+    nvrhi::ITexture* rateSurface,
+    nvrhi::ITexture* nasData,
+    nvrhi::ITexture* motionVectors,
+    uint32_t width,
+    uint32_t height,
+    uint32_t tileSize,
+    float errorSensitivity,
+    uint32_t frameIndex)
+{
+    m_Recorded = false;
+
+    PendingFrame& frame = m_Frames[m_NextFrame];
+    if (frame.pending)
+    {
+        m_SkippedFrameCount++;
+        return;
+    }
+
+    if (tileSize != m_TileSize && !CreatePipeline(tileSize))
+        return;
+
+    nvrhi::ITexture* const textures[3] = {
+        rateSurface,
+        nasData ? nasData : m_DummyTexture.Get(),
+        motionVectors ? motionVectors : m_DummyTexture.Get()
+    };
+    if (!m_BindingSet || !std::equal(std::begin(textures), std::end(textures), std::begin(m_BoundTextures)))
+    {
+        nvrhi::BindingSetDesc bindingSetDesc;
+        bindingSetDesc.bindings = {
+            nvrhi::BindingSetItem::ConstantBuffer(0, m_ConstantBuffer),
+            nvrhi::BindingSetItem::Texture_SRV(0, textures[0], nvrhi::Format::R8_UINT),
+            nvrhi::BindingSetItem::Texture_SRV(1, textures[1]),
+            nvrhi::BindingSetItem::Texture_SRV(2, textures[2]),
+            nvrhi::BindingSetItem::StructuredBuffer_UAV(0, m_Counts)
+        };
+        m_BindingSet = m_Device->createBindingSet(bindingSetDesc, m_BindingLayout);
+        std::copy(std::begin(textures), std::end(textures), std::begin(m_BoundTextures));
+    }
+
+    NASHistogramConstants constants = {};
+    constants.renderSize = uint2(width, height);
+    constants.errorSensitivity = errorSensitivity;
+    constants.motionValid = motionVectors ? 1 : 0;
+    constants.errorValid = nasData ? 1 : 0;
+    commandList->writeBuffer(m_ConstantBuffer, &constants, sizeof(constants));
+
+    const uint32_t zeros[NAS_HISTOGRAM_SIZE] = {};
+    commandList->writeBuffer(m_Counts, zeros, sizeof(zeros));
+
+    nvrhi::ComputeState state;
+    state.pipeline = m_Pipeline;
+    state.bindings = { m_BindingSet };
+    commandList->setComputeState(state);
+
+    const uint32_t tilesX = (width + tileSize - 1) / tileSize;
+    const uint32_t tilesY = (height + tileSize - 1) / tileSize;
+    commandList->dispatch(
+        (tilesX + NAS_HISTOGRAM_GROUP_SIZE - 1) / NAS_HISTOGRAM_GROUP_SIZE,
+        (tilesY + NAS_HISTOGRAM_GROUP_SIZE - 1) / NAS_HISTOGRAM_GROUP_SIZE, 1);
+
+    commandList->copyBuffer(frame.staging, 0, m_Counts, 0, sizeof(zeros));
+
+    frame.result = Result();
+    frame.result.motionValid = motionVectors != nullptr;
+    frame.result.errorValid = nasData != nullptr;
+    frame.result.frameIndex = frameIndex;
+    m_Recorded = true;
+}
+
+void RateHistogram::RecordLitPixels(nvrhi::ICommandList* commandList, nvrhi::IBuffer* litPixelCount)
+{
+    if (!m_Recorded)
+        return;
+
+    PendingFrame& frame = m_Frames[m_NextFrame];
+    commandList->copyBuffer(frame.staging, NAS_HISTOGRAM_LIT_PIXELS * sizeof(uint32_t), litPixelCount, 0, sizeof(uint32_t));
+    frame.result.litPixelsValid = true;
+}
+
+void RateHistogram::Submit()
+{
+    if (!m_Recorded)
+        return;
+
+    PendingFrame& frame = m_Frames[m_NextFrame];
+    m_Device->resetEventQuery(frame.query);
+    m_Device->setEventQuery(frame.query, nvrhi::CommandQueue::Graphics);
+    frame.pending = true;
+
+    m_NextFrame = (m_NextFrame + 1) % c_FramesInFlight;
+    m_Recorded = false;
+}
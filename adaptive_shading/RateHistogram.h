@@ -0,0 +1,129 @@
+//----------------------------------------------------------------------------------
+// File:        RateHistogram.h
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#pragma once
+
+#include <nas/RateStatistics.h>
+#include <nvrhi/nvrhi.h>
+
+#include <memory>
+
+namespace donut::engine
+{
+    class ShaderFactory;
+}
+
+// Rate counts of the VRS surface and histograms of the tile motion and NAS error, reduced on the
+// GPU by ShadingRateHistogram.hlsl. The counts are copied into a ring of staging buffers and read
+// once an event query shows that the GPU is done with them, a few frames later, so reading them
+// never waits for the GPU. When all buffers are still in flight the frame is skipped.
+class RateHistogram
+{
+public:
+    static constexpr uint32_t c_BucketCount = 8;    // NAS_HISTOGRAM_BUCKETS
+
+    struct Result
+    {
+        nas::RateStatistics rates;
+        uint32_t motionBuckets[c_BucketCount] = {};
+        uint32_t errorBuckets[c_BucketCount] = {};
+        bool motionValid = false;
+        bool errorValid = false;
+        uint32_t litPixels = 0;         // pixels the VRS deferred lighting pass lit
+        bool litPixelsValid = false;
+        uint32_t frameIndex = 0;
+    };
+
+    RateHistogram(nvrhi::IDevice* device, std::shared_ptr<donut::engine::ShaderFactory> shaderFactory);
+
+    // Reads the counts of the frames the GPU has finished
+    bool Update();
+
+    // Records the reduction of this frame over the tiles of the render size (width, height), the surfaces
+    // may be larger. Without nasData or motionVectors the matching histogram is empty.
+    void Record(
+        nvrhi::ICommandList* commandList,
+        nvrhi::ITexture* rateSurface,
+        nvrhi::ITexture* nasData,
+        nvrhi::ITexture* motionVectors,
+        uint32_t width,
+        uint32_t height,
+        uint32_t tileSize,
+        float errorSensitivity,
+        uint32_t frameIndex);
+
+    // Adds the lit pixel count of VRSDeferredLighting.hlsl to the frame recorded last, call after
+    // the lighting pass in the same command list
+    void RecordLitPixels(nvrhi::ICommandList* commandList, nvrhi::IBuffer* litPixelCount);
+
+    // Call after the command list passed to Record has been executed
+    void Submit();
+
+    [[nodiscard]] bool HasResult() const { return m_HasResult; }
+    [[nodiscard]] const Result& GetResult() const { return m_Result; }
+    [[nodiscard]] uint32_t GetSkippedFrameCount() const { return m_SkippedFrameCount; }
+
+private:
+    static constexpr uint32_t c_FramesInFlight = 4;
+
+    struct PendingFrame
+    {
+        nvrhi::BufferHandle staging;
+        nvrhi::EventQueryHandle query;
+        Result result;
+        bool pending = false;
+    };
+
+    bool CreatePipeline(uint32_t tileSize);
+    void ReadFrame(PendingFrame& frame);
+
+    nvrhi::DeviceHandle m_Device;
+    std::shared_ptr<donut::engine::ShaderFactory> m_ShaderFactory;
+
+    nvrhi::ShaderHandle m_Shader;
+    nvrhi::BindingLayoutHandle m_BindingLayout;
+    nvrhi::BindingSetHandle m_BindingSet;
+    nvrhi::ComputePipelineHandle m_Pipeline;
+    nvrhi::BufferHandle m_ConstantBuffer;
+    nvrhi::BufferHandle m_Counts;
+    nvrhi::TextureHandle m_DummyTexture;    // bound in place of missing inputs
+    uint32_t m_TileSize = 0;
+    nvrhi::ITexture* m_BoundTextures[3] = {};
+
+    PendingFrame m_Frames[c_FramesInFlight];
+    uint32_t m_NextFrame = 0;
+    bool m_Recorded = false;
+    uint32_t m_SkippedFrameCount = 0;
+
+    Result m_Result;
+    bool m_HasResult = false;
+};
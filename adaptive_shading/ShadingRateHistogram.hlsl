@@ -0,0 +1,88 @@
+#include "Compute_cb.h"
+
+// Reduces the VRS surface into the rate counts of nas::RateStatistics, plus histograms of the
+// tile motion and of the NAS error relative to the error sensitivity. One thread per tile; the
+// counts of a group are summed in groupshared memory before they are added to the output.
+
+cbuffer HistogramCB : register(b0)
+{
+    NASHistogramConstants HistogramParams;
+};
+
+Texture2D<uint> vrsSurface : register(t0);
+Texture2D<float2> nasDataSurface : register(t1);
+Texture2D<float2> motionVectors : register(t2);
+RWStructuredBuffer<uint> histogram : register(u0);
+
+// VRS tile size of the device, one shader permutation per supported size (8, 16 or 32)
+#ifndef TILE_SIZE
+#define TILE_SIZE 16
+#endif
+
+groupshared uint gs_Histogram[NAS_HISTOGRAM_SIZE];
+
+// Logarithmic buckets: bucket referenceBucket starts at referenceValue, each bucket covers twice
+// the values of the one before. The first and last buckets are open-ended.
+uint GetBucket(float value, float referenceValue, int referenceBucket)
+{
+    if (value <= 0)
+        return 0;
+    int bucket = int(floor(log2(value / referenceValue))) + referenceBucket;
+    return uint(clamp(bucket, 0, NAS_HISTOGRAM_BUCKETS - 1));
+}
+
+[numthreads(NAS_HISTOGRAM_GROUP_SIZE, NAS_HISTOGRAM_GROUP_SIZE, 1)]
+void main_cs(uint3 DispatchThreadID : SV_DispatchThreadID, uint GroupIndex : SV_GroupIndex)
+{
+    for (uint index = GroupIndex; index < NAS_HISTOGRAM_SIZE; index += NAS_HISTOGRAM_GROUP_SIZE * NAS_HISTOGRAM_GROUP_SIZE)
+    {
+        gs_Histogram[index] = 0;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    // Only the tiles of the render size, the surface may be larger
+    uint2 tileCount = (HistogramParams.renderSize + TILE_SIZE - 1) / TILE_SIZE;
+
+    if (all(DispatchThreadID.xy < tileCount))
+    {
+        uint2 tile = DispatchThreadID.xy;
+        uint rate = vrsSurface[tile] & 0xf;
+
+        // Partial tiles at the right and bottom edges only count their pixels inside the target
+        uint2 tileOrigin = tile * TILE_SIZE;
+        uint2 tileSize = min(uint2(TILE_SIZE, TILE_SIZE), HistogramParams.renderSize - tileOrigin);
+        uint2 rateSize = uint2(1 << ((rate >> 2) & 3), 1 << (rate & 3));
+        uint2 coarsePixels = (tileSize + rateSize - 1) / rateSize;
+        uint pixels = tileSize.x * tileSize.y;
+
+        InterlockedAdd(gs_Histogram[NAS_HISTOGRAM_TILE_COUNTS + rate], 1);
+        InterlockedAdd(gs_Histogram[NAS_HISTOGRAM_PIXELS], pixels);
+        InterlockedAdd(gs_Histogram[NAS_HISTOGRAM_INVOCATIONS], coarsePixels.x * coarsePixels.y);
+        if (rate != 0)
+        {
+            InterlockedAdd(gs_Histogram[NAS_HISTOGRAM_COARSE_PIXELS], pixels);
+        }
+
+        if (HistogramParams.motionValid != 0)
+        {
+            float2 motion = motionVectors[tileOrigin + tileSize / 2];
+            InterlockedAdd(gs_Histogram[NAS_HISTOGRAM_MOTION + GetBucket(length(motion), NAS_HISTOGRAM_MIN_MOTION, 1)], 1);
+        }
+
+        if (HistogramParams.errorValid != 0)
+        {
+            float2 error = nasDataSurface[tile];
+            float relativeError = max(error.x, error.y) / HistogramParams.errorSensitivity;
+            InterlockedAdd(gs_Histogram[NAS_HISTOGRAM_ERROR + GetBucket(relativeError, 1.0, NAS_HISTOGRAM_ERROR_THRESHOLD_BUCKET)], 1);
+        }
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    for (uint index = GroupIndex; index < NAS_HISTOGRAM_SIZE; index += NAS_HISTOGRAM_GROUP_SIZE * NAS_HISTOGRAM_GROUP_SIZE)
+    {
+        if (gs_Histogram[index] != 0)
+        {
+            InterlockedAdd(histogram[index], gs_Histogram[index]);
+        }
+    }
+}
@@ -9,10 +9,19 @@ enum {
     D3D12_SHADING_RATE_4X4 = 0xa
 };
 
+#include "Compute_cb.h"
+
+cbuffer ShadingRateVisCB : register(b0)
+{
+    NASSurfaceConstants SurfaceParams;
+};
+
 Texture2D<uint> vrsSurface : register(t0);
 Texture2D<float2> nasData : register(t1); // for debug vis
 
+#ifndef TILE_SIZE
 #define TILE_SIZE 16
+#endif
 
 void main_vs(
     in uint iVertex : SV_VertexID,
@@ -29,7 +38,11 @@ void main_ps(
     in float4 pos : SV_Position,
     out float4 o_rgba : SV_Target)
 {
-    uint2 xy = uint2(pos.xy);
+    // The window shows the render size scaled up
+    uint2 xy = uint2(pos.xy * SurfaceParams.windowToRenderScale);
+    if (any(xy / TILE_SIZE >= SurfaceParams.tileCount))
+        discard;
+
     uint2 xyGrid = xy % TILE_SIZE;
     uint shadingRate = vrsSurface.Load(uint3(xy / TILE_SIZE, 0));
 
@@ -52,7 +65,7 @@ void main_ps(
     }
 
     // Tile borders
-    if (xyGrid.x == 15 || xyGrid.y == 15)
+    if (xyGrid.x == TILE_SIZE - 1 || xyGrid.y == TILE_SIZE - 1)
         overlay = float4(0.0, 0.0, 0.0, 0.5);
 
     o_rgba = overlay;
@@ -1,47 +1,91 @@
 
-RWTexture2D<uint> vrsSurface : register(u0);
+// Lowers 4x rates to 2x next to tiles with 1x rate. The rates are read from one surface
+// and written to another, so the result does not depend on the order the groups run in.
 
-#define TILE_SIZE 16
+// Neighborhood: the tiles up to SMOOTH_RADIUS (1 to 3) tiles away in the same row or column
+#ifndef SMOOTH_RADIUS
+#define SMOOTH_RADIUS 1
+#endif
 
-[numthreads(16, 16, 1)]
-void main_cs(uint3 DispatchThreadID : SV_DispatchThreadID, uint3 GroupThreadID : SV_GroupThreadID, uint3 GroupID : SV_GroupID)
+// 0: rows and columns in one pass
+// 1: first pass of the separable version, outputs the rate plus the flags of its row
+// 2: second pass of the separable version, combines those with the flags of its column
+#ifndef SMOOTH_PASS
+#define SMOOTH_PASS 0
+#endif
+
+#define GROUP_SIZE 16
+
+// The group caches its tiles and a halo of SMOOTH_RADIUS tiles in the directions it reads
+#define HALO_X ((SMOOTH_PASS != 2) ? SMOOTH_RADIUS : 0)
+#define HALO_Y ((SMOOTH_PASS != 1) ? SMOOTH_RADIUS : 0)
+#define CACHE_WIDTH (GROUP_SIZE + 2 * HALO_X)
+#define CACHE_HEIGHT (GROUP_SIZE + 2 * HALO_Y)
+
+#include "Compute_cb.h"
+// The first pass outputs FLAG_X1 and FLAG_Y1 above the 4-bit shading rate
+#include "NASCommon.hlsli"
+
+cbuffer SmoothCB : register(b0)
+{
+    NASSurfaceConstants SurfaceParams;
+};
+
+Texture2D<uint> inputRates : register(t0);
+RWTexture2D<uint> outputRates : register(u0);
+
+groupshared uint gs_Rates[CACHE_WIDTH * CACHE_HEIGHT];
+
+uint CachedRate(int2 cacheCoord)
 {
-    uint surfaceWidth, surfaceHeight;
-    vrsSurface.GetDimensions(surfaceWidth, surfaceHeight);
+    return gs_Rates[cacheCoord.y * CACHE_WIDTH + cacheCoord.x];
+}
+
+[numthreads(GROUP_SIZE, GROUP_SIZE, 1)]
+void main_cs(uint3 DispatchThreadID : SV_DispatchThreadID, uint3 GroupThreadID : SV_GroupThreadID, uint3 GroupID : SV_GroupID, uint GroupIndex : SV_GroupIndex)
+{
+    // The surface may be larger than the render size, its tiles past the render size are stale
+    int2 tileCount = int2(SurfaceParams.tileCount);
+
+    // Load the tiles of the group and the halo once, tiles outside of the render size read as 0 (1x1)
+    int2 cacheOrigin = int2(GroupID.xy * GROUP_SIZE) - int2(HALO_X, HALO_Y);
+    for (uint index = GroupIndex; index < CACHE_WIDTH * CACHE_HEIGHT; index += GROUP_SIZE * GROUP_SIZE)
+    {
+        int2 coord = cacheOrigin + int2(index % CACHE_WIDTH, index / CACHE_WIDTH);
+        gs_Rates[index] = all(coord >= 0) && all(coord < tileCount) ? inputRates.Load(int3(coord, 0)) : 0;
+    }
+    GroupMemoryBarrierWithGroupSync();
 
     // out-of-bounds check
-    if (DispatchThreadID.x >= surfaceWidth || DispatchThreadID.y >= surfaceHeight)
+    if (any(int2(DispatchThreadID.xy) >= tileCount))
         return;
 
-    uint centerSR = vrsSurface.Load(DispatchThreadID.xy).x;
+    int2 cacheCoord = int2(GroupThreadID.xy) + int2(HALO_X, HALO_Y);
+    uint centerSR = CachedRate(cacheCoord);
 
-    // Check all tiles that contain 4x shading rate in either X or Y
-    if (centerSR & 0xa)
+#if SMOOTH_PASS == 2
+    uint flags = centerSR & (FLAG_X1 | FLAG_Y1);
+    centerSR &= RATE_MASK;
+#else
+    uint flags = 0;
+#endif
+
+    [unroll]
+    for (int offset = 1; offset <= SMOOTH_RADIUS; offset++)
     {
-        bool x1 = false, y1 = false;
-        uint SR;
-        // check if any of the 4 immediate neighboring tiles has 1x rate
-#       define TestOffset(X, Y) \
-        SR = vrsSurface.Load(DispatchThreadID.xy + int2(X, Y)); \
-        x1 |= ((SR & 0x3) == 0); y1 |= ((SR & 0xc) == 0);
-
-        TestOffset(-1,  0);
-        TestOffset( 0, -1);
-        TestOffset( 0,  1);
-        TestOffset( 1,  0);
-
-        // if an neighboring tile has 1x rate and current tile is 4x in X
-        if (x1 && (centerSR & 0x8))
-        {
-            centerSR ^= 0xc;  // increase the X shading rate from 4x to 2x
-        }
-        // if an neighboring tile has 1x rate and current tile is 4x in Y
-        if (y1 && (centerSR & 0x2))
-        {
-            centerSR ^= 0x3;  // increase the Y shading rate from 4x to 2x
-        }
+#if SMOOTH_PASS != 2
+        flags |= NeighborFlags(CachedRate(cacheCoord + int2(-offset, 0)));
+        flags |= NeighborFlags(CachedRate(cacheCoord + int2(offset, 0)));
+#endif
+#if SMOOTH_PASS != 1
+        flags |= NeighborFlags(CachedRate(cacheCoord + int2(0, -offset)) & RATE_MASK);
+        flags |= NeighborFlags(CachedRate(cacheCoord + int2(0, offset)) & RATE_MASK);
+#endif
     }
 
-    vrsSurface[DispatchThreadID.xy] = centerSR;
-
+#if SMOOTH_PASS == 1
+    outputRates[DispatchThreadID.xy] = centerSR | flags;
+#else
+    outputRates[DispatchThreadID.xy] = ApplySmoothingFlags(centerSR, flags);
+#endif
 }
@@ -0,0 +1,199 @@
+#pragma pack_matrix(row_major)
+
+#include "VRSDeferredLighting_cb.h"
+#include <donut/shaders/gbuffer.hlsli>
+#include <donut/shaders/lighting.hlsli>
+#include <donut/shaders/shadows.hlsli>
+
+// Deferred lighting at the rates of the VRS surface: one pixel of every coarse pixel is lit and
+// its result is copied to the others. The lit pixels of a group are packed together, so the
+// waves past the last one skip the lighting. Coarse pixels whose depth or normal vary are lit
+// per pixel. Lighting itself follows the donut deferred lighting pass, without light probes.
+// Without hardware VRS this pass is the only one that shades at the NAS rates.
+
+cbuffer DeferredLightingCB : register(b0)
+{
+    VRSDeferredLightingConstants LightingParams;
+};
+
+Texture2D<float> gBufferDepth : register(t0);
+Texture2D gBuffer0 : register(t1);
+Texture2D gBuffer1 : register(t2);
+Texture2D gBuffer2 : register(t3);
+Texture2D gBuffer3 : register(t4);
+Texture2D<float> ambientOcclusion : register(t5);
+Texture2DArray shadowMapArray : register(t6);
+Texture2D<uint> vrsSurface : register(t7);
+SamplerComparisonState s_ShadowSampler : register(s0);
+
+RWTexture2D<float4> outputColor : register(u0);
+RWStructuredBuffer<uint> litPixelCount : register(u1);  // lit pixels of all groups, for the rate statistics
+
+// VRS tile size of the device, one shader permutation per supported size (8, 16 or 32)
+#ifndef TILE_SIZE
+#define TILE_SIZE 16
+#endif
+
+#define GROUP_SIZE VRS_DEFERRED_GROUP_SIZE
+#define GROUP_PIXELS (GROUP_SIZE * GROUP_SIZE)
+
+groupshared float4 gs_NormalDepth[GROUP_PIXELS];
+groupshared uint gs_Split[GROUP_PIXELS];      // per coarse pixel, indexed by its lit pixel
+groupshared uint gs_Slot[GROUP_PIXELS];       // lit pixel to its index in gs_LitPixels
+groupshared uint gs_LitPixels[GROUP_PIXELS];
+groupshared float3 gs_LitColors[GROUP_PIXELS];
+groupshared uint gs_LitCount;
+
+float3 GetSurfaceWorldPos(float2 windowPos, float depth)
+{
+    float4 clipPos = float4(windowPos * LightingParams.view.windowToClipScale + LightingParams.view.windowToClipBias, depth, 1);
+    float4 worldPos = mul(clipPos, LightingParams.view.matClipToWorld);
+    return worldPos.xyz / worldPos.w;
+}
+
+float3 GetViewIncident(float3 surfaceWorldPos)
+{
+    float4 cameraDirectionOrPosition = LightingParams.view.cameraDirectionOrPosition;
+    if (cameraDirectionOrPosition.w > 0)
+        return normalize(surfaceWorldPos - cameraDirectionOrPosition.xyz);
+    return cameraDirectionOrPosition.xyz;
+}
+
+float3 LightPixel(uint2 pixel)
+{
+    float4 gbufferChannels[4];
+    gbufferChannels[0] = gBuffer0[pixel];
+    gbufferChannels[1] = gBuffer1[pixel];
+    gbufferChannels[2] = gBuffer2[pixel];
+    gbufferChannels[3] = gBuffer3[pixel];
+    MaterialSample surfaceMaterial = DecodeGBuffer(gbufferChannels);
+
+    float3 surfaceWorldPos = GetSurfaceWorldPos(float2(pixel) + 0.5, gBufferDepth[pixel]);
+    float3 viewIncident = GetViewIncident(surfaceWorldPos);
+
+    float3 diffuseTerm = 0;
+    float3 specularTerm = 0;
+
+    [loop]
+    for (uint lightIndex = 0; lightIndex < LightingParams.numLights; lightIndex++)
+    {
+        LightConstants light = LightingParams.lights[lightIndex];
+
+        // Cascades from the nearest, each one fades into the next
+        float2 shadow = 0;
+        for (int cascade = 0; cascade < 4; cascade++)
+        {
+            if (light.shadowCascades[cascade] < 0)
+                break;
+
+            float2 cascadeShadow = EvaluateShadowGather16(shadowMapArray, s_ShadowSampler,
+                LightingParams.shadows[light.shadowCascades[cascade]], surfaceWorldPos, LightingParams.shadowMapTextureSize);
+
+            shadow = saturate(shadow + cascadeShadow * (1.0001 - shadow.y));
+
+            if (shadow.y == 1)
+                break;
+        }
+        shadow.x += (1 - shadow.y) * light.outOfBoundsShadow;
+
+        float3 diffuseRadiance, specularRadiance;
+        ShadeSurface(light, surfaceMaterial, surfaceWorldPos, viewIncident, diffuseRadiance, specularRadiance);
+
+        diffuseTerm += (shadow.x * diffuseRadiance) * light.color;
+        specularTerm += (shadow.x * specularRadiance) * light.color;
+    }
+
+    float occlusion = surfaceMaterial.occlusion;
+    if (LightingParams.enableAmbientOcclusion != 0)
+    {
+        occlusion *= ambientOcclusion[pixel];
+    }
+
+    float3 ambientColor = lerp(LightingParams.ambientColorBottom.rgb, LightingParams.ambientColorTop.rgb, surfaceMaterial.shadingNormal.y * 0.5 + 0.5);
+    diffuseTerm += ambientColor * surfaceMaterial.diffuseAlbedo * occlusion;
+    specularTerm += ambientColor * surfaceMaterial.specularF0 * occlusion;
+
+    return diffuseTerm + specularTerm + surfaceMaterial.emissiveColor;
+}
+
+// Reverse-Z depth is proportional to 1 / view depth, so its relative difference is the one of the view depth
+bool IsDiscontinuity(float4 a, float4 b)
+{
+    float maxDepth = max(a.w, b.w);
+    bool depthEdge = abs(a.w - b.w) > LightingParams.depthThreshold * maxDepth;
+    bool normalEdge = dot(a.xyz, b.xyz) < LightingParams.normalThreshold;
+    return depthEdge || normalEdge;
+}
+
+[numthreads(GROUP_SIZE, GROUP_SIZE, 1)]
+void main_cs(uint3 GroupThreadID : SV_GroupThreadID, uint3 GroupID : SV_GroupID, uint GroupIndex : SV_GroupIndex)
+{
+    // Groups are aligned to the render target, so they hold whole coarse pixels
+    int2 groupOrigin = (LightingParams.viewOrigin / GROUP_SIZE + int2(GroupID.xy)) * GROUP_SIZE;
+    int2 pixel = groupOrigin + int2(GroupThreadID.xy);
+    int2 viewEnd = LightingParams.viewOrigin + LightingParams.viewSize;
+    bool active = all(pixel >= LightingParams.viewOrigin) && all(pixel < viewEnd);
+
+    float4 normalDepth = float4(0, 0, 0, 0);
+    if (active)
+    {
+        normalDepth = float4(gBuffer2[pixel].xyz, gBufferDepth[pixel]);
+    }
+    gs_NormalDepth[GroupIndex] = normalDepth;
+    gs_Split[GroupIndex] = 0;
+    if (GroupIndex == 0)
+    {
+        gs_LitCount = 0;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    // The top left pixel of the coarse pixel is lit, unless it is outside the view
+    uint rate = vrsSurface[uint2(pixel) / TILE_SIZE];
+    int2 coarseSize = int2(1 << ((rate >> 2) & 3), 1 << (rate & 3));
+    int2 litPixel = pixel & ~(coarseSize - 1);
+    if (any(litPixel < LightingParams.viewOrigin))
+    {
+        litPixel = pixel;
+    }
+
+    int2 litCoord = litPixel - groupOrigin;
+    uint litIndex = litCoord.y * GROUP_SIZE + litCoord.x;
+
+    if (active && litIndex != GroupIndex && IsDiscontinuity(normalDepth, gs_NormalDepth[litIndex]))
+    {
+        InterlockedOr(gs_Split[litIndex], 1);
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    if (gs_Split[litIndex] != 0)
+    {
+        litIndex = GroupIndex;
+    }
+
+    if (active && litIndex == GroupIndex)
+    {
+        uint slot;
+        InterlockedAdd(gs_LitCount, 1, slot);
+        gs_LitPixels[slot] = GroupIndex;
+        gs_Slot[GroupIndex] = slot;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    if (GroupIndex == 0)
+    {
+        InterlockedAdd(litPixelCount[0], gs_LitCount);
+    }
+
+    // Light the packed pixels, the first gs_LitCount threads do all the work
+    if (GroupIndex < gs_LitCount)
+    {
+        uint index = gs_LitPixels[GroupIndex];
+        gs_LitColors[GroupIndex] = LightPixel(uint2(groupOrigin + int2(index % GROUP_SIZE, index / GROUP_SIZE)));
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    if (active)
+    {
+        outputColor[pixel] = float4(gs_LitColors[gs_Slot[litIndex]], 0);
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef VRS_DEFERRED_LIGHTING_CB_H
+#define VRS_DEFERRED_LIGHTING_CB_H
+
+#include <donut/shaders/light_cb.h>
+#include <donut/shaders/view_cb.h>
+
+#define VRS_DEFERRED_MAX_LIGHTS 16
+#define VRS_DEFERRED_MAX_SHADOWS 16
+
+// Pixels per VRSDeferredLighting.hlsl group in X and Y, a multiple of the largest coarse pixel
+#define VRS_DEFERRED_GROUP_SIZE 16
+
+struct VRSDeferredLightingConstants
+{
+    PlanarViewConstants view;
+
+    int2 viewOrigin;                // viewport of the view in the render target
+    int2 viewSize;
+    float2 shadowMapTextureSize;
+    uint numLights;
+    uint enableAmbientOcclusion;
+    float4 ambientColorTop;
+    float4 ambientColorBottom;
+
+    // A coarse pixel is lit per pixel when one of its pixels differs from the lit one by more than this
+    float depthThreshold;           // relative difference of the reverse-Z depth, i.e. of the view depth
+    float normalThreshold;          // min cosine between the normals
+    uint2 padding;
+
+    LightConstants lights[VRS_DEFERRED_MAX_LIGHTS];
+    ShadowConstants shadows[VRS_DEFERRED_MAX_SHADOWS];
+};
+
+#endif // VRS_DEFERRED_LIGHTING_CB_H
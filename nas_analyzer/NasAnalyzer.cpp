@@ -0,0 +1,617 @@
+//----------------------------------------------------------------------------------
+// File:        NasAnalyzer.cpp
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+// Runs the CPU NAS pipeline over a captured frame sequence and reports the resulting
+// shading rates, so the NAS parameters can be tuned without a GPU.
+//
+// The manifest lists one frame per line, paths are relative to the manifest:
+//   <color.ppm> <depth.pfm> <16 floats: view-projection matrix, row-major, row vectors>
+// Frame N is analyzed with the colors of frame N-1 and the depth of frame N, like the
+// sample uses the previous frame's LdrColor with the current depth buffer.
+//
+// Alternatively the input can be a .nascap file recorded by the sample (-nas-capture),
+// whose frames already pair the previous colors with the current depth and are read
+// straight from the mapped file.
+
+#include <nas/CaptureFile.h>
+#include <nas/ImageIO.h>
+#include <nas/NasPipeline.h>
+#include <nas/RateStatistics.h>
+#include <nas/TaskScheduler.h>
+#include <nas/WaveEmulation.h>
+
+#include <donut/core/log.h>
+#include <donut/core/math/math.h>
+
+using namespace donut;
+using namespace donut::math;
+
+#include "Compute_cb.h"  // requires donut::math
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct FrameDesc
+{
+    fs::path colorFile;
+    fs::path depthFile;
+    float4x4 viewProjection;
+};
+
+struct AnalyzerSettings
+{
+    fs::path inputFile;
+    fs::path outputDirectory = "nas_analysis";
+    std::vector<float> errorSensitivities = { 0.07f };
+    std::vector<float> motionSensitivities = { 0.5f };
+    std::vector<float> brightnessSensitivities = { 0.1f };
+    nas::ColorEncoding colorEncoding = nas::ColorEncoding::Srgb;
+    bool enableSmoothing = true;
+    uint32_t smoothingRadius = 1;
+    bool writeRateMaps = true;
+    bool verifyFused = false;
+    bool verifyReductions = false;
+    bool verifySmoothing = false;
+    uint32_t threadCount = 0;
+    uint32_t tileSize = nas::c_DefaultTileSize;
+    nas::ErrorMetric errorMetric = nas::ErrorMetric::Max;
+};
+
+// One combination of the swept parameters
+struct ParameterSet
+{
+    float errorSensitivity;
+    float motionSensitivity;
+    float brightnessSensitivity;
+};
+
+struct FrameResult
+{
+    bool valid = false;
+    std::vector<nas::RateStatistics> stats; // one per parameter set
+    uint32_t fusedDifferences = 0;
+    uint32_t fusedClampedTiles = 0;         // frames where the fused pipeline clamped samples to its cache
+    uint32_t fusedClampedDifferences = 0;   // are counted here instead
+    uint32_t reductionDifferences = 0;
+    uint32_t smoothingDifferences = 0;
+};
+
+static void PrintUsage()
+{
+    printf(
+        "Usage: nas_analyzer <manifest | capture.nascap> [options]\n"
+        "  -output <dir>                  output directory (default: nas_analysis)\n"
+        "  -error-sensitivity <a,b,...>   values to sweep (default: 0.07)\n"
+        "  -motion-sensitivity <a,b,...>  values to sweep (default: 0.5)\n"
+        "  -brightness-sensitivity <...>  values to sweep (default: 0.1)\n"
+        "  -linear                        manifest colors are linear instead of sRGB\n"
+        "  -no-smoothing                  skip the smoothing pass\n"
+        "  -smoothing-radius <1|2|3>      smoothing neighborhood in tiles (default: 1)\n"
+        "  -no-rate-maps                  only write statistics\n"
+        "  -verify-fused                  check the fused pipeline against the three-pass result\n"
+        "  -verify-reductions             check the wave and groupshared reductions of ComputeNASData\n"
+        "  -verify-smoothing              check the separable smoothing against the single-pass result\n"
+        "  -threads <n>                   worker threads, 0 = all cores (default)\n"
+        "  -tile-size <8|16|32>           VRS tile size in pixels (default: 16)\n"
+        "  -error-metric <name>           max, l2 or percentile (default: max)\n");
+}
+
+static bool ParseFloatList(const char* text, std::vector<float>& values)
+{
+    values.clear();
+
+    std::istringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        char* end = nullptr;
+        float value = strtof(item.c_str(), &end);
+        if (item.empty() || *end != 0)
+        {
+            log::error("Invalid number '%s' in '%s'", item.c_str(), text);
+            return false;
+        }
+        values.push_back(value);
+    }
+
+    return !values.empty();
+}
+
+static bool ProcessCommandLine(int argc, const char* const* argv, AnalyzerSettings& settings)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const bool hasValue = i + 1 < argc;
+
+        if (!strcmp(argv[i], "-output") && hasValue)
+        {
+            settings.outputDirectory = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-error-sensitivity") && hasValue)
+        {
+            if (!ParseFloatList(argv[++i], settings.errorSensitivities))
+                return false;
+        }
+        else if (!strcmp(argv[i], "-motion-sensitivity") && hasValue)
+        {
+            if (!ParseFloatList(argv[++i], settings.motionSensitivities))
+                return false;
+        }
+        else if (!strcmp(argv[i], "-brightness-sensitivity") && hasValue)
+        {
+            if (!ParseFloatList(argv[++i], settings.brightnessSensitivities))
+                return false;
+        }
+        else if (!strcmp(argv[i], "-linear"))
+        {
+            settings.colorEncoding = nas::ColorEncoding::Linear;
+        }
+        else if (!strcmp(argv[i], "-no-smoothing"))
+        {
+            settings.enableSmoothing = false;
+        }
+        else if (!strcmp(argv[i], "-smoothing-radius") && hasValue)
+        {
+            settings.smoothingRadius = uint32_t(std::stoi(argv[++i]));
+            if (settings.smoothingRadius < 1 || settings.smoothingRadius > nas::c_MaxSmoothingRadius)
+            {
+                log::error("Unsupported smoothing radius %u, expected 1 to %u", settings.smoothingRadius, nas::c_MaxSmoothingRadius);
+                return false;
+            }
+        }
+        else if (!strcmp(argv[i], "-no-rate-maps"))
+        {
+            settings.writeRateMaps = false;
+        }
+        else if (!strcmp(argv[i], "-verify-fused"))
+        {
+            settings.verifyFused = true;
+        }
+        else if (!strcmp(argv[i], "-verify-reductions"))
+        {
+            settings.verifyReductions = true;
+        }
+        else if (!strcmp(argv[i], "-verify-smoothing"))
+        {
+            settings.verifySmoothing = true;
+        }
+        else if (!strcmp(argv[i], "-threads") && hasValue)
+        {
+            settings.threadCount = uint32_t(std::stoi(argv[++i]));
+        }
+        else if (!strcmp(argv[i], "-tile-size") && hasValue)
+        {
+            settings.tileSize = uint32_t(std::stoi(argv[++i]));
+            if (!nas::IsSupportedTileSize(settings.tileSize))
+            {
+                log::error("Unsupported tile size %u, expected 8, 16 or 32", settings.tileSize);
+                return false;
+            }
+        }
+        else if (!strcmp(argv[i], "-error-metric") && hasValue)
+        {
+            if (!nas::ParseErrorMetricName(argv[++i], settings.errorMetric))
+            {
+                log::error("Unknown error metric '%s'", argv[i]);
+                return false;
+            }
+        }
+        else if (argv[i][0] != '-')
+        {
+            settings.inputFile = argv[i];
+        }
+        else
+        {
+            log::error("Unknown or incomplete option '%s'", argv[i]);
+            return false;
+        }
+    }
+
+    return !settings.inputFile.empty();
+}
+
+static bool LoadManifest(const fs::path& manifestFile, std::vector<FrameDesc>& frames)
+{
+    std::ifstream file(manifestFile);
+    if (!file)
+    {
+        log::error("Cannot open %s", manifestFile.generic_string().c_str());
+        return false;
+    }
+
+    const fs::path baseDirectory = manifestFile.parent_path();
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+
+        std::istringstream stream(line);
+        std::string colorFile, depthFile;
+        if (!(stream >> colorFile) || colorFile[0] == '#')
+            continue;
+
+        FrameDesc frame;
+        bool valid = bool(stream >> depthFile);
+        for (int row = 0; row < 4 && valid; row++)
+            for (int col = 0; col < 4 && valid; col++)
+                valid = bool(stream >> frame.viewProjection[row][col]);
+
+        if (!valid)
+        {
+            log::error("%s(%d): expected <color> <depth> and 16 matrix elements", manifestFile.generic_string().c_str(), lineNumber);
+            return false;
+        }
+
+        frame.colorFile = baseDirectory / colorFile;
+        frame.depthFile = baseDirectory / depthFile;
+        frames.push_back(frame);
+    }
+
+    return true;
+}
+
+// Inputs of one analyzed frame, the sensitivities in rateConstants are replaced by the swept values
+struct FrameInputs
+{
+    nas::ColorView prevFrameColors;
+    nas::DepthView depth;
+    nas::ColorEncoding colorEncoding = nas::ColorEncoding::Srgb;
+    AdaptiveShadingConstants rateConstants = {};
+};
+
+static void AnalyzeFrame(
+    const AnalyzerSettings& settings,
+    const std::vector<ParameterSet>& parameterSets,
+    const FrameInputs& frame,
+    uint32_t frameIndex,
+    FrameResult& result)
+{
+    const uint32_t width = frame.depth.width;
+    const uint32_t height = frame.depth.height;
+
+    AdaptiveShadingConstants rateConstants = frame.rateConstants;
+    ComputeNASDataConstants dataConstants = {};
+
+    nas::PipelineInputs inputs;
+    inputs.prevFrameColors = frame.prevFrameColors;
+    inputs.colorEncoding = frame.colorEncoding;
+    inputs.depth = frame.depth;
+    inputs.dataConstants = &dataConstants;
+    inputs.rateConstants = &rateConstants;
+    inputs.enableSmoothing = settings.enableSmoothing;
+    inputs.smoothingRadius = settings.smoothingRadius;
+    inputs.tileSize = settings.tileSize;
+    inputs.errorMetric = settings.errorMetric;
+
+    const uint32_t tilesX = nas::GetTileCount(width, settings.tileSize);
+    const uint32_t tilesY = nas::GetTileCount(height, settings.tileSize);
+    nas::Image<nas::NasTileData> nasData(tilesX, tilesY);
+    nas::Image<uint8_t> unsmoothedRates(tilesX, tilesY);
+    nas::Image<uint8_t> rates(tilesX, tilesY);
+    nas::Image<uint8_t> smoothingTemp;
+    nas::Image<uint8_t> separableRates;
+    nas::PipelineOutputs fusedOutputs;
+
+    result.stats.resize(parameterSets.size());
+
+    for (size_t setIndex = 0; setIndex < parameterSets.size(); setIndex++)
+    {
+        const ParameterSet& parameters = parameterSets[setIndex];
+
+        // Parameter sets are ordered by brightness sensitivity, the only input of the NAS data pass
+        if (setIndex == 0 || parameters.brightnessSensitivity != parameterSets[setIndex - 1].brightnessSensitivity)
+        {
+            dataConstants.brightnessSensitivity = parameters.brightnessSensitivity;
+            nas::ComputeNASDataVectorized(inputs.prevFrameColors, inputs.colorEncoding, dataConstants, nasData.View(),
+                nas::GetSupportedInstructionSet(), settings.tileSize, settings.errorMetric);
+
+            if (settings.verifyReductions)
+            {
+                result.reductionDifferences += nas::CountReductionVariantDifferences(
+                    inputs.prevFrameColors, inputs.colorEncoding, dataConstants, settings.tileSize);
+            }
+        }
+
+        rateConstants.errorSensitivity = parameters.errorSensitivity;
+        rateConstants.motionSensitivity = parameters.motionSensitivity;
+
+        if (settings.enableSmoothing)
+        {
+            nas::ComputeShadingRate(inputs.depth, nasData.View(), rateConstants, unsmoothedRates.View(), settings.tileSize);
+            nas::SmoothShadingRate(unsmoothedRates.View(), rates.View(), settings.smoothingRadius);
+
+            if (settings.verifySmoothing)
+            {
+                smoothingTemp.Resize(tilesX, tilesY);
+                separableRates.Resize(tilesX, tilesY);
+                nas::SmoothShadingRateSeparable(unsmoothedRates.View(), smoothingTemp.View(), separableRates.View(), settings.smoothingRadius);
+                result.smoothingDifferences += nas::CountRateDifferences(rates.View(), separableRates.View());
+            }
+        }
+        else
+        {
+            nas::ComputeShadingRate(inputs.depth, nasData.View(), rateConstants, rates.View(), settings.tileSize);
+        }
+
+        result.stats[setIndex] = nas::ComputeRateStatistics(rates.View(), width, height, settings.tileSize);
+
+        if (settings.verifyFused)
+        {
+            nas::RunFusedPipeline(inputs, fusedOutputs);
+            const uint32_t differences = nas::CountRateDifferences(rates.View(), fusedOutputs.rates.View());
+
+            // Samples clamped to the group cache are expected to change rates, everything else is a bug
+            if (fusedOutputs.clampedTiles)
+            {
+                result.fusedClampedTiles += fusedOutputs.clampedTiles;
+                result.fusedClampedDifferences += differences;
+            }
+            else
+                result.fusedDifferences += differences;
+        }
+
+        if (settings.writeRateMaps)
+        {
+            char fileName[64];
+            snprintf(fileName, sizeof(fileName), "rates_p%03zu_f%05u.pgm", setIndex, frameIndex);
+            if (!nas::WritePgm(settings.outputDirectory / fileName, rates.View()))
+                return;
+        }
+    }
+
+    result.valid = true;
+}
+
+static void AnalyzeManifestFrame(
+    const AnalyzerSettings& settings,
+    const std::vector<FrameDesc>& frames,
+    const std::vector<ParameterSet>& parameterSets,
+    uint32_t frameIndex,
+    FrameResult& result)
+{
+    const FrameDesc& previous = frames[frameIndex - 1];
+    const FrameDesc& current = frames[frameIndex];
+
+    nas::Image<nas::Rgba8> colors;
+    nas::Image<float> depth;
+    if (!nas::ReadPpm(previous.colorFile, colors) || !nas::ReadPfm(current.depthFile, depth))
+        return;
+
+    const uint32_t width = depth.GetWidth();
+    const uint32_t height = depth.GetHeight();
+
+    if (colors.GetWidth() != width || colors.GetHeight() != height)
+    {
+        log::error("Frame %u: color and depth sizes do not match", frameIndex);
+        return;
+    }
+
+    FrameInputs frame;
+    frame.prevFrameColors = colors.View();
+    frame.depth = depth.View();
+    frame.colorEncoding = settings.colorEncoding;
+
+    // Same as FeatureDemo::ComputeVRSRateSurface: inverse(proj) * inverse(view) * prevView * prevProj
+    frame.rateConstants.reprojectionMatrix = inverse(current.viewProjection) * previous.viewProjection;
+    frame.rateConstants.previousViewOrigin = uint2(0, 0);
+    frame.rateConstants.previousViewSize = uint2(width, height);
+    frame.rateConstants.sourceTextureSizeInv = float2(1.f / float(width), 1.f / float(height));
+
+    AnalyzeFrame(settings, parameterSets, frame, frameIndex, result);
+}
+
+static void AnalyzeCaptureFrame(
+    const AnalyzerSettings& settings,
+    const nas::CaptureReader& capture,
+    const std::vector<ParameterSet>& parameterSets,
+    uint32_t frameIndex,
+    FrameResult& result)
+{
+    const nas::CaptureFrame& captured = capture.GetFrame(frameIndex);
+
+    FrameInputs frame;
+    frame.prevFrameColors = captured.colors;
+    frame.depth = captured.depth;
+    frame.colorEncoding = nas::ColorEncoding(captured.record->colorEncoding);
+
+    ComputeNASDataConstants dataConstants;
+    nas::GetCaptureFrameConstants(*captured.record, dataConstants, frame.rateConstants);
+
+    AnalyzeFrame(settings, parameterSets, frame, frameIndex, result);
+}
+
+static bool WriteStatistics(
+    const fs::path& fileName,
+    const std::vector<ParameterSet>& parameterSets,
+    const std::vector<FrameResult>& results)
+{
+    FILE* file = fopen(fileName.generic_string().c_str(), "w");
+    if (!file)
+    {
+        log::error("Cannot create %s", fileName.generic_string().c_str());
+        return false;
+    }
+
+    fprintf(file, "parameter_set,error_sensitivity,motion_sensitivity,brightness_sensitivity,frame");
+    for (nas::ShadingRate rate : nas::c_ShadingRates)
+        fprintf(file, ",tiles_%s", nas::GetShadingRateName(rate));
+    fprintf(file, ",pixels,invocations,invocations_saved,saved_fraction\n");
+
+    for (size_t setIndex = 0; setIndex < parameterSets.size(); setIndex++)
+    {
+        const ParameterSet& parameters = parameterSets[setIndex];
+
+        for (size_t frameIndex = 0; frameIndex < results.size(); frameIndex++)
+        {
+            if (!results[frameIndex].valid)
+                continue;
+
+            const nas::RateStatistics& stats = results[frameIndex].stats[setIndex];
+
+            fprintf(file, "%zu,%g,%g,%g,%zu", setIndex, parameters.errorSensitivity, parameters.motionSensitivity,
+                parameters.brightnessSensitivity, frameIndex);
+            for (nas::ShadingRate rate : nas::c_ShadingRates)
+                fprintf(file, ",%u", stats.tileCounts[rate]);
+            fprintf(file, ",%llu,%llu,%llu,%.6f\n", (unsigned long long)stats.pixels, (unsigned long long)stats.invocations,
+                (unsigned long long)stats.GetInvocationsSaved(), stats.GetSavedFraction());
+        }
+    }
+
+    fclose(file);
+    return true;
+}
+
+int main(int argc, const char* const* argv)
+{
+    AnalyzerSettings settings;
+    if (!ProcessCommandLine(argc, argv, settings))
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    // A manifest needs the previous frame for the colors, captured frames are self-contained
+    const bool isCapture = settings.inputFile.extension() == ".nascap";
+    const uint32_t firstFrame = isCapture ? 0 : 1;
+
+    std::vector<FrameDesc> frames;
+    nas::CaptureReader capture;
+    uint32_t frameCount = 0;
+
+    if (isCapture)
+    {
+        if (!capture.Open(settings.inputFile))
+            return 1;
+        frameCount = capture.GetFrameCount();
+    }
+    else
+    {
+        if (!LoadManifest(settings.inputFile, frames))
+            return 1;
+        frameCount = uint32_t(frames.size());
+    }
+
+    if (frameCount <= firstFrame)
+    {
+        log::error("%s does not contain enough frames", settings.inputFile.generic_string().c_str());
+        return 1;
+    }
+
+    std::error_code error;
+    fs::create_directories(settings.outputDirectory, error);
+    if (error)
+    {
+        log::error("Cannot create %s: %s", settings.outputDirectory.generic_string().c_str(), error.message().c_str());
+        return 1;
+    }
+
+    std::vector<ParameterSet> parameterSets;
+    for (float brightnessSensitivity : settings.brightnessSensitivities)
+        for (float errorSensitivity : settings.errorSensitivities)
+            for (float motionSensitivity : settings.motionSensitivities)
+                parameterSets.push_back({ errorSensitivity, motionSensitivity, brightnessSensitivity });
+
+    // Frames are independent, so they are the unit of parallelism
+    std::vector<FrameResult> results(frameCount);
+    nas::TaskScheduler scheduler(settings.threadCount);
+
+    printf("Analyzing %u frames with %zu parameter sets on %u threads\n", frameCount - firstFrame, parameterSets.size(), scheduler.GetThreadCount());
+
+    scheduler.ParallelFor(frameCount - firstFrame, [&](uint32_t index)
+    {
+        const uint32_t frameIndex = index + firstFrame;
+        if (isCapture)
+            AnalyzeCaptureFrame(settings, capture, parameterSets, frameIndex, results[frameIndex]);
+        else
+            AnalyzeManifestFrame(settings, frames, parameterSets, frameIndex, results[frameIndex]);
+    });
+
+    if (!WriteStatistics(settings.outputDirectory / "statistics.csv", parameterSets, results))
+        return 1;
+
+    uint32_t failedFrames = 0;
+    uint32_t fusedDifferences = 0;
+    uint32_t fusedClampedTiles = 0;
+    uint32_t fusedClampedDifferences = 0;
+    uint32_t reductionDifferences = 0;
+    uint32_t smoothingDifferences = 0;
+    for (size_t frameIndex = firstFrame; frameIndex < results.size(); frameIndex++)
+    {
+        failedFrames += results[frameIndex].valid ? 0 : 1;
+        fusedDifferences += results[frameIndex].fusedDifferences;
+        fusedClampedTiles += results[frameIndex].fusedClampedTiles;
+        fusedClampedDifferences += results[frameIndex].fusedClampedDifferences;
+        reductionDifferences += results[frameIndex].reductionDifferences;
+        smoothingDifferences += results[frameIndex].smoothingDifferences;
+    }
+
+    for (size_t setIndex = 0; setIndex < parameterSets.size(); setIndex++)
+    {
+        nas::RateStatistics total;
+        for (const FrameResult& result : results)
+        {
+            if (result.valid)
+                total.Accumulate(result.stats[setIndex]);
+        }
+
+        const ParameterSet& parameters = parameterSets[setIndex];
+        printf("Set %zu (error %g, motion %g, brightness %g): %.2f%% pixel shader invocations saved\n", setIndex,
+            parameters.errorSensitivity, parameters.motionSensitivity, parameters.brightnessSensitivity, total.GetSavedFraction() * 100.0);
+    }
+
+    if (settings.verifyFused)
+    {
+        printf("Fused pipeline: %u tiles differ from the three-pass result\n", fusedDifferences);
+        printf("Fused pipeline: %u tiles sampled outside of the group cache, %u tiles differ in their frames\n",
+            fusedClampedTiles, fusedClampedDifferences);
+    }
+
+    if (settings.verifyReductions)
+        printf("Reduction variants: %u tiles differ from the groupshared reduction\n", reductionDifferences);
+
+    if (settings.verifySmoothing)
+        printf("Separable smoothing: %u tiles differ from the single-pass result\n", smoothingDifferences);
+
+    if (failedFrames)
+        log::error("%u frames could not be analyzed", failedFrames);
+
+    return (failedFrames || fusedDifferences || reductionDifferences || smoothingDifferences) ? 1 : 0;
+}
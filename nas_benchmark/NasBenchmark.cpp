@@ -0,0 +1,1059 @@
+//----------------------------------------------------------------------------------
+// File:        NasBenchmark.cpp
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+// Measures the CPU NAS stages in isolation and writes the results as JSON, so that
+// regressions can be tracked from one build to the next.
+//
+// Every combination of content (synthetic and/or a .nascap capture), resolution and tile
+// size is measured for each stage. The multithreaded pipeline is additionally measured
+// for every requested thread count to show the thread scaling. The incremental pipeline
+// runs over the frames in order and also reports the fraction of tiles it recomputed;
+// synthetic content is a single repeated frame, so it only shows the best case.
+//
+// The error metrics are compared on the reference implementation, which is the only one that
+// implements all of them: their cost, and how the rates they select differ from those of the
+// max metric. The error scalers are compared the same way, the pow chains against the table.
+//
+// -simulate-controller instead runs nas::BudgetController against a cost model of the
+// controlled pass and fails when it misses the target.
+
+#include <nas/BudgetController.h>
+#include <nas/CaptureFile.h>
+#include <nas/ErrorScalers.h>
+#include <nas/IncrementalPipeline.h>
+#include <nas/ParallelPipeline.h>
+#include <nas/RateStatistics.h>
+
+#include <donut/core/log.h>
+#include <donut/core/math/math.h>
+
+using namespace donut;
+using namespace donut::math;
+
+#include "Compute_cb.h"  // requires donut::math
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct Resolution
+{
+    std::string name;
+    uint32_t width;
+    uint32_t height;
+};
+
+struct BenchmarkSettings
+{
+    fs::path outputFile = "nas_benchmark.json";
+    fs::path captureFile;
+    fs::path errorScalerTable;  // -write-error-scalers, written instead of running the benchmark
+    bool simulateController = false;  // -simulate-controller, run instead of the benchmark
+    std::vector<Resolution> resolutions;
+    std::vector<uint32_t> tileSizes = { 8, 16, 32 };
+    std::vector<uint32_t> threadCounts;
+    nas::InstructionSet instructionSet = nas::GetSupportedInstructionSet();
+    bool synthetic = true;
+    double minTimeMs = 200.0;
+    uint32_t minSamples = 5;
+    float motionTolerance = 0.f;
+    float errorTolerance = 0.f;
+};
+
+// The inputs of one frame, views into either generated images or a mapped capture
+struct BenchmarkFrame
+{
+    nas::ColorView prevFrameColors;
+    nas::DepthView depth;
+    nas::ColorEncoding colorEncoding = nas::ColorEncoding::Srgb;
+    ComputeNASDataConstants dataConstants = {};
+    AdaptiveShadingConstants rateConstants = {};
+};
+
+struct BenchmarkContent
+{
+    std::string name;
+    std::string resolution;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<BenchmarkFrame> frames;
+
+    // Storage of the synthetic frames
+    nas::Image<nas::Rgba8> colors;
+    nas::Image<float> depth;
+};
+
+struct Measurement
+{
+    uint32_t samples = 0;
+    double medianMs = 0.0;
+    double minMs = 0.0;
+};
+
+struct BenchmarkResult
+{
+    std::string stage;
+    std::string content;
+    std::string resolution;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t tileSize = 0;
+    uint32_t threads = 1;
+    uint64_t tiles = 0;
+    uint64_t bytesPerTile = 0;
+    Measurement time;
+    double speedup = 1.0;   // only for multithreaded stages, relative to 1 thread
+    double dirtyFraction = 1.0; // only for the incremental stage, tiles recomputed per tile
+    double rateDifference = 0.0; // only for the metric and scaler stages, tiles whose rate differs from the max metric or the pow scalers
+    double savedFraction = 0.0; // only for the metric stages, pixel shader invocations saved by the rates
+};
+
+struct ErrorScalerAccuracy
+{
+    double maxHalfRateError = 0.0;
+    double maxHalfRateErrorMotion = 0.0;
+    double maxHalfRateRelativeError = 0.0;
+    double maxQuarterRateError = 0.0;
+    double maxQuarterRateErrorMotion = 0.0;
+    double maxQuarterRateRelativeError = 0.0;
+};
+
+static const Resolution c_StandardResolutions[] = {
+    { "1080p", 1920, 1080 },
+    { "1440p", 2560, 1440 },
+    { "4k", 3840, 2160 },
+    { "8k", 7680, 4320 },
+};
+
+static void PrintUsage()
+{
+    printf(
+        "Usage: nas_benchmark [options]\n"
+        "  -output <file>            JSON results (default: nas_benchmark.json)\n"
+        "  -resolutions <a,b,...>    1080p, 1440p, 4k, 8k or WxH (default: all four)\n"
+        "  -tile-sizes <a,b,...>     VRS tile sizes (default: 8,16,32)\n"
+        "  -threads <a,b,...>        thread counts for the parallel pipeline (default: 1, 2, 4, ... all cores)\n"
+        "  -capture <file.nascap>    also measure the frames of a capture, at its own resolution\n"
+        "  -no-synthetic             only measure the capture\n"
+        "  -isa <name>               instruction set of the NAS data kernels (default: best supported)\n"
+        "  -min-time <ms>            minimum measurement time per result (default: 200)\n"
+        "  -min-samples <n>          minimum number of timed runs per result (default: 5)\n"
+        "  -motion-tolerance <px>    motion tolerance of the incremental pipeline (default: 0)\n"
+        "  -error-tolerance <f>      NAS data tolerance of the incremental pipeline, a fraction of the error sensitivity (default: 0)\n"
+        "  -write-error-scalers <file>  only write the error scaler table of the shaders (ErrorScalerTable.h)\n"
+        "  -simulate-controller      only run the NAS budget controller against a simulated cost model\n");
+}
+
+template<typename T, typename Parse>
+static bool ParseList(const char* text, std::vector<T>& values, Parse parse)
+{
+    values.clear();
+
+    std::istringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        T value;
+        if (item.empty() || !parse(item, value))
+        {
+            log::error("Invalid value '%s' in '%s'", item.c_str(), text);
+            return false;
+        }
+        values.push_back(value);
+    }
+
+    return !values.empty();
+}
+
+static bool ParseUint(const std::string& text, uint32_t& value)
+{
+    char* end = nullptr;
+    unsigned long result = strtoul(text.c_str(), &end, 10);
+    value = uint32_t(result);
+    return *end == 0 && result > 0;
+}
+
+static bool ParseResolution(const std::string& text, Resolution& resolution)
+{
+    for (const Resolution& standard : c_StandardResolutions)
+    {
+        if (text == standard.name)
+        {
+            resolution = standard;
+            return true;
+        }
+    }
+
+    unsigned width = 0, height = 0;
+    char separator = 0;
+    std::istringstream stream(text);
+    if (stream >> width >> separator >> height && separator == 'x' && width > 0 && height > 0 && stream.eof())
+    {
+        resolution = { text, width, height };
+        return true;
+    }
+
+    return false;
+}
+
+static bool ProcessCommandLine(int argc, const char* const* argv, BenchmarkSettings& settings)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const bool hasValue = i + 1 < argc;
+
+        if (!strcmp(argv[i], "-output") && hasValue)
+        {
+            settings.outputFile = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-resolutions") && hasValue)
+        {
+            if (!ParseList(argv[++i], settings.resolutions, ParseResolution))
+                return false;
+        }
+        else if (!strcmp(argv[i], "-tile-sizes") && hasValue)
+        {
+            if (!ParseList(argv[++i], settings.tileSizes, ParseUint))
+                return false;
+
+            for (uint32_t tileSize : settings.tileSizes)
+            {
+                if (!nas::IsSupportedTileSize(tileSize))
+                {
+                    log::error("Unsupported tile size %u, expected 8, 16 or 32", tileSize);
+                    return false;
+                }
+            }
+        }
+        else if (!strcmp(argv[i], "-threads") && hasValue)
+        {
+            if (!ParseList(argv[++i], settings.threadCounts, ParseUint))
+                return false;
+        }
+        else if (!strcmp(argv[i], "-capture") && hasValue)
+        {
+            settings.captureFile = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-no-synthetic"))
+        {
+            settings.synthetic = false;
+        }
+        else if (!strcmp(argv[i], "-isa") && hasValue)
+        {
+            nas::InstructionSet instructionSet;
+            if (!nas::ParseInstructionSetName(argv[++i], instructionSet))
+            {
+                log::error("Unknown instruction set '%s'", argv[i]);
+                return false;
+            }
+            settings.instructionSet = nas::ResolveInstructionSet(instructionSet);
+        }
+        else if (!strcmp(argv[i], "-motion-tolerance") && hasValue)
+        {
+            settings.motionTolerance = std::stof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-error-tolerance") && hasValue)
+        {
+            settings.errorTolerance = std::stof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-min-time") && hasValue)
+        {
+            settings.minTimeMs = std::stod(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "-min-samples") && hasValue)
+        {
+            settings.minSamples = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (!strcmp(argv[i], "-write-error-scalers") && hasValue)
+        {
+            settings.errorScalerTable = argv[++i];
+        }
+        else if (!strcmp(argv[i], "-simulate-controller"))
+        {
+            settings.simulateController = true;
+        }
+        else
+        {
+            log::error("Unknown or incomplete option '%s'", argv[i]);
+            return false;
+        }
+    }
+
+    if (settings.resolutions.empty())
+        settings.resolutions.assign(std::begin(c_StandardResolutions), std::end(c_StandardResolutions));
+
+    if (settings.threadCounts.empty())
+    {
+        const uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+        for (uint32_t threads = 1; threads < hardwareThreads; threads *= 2)
+            settings.threadCounts.push_back(threads);
+        settings.threadCounts.push_back(hardwareThreads);
+    }
+
+    if (!settings.synthetic && settings.captureFile.empty())
+    {
+        log::error("-no-synthetic requires -capture");
+        return false;
+    }
+
+    return true;
+}
+
+static uint32_t Hash(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352d;
+    x ^= x >> 15;
+    x *= 0x846ca68b;
+    x ^= x >> 16;
+    return x;
+}
+
+// Deterministic content with the mix of flat, smooth and detailed regions that makes NAS
+// select every shading rate, and a slight camera motion so the reprojection is not trivial
+static void CreateSyntheticContent(const Resolution& resolution, BenchmarkContent& content)
+{
+    const uint32_t width = resolution.width;
+    const uint32_t height = resolution.height;
+    const uint32_t c_RegionSize = 64;
+
+    content.name = "synthetic";
+    content.resolution = resolution.name;
+    content.width = width;
+    content.height = height;
+    content.colors.Resize(width, height);
+    content.depth.Resize(width, height);
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        for (uint32_t x = 0; x < width; x++)
+        {
+            const uint32_t region = Hash((y / c_RegionSize) * 4099 + x / c_RegionSize) % 3;
+            const uint32_t noise = Hash(y * width + x);
+
+            uint8_t value;
+            switch (region)
+            {
+            case 0: value = 96; break;
+            case 1: value = uint8_t((x + y) % 256); break;
+            default: value = uint8_t(noise); break;
+            }
+
+            content.colors.At(x, y) = { value, uint8_t(255 - value), uint8_t(value / 2 + 64), 255 };
+            content.depth.At(x, y) = 0.5f + 0.4f * float(x) / float(width) + 0.05f * float((noise >> 8) & 0xff) / 255.f;
+        }
+    }
+
+    BenchmarkFrame frame;
+    frame.prevFrameColors = content.colors.View();
+    frame.depth = content.depth.View();
+    frame.dataConstants.brightnessSensitivity = 0.1f;
+    frame.rateConstants.reprojectionMatrix = float4x4::identity();
+    frame.rateConstants.reprojectionMatrix[3][0] = 0.01f; // small horizontal camera motion
+    frame.rateConstants.previousViewOrigin = uint2(0, 0);
+    frame.rateConstants.previousViewSize = uint2(width, height);
+    frame.rateConstants.sourceTextureSizeInv = float2(1.f / float(width), 1.f / float(height));
+    frame.rateConstants.errorSensitivity = 0.07f;
+    frame.rateConstants.motionSensitivity = 0.5f;
+    content.frames.push_back(frame);
+}
+
+// Uses the captured frames that have the resolution of the first one, they stay in the mapping
+static bool CreateCapturedContent(const nas::CaptureReader& capture, BenchmarkContent& content)
+{
+    if (capture.GetFrameCount() == 0)
+        return false;
+
+    content.name = "captured";
+    content.width = capture.GetFrame(0).record->width;
+    content.height = capture.GetFrame(0).record->height;
+    content.resolution = std::to_string(content.width) + "x" + std::to_string(content.height);
+
+    for (uint32_t frameIndex = 0; frameIndex < capture.GetFrameCount(); frameIndex++)
+    {
+        const nas::CaptureFrame& captured = capture.GetFrame(frameIndex);
+        if (captured.record->width != content.width || captured.record->height != content.height)
+            continue;
+
+        BenchmarkFrame frame;
+        frame.prevFrameColors = captured.colors;
+        frame.depth = captured.depth;
+        frame.colorEncoding = nas::ColorEncoding(captured.record->colorEncoding);
+        nas::GetCaptureFrameConstants(*captured.record, frame.dataConstants, frame.rateConstants);
+        content.frames.push_back(frame);
+    }
+
+    return true;
+}
+
+// Bytes each stage reads and writes per tile, not counting cache effects or recomputation.
+// Depth is sampled sparsely: four of the eight pixels of every 2x4 block.
+static uint64_t GetBytesPerTile(const std::string& stage, uint32_t tileSize)
+{
+    const uint64_t colorBytes = uint64_t(tileSize) * tileSize * sizeof(nas::Rgba8);
+    const uint64_t depthBytes = uint64_t(tileSize) * tileSize / 2 * sizeof(float);
+    const uint64_t nasDataBytes = sizeof(nas::NasTileData);
+    const uint64_t rateBytes = 1;
+
+    const uint64_t nasData = colorBytes + nasDataBytes;
+    const uint64_t shadingRate = depthBytes + 4 * nasDataBytes + rateBytes; // bilinear NAS data sample
+    const uint64_t smoothing = 5 * rateBytes + rateBytes;
+
+    if (stage == "nas_data")
+        return nasData;
+    if (stage == "shading_rate")
+        return shadingRate;
+    if (stage == "smoothing")
+        return smoothing;
+    if (stage == "fused")
+        return colorBytes + depthBytes + rateBytes;
+    if (stage == "incremental")
+        return nasData + shadingRate + sizeof(nas::TileSignature) * 2 + smoothing; // signature read and write
+    if (stage.compare(0, 9, "nas_data_") == 0)
+        return nasData;
+    if (stage.compare(0, 8, "scalers_") == 0)
+        return sizeof(float) + 2 * sizeof(float); // motion in, both scalers out
+    return nasData + shadingRate + smoothing;
+}
+
+// The error scalers the way the rate selection evaluated them before the table
+static float EvaluateHalfRateErrorScaler(float motion)
+{
+    return powf(1.f / (1.f + powf(1.05f * motion, 3.1f)), 0.35f);
+}
+
+static float EvaluateQuarterRateErrorScaler(float motion)
+{
+    return 2.13f * powf(1.f / (1.f + powf(0.55f * motion, 2.41f)), 0.49f);
+}
+
+// Keeps the scaler loops from being optimized away
+static volatile float g_ScalerSink;
+
+// Rate decision of one direction: 0 for 1x, 1 for 2x, 2 for 4x, see nas::SelectShadingRate
+static int SelectRateStep(float error, float halfRateScaler, float quarterRateScaler, float threshold)
+{
+    if (error * halfRateScaler >= threshold)
+        return 0;
+    return (error * quarterRateScaler > threshold) ? 1 : 2;
+}
+
+// Tiles whose decision in X or Y changes when the table replaces the pow chains, each tile moving by its motion
+static uint32_t CountScalerDecisionDifferences(const nas::Image<nas::NasTileData>& nasData, const std::vector<float>& motions, float threshold)
+{
+    uint32_t differences = 0;
+    for (uint32_t y = 0; y < nasData.GetHeight(); y++)
+    {
+        for (uint32_t x = 0; x < nasData.GetWidth(); x++)
+        {
+            const float motion = motions[y * nasData.GetWidth() + x];
+            const float halfRate = EvaluateHalfRateErrorScaler(motion);
+            const float quarterRate = EvaluateQuarterRateErrorScaler(motion);
+            const float halfRateTable = nas::GetHalfRateErrorScaler(motion);
+            const float quarterRateTable = nas::GetQuarterRateErrorScaler(motion);
+
+            bool differs = false;
+            for (uint16_t error : { nasData.At(x, y).errorX, nasData.At(x, y).errorY })
+            {
+                const float value = nas::HalfToFloat(error);
+                differs |= SelectRateStep(value, halfRate, quarterRate, threshold) != SelectRateStep(value, halfRateTable, quarterRateTable, threshold);
+            }
+
+            if (differs)
+                differences++;
+        }
+    }
+    return differences;
+}
+
+// Largest difference between the interpolated table and the scaler equations over every motion:
+// 256 samples per table interval, up to the last one, whose end is infinite motion. The relative
+// error is only taken where the scaler is above 1e-3; it grows without bound toward zero.
+static ErrorScalerAccuracy MeasureErrorScalerAccuracy()
+{
+    constexpr uint32_t c_Samples = (nas::c_ErrorScalerEntries - 1) * 256;
+    constexpr double c_MinRelativeValue = 1e-3;
+
+    auto update = [](double table, double exact, double motion, double& maxError, double& maxErrorMotion, double& maxRelativeError)
+    {
+        const double error = fabs(table - exact);
+        if (error > maxError)
+        {
+            maxError = error;
+            maxErrorMotion = motion;
+        }
+        if (exact > c_MinRelativeValue)
+            maxRelativeError = std::max(maxRelativeError, error / exact);
+    };
+
+    ErrorScalerAccuracy accuracy;
+    for (uint32_t i = 0; i < c_Samples; i++)
+    {
+        const double motion = nas::GetErrorScalerMotion(double(i) / double(c_Samples));
+        update(nas::GetHalfRateErrorScaler(float(motion)), nas::HalfRateErrorScaler(motion), motion,
+            accuracy.maxHalfRateError, accuracy.maxHalfRateErrorMotion, accuracy.maxHalfRateRelativeError);
+        update(nas::GetQuarterRateErrorScaler(float(motion)), nas::QuarterRateErrorScaler(motion), motion,
+            accuracy.maxQuarterRateError, accuracy.maxQuarterRateErrorMotion, accuracy.maxQuarterRateRelativeError);
+    }
+    return accuracy;
+}
+
+// Runs the function until both the minimum time and the minimum sample count are reached.
+// The iteration index lets the caller cycle through the frames of a capture.
+static Measurement Measure(const BenchmarkSettings& settings, const std::function<void(uint32_t)>& function)
+{
+    using Clock = std::chrono::steady_clock;
+    constexpr uint32_t c_MaxSamples = 1000;
+
+    function(0); // warm-up, also faults in the outputs
+
+    std::vector<double> samples;
+    const Clock::time_point start = Clock::now();
+    uint32_t iteration = 1;
+
+    while (samples.size() < c_MaxSamples)
+    {
+        const Clock::time_point begin = Clock::now();
+        function(iteration++);
+        const Clock::time_point end = Clock::now();
+
+        samples.push_back(std::chrono::duration<double, std::milli>(end - begin).count());
+
+        double elapsedMs = std::chrono::duration<double, std::milli>(end - start).count();
+        if (samples.size() >= settings.minSamples && elapsedMs >= settings.minTimeMs)
+            break;
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    Measurement measurement;
+    measurement.samples = uint32_t(samples.size());
+    measurement.medianMs = samples[samples.size() / 2];
+    measurement.minMs = samples.front();
+    return measurement;
+}
+
+static void PrintResult(const BenchmarkResult& result)
+{
+    const double nsPerTile = result.time.medianMs * 1e6 / double(result.tiles);
+    printf("%-10s %-19s %-10s tile %2u  threads %2u  %9.3f ms  %8.2f ns/tile  %6.2fx",
+        result.content.c_str(), result.stage.c_str(), result.resolution.c_str(), result.tileSize,
+        result.threads, result.time.medianMs, nsPerTile, result.speedup);
+
+    if (result.stage == "incremental")
+        printf("  %5.1f%% dirty", result.dirtyFraction * 100.0);
+    if (result.stage.compare(0, 9, "nas_data_") == 0)
+        printf("  %5.1f%% rates differ  %5.1f%% saved", result.rateDifference * 100.0, result.savedFraction * 100.0);
+    if (result.stage == "scalers_lut")
+        printf("  %5.3f%% rates differ", result.rateDifference * 100.0);
+    printf("\n");
+}
+
+static void RunBenchmarks(
+    const BenchmarkSettings& settings,
+    const BenchmarkContent& content,
+    uint32_t tileSize,
+    std::vector<BenchmarkResult>& results)
+{
+    const uint32_t frameCount = uint32_t(content.frames.size());
+    const uint32_t tilesX = nas::GetTileCount(content.width, tileSize);
+    const uint32_t tilesY = nas::GetTileCount(content.height, tileSize);
+
+    nas::Image<nas::NasTileData> nasData(tilesX, tilesY);
+    nas::Image<uint8_t> unsmoothedRates(tilesX, tilesY);
+    nas::Image<uint8_t> rates(tilesX, tilesY);
+    nas::PipelineOutputs outputs;
+
+    auto getInputs = [&content, &settings, frameCount, tileSize](uint32_t iteration)
+    {
+        const BenchmarkFrame& frame = content.frames[iteration % frameCount];
+
+        nas::PipelineInputs inputs;
+        inputs.prevFrameColors = frame.prevFrameColors;
+        inputs.colorEncoding = frame.colorEncoding;
+        inputs.depth = frame.depth;
+        inputs.dataConstants = &frame.dataConstants;
+        inputs.rateConstants = &frame.rateConstants;
+        inputs.instructionSet = settings.instructionSet;
+        inputs.tileSize = tileSize;
+        return inputs;
+    };
+
+    auto addResult = [&](const std::string& stage, uint32_t threads, const Measurement& time, double speedup, double dirtyFraction = 1.0,
+        double rateDifference = 0.0, double savedFraction = 0.0)
+    {
+        BenchmarkResult result;
+        result.stage = stage;
+        result.content = content.name;
+        result.resolution = content.resolution;
+        result.width = content.width;
+        result.height = content.height;
+        result.tileSize = tileSize;
+        result.threads = threads;
+        result.tiles = uint64_t(tilesX) * tilesY;
+        result.bytesPerTile = GetBytesPerTile(stage, tileSize);
+        result.time = time;
+        result.speedup = speedup;
+        result.dirtyFraction = dirtyFraction;
+        result.rateDifference = rateDifference;
+        result.savedFraction = savedFraction;
+        PrintResult(result);
+        results.push_back(result);
+    };
+
+    // Each stage consumes the outputs left over from the last run of the previous one
+    addResult("nas_data", 1, Measure(settings, [&](uint32_t iteration)
+    {
+        nas::PipelineInputs inputs = getInputs(iteration);
+        nas::ComputeNASDataVectorized(inputs.prevFrameColors, inputs.colorEncoding, *inputs.dataConstants,
+            nasData.View(), inputs.instructionSet, tileSize);
+    }), 1.0);
+
+    addResult("shading_rate", 1, Measure(settings, [&](uint32_t iteration)
+    {
+        nas::PipelineInputs inputs = getInputs(iteration);
+        nas::ComputeShadingRate(inputs.depth, nasData.View(), *inputs.rateConstants, unsmoothedRates.View(), tileSize);
+    }), 1.0);
+
+    addResult("smoothing", 1, Measure(settings, [&](uint32_t)
+    {
+        nas::SmoothShadingRate(unsmoothedRates.View(), rates.View());
+    }), 1.0);
+
+    addResult("fused", 1, Measure(settings, [&](uint32_t iteration)
+    {
+        nas::RunFusedPipeline(getInputs(iteration), outputs);
+    }), 1.0);
+
+    // Frames in capture order, the first run (the warm-up) has no previous signatures
+    nas::IncrementalPipeline incremental;
+    incremental.SetMotionTolerance(settings.motionTolerance);
+    incremental.SetErrorTolerance(settings.errorTolerance);
+    uint64_t dirtyTiles = 0;
+    uint64_t measuredTiles = 0;
+
+    Measurement incrementalTime = Measure(settings, [&](uint32_t iteration)
+    {
+        incremental.Run(getInputs(iteration), outputs);
+        if (iteration > 0)
+        {
+            dirtyTiles += incremental.GetDirtyTileCount();
+            measuredTiles += uint64_t(tilesX) * tilesY;
+        }
+    });
+
+    addResult("incremental", 1, incrementalTime, 1.0, double(dirtyTiles) / double(measuredTiles));
+
+    double singleThreadMs = 0.0;
+    for (uint32_t threadCount : settings.threadCounts)
+    {
+        nas::ParallelPipeline pipeline(threadCount);
+
+        Measurement time = Measure(settings, [&](uint32_t iteration)
+        {
+            pipeline.Run(getInputs(iteration), outputs);
+        });
+
+        if (pipeline.GetThreadCount() == 1)
+            singleThreadMs = time.medianMs;
+
+        addResult("pipeline", pipeline.GetThreadCount(), time, singleThreadMs > 0.0 ? singleThreadMs / time.medianMs : 0.0);
+    }
+
+    // Rates of the first frame with the given metric, smoothed like the pipeline
+    const BenchmarkFrame& firstFrame = content.frames[0];
+    const double tileCount = double(tilesX) * double(tilesY);
+    auto computeRates = [&](nas::ErrorMetric metric)
+    {
+        nas::ComputeNASData(firstFrame.prevFrameColors, firstFrame.colorEncoding, firstFrame.dataConstants, nasData.View(), tileSize, metric);
+        nas::ComputeShadingRate(firstFrame.depth, nasData.View(), firstFrame.rateConstants, unsmoothedRates.View(), tileSize);
+        nas::SmoothShadingRate(unsmoothedRates.View(), rates.View());
+    };
+
+    nas::Image<uint8_t> maxMetricRates(tilesX, tilesY);
+    for (nas::ErrorMetric metric : { nas::ErrorMetric::Max, nas::ErrorMetric::L2, nas::ErrorMetric::Percentile })
+    {
+        Measurement time = Measure(settings, [&](uint32_t iteration)
+        {
+            nas::PipelineInputs inputs = getInputs(iteration);
+            nas::ComputeNASData(inputs.prevFrameColors, inputs.colorEncoding, *inputs.dataConstants, nasData.View(), tileSize, metric);
+        });
+
+        computeRates(metric);
+        if (metric == nas::ErrorMetric::Max)
+            maxMetricRates = rates;
+
+        const double rateDifference = double(nas::CountRateDifferences(rates.View(), maxMetricRates.View())) / tileCount;
+        const double savedFraction = nas::ComputeRateStatistics(rates.View(), content.width, content.height, tileSize).GetSavedFraction();
+        addResult(std::string("nas_data_") + nas::GetErrorMetricName(metric), 1, time, 1.0, 1.0, rateDifference, savedFraction);
+    }
+
+    // Scaled motions of up to 32 pixels per tile, and the error of the max metric
+    std::vector<float> motions(tilesX * tilesY);
+    for (uint32_t tile = 0; tile < tilesX * tilesY; tile++)
+        motions[tile] = float(Hash(tile) % 4096) / 128.f * firstFrame.rateConstants.motionSensitivity;
+
+    computeRates(nas::ErrorMetric::Max);
+
+    addResult("scalers_pow", 1, Measure(settings, [&](uint32_t)
+    {
+        float sum = 0.f;
+        for (float motion : motions)
+            sum += EvaluateHalfRateErrorScaler(motion) + EvaluateQuarterRateErrorScaler(motion);
+        g_ScalerSink = sum;
+    }), 1.0);
+
+    addResult("scalers_lut", 1, Measure(settings, [&](uint32_t)
+    {
+        float sum = 0.f;
+        for (float motion : motions)
+            sum += nas::GetHalfRateErrorScaler(motion) + nas::GetQuarterRateErrorScaler(motion);
+        g_ScalerSink = sum;
+    }), 1.0, 1.0, double(CountScalerDecisionDifferences(nasData, motions, firstFrame.rateConstants.errorSensitivity)) / tileCount);
+}
+
+static void WriteScalerMacro(FILE* file, const char* name, const float* values)
+{
+    constexpr uint32_t c_ValuesPerLine = 8;
+
+    fprintf(file, "#define %s { \\\n", name);
+    for (uint32_t i = 0; i < nas::c_ErrorScalerEntries; i++)
+    {
+        // 9 significant digits round-trip a float; keep a decimal point so that every value is a float literal
+        char value[32];
+        snprintf(value, sizeof(value), "%.9g", values[i]);
+        if (!strpbrk(value, ".e"))
+            strncat(value, ".0", sizeof(value) - strlen(value) - 1);
+
+        const bool last = i + 1 == nas::c_ErrorScalerEntries;
+        fprintf(file, "%s%s%s", (i % c_ValuesPerLine == 0) ? "    " : " ", value, last ? " }\n" : ",");
+        if (!last && i % c_ValuesPerLine == c_ValuesPerLine - 1)
+            fprintf(file, " \\\n");
+    }
+}
+
+// Writes ErrorScalerTable.h, the copy of nas::c_ErrorScalerTable the shaders include
+static bool WriteErrorScalerTable(const fs::path& path)
+{
+    FILE* file = fopen(path.generic_string().c_str(), "w");
+    if (!file)
+    {
+        log::error("Cannot create %s", path.generic_string().c_str());
+        return false;
+    }
+
+    fprintf(file, "#ifndef ERROR_SCALER_TABLE_H\n");
+    fprintf(file, "#define ERROR_SCALER_TABLE_H\n\n");
+    fprintf(file, "// Error scalers of the rate selection, see nas/ErrorScalers.h. Entry i holds the scalers of the\n");
+    fprintf(file, "// scaled tile motion 1 / (1 - p)^2 - 1 with p = i / (NAS_ERROR_SCALER_ENTRIES - 1).\n");
+    fprintf(file, "// Generated by nas_benchmark -write-error-scalers, do not edit.\n\n");
+    fprintf(file, "#define NAS_ERROR_SCALER_ENTRIES %u\n\n", nas::c_ErrorScalerEntries);
+    WriteScalerMacro(file, "NAS_HALF_RATE_SCALERS", nas::c_ErrorScalerTable.halfRate);
+    fprintf(file, "\n");
+    WriteScalerMacro(file, "NAS_QUARTER_RATE_SCALERS", nas::c_ErrorScalerTable.quarterRate);
+    fprintf(file, "\n#endif // ERROR_SCALER_TABLE_H\n");
+
+    fclose(file);
+    return true;
+}
+
+// A scene of the simulated budget controller run, with a cost model of the controlled pass:
+// NAS saves up to maxSavedFraction of the invocations, approaching it as the error
+// sensitivity grows past sensitivityScale, and a rate floor saves at least its share
+struct SimulatedScene
+{
+    const char* name;
+    float fullRateMs;
+    float maxSavedFraction;
+    float sensitivityScale;
+};
+
+static const SimulatedScene c_SimulatedScenes[] = {
+    { "flat", 3.f, 0.2f, 0.05f },       // under budget at full rate
+    { "foliage", 5.5f, 0.6f, 0.05f },   // reachable with the sensitivity alone
+    { "detail", 6.5f, 0.25f, 0.03f },   // needs a rate floor
+    { "flat", 3.f, 0.2f, 0.05f },
+};
+
+static constexpr float c_SimulatedTargetMs = 4.f;
+static constexpr float c_SimulatedFixedFraction = 0.2f;    // of the full rate time, not shaded per pixel
+static constexpr float c_SimulatedNoise = 0.03f;           // relative, uniform
+static constexpr uint32_t c_SimulatedLatency = 3;          // frames until a GPU time is resolved
+static constexpr uint32_t c_SimulatedSceneFrames = 600;
+
+static float GetSimulatedPassTime(const SimulatedScene& scene, float errorSensitivity, nas::ShadingRate floor)
+{
+    float savedFraction = scene.maxSavedFraction * (1.f - std::exp(-errorSensitivity / scene.sensitivityScale));
+    savedFraction = std::max(savedFraction, 1.f - 1.f / float(nas::GetShadingRateWidth(floor) * nas::GetShadingRateHeight(floor)));
+    return scene.fullRateMs * (c_SimulatedFixedFraction + (1.f - c_SimulatedFixedFraction) * (1.f - savedFraction));
+}
+
+// Runs the controller against the cost model over scenes that are under, near and over the
+// budget, with timer noise and the latency of the GPU profiler. Returns false when the
+// controller misses the target in a scene where it can be reached, or does not saturate
+// the clamps in one where it cannot.
+static bool SimulateBudgetController()
+{
+    bool success = true;
+
+    for (bool enableRateFloor : { false, true })
+    {
+        nas::BudgetControllerSettings settings;
+        settings.targetMs = c_SimulatedTargetMs;
+        settings.enableRateFloor = enableRateFloor;
+
+        nas::BudgetController controller;
+        controller.SetSettings(settings);
+        controller.Reset(0.07f);
+
+        const nas::ShadingRate maxFloor = enableRateFloor ? settings.maxRateFloor : nas::ShadingRate_1x1;
+
+        printf("Budget controller, target %.2f ms, rate floor %s\n", settings.targetMs, enableRateFloor ? "on" : "off");
+        printf("  %-10s %9s %9s %9s %11s %6s %10s %9s\n", "scene", "min ms", "max ms", "mean ms", "in band", "floor", "sensitivity", "reversals");
+
+        float pendingTimes[c_SimulatedLatency] = {};
+        uint32_t frame = 0;
+
+        for (const SimulatedScene& scene : c_SimulatedScenes)
+        {
+            const float minMs = GetSimulatedPassTime(scene, settings.maxErrorSensitivity, maxFloor);
+            const float maxMs = GetSimulatedPassTime(scene, settings.minErrorSensitivity, nas::ShadingRate_1x1);
+
+            // Statistics of the second half of the scene, after the controller had time to converge
+            double sumMs = 0.0;
+            uint32_t inBand = 0;
+            uint32_t measuredFrames = 0;
+            uint32_t reversals = 0;
+            float lastStep = 0.f;
+
+            for (uint32_t sceneFrame = 0; sceneFrame < c_SimulatedSceneFrames; sceneFrame++, frame++)
+            {
+                const float previousSensitivity = controller.GetErrorSensitivity();
+
+                float noise = (float(Hash(frame) & 0xffff) / 65535.f * 2.f - 1.f) * c_SimulatedNoise;
+                float timeMs = GetSimulatedPassTime(scene, controller.GetErrorSensitivity(), controller.GetRateFloor()) * (1.f + noise);
+
+                // The controller sees the time of the frame rendered c_SimulatedLatency frames ago
+                float resolvedMs = pendingTimes[frame % c_SimulatedLatency];
+                pendingTimes[frame % c_SimulatedLatency] = timeMs;
+                controller.Update(resolvedMs);
+
+                if (sceneFrame < c_SimulatedSceneFrames / 2)
+                    continue;
+
+                sumMs += timeMs;
+                measuredFrames++;
+                if (std::abs(timeMs / settings.targetMs - 1.f) <= settings.tolerance + c_SimulatedNoise)
+                    inBand++;
+
+                const float step = controller.GetErrorSensitivity() - previousSensitivity;
+                if (step != 0.f)
+                {
+                    if (lastStep != 0.f && (step > 0.f) != (lastStep > 0.f))
+                        reversals++;
+                    lastStep = step;
+                }
+            }
+
+            const double meanMs = sumMs / double(measuredFrames);
+            const double inBandFraction = double(inBand) / double(measuredFrames);
+
+            printf("  %-10s %9.2f %9.2f %9.2f %10.1f%% %6s %11.4f %9u\n", scene.name, minMs, maxMs, meanMs, inBandFraction * 100.0,
+                nas::GetShadingRateName(controller.GetRateFloor()), controller.GetErrorSensitivity(), reversals);
+
+            bool sceneSuccess;
+            if (maxMs <= settings.targetMs)
+                sceneSuccess = controller.GetErrorSensitivity() == settings.minErrorSensitivity && controller.GetRateFloor() == nas::ShadingRate_1x1;
+            else if (minMs >= settings.targetMs)
+                sceneSuccess = controller.GetErrorSensitivity() == settings.maxErrorSensitivity && controller.GetRateFloor() == maxFloor;
+            else
+                sceneSuccess = std::abs(meanMs / settings.targetMs - 1.0) <= settings.tolerance && inBandFraction >= 0.9;
+
+            if (!sceneSuccess)
+            {
+                log::error("The budget controller failed in scene '%s'", scene.name);
+                success = false;
+            }
+        }
+    }
+
+    return success;
+}
+
+static const char* GetCompilerName()
+{
+#if defined(__clang__)
+    return "clang " __clang_version__;
+#elif defined(__GNUC__)
+    return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+    return "msvc";
+#else
+    return "unknown";
+#endif
+}
+
+static bool WriteResults(const BenchmarkSettings& settings, const ErrorScalerAccuracy& scalerAccuracy, const std::vector<BenchmarkResult>& results)
+{
+    FILE* file = fopen(settings.outputFile.generic_string().c_str(), "w");
+    if (!file)
+    {
+        log::error("Cannot create %s", settings.outputFile.generic_string().c_str());
+        return false;
+    }
+
+#ifdef NDEBUG
+    const char* buildType = "release";
+#else
+    const char* buildType = "debug";
+#endif
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"version\": 1,\n");
+    fprintf(file, "  \"system\": {\n");
+    fprintf(file, "    \"hardware_threads\": %u,\n", std::thread::hardware_concurrency());
+    fprintf(file, "    \"instruction_set\": \"%s\",\n", nas::GetInstructionSetName(settings.instructionSet));
+    fprintf(file, "    \"compiler\": \"%s\",\n", GetCompilerName());
+    fprintf(file, "    \"build\": \"%s\"\n", buildType);
+    fprintf(file, "  },\n");
+    fprintf(file, "  \"min_time_ms\": %g,\n", settings.minTimeMs);
+    fprintf(file, "  \"min_samples\": %u,\n", settings.minSamples);
+    fprintf(file, "  \"motion_tolerance\": %g,\n", settings.motionTolerance);
+    fprintf(file, "  \"error_tolerance\": %g,\n", settings.errorTolerance);
+    fprintf(file, "  \"error_scalers\": { \"entries\": %u, "
+        "\"max_half_rate_error\": %.3g, \"max_half_rate_error_motion\": %.4g, \"max_half_rate_relative_error\": %.3g, "
+        "\"max_quarter_rate_error\": %.3g, \"max_quarter_rate_error_motion\": %.4g, \"max_quarter_rate_relative_error\": %.3g },\n",
+        nas::c_ErrorScalerEntries,
+        scalerAccuracy.maxHalfRateError, scalerAccuracy.maxHalfRateErrorMotion, scalerAccuracy.maxHalfRateRelativeError,
+        scalerAccuracy.maxQuarterRateError, scalerAccuracy.maxQuarterRateErrorMotion, scalerAccuracy.maxQuarterRateRelativeError);
+
+    fprintf(file, "  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BenchmarkResult& result = results[i];
+        const double nsPerTile = result.time.medianMs * 1e6 / double(result.tiles);
+        const double tilesPerSecond = double(result.tiles) * 1e3 / result.time.medianMs;
+
+        fprintf(file, "    { \"stage\": \"%s\", \"content\": \"%s\", \"resolution\": \"%s\", \"width\": %u, \"height\": %u, "
+            "\"tile_size\": %u, \"threads\": %u, \"tiles\": %llu, \"samples\": %u, \"median_ms\": %.6f, \"min_ms\": %.6f, "
+            "\"ns_per_tile\": %.3f, \"tiles_per_second\": %.0f, \"bytes_per_tile\": %llu, \"speedup\": %.3f, \"efficiency\": %.3f, "
+            "\"dirty_fraction\": %.4f, \"rate_difference\": %.6f, \"saved_fraction\": %.4f }%s\n",
+            result.stage.c_str(), result.content.c_str(), result.resolution.c_str(), result.width, result.height,
+            result.tileSize, result.threads, (unsigned long long)result.tiles, result.time.samples, result.time.medianMs,
+            result.time.minMs, nsPerTile, tilesPerSecond, (unsigned long long)result.bytesPerTile, result.speedup,
+            result.speedup / double(result.threads), result.dirtyFraction, result.rateDifference, result.savedFraction,
+            i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n");
+    fprintf(file, "}\n");
+
+    fclose(file);
+    return true;
+}
+
+int main(int argc, const char* const* argv)
+{
+    BenchmarkSettings settings;
+    if (!ProcessCommandLine(argc, argv, settings))
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    if (!settings.errorScalerTable.empty())
+    {
+        if (!WriteErrorScalerTable(settings.errorScalerTable))
+            return 1;
+
+        printf("Error scaler table written to %s\n", settings.errorScalerTable.generic_string().c_str());
+        return 0;
+    }
+
+    if (settings.simulateController)
+        return SimulateBudgetController() ? 0 : 1;
+
+    nas::CaptureReader capture;
+    if (!settings.captureFile.empty() && !capture.Open(settings.captureFile))
+        return 1;
+
+    printf("NAS benchmark, %s kernels, %u hardware threads\n",
+        nas::GetInstructionSetName(settings.instructionSet), std::thread::hardware_concurrency());
+
+    const ErrorScalerAccuracy scalerAccuracy = MeasureErrorScalerAccuracy();
+    printf("Error scaler table: %u entries, max error %.3g at motion %.4g (half rate), %.3g at motion %.4g (quarter rate), "
+        "max relative error %.3g (half rate), %.3g (quarter rate)\n", nas::c_ErrorScalerEntries,
+        scalerAccuracy.maxHalfRateError, scalerAccuracy.maxHalfRateErrorMotion,
+        scalerAccuracy.maxQuarterRateError, scalerAccuracy.maxQuarterRateErrorMotion,
+        scalerAccuracy.maxHalfRateRelativeError, scalerAccuracy.maxQuarterRateRelativeError);
+
+    std::vector<BenchmarkResult> results;
+
+    for (uint32_t tileSize : settings.tileSizes)
+    {
+        if (settings.synthetic)
+        {
+            for (const Resolution& resolution : settings.resolutions)
+            {
+                BenchmarkContent content;
+                CreateSyntheticContent(resolution, content);
+                RunBenchmarks(settings, content, tileSize, results);
+            }
+        }
+
+        if (!settings.captureFile.empty())
+        {
+            BenchmarkContent content;
+            if (!CreateCapturedContent(capture, content))
+            {
+                log::error("%s contains no frames", settings.captureFile.generic_string().c_str());
+                return 1;
+            }
+            RunBenchmarks(settings, content, tileSize, results);
+        }
+    }
+
+    if (!WriteResults(settings, scalerAccuracy, results))
+        return 1;
+
+    printf("Results written to %s\n", settings.outputFile.generic_string().c_str());
+    return 0;
+}
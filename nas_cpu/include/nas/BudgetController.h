@@ -0,0 +1,100 @@
+//----------------------------------------------------------------------------------
+// File:        BudgetController.h
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+#pragma once
+
+#include <nas/NasPipeline.h>
+
+namespace nas
+{
+    // Rates the controller floors a pass at, coarser ones later. Under a floor, no pixel of the
+    // pass shades finer than the floor whatever the rate surface says.
+    constexpr ShadingRate c_RateFloors[] = { ShadingRate_1x1, ShadingRate_2x1, ShadingRate_2x2, ShadingRate_2x4 };
+
+    struct BudgetControllerSettings
+    {
+        float targetMs = 4.f;               // GPU time of the controlled pass
+        float tolerance = 0.05f;            // relative: corrects beyond target * (1 +- tolerance), stops within half of it
+        float gain = 0.5f;                  // log sensitivity change per log of the time / target ratio
+        float maxStep = 0.1f;               // largest relative sensitivity change per update
+        float smoothing = 0.25f;            // weight of a new time in the filtered time
+        float minErrorSensitivity = 0.02f;  // quality clamps of the sensitivity
+        float maxErrorSensitivity = 0.2f;
+        bool enableRateFloor = false;       // raise a rate floor when the max sensitivity is not enough
+        ShadingRate maxRateFloor = ShadingRate_2x2;
+        uint32_t floorDelay = 16;           // updates over budget at the max sensitivity before the floor is raised,
+                                            // and updates after a floor change before the time is trusted again
+    };
+
+    // Closed-loop controller that holds the GPU time of a pass near a target by adjusting the
+    // NAS error sensitivity from the measured times, one update per measured frame.
+    //
+    // The sensitivity changes multiplicatively, the time of a pass is closer to linear in its
+    // log than in the value. The tolerance band gives the loop hysteresis: it settles once the
+    // time is within half the band and only wakes up when the time leaves the whole band, so
+    // timer noise does not make the rates flicker. When the max sensitivity still misses the
+    // target, the rate floor goes one step coarser at a time. The time a floor saved is
+    // remembered, and the floor is only lowered again once the time predicted without it is
+    // within the band, which keeps the loop from toggling it every few frames.
+    class BudgetController
+    {
+    public:
+        void SetSettings(const BudgetControllerSettings& settings) { m_Settings = settings; }
+        [[nodiscard]] const BudgetControllerSettings& GetSettings() const { return m_Settings; }
+
+        // Forgets the measured times and the floor, e.g. when the controller is switched on
+        void Reset(float errorSensitivity);
+
+        // passTimeMs is the measured time of the pass rendered with the last sensitivity and
+        // floor, times that are not positive are ignored
+        void Update(float passTimeMs);
+
+        [[nodiscard]] float GetErrorSensitivity() const { return m_ErrorSensitivity; }
+        [[nodiscard]] ShadingRate GetRateFloor() const { return c_RateFloors[m_FloorLevel]; }
+        [[nodiscard]] float GetFilteredTimeMs() const { return m_FilteredMs; }
+        [[nodiscard]] bool IsSettled() const { return m_Settled; }
+
+    private:
+        static constexpr uint32_t c_FloorLevels = uint32_t(sizeof(c_RateFloors) / sizeof(c_RateFloors[0]));
+
+        void ChangeFloor(uint32_t level);
+
+        BudgetControllerSettings m_Settings;
+        float m_ErrorSensitivity = 0.07f;
+        float m_FilteredMs = 0.f;
+        bool m_Settled = false;
+        uint32_t m_FloorLevel = 0;
+        uint32_t m_SaturatedUpdates = 0;    // consecutive updates that wanted a floor change
+        uint32_t m_Cooldown = 0;            // updates left until the last floor change shows in the time
+        float m_TimeBeforeFloorMs = 0.f;    // filtered time when the floor was raised
+        float m_FloorSavings[c_FloorLevels] = {};  // time without / with each floor level, measured when it was raised
+    };
+}
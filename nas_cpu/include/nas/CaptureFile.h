@@ -0,0 +1,172 @@
+//----------------------------------------------------------------------------------
+// File:        CaptureFile.h
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#pragma once
+
+// Append-only container for the per-frame inputs of the NAS passes.
+//
+// Layout (little endian, all payloads 64-byte aligned):
+//   CaptureFileHeader
+//   per frame: CaptureFrameRecord, color rows (RGBA8), depth rows (float)
+//   index: uint64_t offset of every CaptureFrameRecord, written on Close()
+//
+// Frames are self-contained: the colors are the previous frame's LdrColor and the depth,
+// reprojection and view parameters belong to the current frame, exactly what
+// ComputeNASData and ComputeShadingRate consume. Readers map the file and hand out
+// views into the mapping, so frames can be fed to the NAS kernels without copies.
+// A capture that was not closed has no index; the reader then walks the records.
+
+#include <nas/NasPipeline.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+namespace nas
+{
+    constexpr uint32_t c_CaptureFileMagic = 0x4353414e;  // "NASC"
+    constexpr uint32_t c_CaptureFrameMagic = 0x4653414e; // "NASF"
+    constexpr uint32_t c_CaptureFileVersion = 1;
+    constexpr uint32_t c_CaptureAlignment = 64;
+
+    struct CaptureFileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t frameCount;        // valid once indexOffset is set
+        uint32_t reserved0;
+        uint64_t indexOffset;       // 0 while the capture is still being written
+        uint64_t reserved1[5];
+    };
+
+    struct CaptureFrameRecord
+    {
+        uint32_t magic;
+        uint32_t frameIndex;
+        uint32_t width;
+        uint32_t height;
+        uint64_t colorOffset;       // absolute file offsets
+        uint64_t depthOffset;
+        uint64_t recordSize;        // from the start of this record to the next one
+        uint32_t colorRowPitch;     // in bytes
+        uint32_t depthRowPitch;
+        uint32_t colorEncoding;     // ColorEncoding
+
+        // AdaptiveShadingConstants and ComputeNASDataConstants of the frame
+        float reprojectionMatrix[16];
+        uint32_t previousViewOrigin[2];
+        uint32_t previousViewSize[2];
+        float errorSensitivity;
+        float motionSensitivity;
+        float brightnessSensitivity;
+
+        uint32_t reserved[11];
+    };
+
+    static_assert(sizeof(CaptureFileHeader) == 64, "CaptureFileHeader must stay 64 bytes");
+    static_assert(sizeof(CaptureFrameRecord) % c_CaptureAlignment == 0, "CaptureFrameRecord must keep payloads aligned");
+
+    // Fills the shader constants from a captured frame, sourceTextureSizeInv is derived from the frame size
+    void GetCaptureFrameConstants(
+        const CaptureFrameRecord& record,
+        ComputeNASDataConstants& dataConstants,
+        AdaptiveShadingConstants& rateConstants);
+
+    // Fills the capture fields of a record from the shader constants
+    void SetCaptureFrameConstants(
+        CaptureFrameRecord& record,
+        const ComputeNASDataConstants& dataConstants,
+        const AdaptiveShadingConstants& rateConstants);
+
+    class CaptureWriter
+    {
+    public:
+        CaptureWriter() = default;
+        ~CaptureWriter();
+
+        CaptureWriter(const CaptureWriter&) = delete;
+        CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+        bool Open(const std::filesystem::path& fileName);
+
+        // Appends a frame; the size, pitch and offset fields of the record are filled in here.
+        // The views may have any row pitch, e.g. mapped staging textures.
+        bool AppendFrame(CaptureFrameRecord record, const ColorView& colors, const DepthView& depth);
+
+        // Writes the index and closes the file
+        bool Close();
+
+        [[nodiscard]] bool IsOpen() const { return m_File != nullptr; }
+        [[nodiscard]] uint32_t GetFrameCount() const { return uint32_t(m_FrameOffsets.size()); }
+
+    private:
+        bool WriteAligned(const void* data, size_t size);
+        bool WriteRows(const void* data, size_t rowSize, size_t rowPitch, uint32_t rows, uint32_t alignedRowSize);
+
+        FILE* m_File = nullptr;
+        uint64_t m_Offset = 0;
+        std::vector<uint64_t> m_FrameOffsets;
+    };
+
+    // A frame of a mapped capture, all pointers point into the mapping
+    struct CaptureFrame
+    {
+        const CaptureFrameRecord* record = nullptr;
+        ColorView colors;
+        DepthView depth;
+    };
+
+    class CaptureReader
+    {
+    public:
+        CaptureReader() = default;
+        ~CaptureReader();
+
+        CaptureReader(const CaptureReader&) = delete;
+        CaptureReader& operator=(const CaptureReader&) = delete;
+
+        bool Open(const std::filesystem::path& fileName);
+        void Close();
+
+        [[nodiscard]] uint32_t GetFrameCount() const { return uint32_t(m_Frames.size()); }
+        [[nodiscard]] const CaptureFrame& GetFrame(uint32_t index) const { return m_Frames[index]; }
+
+    private:
+        bool ValidateRecord(uint64_t offset, CaptureFrame& frame) const;
+
+        const uint8_t* m_Data = nullptr;
+        uint64_t m_Size = 0;
+        void* m_FileHandle = nullptr;
+        void* m_MappingHandle = nullptr;
+        std::vector<CaptureFrame> m_Frames;
+    };
+}
@@ -0,0 +1,186 @@
+//----------------------------------------------------------------------------------
+// File:        ErrorScalers.h
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#pragma once
+
+// Motion-dependent error scalers of the rate selection (equations from the I3D 2019 paper):
+// the half rate scaler bhv and the quarter rate scaler bqv. Instead of evaluating two pow
+// chains per tile, the shaders and the CPU pipeline interpolate a table sampled at
+// compile time, see ErrorScalerTable.h.
+//
+// The table is indexed by p = 1 - 1 / sqrt(1 + m) of the scaled motion m, which maps the
+// whole motion range to [0, 1]: the last entry is the limit of both scalers, zero. The scalers
+// fall off like a power of 1 / (1 + m) slightly above 1, which a table linear in that
+// quantity only follows with large relative errors in the tail; in p they fall off like a
+// power slightly above 2, so the entries are spread more densely toward large motion.
+
+#include "ErrorScalerTable.h"
+
+#include <cmath>
+#include <cstdint>
+
+namespace nas
+{
+    constexpr uint32_t c_ErrorScalerEntries = 129;
+
+    namespace detail
+    {
+        // Double precision exp and log for constant evaluation, the <cmath> ones are not constexpr
+        constexpr double c_Ln2 = 0.693147180559945309417;
+
+        constexpr double ConstexprLog(double x)
+        {
+            // x = mantissa * 2^exponent with the mantissa in [1, 2)
+            int exponent = 0;
+            while (x >= 2.0) { x *= 0.5; exponent++; }
+            while (x < 1.0) { x *= 2.0; exponent--; }
+
+            // ln(x) = 2 atanh((x - 1) / (x + 1)), the argument is below 1/3
+            const double y = (x - 1.0) / (x + 1.0);
+            const double y2 = y * y;
+            double term = y;
+            double sum = 0.0;
+            for (int n = 1; n < 64; n += 2)
+            {
+                sum += term / double(n);
+                term *= y2;
+            }
+            return 2.0 * sum + double(exponent) * c_Ln2;
+        }
+
+        constexpr double ConstexprExp(double x)
+        {
+            if (x < -700.0)
+                return 0.0;
+
+            // exp(x) = 2^n exp(r) with r in [0, ln 2)
+            int n = int(x / c_Ln2);
+            if (double(n) * c_Ln2 > x)
+                n--;
+            const double r = x - double(n) * c_Ln2;
+
+            double term = 1.0;
+            double sum = 1.0;
+            for (int k = 1; k < 32; k++)
+            {
+                term *= r / double(k);
+                sum += term;
+            }
+
+            for (; n > 0; n--) sum *= 2.0;
+            for (; n < 0; n++) sum *= 0.5;
+            return sum;
+        }
+
+        constexpr double ConstexprPow(double base, double exponent)
+        {
+            return base > 0.0 ? ConstexprExp(exponent * ConstexprLog(base)) : 0.0;
+        }
+    }
+
+    // The scalers as functions of the scaled tile motion |mVec| * motionSensitivity
+    constexpr double HalfRateErrorScaler(double motion)
+    {
+        return detail::ConstexprPow(1.0 / (1.0 + detail::ConstexprPow(1.05 * motion, 3.1)), 0.35);
+    }
+
+    constexpr double QuarterRateErrorScaler(double motion)
+    {
+        return 2.13 * detail::ConstexprPow(1.0 / (1.0 + detail::ConstexprPow(0.55 * motion, 2.41)), 0.49);
+    }
+
+    // Scaled motion of a table position in [0, 1), the inverse of the indexing
+    constexpr double GetErrorScalerMotion(double position)
+    {
+        return 1.0 / ((1.0 - position) * (1.0 - position)) - 1.0;
+    }
+
+    struct ErrorScalerTable
+    {
+        float halfRate[c_ErrorScalerEntries] = {};
+        float quarterRate[c_ErrorScalerEntries] = {};
+    };
+
+    constexpr ErrorScalerTable MakeErrorScalerTable()
+    {
+        ErrorScalerTable table;
+        for (uint32_t i = 0; i + 1 < c_ErrorScalerEntries; i++)
+        {
+            const double motion = GetErrorScalerMotion(double(i) / double(c_ErrorScalerEntries - 1));
+            table.halfRate[i] = float(HalfRateErrorScaler(motion));
+            table.quarterRate[i] = float(QuarterRateErrorScaler(motion));
+        }
+        return table;
+    }
+
+    constexpr ErrorScalerTable c_ErrorScalerTable = MakeErrorScalerTable();
+
+    // The table the shaders use, NAS_HALF_RATE_SCALERS and NAS_QUARTER_RATE_SCALERS
+    constexpr float c_ShaderHalfRateScalers[NAS_ERROR_SCALER_ENTRIES] = NAS_HALF_RATE_SCALERS;
+    constexpr float c_ShaderQuarterRateScalers[NAS_ERROR_SCALER_ENTRIES] = NAS_QUARTER_RATE_SCALERS;
+
+    // Whether ErrorScalerTable.h holds c_ErrorScalerTable, checked where the shaders are used.
+    // The constant evaluation may round differently from the generator's by an ulp.
+    constexpr bool ShaderErrorScalersMatch()
+    {
+        if (NAS_ERROR_SCALER_ENTRIES != c_ErrorScalerEntries)
+            return false;
+
+        for (uint32_t i = 0; i < c_ErrorScalerEntries; i++)
+        {
+            const float halfRateError = c_ErrorScalerTable.halfRate[i] - c_ShaderHalfRateScalers[i];
+            const float quarterRateError = c_ErrorScalerTable.quarterRate[i] - c_ShaderQuarterRateScalers[i];
+            if (halfRateError * halfRateError > 1e-12f || quarterRateError * quarterRateError > 1e-12f)
+                return false;
+        }
+        return true;
+    }
+
+    // Linear interpolation of the table, the same operations as GetErrorScalers in ErrorScalers.hlsli
+    inline float LookupErrorScaler(const float (&table)[c_ErrorScalerEntries], float motion)
+    {
+        const float position = (1.f - 1.f / sqrtf(1.f + motion)) * float(c_ErrorScalerEntries - 1);
+        const uint32_t index = position < float(c_ErrorScalerEntries - 2) ? uint32_t(position) : c_ErrorScalerEntries - 2;
+        const float weight = position - float(index);
+        return table[index] + (table[index + 1] - table[index]) * weight;
+    }
+
+    inline float GetHalfRateErrorScaler(float motion)
+    {
+        return LookupErrorScaler(c_ErrorScalerTable.halfRate, motion);
+    }
+
+    inline float GetQuarterRateErrorScaler(float motion)
+    {
+        return LookupErrorScaler(c_ErrorScalerTable.quarterRate, motion);
+    }
+}
@@ -0,0 +1,139 @@
+//----------------------------------------------------------------------------------
+// File:        Image.h
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace nas
+{
+    // Non-owning view of a 2D image with an arbitrary row pitch, so that the
+    // NAS kernels can work directly on mapped readback buffers or capture files.
+    template<typename T>
+    struct ImageView
+    {
+        using Byte = std::conditional_t<std::is_const_v<T>, const uint8_t, uint8_t>;
+
+        T* data = nullptr;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        size_t rowPitch = 0; // in bytes
+
+        ImageView() = default;
+
+        ImageView(T* _data, uint32_t _width, uint32_t _height, size_t _rowPitch = 0)
+            : data(_data)
+            , width(_width)
+            , height(_height)
+            , rowPitch(_rowPitch ? _rowPitch : _width * sizeof(T))
+        { }
+
+        // Allow implicit conversion from a mutable view to a const view
+        template<typename U, typename = std::enable_if_t<std::is_same_v<const U, T>>>
+        ImageView(const ImageView<U>& other)
+            : data(other.data)
+            , width(other.width)
+            , height(other.height)
+            , rowPitch(other.rowPitch)
+        { }
+
+        [[nodiscard]] bool IsValid() const { return data != nullptr && width > 0 && height > 0; }
+
+        [[nodiscard]] T* Row(uint32_t y) const
+        {
+            return reinterpret_cast<T*>(reinterpret_cast<Byte*>(data) + size_t(y) * rowPitch);
+        }
+
+        [[nodiscard]] T& At(uint32_t x, uint32_t y) const { return Row(y)[x]; }
+    };
+
+    // Tightly packed, owning image
+    template<typename T>
+    class Image
+    {
+    private:
+        std::vector<T> m_Data;
+        uint32_t m_Width = 0;
+        uint32_t m_Height = 0;
+
+    public:
+        Image() = default;
+
+        Image(uint32_t width, uint32_t height, const T& value = T())
+        {
+            Resize(width, height, value);
+        }
+
+        void Resize(uint32_t width, uint32_t height, const T& value = T())
+        {
+            m_Width = width;
+            m_Height = height;
+            m_Data.assign(size_t(width) * height, value);
+        }
+
+        [[nodiscard]] uint32_t GetWidth() const { return m_Width; }
+        [[nodiscard]] uint32_t GetHeight() const { return m_Height; }
+        [[nodiscard]] T* GetData() { return m_Data.data(); }
+        [[nodiscard]] const T* GetData() const { return m_Data.data(); }
+        [[nodiscard]] T& At(uint32_t x, uint32_t y) { return m_Data[size_t(y) * m_Width + x]; }
+        [[nodiscard]] const T& At(uint32_t x, uint32_t y) const { return m_Data[size_t(y) * m_Width + x]; }
+
+        [[nodiscard]] ImageView<T> View() { return ImageView<T>(m_Data.data(), m_Width, m_Height); }
+        [[nodiscard]] ImageView<const T> View() const { return ImageView<const T>(m_Data.data(), m_Width, m_Height); }
+    };
+
+    // 8-bit RGBA pixel, same memory layout as RGBA8_UNORM / SRGBA8_UNORM
+    struct Rgba8
+    {
+        uint8_t r;
+        uint8_t g;
+        uint8_t b;
+        uint8_t a;
+    };
+
+    // One texel of the NAS data surface: two IEEE half floats, same layout as RG16_FLOAT
+    struct NasTileData
+    {
+        uint16_t errorX;
+        uint16_t errorY;
+    };
+
+    typedef ImageView<const Rgba8> ColorView;
+    typedef ImageView<const float> DepthView;
+    typedef ImageView<NasTileData> NasDataView;
+    typedef ImageView<const NasTileData> ConstNasDataView;
+    typedef ImageView<uint8_t> RateView;
+    typedef ImageView<const uint8_t> ConstRateView;
+}
@@ -0,0 +1,86 @@
+//----------------------------------------------------------------------------------
+// File:        IncrementalPipeline.h
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#pragma once
+
+#include <nas/NasPipeline.h>
+
+namespace nas
+{
+    // What the shading rate of a tile was computed from: the reprojected tile center,
+    // which covers the min depth and the camera motion, and the NAS data sampled there,
+    // which covers the luma gradients it reads. The rate follows from these two alone.
+    struct TileSignature
+    {
+        float prevWindowPosX;
+        float prevWindowPosY;
+        float sampledErrorX;
+        float sampledErrorY;
+    };
+
+    // RunPipeline that keeps the shading rate of tiles whose signature did not change since
+    // the frame their rate was last computed, like the DetectNASChanges.hlsl and incremental
+    // ComputeShadingRate.hlsl passes. NAS data and smoothing still run over the whole surface.
+    //
+    // With both tolerances at 0 only identical signatures are clean, so the rates match
+    // RunPipeline exactly. Larger tolerances trade accuracy for fewer dirty tiles. Frames must
+    // be passed in order for the signatures to mean anything.
+    class IncrementalPipeline
+    {
+    public:
+        // Largest reprojected tile center movement in pixels, per axis, that keeps a tile clean
+        void SetMotionTolerance(float pixels) { m_MotionTolerance = pixels; }
+
+        // Largest change of the sampled NAS data, per axis and as a fraction of the error
+        // sensitivity, that keeps a tile clean
+        void SetErrorTolerance(float fraction) { m_ErrorTolerance = fraction; }
+
+        // Marks every tile dirty in the next Run, e.g. after a cut in the sequence
+        void Invalidate() { m_Valid = false; }
+
+        // Tiles whose rate was recomputed by the last Run
+        [[nodiscard]] uint32_t GetDirtyTileCount() const { return m_DirtyTileCount; }
+
+        void Run(const PipelineInputs& inputs, PipelineOutputs& outputs);
+
+    private:
+        Image<TileSignature> m_Signatures;
+        Image<uint8_t> m_UnsmoothedRates;
+        float m_ErrorSensitivity = 0.f;
+        float m_MotionSensitivity = 0.f;
+        float m_MotionTolerance = 0.f;
+        float m_ErrorTolerance = 0.f;
+        uint32_t m_TileSize = 0;
+        uint32_t m_DirtyTileCount = 0;
+        bool m_Valid = false;
+    };
+}
@@ -0,0 +1,182 @@
+//----------------------------------------------------------------------------------
+// File:        NasPipeline.h
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#pragma once
+
+#include <nas/Image.h>
+#include <nas/InstructionSet.h>
+
+// Constant buffer layouts shared with the shaders, see adaptive_shading/Compute_cb.h.
+// Include Compute_cb.h (after donut/core/math/math.h) to fill them in.
+struct ComputeNASDataConstants;
+struct AdaptiveShadingConstants;
+
+namespace nas
+{
+    // VRS tile sizes in pixels the pipeline is specialized for, matching the TILE_SIZE
+    // permutations of the shaders. The tile size is a property of the device.
+    constexpr uint32_t c_TileSizes[] = { 8, 16, 32 };
+    constexpr uint32_t c_DefaultTileSize = 16;
+
+    // Largest smoothing radius in tiles, matching the SMOOTH_RADIUS permutations of SmoothShadingRate.hlsl
+    constexpr uint32_t c_MaxSmoothingRadius = 3;
+
+    // Shading rate encoding used by the rate surface (D3D12_SHADING_RATE values)
+    enum ShadingRate : uint8_t
+    {
+        ShadingRate_1x1 = 0x0,
+        ShadingRate_1x2 = 0x1,
+        ShadingRate_2x1 = 0x4,
+        ShadingRate_2x2 = 0x5,
+        ShadingRate_2x4 = 0x6,
+        ShadingRate_4x2 = 0x9,
+        ShadingRate_4x4 = 0xa
+    };
+
+    // Pixel color encoding of the RGBA8 color input.
+    // The sample binds LdrColor as SRGBA8_UNORM, so the shaders see linear values.
+    enum class ColorEncoding
+    {
+        Srgb,
+        Linear
+    };
+
+    // Per-tile error of the NAS data, the ERROR_METRIC permutations of ComputeNASData.hlsl
+    enum class ErrorMetric
+    {
+        Max,        // largest derivative of the tile
+        L2,         // root mean square of the derivatives, the original metric of the paper
+        Percentile  // block maximum exceeded by 1/8 of the blocks, ignores isolated outliers
+    };
+
+    // "max", "l2" and "percentile"
+    const char* GetErrorMetricName(ErrorMetric metric);
+    bool ParseErrorMetricName(const char* name, ErrorMetric& metric);
+
+    [[nodiscard]] constexpr bool IsSupportedTileSize(uint32_t tileSize)
+    {
+        return tileSize == 8 || tileSize == 16 || tileSize == 32;
+    }
+
+    [[nodiscard]] inline uint32_t GetTileCount(uint32_t pixels, uint32_t tileSize = c_DefaultTileSize)
+    {
+        return (pixels + tileSize - 1) / tileSize;
+    }
+
+    float HalfToFloat(uint16_t value);
+    uint16_t FloatToHalf(float value);
+
+    // CPU equivalent of ComputeNASData.hlsl: per-tile luminance error of the previous frame.
+    // The output must be GetTileCount(width, tileSize) x GetTileCount(height, tileSize) of the color input.
+    // All functions taking a tileSize require IsSupportedTileSize(tileSize).
+    void ComputeNASData(
+        const ColorView& prevFrameColors,
+        ColorEncoding encoding,
+        const ComputeNASDataConstants& constants,
+        const NasDataView& nasData,
+        uint32_t tileSize = c_DefaultTileSize,
+        ErrorMetric metric = ErrorMetric::Max);
+
+    // Same result as ComputeNASData, bit for bit, but converts whole rows to luminance and
+    // evaluates the gradients with SIMD instructions. Unsupported instruction sets fall back
+    // to the best supported one. The SIMD kernels implement the max metric, the other
+    // metrics run ComputeNASData.
+    void ComputeNASDataVectorized(
+        const ColorView& prevFrameColors,
+        ColorEncoding encoding,
+        const ComputeNASDataConstants& constants,
+        const NasDataView& nasData,
+        InstructionSet instructionSet = GetSupportedInstructionSet(),
+        uint32_t tileSize = c_DefaultTileSize,
+        ErrorMetric metric = ErrorMetric::Max);
+
+    // CPU equivalent of ComputeShadingRate.hlsl: motion-adjusted shading rate per tile.
+    void ComputeShadingRate(
+        const DepthView& depth,
+        const ConstNasDataView& nasData,
+        const AdaptiveShadingConstants& constants,
+        const RateView& rates,
+        uint32_t tileSize = c_DefaultTileSize);
+
+    // CPU equivalent of SmoothShadingRate.hlsl: a tile with a 4x rate is lowered to 2x when one of
+    // the tiles up to radius (1 to c_MaxSmoothingRadius) tiles away in the same row or column has
+    // a 1x rate. Like the shader, it reads the input and writes a separate output, so the result
+    // only depends on the input.
+    void SmoothShadingRate(
+        const ConstRateView& input,
+        const RateView& output,
+        uint32_t radius = 1);
+
+    // Same result as SmoothShadingRate in two passes, like SMOOTH_PASS 1 and 2 of the shader:
+    // the row pass stores the rates and the neighbor flags of their rows in temp, the column
+    // pass adds the flags of the columns. All three surfaces must have the same size.
+    void SmoothShadingRateSeparable(
+        const ConstRateView& input,
+        const RateView& temp,
+        const RateView& output,
+        uint32_t radius = 1);
+
+    struct PipelineInputs
+    {
+        ColorView prevFrameColors;
+        ColorEncoding colorEncoding = ColorEncoding::Srgb;
+        DepthView depth;
+        const ComputeNASDataConstants* dataConstants = nullptr;
+        const AdaptiveShadingConstants* rateConstants = nullptr;
+        bool enableSmoothing = true;
+        uint32_t smoothingRadius = 1;
+        InstructionSet instructionSet = GetSupportedInstructionSet();
+        uint32_t tileSize = c_DefaultTileSize;
+        ErrorMetric errorMetric = ErrorMetric::Max;
+    };
+
+    struct PipelineOutputs
+    {
+        Image<NasTileData> nasData;
+        Image<uint8_t> rates;
+        uint32_t clampedTiles = 0;  // RunFusedPipeline: rate tiles that sampled NAS data outside of the group cache
+    };
+
+    // Runs the whole NAS pipeline the same way FeatureDemo does on the GPU:
+    // NAS data, shading rate, and optionally smoothing. Outputs are (re)allocated as needed.
+    void RunPipeline(const PipelineInputs& inputs, PipelineOutputs& outputs);
+
+    // CPU equivalent of FusedNAS.hlsl: the whole pipeline in one pass per group of tiles.
+    // Each group recomputes the NAS data it samples instead of reading a shared surface,
+    // so only outputs.rates is written. Like the shader, a group only caches the NAS data under
+    // motion below one tile and clamps samples moved further to the edge of its cache; those are
+    // counted in outputs.clampedTiles. The rates must match RunPipeline exactly when it is 0.
+    void RunFusedPipeline(const PipelineInputs& inputs, PipelineOutputs& outputs);
+
+    // Number of tiles that differ between two rate surfaces of the same size
+    uint32_t CountRateDifferences(const ConstRateView& a, const ConstRateView& b);
+}
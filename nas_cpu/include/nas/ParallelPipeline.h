@@ -0,0 +1,79 @@
+//----------------------------------------------------------------------------------
+// File:        ParallelPipeline.h
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#pragma once
+
+#include <nas/NasPipeline.h>
+#include <nas/TaskScheduler.h>
+
+namespace nas
+{
+    // Time spent in each stage of the last ParallelPipeline::Run, in milliseconds.
+    // Stage times are summed over all threads; totalMs is wall-clock time, so
+    // (nasDataMs + shadingRateMs + smoothingMs) / (totalMs * threads) is the parallel efficiency.
+    struct PipelineTimings
+    {
+        double nasDataMs = 0.0;
+        double shadingRateMs = 0.0;
+        double smoothingMs = 0.0;
+        double totalMs = 0.0;
+    };
+
+    // Multithreaded RunPipeline. The tile grid is split into bands of whole tile rows,
+    // which play the role of the GPU thread groups, and the bands are processed by a
+    // work-stealing TaskScheduler. The results are identical to RunPipeline.
+    //
+    // NAS data is complete before any shading rate is computed, since the reprojected
+    // sample of a tile can land anywhere in the previous frame. Smoothing a band needs the
+    // unsmoothed rates of the band and the bands within the smoothing radius, so it starts as
+    // soon as the last of those bands is done, without a second barrier.
+    class ParallelPipeline
+    {
+    public:
+        // threadCount includes the calling thread, 0 uses all hardware threads
+        explicit ParallelPipeline(uint32_t threadCount = 0);
+
+        // Band height in tile rows, 0 picks a size that gives every thread several bands
+        void SetTileRowsPerBand(uint32_t rows) { m_TileRowsPerBand = rows; }
+
+        [[nodiscard]] uint32_t GetThreadCount() const { return m_Scheduler.GetThreadCount(); }
+        [[nodiscard]] const PipelineTimings& GetTimings() const { return m_Timings; }
+
+        void Run(const PipelineInputs& inputs, PipelineOutputs& outputs);
+
+    private:
+        TaskScheduler m_Scheduler;
+        Image<uint8_t> m_UnsmoothedRates;
+        PipelineTimings m_Timings;
+        uint32_t m_TileRowsPerBand = 0;
+    };
+}
@@ -0,0 +1,76 @@
+//----------------------------------------------------------------------------------
+// File:        RateStatistics.h
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#pragma once
+
+#include <nas/NasPipeline.h>
+
+namespace nas
+{
+    // All rates the NAS shaders can produce
+    constexpr ShadingRate c_ShadingRates[] = {
+        ShadingRate_1x1, ShadingRate_1x2, ShadingRate_2x1, ShadingRate_2x2,
+        ShadingRate_2x4, ShadingRate_4x2, ShadingRate_4x4
+    };
+
+    // Coarse pixel size of a rate code: the low two bits encode log2 of the height,
+    // the next two bits log2 of the width
+    inline uint32_t GetShadingRateWidth(uint8_t rate) { return 1u << ((rate >> 2) & 3); }
+    inline uint32_t GetShadingRateHeight(uint8_t rate) { return 1u << (rate & 3); }
+
+    // "1x1", "2x4" etc.
+    const char* GetShadingRateName(uint8_t rate);
+
+    struct RateStatistics
+    {
+        // Number of tiles per rate, indexed by rate code
+        uint32_t tileCounts[16] = {};
+
+        // Pixels covered by the rate surface, and the part of them at rates other than 1x1
+        uint64_t pixels = 0;
+        uint64_t coarsePixels = 0;
+
+        // Estimated pixel shader invocations at the given rates, assuming every pixel is covered
+        // once and ignoring helper lanes
+        uint64_t invocations = 0;
+
+        [[nodiscard]] uint64_t GetInvocationsSaved() const { return pixels - invocations; }
+        [[nodiscard]] double GetSavedFraction() const { return pixels ? double(GetInvocationsSaved()) / double(pixels) : 0.0; }
+        [[nodiscard]] double GetCoarseFraction() const { return pixels ? double(coarsePixels) / double(pixels) : 0.0; }
+
+        void Accumulate(const RateStatistics& other);
+    };
+
+    // Statistics of a rate surface for a width x height pixel render target.
+    // Partial tiles at the right and bottom edges only count their pixels inside the target.
+    RateStatistics ComputeRateStatistics(const ConstRateView& rates, uint32_t width, uint32_t height, uint32_t tileSize = c_DefaultTileSize);
+}
@@ -0,0 +1,90 @@
+//----------------------------------------------------------------------------------
+// File:        TaskScheduler.h
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nas
+{
+    // Small fork-join scheduler with work stealing, used to process tile bands in parallel.
+    //
+    // ParallelFor splits the index range evenly over the threads. Every thread takes
+    // indices from the front of its own range and, once that is empty, steals from the
+    // back of the other ranges, so uneven band costs do not leave threads idle.
+    // The calling thread participates as worker 0. Calls must not be nested.
+    class TaskScheduler
+    {
+    public:
+        // threadCount includes the calling thread, 0 uses all hardware threads
+        explicit TaskScheduler(uint32_t threadCount = 0);
+        ~TaskScheduler();
+
+        TaskScheduler(const TaskScheduler&) = delete;
+        TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+        [[nodiscard]] uint32_t GetThreadCount() const { return uint32_t(m_Queues.size()); }
+
+        // Calls func(index) for every index in [0, count) and returns when all calls have finished
+        void ParallelFor(uint32_t count, const std::function<void(uint32_t index)>& func);
+
+    private:
+        struct WorkQueue
+        {
+            std::mutex mutex;
+            uint32_t begin = 0;
+            uint32_t end = 0;
+        };
+
+        bool PopLocal(uint32_t worker, uint32_t& index);
+        bool Steal(uint32_t worker, uint32_t& index);
+        void RunWorker(uint32_t worker);
+        void WorkerMain(uint32_t worker);
+
+        std::vector<std::unique_ptr<WorkQueue>> m_Queues;
+        std::vector<std::thread> m_Threads;
+
+        std::mutex m_Mutex;
+        std::condition_variable m_WakeCondition;
+        std::condition_variable m_DoneCondition;
+        const std::function<void(uint32_t)>* m_Func = nullptr;
+        uint64_t m_Generation = 0;
+        uint32_t m_ActiveWorkers = 0;
+        bool m_Stop = false;
+    };
+}
@@ -0,0 +1,106 @@
+//----------------------------------------------------------------------------------
+// File:        WaveEmulation.h
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#pragma once
+
+#include <nas/NasPipeline.h>
+
+namespace nas
+{
+    // Group reductions of ComputeNASData.hlsl, one per WAVE_SIZE permutation
+    enum class ReductionVariant
+    {
+        Groupshared,    // WAVE_SIZE=0, any wave size
+        Wave32,         // WAVE_SIZE=32
+        Wave64          // WAVE_SIZE=64
+    };
+
+    constexpr ReductionVariant c_ReductionVariants[] = {
+        ReductionVariant::Groupshared, ReductionVariant::Wave32, ReductionVariant::Wave64
+    };
+
+    const char* GetReductionVariantName(ReductionVariant variant);
+
+    // Lane count a variant is compiled for, 0 for the groupshared variant
+    uint32_t GetReductionWaveSize(ReductionVariant variant);
+
+    // Picks the variant for a device that runs waves of minLanes to maxLanes lanes. The wave
+    // variants need a fixed lane count, everything else falls back to groupshared memory.
+    ReductionVariant SelectReductionVariant(uint32_t minLanes, uint32_t maxLanes);
+
+    // CPU model of the wave intrinsics used by the NAS shaders. The threads of a group are
+    // assigned to waves in SV_GroupIndex order; lanes past the end of the group are inactive.
+    // HLSL does not define the order of WaveActiveSum, it is modeled as a pairwise reduction:
+    // neighbors first, then doubling the stride. That is the order of the groupshared variant, so
+    // float sums match it exactly here, while hardware may round differently in the last bits.
+    class WaveEmulator
+    {
+    public:
+        // D3D12 allows 4 to 128 lanes
+        static constexpr uint32_t c_MaxLanes = 128;
+
+        explicit WaveEmulator(uint32_t laneCount);
+
+        [[nodiscard]] uint32_t GetLaneCount() const { return m_LaneCount; }
+
+        // Waves needed for a group of groupThreads threads
+        [[nodiscard]] uint32_t GetWaveCount(uint32_t groupThreads) const { return (groupThreads + m_LaneCount - 1) / m_LaneCount; }
+
+        // WaveActiveSum and WaveActiveMax over the first activeLanes lanes of a wave
+        [[nodiscard]] float ActiveSum(const float* laneValues, uint32_t activeLanes) const;
+        [[nodiscard]] float ActiveMax(const float* laneValues, uint32_t activeLanes) const;
+
+    private:
+        uint32_t m_LaneCount;
+    };
+
+    // ComputeNASData.hlsl compiled for the given reduction variant, with the wave and groupshared
+    // reductions emulated thread by thread. Slower than ComputeNASData, meant for verification.
+    void ComputeNASDataEmulated(
+        const ColorView& prevFrameColors,
+        ColorEncoding encoding,
+        const ComputeNASDataConstants& constants,
+        const NasDataView& nasData,
+        ReductionVariant variant,
+        uint32_t tileSize = c_DefaultTileSize);
+
+    // Runs every reduction variant and counts the tiles whose NAS data differs from the groupshared
+    // variant, summed over the wave variants.
+    // Under the pairwise model of WaveActiveSum the variants are interchangeable, so anything but 0
+    // is a bug in the wave layout or the combining of the waves. On hardware only the max errors are
+    // guaranteed to match; the luma and L2 sums may differ by the rounding of another summation order.
+    uint32_t CountReductionVariantDifferences(
+        const ColorView& prevFrameColors,
+        ColorEncoding encoding,
+        const ComputeNASDataConstants& constants,
+        uint32_t tileSize = c_DefaultTileSize);
+}
@@ -0,0 +1,145 @@
+//----------------------------------------------------------------------------------
+// File:        BudgetController.cpp
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include <nas/BudgetController.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+namespace nas
+{
+    // Index of the coarsest floor the settings allow in c_RateFloors
+    static uint32_t GetMaxFloorLevel(const BudgetControllerSettings& settings)
+    {
+        if (!settings.enableRateFloor)
+            return 0;
+
+        for (uint32_t level = uint32_t(std::size(c_RateFloors)) - 1; level > 0; level--)
+        {
+            if (c_RateFloors[level] == settings.maxRateFloor)
+                return level;
+        }
+        return 0;
+    }
+
+    void BudgetController::Reset(float errorSensitivity)
+    {
+        m_ErrorSensitivity = std::min(std::max(errorSensitivity, m_Settings.minErrorSensitivity), m_Settings.maxErrorSensitivity);
+        m_FilteredMs = 0.f;
+        m_Settled = false;
+        m_FloorLevel = 0;
+        m_SaturatedUpdates = 0;
+        m_Cooldown = 0;
+        m_TimeBeforeFloorMs = 0.f;
+        std::fill(std::begin(m_FloorSavings), std::end(m_FloorSavings), 0.f);
+    }
+
+    void BudgetController::ChangeFloor(uint32_t level)
+    {
+        // Only a raised floor measures its savings, lowering it is judged by those
+        m_TimeBeforeFloorMs = (level > m_FloorLevel) ? m_FilteredMs : 0.f;
+        m_FloorLevel = level;
+        m_SaturatedUpdates = 0;
+        m_Cooldown = m_Settings.floorDelay;
+        m_Settled = false;
+    }
+
+    void BudgetController::Update(float passTimeMs)
+    {
+        if (!(passTimeMs > 0.f) || !(m_Settings.targetMs > 0.f))
+            return;
+
+        m_FilteredMs = (m_FilteredMs == 0.f) ? passTimeMs : m_FilteredMs + (passTimeMs - m_FilteredMs) * m_Settings.smoothing;
+
+        // The clamps and the max floor may have changed since the last update
+        m_ErrorSensitivity = std::min(std::max(m_ErrorSensitivity, m_Settings.minErrorSensitivity), m_Settings.maxErrorSensitivity);
+
+        const uint32_t maxFloorLevel = GetMaxFloorLevel(m_Settings);
+        if (m_FloorLevel > maxFloorLevel)
+        {
+            ChangeFloor(maxFloorLevel);
+            return;
+        }
+
+        // The filtered time still holds the frames before the floor change for a while, and the
+        // GPU times arrive a few frames late
+        if (m_Cooldown > 0)
+        {
+            if (--m_Cooldown == 0 && m_TimeBeforeFloorMs > 0.f)
+            {
+                m_FloorSavings[m_FloorLevel] = std::max(m_TimeBeforeFloorMs / m_FilteredMs, 1.f);
+                m_TimeBeforeFloorMs = 0.f;
+            }
+            return;
+        }
+
+        const float ratio = m_FilteredMs / m_Settings.targetMs;
+        const float deviation = std::abs(ratio - 1.f);
+        const float innerTolerance = m_Settings.tolerance * 0.5f;
+        if (deviation <= (m_Settled ? m_Settings.tolerance : innerTolerance))
+        {
+            m_Settled = true;
+            m_SaturatedUpdates = 0;
+            return;
+        }
+        m_Settled = false;
+
+        if (ratio > 1.f)
+        {
+            if (m_ErrorSensitivity < m_Settings.maxErrorSensitivity)
+            {
+                m_SaturatedUpdates = 0;
+            }
+            else
+            {
+                if (m_FloorLevel < maxFloorLevel && ++m_SaturatedUpdates >= m_Settings.floorDelay)
+                    ChangeFloor(m_FloorLevel + 1);
+                return;
+            }
+        }
+        else if (m_FloorLevel > 0 && m_FilteredMs * std::max(m_FloorSavings[m_FloorLevel], 1.f) <= m_Settings.targetMs * (1.f - innerTolerance))
+        {
+            // The time without this floor fits, lower it before the sensitivity
+            if (++m_SaturatedUpdates >= m_Settings.floorDelay)
+                ChangeFloor(m_FloorLevel - 1);
+            return;
+        }
+        else
+        {
+            m_SaturatedUpdates = 0;
+        }
+
+        const float step = std::min(std::max(m_Settings.gain * std::log(ratio), -m_Settings.maxStep), m_Settings.maxStep);
+        m_ErrorSensitivity = std::min(std::max(m_ErrorSensitivity * std::exp(step), m_Settings.minErrorSensitivity), m_Settings.maxErrorSensitivity);
+    }
+}
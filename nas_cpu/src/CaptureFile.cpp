@@ -0,0 +1,420 @@
+//----------------------------------------------------------------------------------
+// File:        CaptureFile.cpp
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include <nas/CaptureFile.h>
+
+#include <donut/core/log.h>
+#include <donut/core/math/math.h>
+
+using namespace donut;
+using namespace donut::math;
+
+#include "Compute_cb.h"  // requires donut::math
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace nas
+{
+    static_assert(sizeof(CaptureFrameRecord::reprojectionMatrix) == sizeof(float4x4), "reprojection matrix layout mismatch");
+
+    static uint64_t AlignCaptureOffset(uint64_t offset)
+    {
+        return (offset + c_CaptureAlignment - 1) & ~uint64_t(c_CaptureAlignment - 1);
+    }
+
+    // Whether [begin, begin + size) lies inside [rangeBegin, rangeEnd), written so that no sum can wrap
+    static bool IsRangeInside(uint64_t begin, uint64_t size, uint64_t rangeBegin, uint64_t rangeEnd)
+    {
+        return begin >= rangeBegin && begin <= rangeEnd && size <= rangeEnd - begin;
+    }
+
+    static bool SeekFile(FILE* file, uint64_t offset)
+    {
+#ifdef _WIN32
+        return _fseeki64(file, int64_t(offset), SEEK_SET) == 0;
+#else
+        return fseeko(file, off_t(offset), SEEK_SET) == 0;
+#endif
+    }
+
+    void GetCaptureFrameConstants(
+        const CaptureFrameRecord& record,
+        ComputeNASDataConstants& dataConstants,
+        AdaptiveShadingConstants& rateConstants)
+    {
+        dataConstants.brightnessSensitivity = record.brightnessSensitivity;
+
+        memcpy(&rateConstants.reprojectionMatrix, record.reprojectionMatrix, sizeof(record.reprojectionMatrix));
+        rateConstants.previousViewOrigin = uint2(record.previousViewOrigin[0], record.previousViewOrigin[1]);
+        rateConstants.previousViewSize = uint2(record.previousViewSize[0], record.previousViewSize[1]);
+        rateConstants.sourceTextureSizeInv = float2(1.f / float(record.width), 1.f / float(record.height));
+        rateConstants.errorSensitivity = record.errorSensitivity;
+        rateConstants.motionSensitivity = record.motionSensitivity;
+    }
+
+    void SetCaptureFrameConstants(
+        CaptureFrameRecord& record,
+        const ComputeNASDataConstants& dataConstants,
+        const AdaptiveShadingConstants& rateConstants)
+    {
+        record.brightnessSensitivity = dataConstants.brightnessSensitivity;
+
+        memcpy(record.reprojectionMatrix, &rateConstants.reprojectionMatrix, sizeof(record.reprojectionMatrix));
+        record.previousViewOrigin[0] = rateConstants.previousViewOrigin.x;
+        record.previousViewOrigin[1] = rateConstants.previousViewOrigin.y;
+        record.previousViewSize[0] = rateConstants.previousViewSize.x;
+        record.previousViewSize[1] = rateConstants.previousViewSize.y;
+        record.errorSensitivity = rateConstants.errorSensitivity;
+        record.motionSensitivity = rateConstants.motionSensitivity;
+    }
+
+    CaptureWriter::~CaptureWriter()
+    {
+        Close();
+    }
+
+    bool CaptureWriter::Open(const std::filesystem::path& fileName)
+    {
+        Close();
+
+#ifdef _WIN32
+        m_File = _wfopen(fileName.c_str(), L"wb");
+#else
+        m_File = fopen(fileName.c_str(), "wb");
+#endif
+        if (!m_File)
+        {
+            log::error("%s: cannot open the capture file for writing", fileName.generic_string().c_str());
+            return false;
+        }
+
+        CaptureFileHeader header = {};
+        header.magic = c_CaptureFileMagic;
+        header.version = c_CaptureFileVersion;
+
+        m_Offset = 0;
+        m_FrameOffsets.clear();
+
+        if (!WriteAligned(&header, sizeof(header)))
+        {
+            log::error("%s: cannot write the capture header", fileName.generic_string().c_str());
+            fclose(m_File);
+            m_File = nullptr;
+            return false;
+        }
+
+        return true;
+    }
+
+    // Writes a block and pads the file to the next aligned offset
+    bool CaptureWriter::WriteAligned(const void* data, size_t size)
+    {
+        static const uint8_t padding[c_CaptureAlignment] = {};
+
+        if (fwrite(data, 1, size, m_File) != size)
+            return false;
+        m_Offset += size;
+
+        size_t paddingSize = size_t(AlignCaptureOffset(m_Offset) - m_Offset);
+        if (paddingSize && fwrite(padding, 1, paddingSize, m_File) != paddingSize)
+            return false;
+        m_Offset += paddingSize;
+
+        return true;
+    }
+
+    // Writes image rows with the capture row pitch, which may differ from the source pitch
+    bool CaptureWriter::WriteRows(const void* data, size_t rowSize, size_t rowPitch, uint32_t rows, uint32_t alignedRowSize)
+    {
+        static const uint8_t padding[c_CaptureAlignment] = {};
+        const size_t paddingSize = alignedRowSize - rowSize;
+
+        if (rowPitch == alignedRowSize)
+        {
+            size_t size = size_t(alignedRowSize) * rows;
+            if (fwrite(data, 1, size, m_File) != size)
+                return false;
+        }
+        else
+        {
+            for (uint32_t y = 0; y < rows; y++)
+            {
+                const uint8_t* row = static_cast<const uint8_t*>(data) + y * rowPitch;
+                if (fwrite(row, 1, rowSize, m_File) != rowSize)
+                    return false;
+                if (paddingSize && fwrite(padding, 1, paddingSize, m_File) != paddingSize)
+                    return false;
+            }
+        }
+
+        m_Offset += uint64_t(alignedRowSize) * rows;
+        return true;
+    }
+
+    bool CaptureWriter::AppendFrame(CaptureFrameRecord record, const ColorView& colors, const DepthView& depth)
+    {
+        if (!m_File)
+            return false;
+
+        if (!colors.IsValid() || colors.width != depth.width || colors.height != depth.height)
+        {
+            log::error("Capture frame %u: color and depth images must be valid and have the same size", record.frameIndex);
+            return false;
+        }
+
+        const uint32_t colorRowPitch = uint32_t(AlignCaptureOffset(colors.width * sizeof(Rgba8)));
+        const uint32_t depthRowPitch = uint32_t(AlignCaptureOffset(depth.width * sizeof(float)));
+        const uint64_t recordOffset = m_Offset;
+
+        record.magic = c_CaptureFrameMagic;
+        record.width = colors.width;
+        record.height = colors.height;
+        record.colorRowPitch = colorRowPitch;
+        record.depthRowPitch = depthRowPitch;
+        record.colorOffset = recordOffset + sizeof(CaptureFrameRecord);
+        record.depthOffset = record.colorOffset + uint64_t(colorRowPitch) * colors.height;
+        record.recordSize = record.depthOffset + uint64_t(depthRowPitch) * depth.height - recordOffset;
+
+        bool success = WriteAligned(&record, sizeof(record))
+            && WriteRows(colors.data, colors.width * sizeof(Rgba8), colors.rowPitch, colors.height, colorRowPitch)
+            && WriteRows(depth.data, depth.width * sizeof(float), depth.rowPitch, depth.height, depthRowPitch);
+
+        if (!success)
+        {
+            log::error("Capture frame %u: write failed", record.frameIndex);
+            return false;
+        }
+
+        m_FrameOffsets.push_back(recordOffset);
+        return true;
+    }
+
+    bool CaptureWriter::Close()
+    {
+        if (!m_File)
+            return false;
+
+        CaptureFileHeader header = {};
+        header.magic = c_CaptureFileMagic;
+        header.version = c_CaptureFileVersion;
+        header.frameCount = uint32_t(m_FrameOffsets.size());
+        header.indexOffset = m_Offset;
+
+        size_t indexSize = m_FrameOffsets.size() * sizeof(uint64_t);
+        bool success = (indexSize == 0 || fwrite(m_FrameOffsets.data(), 1, indexSize, m_File) == indexSize)
+            && SeekFile(m_File, 0)
+            && fwrite(&header, 1, sizeof(header), m_File) == sizeof(header);
+
+        success = (fclose(m_File) == 0) && success;
+        m_File = nullptr;
+        m_FrameOffsets.clear();
+
+        if (!success)
+            log::error("Failed to write the capture index");
+
+        return success;
+    }
+
+    CaptureReader::~CaptureReader()
+    {
+        Close();
+    }
+
+    bool CaptureReader::Open(const std::filesystem::path& fileName)
+    {
+        Close();
+
+        const std::string name = fileName.generic_string();
+
+#ifdef _WIN32
+        HANDLE file = CreateFileW(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            log::error("%s: cannot open the capture file", name.c_str());
+            return false;
+        }
+        m_FileHandle = file;
+
+        LARGE_INTEGER fileSize = {};
+        GetFileSizeEx(file, &fileSize);
+        m_Size = uint64_t(fileSize.QuadPart);
+
+        if (m_Size >= sizeof(CaptureFileHeader))
+        {
+            m_MappingHandle = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (m_MappingHandle)
+                m_Data = static_cast<const uint8_t*>(MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0, 0, 0));
+        }
+#else
+        int file = open(fileName.c_str(), O_RDONLY);
+        if (file < 0)
+        {
+            log::error("%s: cannot open the capture file", name.c_str());
+            return false;
+        }
+
+        struct stat fileStat = {};
+        fstat(file, &fileStat);
+        m_Size = uint64_t(fileStat.st_size);
+
+        if (m_Size >= sizeof(CaptureFileHeader))
+        {
+            void* data = mmap(nullptr, size_t(m_Size), PROT_READ, MAP_SHARED, file, 0);
+            if (data != MAP_FAILED)
+                m_Data = static_cast<const uint8_t*>(data);
+        }
+
+        // The mapping keeps its own reference to the file
+        close(file);
+#endif
+
+        if (!m_Data)
+        {
+            log::error("%s: cannot map the capture file", name.c_str());
+            Close();
+            return false;
+        }
+
+        const CaptureFileHeader& header = *reinterpret_cast<const CaptureFileHeader*>(m_Data);
+        if (header.magic != c_CaptureFileMagic || header.version != c_CaptureFileVersion)
+        {
+            log::error("%s: not a NAS capture file or unsupported version", name.c_str());
+            Close();
+            return false;
+        }
+
+        if (header.indexOffset != 0)
+        {
+            if (header.indexOffset % sizeof(uint64_t) != 0
+                || !IsRangeInside(header.indexOffset, uint64_t(header.frameCount) * sizeof(uint64_t), 0, m_Size))
+            {
+                log::error("%s: the frame index is out of bounds", name.c_str());
+                Close();
+                return false;
+            }
+
+            const uint64_t* index = reinterpret_cast<const uint64_t*>(m_Data + header.indexOffset);
+            m_Frames.resize(header.frameCount);
+
+            for (uint32_t frameIndex = 0; frameIndex < header.frameCount; frameIndex++)
+            {
+                if (!ValidateRecord(index[frameIndex], m_Frames[frameIndex]))
+                {
+                    log::error("%s: frame %u is corrupt", name.c_str(), frameIndex);
+                    Close();
+                    return false;
+                }
+            }
+        }
+        else
+        {
+            // The capture was not closed properly, recover the frames that were written completely.
+            // ValidateRecord requires a record to cover at least its own header, so the offset advances.
+            uint64_t offset = AlignCaptureOffset(sizeof(CaptureFileHeader));
+            CaptureFrame frame;
+            while (ValidateRecord(offset, frame))
+            {
+                m_Frames.push_back(frame);
+                offset += AlignCaptureOffset(frame.record->recordSize);
+            }
+
+            log::warning("%s: the capture has no index, recovered %u frames", name.c_str(), GetFrameCount());
+        }
+
+        return true;
+    }
+
+    bool CaptureReader::ValidateRecord(uint64_t offset, CaptureFrame& frame) const
+    {
+        if (offset % c_CaptureAlignment != 0 || !IsRangeInside(offset, sizeof(CaptureFrameRecord), 0, m_Size))
+            return false;
+
+        const CaptureFrameRecord* record = reinterpret_cast<const CaptureFrameRecord*>(m_Data + offset);
+
+        if (record->magic != c_CaptureFrameMagic || record->width == 0 || record->height == 0
+            || record->colorRowPitch < record->width * sizeof(Rgba8)
+            || record->depthRowPitch < record->width * sizeof(float)
+            || record->colorOffset % c_CaptureAlignment != 0
+            || record->depthOffset % c_CaptureAlignment != 0
+            || record->recordSize < sizeof(CaptureFrameRecord)
+            || !IsRangeInside(offset, record->recordSize, 0, m_Size))
+            return false;
+
+        // The images follow the record header and end before the next record
+        const uint64_t payloadBegin = offset + sizeof(CaptureFrameRecord);
+        const uint64_t recordEnd = offset + record->recordSize;
+        if (!IsRangeInside(record->colorOffset, uint64_t(record->colorRowPitch) * record->height, payloadBegin, recordEnd)
+            || !IsRangeInside(record->depthOffset, uint64_t(record->depthRowPitch) * record->height, payloadBegin, recordEnd))
+            return false;
+
+        frame.record = record;
+        frame.colors = ColorView(reinterpret_cast<const Rgba8*>(m_Data + record->colorOffset),
+            record->width, record->height, record->colorRowPitch);
+        frame.depth = DepthView(reinterpret_cast<const float*>(m_Data + record->depthOffset),
+            record->width, record->height, record->depthRowPitch);
+
+        return true;
+    }
+
+    void CaptureReader::Close()
+    {
+#ifdef _WIN32
+        if (m_Data)
+            UnmapViewOfFile(m_Data);
+        if (m_MappingHandle)
+            CloseHandle(m_MappingHandle);
+        if (m_FileHandle)
+            CloseHandle(m_FileHandle);
+#else
+        if (m_Data)
+            munmap(const_cast<uint8_t*>(m_Data), size_t(m_Size));
+#endif
+
+        m_Data = nullptr;
+        m_Size = 0;
+        m_FileHandle = nullptr;
+        m_MappingHandle = nullptr;
+        m_Frames.clear();
+    }
+}
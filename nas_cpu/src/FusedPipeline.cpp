@@ -0,0 +1,174 @@
+//----------------------------------------------------------------------------------
+// File:        FusedPipeline.cpp
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include "NasTile.h"
+
+using namespace donut::math;
+
+#include "Compute_cb.h"  // requires donut::math
+
+#include <algorithm>
+#include <cassert>
+
+namespace nas
+{
+    // Tiles handled by one group of FusedNAS.hlsl: the output tiles, the rates of a halo of the
+    // smoothing radius, and the NAS data under the bilinear footprint of those rates for motion
+    // below one tile in any direction. Samples moved further read the edge of the cache.
+    constexpr int c_GroupTiles = FUSED_NAS_GROUP_TILES;
+    constexpr int c_MaxRateTiles = c_GroupTiles + 2 * int(c_MaxSmoothingRadius);
+    constexpr int c_MaxCacheTiles = c_MaxRateTiles + 2;
+
+    static int WrapTile(int tile, int count)
+    {
+        return ((tile % count) + count) % count;
+    }
+
+    template<uint32_t TileSize>
+    static void RunFusedGroups(const PipelineInputs& inputs, PipelineOutputs& outputs)
+    {
+        const LuminanceTables& tables = GetLuminanceTables(inputs.colorEncoding);
+        const ComputeNASDataConstants& dataConstants = *inputs.dataConstants;
+        const AdaptiveShadingConstants& constants = *inputs.rateConstants;
+        const RateView rates = outputs.rates.View();
+        const int tilesX = int(rates.width);
+        const int tilesY = int(rates.height);
+
+        // SMOOTH_RADIUS of the shader, 0 without smoothing
+        const int radius = inputs.enableSmoothing ? int(inputs.smoothingRadius) : 0;
+        const int rateTiles = c_GroupTiles + 2 * radius;
+        const int cacheTiles = rateTiles + 2;
+
+        float2 cache[c_MaxCacheTiles * c_MaxCacheTiles];
+        uint8_t groupRates[c_MaxRateTiles * c_MaxRateTiles];
+
+        outputs.clampedTiles = 0;
+
+        for (int groupY = 0; groupY < (tilesY + c_GroupTiles - 1) / c_GroupTiles; groupY++)
+        {
+            for (int groupX = 0; groupX < (tilesX + c_GroupTiles - 1) / c_GroupTiles; groupX++)
+            {
+                const int outputX = groupX * c_GroupTiles;
+                const int outputY = groupY * c_GroupTiles;
+                const int rateX = outputX - radius;
+                const int rateY = outputY - radius;
+                const int cacheX = rateX - 1;
+                const int cacheY = rateY - 1;
+
+                // NAS data around the group, at wrapped coordinates like the sampler
+                for (int y = 0; y < cacheTiles; y++)
+                {
+                    for (int x = 0; x < cacheTiles; x++)
+                    {
+                        cache[y * cacheTiles + x] = DecodeTileError(ComputeTileNasData<TileSize>(inputs.prevFrameColors, tables, dataConstants,
+                            uint32_t(WrapTile(cacheX + x, tilesX)), uint32_t(WrapTile(cacheY + y, tilesY)), inputs.errorMetric));
+                    }
+                }
+
+                // Texels outside of the cache (larger motion) are clamped to its edge
+                bool clamped = false;
+                auto fetch = [&](uint32_t x, uint32_t y)
+                {
+                    int localX = int(x) - cacheX;
+                    int localY = int(y) - cacheY;
+                    localX += (localX < 0) ? tilesX : (localX >= cacheTiles) ? -tilesX : 0;
+                    localY += (localY < 0) ? tilesY : (localY >= cacheTiles) ? -tilesY : 0;
+
+                    const int clampedX = std::clamp(localX, 0, cacheTiles - 1);
+                    const int clampedY = std::clamp(localY, 0, cacheTiles - 1);
+                    clamped |= clampedX != localX || clampedY != localY;
+
+                    return cache[clampedY * cacheTiles + clampedX];
+                };
+
+                for (int y = 0; y < rateTiles; y++)
+                {
+                    for (int x = 0; x < rateTiles; x++)
+                    {
+                        const int tileX = rateX + x;
+                        const int tileY = rateY + y;
+
+                        // Tiles outside of the surface read as 1x1, like out-of-bounds loads of the smoothing pass
+                        if (tileX < 0 || tileY < 0 || tileX >= tilesX || tileY >= tilesY)
+                        {
+                            groupRates[y * rateTiles + x] = ShadingRate_1x1;
+                            continue;
+                        }
+
+                        float minDepth = ComputeTileMinDepth<TileSize>(inputs.depth, uint32_t(tileX), uint32_t(tileY));
+
+                        float2 prevWindowPos, mVec;
+                        ReprojectTile<TileSize>(constants, uint32_t(tileX), uint32_t(tileY), minDepth, prevWindowPos, mVec);
+
+                        clamped = false;
+                        float2 diff = SampleNasData(rates.width, rates.height,
+                            prevWindowPos.x * constants.sourceTextureSizeInv.x,
+                            prevWindowPos.y * constants.sourceTextureSizeInv.y,
+                            fetch);
+                        outputs.clampedTiles += clamped ? 1 : 0;
+
+                        groupRates[y * rateTiles + x] = SelectShadingRate(diff, mVec, constants.errorSensitivity);
+                    }
+                }
+
+                for (int y = 0; y < c_GroupTiles && outputY + y < tilesY; y++)
+                {
+                    for (int x = 0; x < c_GroupTiles && outputX + x < tilesX; x++)
+                    {
+                        const int center = (y + radius) * rateTiles + (x + radius);
+
+                        uint8_t flags = 0;
+                        for (int offset = 1; offset <= radius; offset++)
+                        {
+                            flags |= GetSmoothingFlags(groupRates[center - offset]);
+                            flags |= GetSmoothingFlags(groupRates[center + offset]);
+                            flags |= GetSmoothingFlags(groupRates[center - offset * rateTiles]);
+                            flags |= GetSmoothingFlags(groupRates[center + offset * rateTiles]);
+                        }
+
+                        rates.At(uint32_t(outputX + x), uint32_t(outputY + y)) = ApplySmoothingFlags(groupRates[center], flags);
+                    }
+                }
+            }
+        }
+    }
+
+    void RunFusedPipeline(const PipelineInputs& inputs, PipelineOutputs& outputs)
+    {
+        assert(inputs.dataConstants && inputs.rateConstants);
+        assert(!inputs.enableSmoothing || (inputs.smoothingRadius >= 1 && inputs.smoothingRadius <= c_MaxSmoothingRadius));
+
+        PrepareOutputs(inputs, outputs);
+
+        DispatchTileSize(inputs.tileSize, [&](auto size) { RunFusedGroups<size>(inputs, outputs); });
+    }
+}
@@ -0,0 +1,117 @@
+//----------------------------------------------------------------------------------
+// File:        HalfFloat.cpp
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include <nas/NasPipeline.h>
+
+#include <cstring>
+
+namespace nas
+{
+    float HalfToFloat(uint16_t value)
+    {
+        uint32_t sign = uint32_t(value & 0x8000) << 16;
+        uint32_t exponent = (value >> 10) & 0x1f;
+        uint32_t mantissa = value & 0x3ff;
+        uint32_t bits;
+
+        if (exponent == 0x1f)
+        {
+            // Inf / NaN
+            bits = sign | 0x7f800000 | (mantissa << 13);
+        }
+        else if (exponent != 0)
+        {
+            bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+        }
+        else if (mantissa != 0)
+        {
+            // Denormal: renormalize
+            exponent = 113;
+            while ((mantissa & 0x400) == 0)
+            {
+                mantissa <<= 1;
+                --exponent;
+            }
+            bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+        }
+        else
+        {
+            bits = sign;
+        }
+
+        float result;
+        memcpy(&result, &bits, sizeof(result));
+        return result;
+    }
+
+    // Round-to-nearest-even conversion, as performed by UAV writes to 16-bit float formats
+    uint16_t FloatToHalf(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+
+        uint16_t sign = uint16_t((bits >> 16) & 0x8000);
+        uint32_t absBits = bits & 0x7fffffff;
+
+        if (absBits >= 0x7f800000)
+        {
+            // Inf / NaN, keep NaNs quiet
+            return uint16_t(sign | 0x7c00 | (absBits > 0x7f800000 ? 0x200 : 0));
+        }
+
+        if (absBits >= 0x477ff000)
+        {
+            // Rounds to a value above 65504
+            return uint16_t(sign | 0x7c00);
+        }
+
+        if (absBits < 0x38800000)
+        {
+            // Result is a half denormal (or zero)
+            if (absBits < 0x33000000)
+                return sign;
+
+            uint32_t exponent = absBits >> 23;
+            uint32_t mantissa = (absBits & 0x7fffff) | 0x800000;
+            uint32_t shift = 126 - exponent;
+            uint32_t halfMantissa = mantissa >> shift;
+            uint32_t remainder = mantissa & ((1u << shift) - 1);
+            uint32_t halfway = 1u << (shift - 1);
+            if (remainder > halfway || (remainder == halfway && (halfMantissa & 1)))
+                ++halfMantissa;
+            return uint16_t(sign | halfMantissa);
+        }
+
+        uint32_t rounded = absBits + 0xfff + ((absBits >> 13) & 1);
+        return uint16_t(sign | ((rounded - 0x38000000) >> 13));
+    }
+}
@@ -0,0 +1,186 @@
+//----------------------------------------------------------------------------------
+// File:        ImageIO.cpp
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include <nas/ImageIO.h>
+
+#include <donut/core/log.h>
+
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string>
+
+using namespace donut;
+
+namespace nas
+{
+    // Reads the magic number, width, height and max value / scale of a PNM-style header
+    // and skips the single whitespace character that precedes the binary data
+    static bool ReadHeader(std::ifstream& file, const std::filesystem::path& fileName, const char* magic,
+        uint32_t& width, uint32_t& height, double& range)
+    {
+        std::string fileMagic;
+        file >> fileMagic;
+
+        if (fileMagic != magic)
+        {
+            log::error("%s: expected a '%s' image", fileName.generic_string().c_str(), magic);
+            return false;
+        }
+
+        // Skip comments between the header tokens
+        auto readToken = [&file](auto& value)
+        {
+            file >> std::ws;
+            while (file.peek() == '#')
+            {
+                file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                file >> std::ws;
+            }
+            file >> value;
+        };
+
+        readToken(width);
+        readToken(height);
+        readToken(range);
+        file.get();
+
+        if (!file || width == 0 || height == 0)
+        {
+            log::error("%s: invalid image header", fileName.generic_string().c_str());
+            return false;
+        }
+
+        return true;
+    }
+
+    bool ReadPpm(const std::filesystem::path& fileName, Image<Rgba8>& image)
+    {
+        std::ifstream file(fileName, std::ios::binary);
+        if (!file)
+        {
+            log::error("Cannot open %s", fileName.generic_string().c_str());
+            return false;
+        }
+
+        uint32_t width, height;
+        double maxValue;
+        if (!ReadHeader(file, fileName, "P6", width, height, maxValue))
+            return false;
+
+        if (maxValue != 255.0)
+        {
+            log::error("%s: only 8-bit PPM images are supported", fileName.generic_string().c_str());
+            return false;
+        }
+
+        std::vector<uint8_t> rgb(size_t(width) * height * 3);
+        if (!file.read(reinterpret_cast<char*>(rgb.data()), std::streamsize(rgb.size())))
+        {
+            log::error("%s: unexpected end of file", fileName.generic_string().c_str());
+            return false;
+        }
+
+        image.Resize(width, height);
+        Rgba8* dst = image.GetData();
+        for (size_t i = 0; i < size_t(width) * height; i++)
+            dst[i] = Rgba8{ rgb[i * 3 + 0], rgb[i * 3 + 1], rgb[i * 3 + 2], 255 };
+
+        return true;
+    }
+
+    bool ReadPfm(const std::filesystem::path& fileName, Image<float>& image)
+    {
+        std::ifstream file(fileName, std::ios::binary);
+        if (!file)
+        {
+            log::error("Cannot open %s", fileName.generic_string().c_str());
+            return false;
+        }
+
+        uint32_t width, height;
+        double scale;
+        if (!ReadHeader(file, fileName, "Pf", width, height, scale))
+            return false;
+
+        image.Resize(width, height);
+
+        // PFM stores rows bottom to top
+        for (uint32_t row = 0; row < height; row++)
+        {
+            if (!file.read(reinterpret_cast<char*>(&image.At(0, height - 1 - row)), std::streamsize(width * sizeof(float))))
+            {
+                log::error("%s: unexpected end of file", fileName.generic_string().c_str());
+                return false;
+            }
+        }
+
+        // A negative scale means little endian data
+        const uint16_t endianTest = 1;
+        const bool hostLittleEndian = *reinterpret_cast<const uint8_t*>(&endianTest) == 1;
+
+        if ((scale < 0.0) != hostLittleEndian)
+        {
+            for (size_t i = 0; i < size_t(width) * height; i++)
+            {
+                uint32_t bits;
+                memcpy(&bits, image.GetData() + i, sizeof(bits));
+                bits = (bits >> 24) | ((bits >> 8) & 0xff00) | ((bits << 8) & 0xff0000) | (bits << 24);
+                memcpy(image.GetData() + i, &bits, sizeof(bits));
+            }
+        }
+
+        return true;
+    }
+
+    bool WritePgm(const std::filesystem::path& fileName, const ConstRateView& image)
+    {
+        std::ofstream file(fileName, std::ios::binary);
+        if (!file)
+        {
+            log::error("Cannot create %s", fileName.generic_string().c_str());
+            return false;
+        }
+
+        file << "P5\n" << image.width << " " << image.height << "\n255\n";
+        for (uint32_t y = 0; y < image.height; y++)
+            file.write(reinterpret_cast<const char*>(image.Row(y)), image.width);
+
+        if (!file)
+        {
+            log::error("Cannot write %s", fileName.generic_string().c_str());
+            return false;
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,125 @@
+//----------------------------------------------------------------------------------
+// File:        IncrementalPipeline.cpp
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include <nas/IncrementalPipeline.h>
+
+#include "NasTile.h"
+
+using namespace donut::math;
+
+#include "Compute_cb.h"  // requires donut::math
+
+#include <cassert>
+
+namespace nas
+{
+    void IncrementalPipeline::Run(const PipelineInputs& inputs, PipelineOutputs& outputs)
+    {
+        assert(inputs.dataConstants && inputs.rateConstants);
+        assert(IsSupportedTileSize(inputs.tileSize));
+
+        PrepareOutputs(inputs, outputs);
+
+        ComputeNASDataVectorized(inputs.prevFrameColors, inputs.colorEncoding, *inputs.dataConstants, outputs.nasData.View(),
+            inputs.instructionSet, inputs.tileSize, inputs.errorMetric);
+
+        const AdaptiveShadingConstants& constants = *inputs.rateConstants;
+        const uint32_t tilesX = outputs.rates.GetWidth();
+        const uint32_t tilesY = outputs.rates.GetHeight();
+
+        // Rates computed for another tile grid or with other sensitivities cannot be kept
+        if (m_Signatures.GetWidth() != tilesX || m_Signatures.GetHeight() != tilesY || m_TileSize != inputs.tileSize
+            || m_ErrorSensitivity != constants.errorSensitivity || m_MotionSensitivity != constants.motionSensitivity)
+        {
+            m_Valid = false;
+        }
+
+        const bool forceDirty = !m_Valid;
+        if (forceDirty)
+        {
+            m_Signatures.Resize(tilesX, tilesY);
+            m_UnsmoothedRates.Resize(tilesX, tilesY);
+            m_TileSize = inputs.tileSize;
+            m_ErrorSensitivity = constants.errorSensitivity;
+            m_MotionSensitivity = constants.motionSensitivity;
+            m_Valid = true;
+        }
+
+        const ConstNasDataView nasData = outputs.nasData.View();
+        auto fetch = [&nasData](uint32_t x, uint32_t y) { return DecodeTileError(nasData.At(x, y)); };
+
+        // Relative to the error sensitivity, which the rate thresholds scale with
+        const float errorTolerance = m_ErrorTolerance * constants.errorSensitivity;
+
+        m_DirtyTileCount = 0;
+
+        DispatchTileSize(inputs.tileSize, [&](auto size)
+        {
+            for (uint32_t tileY = 0; tileY < tilesY; tileY++)
+            {
+                for (uint32_t tileX = 0; tileX < tilesX; tileX++)
+                {
+                    // Change detection: everything the rate depends on except the final selection
+                    float minDepth = ComputeTileMinDepth<size>(inputs.depth, tileX, tileY);
+
+                    float2 prevWindowPos, mVec;
+                    ReprojectTile<size>(constants, tileX, tileY, minDepth, prevWindowPos, mVec);
+
+                    BilinearFootprint footprint = GetBilinearFootprint(nasData.width, nasData.height,
+                        prevWindowPos.x * constants.sourceTextureSizeInv.x,
+                        prevWindowPos.y * constants.sourceTextureSizeInv.y);
+                    float2 diff = SampleNasData(footprint, fetch);
+
+                    TileSignature& signature = m_Signatures.At(tileX, tileY);
+                    bool dirty = forceDirty
+                        || fabsf(signature.sampledErrorX - diff.x) > errorTolerance
+                        || fabsf(signature.sampledErrorY - diff.y) > errorTolerance
+                        || fabsf(signature.prevWindowPosX - prevWindowPos.x) > m_MotionTolerance
+                        || fabsf(signature.prevWindowPosY - prevWindowPos.y) > m_MotionTolerance;
+
+                    if (!dirty)
+                        continue;
+
+                    m_UnsmoothedRates.At(tileX, tileY) = SelectShadingRate(diff, mVec, constants.errorSensitivity);
+
+                    signature = TileSignature{ prevWindowPos.x, prevWindowPos.y, diff.x, diff.y };
+                    m_DirtyTileCount++;
+                }
+            }
+        });
+
+        if (inputs.enableSmoothing)
+            SmoothShadingRate(m_UnsmoothedRates.View(), outputs.rates.View(), inputs.smoothingRadius);
+        else
+            outputs.rates = m_UnsmoothedRates;
+    }
+}
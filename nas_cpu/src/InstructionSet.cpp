@@ -0,0 +1,139 @@
+//----------------------------------------------------------------------------------
+// File:        InstructionSet.cpp
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include <nas/InstructionSet.h>
+#include "NasDataKernels.h"
+
+#include <string.h>
+#ifndef _WIN32
+#include <strings.h>
+#endif
+
+#if NAS_ARCH_X86 && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace nas
+{
+    static InstructionSet DetectInstructionSet()
+    {
+#if NAS_ARCH_X86
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        int maxLeaf = info[0];
+
+        __cpuid(info, 1);
+        bool sse41 = (info[2] & (1 << 19)) != 0;
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        bool avx2 = false;
+
+        // AVX state must be enabled by the OS as well
+        if (osxsave && avx && (_xgetbv(0) & 0x6) == 0x6 && maxLeaf >= 7)
+        {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] & (1 << 5)) != 0;
+        }
+#else
+        __builtin_cpu_init();
+        bool sse41 = __builtin_cpu_supports("sse4.1");
+        bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+        if (avx2)
+            return InstructionSet::AVX2;
+        if (sse41)
+            return InstructionSet::SSE41;
+        return InstructionSet::Scalar;
+#elif NAS_ARCH_ARM64
+        return InstructionSet::NEON;
+#else
+        return InstructionSet::Scalar;
+#endif
+    }
+
+    InstructionSet GetSupportedInstructionSet()
+    {
+        static const InstructionSet supported = DetectInstructionSet();
+        return supported;
+    }
+
+    InstructionSet ResolveInstructionSet(InstructionSet requested)
+    {
+        InstructionSet supported = GetSupportedInstructionSet();
+
+        switch (requested)
+        {
+        case InstructionSet::Scalar:
+            return requested;
+        case InstructionSet::SSE41:
+            return (supported == InstructionSet::SSE41 || supported == InstructionSet::AVX2) ? requested : supported;
+        case InstructionSet::AVX2:
+        case InstructionSet::NEON:
+        default:
+            return supported == requested ? requested : supported;
+        }
+    }
+
+    const char* GetInstructionSetName(InstructionSet instructionSet)
+    {
+        switch (instructionSet)
+        {
+        case InstructionSet::Scalar: return "scalar";
+        case InstructionSet::SSE41: return "sse4.1";
+        case InstructionSet::AVX2: return "avx2";
+        case InstructionSet::NEON: return "neon";
+        default: return "unknown";
+        }
+    }
+
+    bool ParseInstructionSetName(const char* name, InstructionSet& result)
+    {
+        const InstructionSet all[] = { InstructionSet::Scalar, InstructionSet::SSE41, InstructionSet::AVX2, InstructionSet::NEON };
+
+        for (InstructionSet instructionSet : all)
+        {
+#ifdef _WIN32
+            if (_stricmp(name, GetInstructionSetName(instructionSet)) == 0)
+#else
+            if (strcasecmp(name, GetInstructionSetName(instructionSet)) == 0)
+#endif
+            {
+                result = instructionSet;
+                return true;
+            }
+        }
+
+        return false;
+    }
+}
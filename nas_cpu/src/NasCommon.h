@@ -0,0 +1,179 @@
+//----------------------------------------------------------------------------------
+// File:        NasCommon.h
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#pragma once
+
+// Helpers shared by the CPU NAS kernels, not part of the public interface
+
+#include <nas/NasPipeline.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <type_traits>
+
+namespace nas
+{
+    // RgbToLuminance weights from ComputeNASData.hlsl
+    constexpr float c_LumaWeightR = 0.299f;
+    constexpr float c_LumaWeightG = 0.587f;
+    constexpr float c_LumaWeightB = 0.114f;
+
+    // Fractional bits of bilinear filter weights. D3D requires at least 8 bits of
+    // sub-texel precision, which is what current GPUs implement.
+    constexpr float c_FilterWeightScale = 256.f;
+
+    // Threadgroup layout of the NAS compute shaders: one thread per 2x4 pixel block of the tile,
+    // i.e. 4x2 threads for 8x8 tiles, 8x4 for 16x16 and 16x8 for 32x32
+    constexpr uint32_t c_BlockSizeX = 2;
+    constexpr uint32_t c_BlockSizeY = 4;
+
+    template<uint32_t TileSize>
+    struct TileLayout
+    {
+        static_assert(IsSupportedTileSize(TileSize), "unsupported tile size");
+
+        static constexpr uint32_t groupSizeX = TileSize / c_BlockSizeX;
+        static constexpr uint32_t groupSizeY = TileSize / c_BlockSizeY;
+        static constexpr uint32_t threads = groupSizeX * groupSizeY;
+    };
+
+    template<uint32_t TileSize>
+    using TileSizeConstant = std::integral_constant<uint32_t, TileSize>;
+
+    // Calls func(TileSizeConstant<N>()) for the runtime tile size, so that every size
+    // runs a loop structure specialized for it
+    template<typename Func>
+    decltype(auto) DispatchTileSize(uint32_t tileSize, Func&& func)
+    {
+        assert(IsSupportedTileSize(tileSize));
+
+        switch (tileSize)
+        {
+        case 8: return func(TileSizeConstant<8>());
+        case 32: return func(TileSizeConstant<32>());
+        default: return func(TileSizeConstant<16>());
+        }
+    }
+
+    // Per-channel luminance contributions of an 8-bit channel value, i.e. the channel
+    // decoded like a UNORM or SRGB texture view and multiplied by its RgbToLuminance weight.
+    // Using tables keeps the luminance a sum of three values, so every kernel variant
+    // produces bit-identical results regardless of FMA contraction.
+    struct LuminanceTables
+    {
+        float r[256];
+        float g[256];
+        float b[256];
+    };
+
+    const LuminanceTables& GetLuminanceTables(ColorEncoding encoding);
+
+    inline float RgbToLuminance(const Rgba8& pixel, const LuminanceTables& tables)
+    {
+        return (tables.r[pixel.r] + tables.g[pixel.g]) + tables.b[pixel.b];
+    }
+
+    // Texture2D.Load semantics: out-of-bounds reads return zero
+    inline float LoadLuminance(const ColorView& colors, const LuminanceTables& tables, int x, int y)
+    {
+        if (x < 0 || y < 0 || uint32_t(x) >= colors.width || uint32_t(y) >= colors.height)
+            return 0.f;
+
+        return RgbToLuminance(colors.At(uint32_t(x), uint32_t(y)), tables);
+    }
+
+    inline float LoadDepth(const DepthView& depth, int x, int y)
+    {
+        if (x < 0 || y < 0 || uint32_t(x) >= depth.width || uint32_t(y) >= depth.height)
+            return 0.f;
+
+        return depth.At(uint32_t(x), uint32_t(y));
+    }
+
+    inline uint8_t LoadRate(const ConstRateView& rates, int x, int y)
+    {
+        if (x < 0 || y < 0 || uint32_t(x) >= rates.width || uint32_t(y) >= rates.height)
+            return 0;
+
+        return rates.At(uint32_t(x), uint32_t(y));
+    }
+
+    // Tile row range variants of the passes, used to split the work into bands.
+    // Each one writes rows [tileRowBegin, tileRowEnd) of its output only.
+    void ComputeNASDataRows(
+        const ColorView& prevFrameColors,
+        ColorEncoding encoding,
+        const ComputeNASDataConstants& constants,
+        const NasDataView& nasData,
+        uint32_t tileSize,
+        ErrorMetric metric,
+        uint32_t tileRowBegin,
+        uint32_t tileRowEnd);
+
+    void ComputeNASDataVectorizedRows(
+        const ColorView& prevFrameColors,
+        ColorEncoding encoding,
+        const ComputeNASDataConstants& constants,
+        const NasDataView& nasData,
+        InstructionSet instructionSet,
+        uint32_t tileSize,
+        ErrorMetric metric,
+        uint32_t tileRowBegin,
+        uint32_t tileRowEnd);
+
+    void ComputeShadingRateRows(
+        const DepthView& depth,
+        const ConstNasDataView& nasData,
+        const AdaptiveShadingConstants& constants,
+        const RateView& rates,
+        uint32_t tileSize,
+        uint32_t tileRowBegin,
+        uint32_t tileRowEnd);
+
+    // Reads input rows [tileRowBegin - radius, tileRowEnd + radius - 1] (clamped to the surface)
+    void SmoothShadingRateRows(
+        const ConstRateView& input,
+        const RateView& output,
+        uint32_t radius,
+        uint32_t tileRowBegin,
+        uint32_t tileRowEnd);
+
+    // (Re)allocates the outputs to the tile grid of the inputs
+    void PrepareOutputs(const PipelineInputs& inputs, PipelineOutputs& outputs);
+
+    // Stores a tile error the way a RG16_FLOAT UAV write does
+    inline NasTileData EncodeTileError(float errorX, float errorY)
+    {
+        return NasTileData{ FloatToHalf(errorX), FloatToHalf(errorY) };
+    }
+}
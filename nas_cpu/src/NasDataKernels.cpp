@@ -0,0 +1,221 @@
+//----------------------------------------------------------------------------------
+// File:        NasDataKernels.cpp
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include "NasDataKernels.h"
+#include "NasCommon.h"
+
+#include <donut/core/math/math.h>
+
+using namespace donut::math;
+
+#include "Compute_cb.h"  // requires donut::math
+
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+namespace nas
+{
+    namespace kernels
+    {
+        void ConvertRowScalar(const Rgba8* src, uint32_t count, const LuminanceTables& tables, float* dst)
+        {
+            for (uint32_t x = 0; x < count; x++)
+                dst[x] = RgbToLuminance(src[x], tables);
+        }
+
+        template<uint32_t TileSize>
+        void TileRowGradientsScalar(const float* const* rows, uint32_t tileCount, TileAccumulators* tiles)
+        {
+            using Layout = TileLayout<TileSize>;
+
+            for (uint32_t tile = 0; tile < tileCount; tile++)
+            {
+                const uint32_t base = tile * TileSize;
+                float errX = 0.f;
+                float errY = 0.f;
+
+                for (uint32_t y = 0; y < TileSize; y++)
+                {
+                    const float* r0 = rows[y] + base;
+                    const float* r1 = rows[y + 1] + base;
+
+                    for (uint32_t x = y & 1; x < TileSize; x += 2)
+                    {
+                        errX = std::max(errX, fabsf(r0[x + 1] - r0[x]));
+                        errY = std::max(errY, fabsf(r1[x] - r0[x]));
+                    }
+                }
+
+                tiles[tile].errorX = errX;
+                tiles[tile].errorY = errY;
+
+                for (uint32_t blockY = 0; blockY < Layout::groupSizeY; blockY++)
+                {
+                    const float* a = rows[blockY * c_BlockSizeY + 0] + base;
+                    const float* b = rows[blockY * c_BlockSizeY + 1] + base;
+                    const float* c = rows[blockY * c_BlockSizeY + 2] + base;
+                    const float* d = rows[blockY * c_BlockSizeY + 3] + base;
+
+                    for (uint32_t blockX = 0; blockX < Layout::groupSizeX; blockX++)
+                    {
+                        uint32_t x = blockX * c_BlockSizeX;
+                        tiles[tile].blockAverages[blockY * Layout::groupSizeX + blockX] =
+                            ((a[x] + c[x]) + (a[x + 1] + c[x + 1]) + (b[x] + d[x]) + (b[x + 1] + d[x + 1])) / 8;
+                    }
+                }
+            }
+        }
+
+        template void TileRowGradientsScalar<8>(const float* const*, uint32_t, TileAccumulators*);
+        template void TileRowGradientsScalar<16>(const float* const*, uint32_t, TileAccumulators*);
+        template void TileRowGradientsScalar<32>(const float* const*, uint32_t, TileAccumulators*);
+    }
+
+    struct NasDataKernelSet
+    {
+        kernels::ConvertRowFunc convertRow;
+        kernels::TileRowGradientsFunc tileRowGradients;
+    };
+
+    template<uint32_t TileSize>
+    static NasDataKernelSet GetNasDataKernelSet(InstructionSet instructionSet)
+    {
+        switch (ResolveInstructionSet(instructionSet))
+        {
+#if NAS_ARCH_X86
+        case InstructionSet::AVX2:
+            return { kernels::ConvertRowAvx2, kernels::TileRowGradientsAvx2<TileSize> };
+        case InstructionSet::SSE41:
+            return { kernels::ConvertRowSse41, kernels::TileRowGradientsSse41<TileSize> };
+#endif
+#if NAS_ARCH_ARM64
+        case InstructionSet::NEON:
+            return { kernels::ConvertRowNeon, kernels::TileRowGradientsNeon<TileSize> };
+#endif
+        default:
+            return { kernels::ConvertRowScalar, kernels::TileRowGradientsScalar<TileSize> };
+        }
+    }
+
+    static NasDataKernelSet GetNasDataKernelSet(InstructionSet instructionSet, uint32_t tileSize)
+    {
+        return DispatchTileSize(tileSize, [instructionSet](auto size) { return GetNasDataKernelSet<size>(instructionSet); });
+    }
+
+    void ComputeNASDataVectorizedRows(
+        const ColorView& prevFrameColors,
+        ColorEncoding encoding,
+        const ComputeNASDataConstants& constants,
+        const NasDataView& nasData,
+        InstructionSet instructionSet,
+        uint32_t tileSize,
+        ErrorMetric metric,
+        uint32_t tileRowBegin,
+        uint32_t tileRowEnd)
+    {
+        // The kernels accumulate the max metric only
+        if (metric != ErrorMetric::Max)
+        {
+            ComputeNASDataRows(prevFrameColors, encoding, constants, nasData, tileSize, metric, tileRowBegin, tileRowEnd);
+            return;
+        }
+
+        assert(nasData.width == GetTileCount(prevFrameColors.width, tileSize));
+        assert(nasData.height == GetTileCount(prevFrameColors.height, tileSize));
+        assert(tileRowBegin <= tileRowEnd && tileRowEnd <= nasData.height);
+
+        const LuminanceTables& tables = GetLuminanceTables(encoding);
+        const NasDataKernelSet kernelSet = GetNasDataKernelSet(instructionSet, tileSize);
+
+        const uint32_t rowsPerTileRow = tileSize + 1;
+        const uint32_t blocksPerTile = (tileSize / c_BlockSizeX) * (tileSize / c_BlockSizeY);
+        const uint32_t rowLength = nasData.width * tileSize + kernels::c_RowPadding;
+        const uint32_t width = prevFrameColors.width;
+
+        std::vector<float> lumaRows(size_t(rowLength) * rowsPerTileRow);
+        std::vector<kernels::TileAccumulators> tiles(nasData.width);
+        const float* rowPointers[kernels::c_MaxRowsPerTileRow];
+
+        for (uint32_t row = 0; row < rowsPerTileRow; row++)
+            rowPointers[row] = lumaRows.data() + size_t(row) * rowLength;
+
+        for (uint32_t tileY = tileRowBegin; tileY < tileRowEnd; tileY++)
+        {
+            // Out-of-bounds pixels read as zero, like Texture2D.Load
+            for (uint32_t row = 0; row < rowsPerTileRow; row++)
+            {
+                uint32_t y = tileY * tileSize + row;
+                float* dst = lumaRows.data() + size_t(row) * rowLength;
+
+                if (y < prevFrameColors.height)
+                {
+                    kernelSet.convertRow(prevFrameColors.Row(y), width, tables, dst);
+                    memset(dst + width, 0, (rowLength - width) * sizeof(float));
+                }
+                else
+                {
+                    memset(dst, 0, rowLength * sizeof(float));
+                }
+            }
+
+            kernelSet.tileRowGradients(rowPointers, nasData.width, tiles.data());
+
+            for (uint32_t tileX = 0; tileX < nasData.width; tileX++)
+            {
+                const kernels::TileAccumulators& tile = tiles[tileX];
+
+                // Same accumulation order as the reference implementation
+                float lumaSum = 0.f;
+                for (uint32_t block = 0; block < blocksPerTile; block++)
+                    lumaSum += tile.blockAverages[block];
+
+                float avgLuma = lumaSum / float(blocksPerTile) + constants.brightnessSensitivity;
+                avgLuma = fabsf(avgLuma);
+
+                nasData.At(tileX, tileY) = EncodeTileError(tile.errorX / avgLuma, tile.errorY / avgLuma);
+            }
+        }
+    }
+
+    void ComputeNASDataVectorized(
+        const ColorView& prevFrameColors,
+        ColorEncoding encoding,
+        const ComputeNASDataConstants& constants,
+        const NasDataView& nasData,
+        InstructionSet instructionSet,
+        uint32_t tileSize,
+        ErrorMetric metric)
+    {
+        ComputeNASDataVectorizedRows(prevFrameColors, encoding, constants, nasData, instructionSet, tileSize, metric, 0, nasData.height);
+    }
+}
@@ -0,0 +1,115 @@
+//----------------------------------------------------------------------------------
+// File:        NasDataKernels.h
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#pragma once
+
+// Row-based NAS data kernels, one implementation per instruction set.
+//
+// ComputeNASData.hlsl evaluates derivatives on a checkerboard: for every pixel with even
+// (x + y) inside a tile it takes |L(x+1, y) - L(x, y)| and |L(x, y+1) - L(x, y)|.
+// The kernels below convert whole rows of the tile row to luminance first and then
+// evaluate that pattern on 4 or 8 pixels per instruction, which produces the same
+// values as the 13 point loads per 2x4 block of the shader.
+//
+// The per-ISA translation units are compiled with different code generation flags,
+// so they must not define or instantiate inline functions shared with other files.
+// The gradient kernels are templates on the tile size; each translation unit explicitly
+// instantiates its own kernel for every size in c_TileSizes, so there is exactly one
+// definition per instantiation.
+
+#include <nas/Image.h>
+#include <nas/InstructionSet.h>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define NAS_ARCH_X86 1
+#else
+#define NAS_ARCH_X86 0
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define NAS_ARCH_ARM64 1
+#else
+#define NAS_ARCH_ARM64 0
+#endif
+
+namespace nas
+{
+    struct LuminanceTables;
+
+    namespace kernels
+    {
+        // Pixel rows of one tile row needed by the gradient kernel: the rows of the tile plus the first row below.
+        // Sized for the largest tile.
+        constexpr uint32_t c_MaxRowsPerTileRow = 32 + 1;
+
+        // Padding after the last tile of a luminance row; zero-filled, covers the x + 1 reads
+        constexpr uint32_t c_RowPadding = 16;
+
+        // Blocks of 2x4 pixels in the largest tile, i.e. threads in a ComputeNASData group
+        constexpr uint32_t c_MaxBlocksPerTile = (32 / 2) * (32 / 4);
+
+        struct TileAccumulators
+        {
+            float errorX;
+            float errorY;
+            // Average luminance of each 2x4 block, in thread order (x fastest), summed
+            // pairwise the same way as the shader: ((l0.x + l1.x) + (l0.y + l1.y) + ...) / 8
+            float blockAverages[c_MaxBlocksPerTile];
+        };
+
+        // Converts 'count' RGBA8 pixels to luminance
+        typedef void (*ConvertRowFunc)(const Rgba8* src, uint32_t count, const LuminanceTables& tables, float* dst);
+
+        // Evaluates one tile row. 'rows' points at TileSize + 1 luminance rows holding
+        // tileCount * TileSize + c_RowPadding values each.
+        typedef void (*TileRowGradientsFunc)(const float* const* rows, uint32_t tileCount, TileAccumulators* tiles);
+
+        void ConvertRowScalar(const Rgba8* src, uint32_t count, const LuminanceTables& tables, float* dst);
+        template<uint32_t TileSize>
+        void TileRowGradientsScalar(const float* const* rows, uint32_t tileCount, TileAccumulators* tiles);
+
+#if NAS_ARCH_X86
+        void ConvertRowSse41(const Rgba8* src, uint32_t count, const LuminanceTables& tables, float* dst);
+        template<uint32_t TileSize>
+        void TileRowGradientsSse41(const float* const* rows, uint32_t tileCount, TileAccumulators* tiles);
+        void ConvertRowAvx2(const Rgba8* src, uint32_t count, const LuminanceTables& tables, float* dst);
+        template<uint32_t TileSize>
+        void TileRowGradientsAvx2(const float* const* rows, uint32_t tileCount, TileAccumulators* tiles);
+#endif
+
+#if NAS_ARCH_ARM64
+        void ConvertRowNeon(const Rgba8* src, uint32_t count, const LuminanceTables& tables, float* dst);
+        template<uint32_t TileSize>
+        void TileRowGradientsNeon(const float* const* rows, uint32_t tileCount, TileAccumulators* tiles);
+#endif
+    }
+}
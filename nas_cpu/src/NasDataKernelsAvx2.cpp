@@ -0,0 +1,181 @@
+//----------------------------------------------------------------------------------
+// File:        NasDataKernelsAvx2.cpp
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+// Compiled with AVX2 code generation, only called after runtime detection.
+
+#include "NasDataKernels.h"
+#include "NasCommon.h"
+
+#if NAS_ARCH_X86
+
+#include <immintrin.h>
+
+namespace nas
+{
+    namespace kernels
+    {
+        static float HorizontalMax(__m256 value)
+        {
+            __m128 m = _mm_max_ps(_mm256_castps256_ps128(value), _mm256_extractf128_ps(value, 1));
+            m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+            m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+            return _mm_cvtss_f32(m);
+        }
+
+        void ConvertRowAvx2(const Rgba8* src, uint32_t count, const LuminanceTables& tables, float* dst)
+        {
+            const __m256i byteMask = _mm256_set1_epi32(0xff);
+
+            uint32_t x = 0;
+            for (; x + 8 <= count; x += 8)
+            {
+                __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x));
+                __m256i r = _mm256_and_si256(pixels, byteMask);
+                __m256i g = _mm256_and_si256(_mm256_srli_epi32(pixels, 8), byteMask);
+                __m256i b = _mm256_and_si256(_mm256_srli_epi32(pixels, 16), byteMask);
+
+                __m256 luma = _mm256_add_ps(_mm256_i32gather_ps(tables.r, r, 4), _mm256_i32gather_ps(tables.g, g, 4));
+                luma = _mm256_add_ps(luma, _mm256_i32gather_ps(tables.b, b, 4));
+                _mm256_storeu_ps(dst + x, luma);
+            }
+
+            for (; x < count; x++)
+                dst[x] = (tables.r[src[x].r] + tables.g[src[x].g]) + tables.b[src[x].b];
+        }
+
+        template<uint32_t TileSize>
+        void TileRowGradientsAvx2(const float* const* rows, uint32_t tileCount, TileAccumulators* tiles)
+        {
+            using Layout = TileLayout<TileSize>;
+
+            // abs() combined with the checkerboard: only pixels with even (x + y) contribute
+            const __m256 maskEven = _mm256_castsi256_ps(_mm256_setr_epi32(0x7fffffff, 0, 0x7fffffff, 0, 0x7fffffff, 0, 0x7fffffff, 0));
+            const __m256 maskOdd = _mm256_castsi256_ps(_mm256_setr_epi32(0, 0x7fffffff, 0, 0x7fffffff, 0, 0x7fffffff, 0, 0x7fffffff));
+            const __m256 eighth = _mm256_set1_ps(0.125f);
+
+            for (uint32_t tile = 0; tile < tileCount; tile++)
+            {
+                const uint32_t base = tile * TileSize;
+                __m256 maxX0 = _mm256_setzero_ps();
+                __m256 maxX1 = _mm256_setzero_ps();
+                __m256 maxY0 = _mm256_setzero_ps();
+                __m256 maxY1 = _mm256_setzero_ps();
+
+                for (uint32_t y = 0; y < TileSize; y++)
+                {
+                    const float* r0 = rows[y] + base;
+                    const float* r1 = rows[y + 1] + base;
+                    const __m256 mask = (y & 1) ? maskOdd : maskEven;
+
+                    // 8 columns per iteration, alternating between two accumulators
+                    for (uint32_t x = 0; x < TileSize; x += 8)
+                    {
+                        __m256 center = _mm256_loadu_ps(r0 + x);
+                        __m256 dx = _mm256_and_ps(_mm256_sub_ps(_mm256_loadu_ps(r0 + x + 1), center), mask);
+                        __m256 dy = _mm256_and_ps(_mm256_sub_ps(_mm256_loadu_ps(r1 + x), center), mask);
+
+                        if ((x / 8) & 1)
+                        {
+                            maxX1 = _mm256_max_ps(maxX1, dx);
+                            maxY1 = _mm256_max_ps(maxY1, dy);
+                        }
+                        else
+                        {
+                            maxX0 = _mm256_max_ps(maxX0, dx);
+                            maxY0 = _mm256_max_ps(maxY0, dy);
+                        }
+                    }
+                }
+
+                tiles[tile].errorX = HorizontalMax(_mm256_max_ps(maxX0, maxX1));
+                tiles[tile].errorY = HorizontalMax(_mm256_max_ps(maxY0, maxY1));
+
+                for (uint32_t blockY = 0; blockY < Layout::groupSizeY; blockY++)
+                {
+                    const float* a = rows[blockY * c_BlockSizeY + 0] + base;
+                    const float* b = rows[blockY * c_BlockSizeY + 1] + base;
+                    const float* c = rows[blockY * c_BlockSizeY + 2] + base;
+                    const float* d = rows[blockY * c_BlockSizeY + 3] + base;
+                    float* averages = tiles[tile].blockAverages + blockY * Layout::groupSizeX;
+
+                    if constexpr (TileSize == 8)
+                    {
+                        // A single group of 8 columns = 4 blocks
+                        __m256 ac = _mm256_add_ps(_mm256_loadu_ps(a), _mm256_loadu_ps(c));
+                        __m256 bd = _mm256_add_ps(_mm256_loadu_ps(b), _mm256_loadu_ps(d));
+
+                        // In-lane split of even and odd columns; lanes end up in block order 0,1,0,1,2,3,2,3
+                        __m256 acEven = _mm256_shuffle_ps(ac, ac, _MM_SHUFFLE(2, 0, 2, 0));
+                        __m256 acOdd = _mm256_shuffle_ps(ac, ac, _MM_SHUFFLE(3, 1, 3, 1));
+                        __m256 bdEven = _mm256_shuffle_ps(bd, bd, _MM_SHUFFLE(2, 0, 2, 0));
+                        __m256 bdOdd = _mm256_shuffle_ps(bd, bd, _MM_SHUFFLE(3, 1, 3, 1));
+
+                        __m256 sum = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(acEven, acOdd), bdEven), bdOdd);
+                        sum = _mm256_mul_ps(sum, eighth);
+                        sum = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(sum), _MM_SHUFFLE(3, 1, 2, 0)));
+
+                        _mm_storeu_ps(averages, _mm256_castps256_ps128(sum));
+                    }
+                    else
+                    {
+                        // 16 columns = 8 blocks per iteration
+                        for (uint32_t x = 0; x < TileSize; x += 16)
+                        {
+                            __m256 ac0 = _mm256_add_ps(_mm256_loadu_ps(a + x), _mm256_loadu_ps(c + x));
+                            __m256 ac1 = _mm256_add_ps(_mm256_loadu_ps(a + x + 8), _mm256_loadu_ps(c + x + 8));
+                            __m256 bd0 = _mm256_add_ps(_mm256_loadu_ps(b + x), _mm256_loadu_ps(d + x));
+                            __m256 bd1 = _mm256_add_ps(_mm256_loadu_ps(b + x + 8), _mm256_loadu_ps(d + x + 8));
+
+                            // Split even and odd columns; lanes end up in block order 0,1,4,5,2,3,6,7
+                            __m256 acEven = _mm256_shuffle_ps(ac0, ac1, _MM_SHUFFLE(2, 0, 2, 0));
+                            __m256 acOdd = _mm256_shuffle_ps(ac0, ac1, _MM_SHUFFLE(3, 1, 3, 1));
+                            __m256 bdEven = _mm256_shuffle_ps(bd0, bd1, _MM_SHUFFLE(2, 0, 2, 0));
+                            __m256 bdOdd = _mm256_shuffle_ps(bd0, bd1, _MM_SHUFFLE(3, 1, 3, 1));
+
+                            __m256 sum = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(acEven, acOdd), bdEven), bdOdd);
+                            sum = _mm256_mul_ps(sum, eighth);
+                            sum = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(sum), _MM_SHUFFLE(3, 1, 2, 0)));
+
+                            _mm256_storeu_ps(averages + x / c_BlockSizeX, sum);
+                        }
+                    }
+                }
+            }
+        }
+
+        template void TileRowGradientsAvx2<8>(const float* const*, uint32_t, TileAccumulators*);
+        template void TileRowGradientsAvx2<16>(const float* const*, uint32_t, TileAccumulators*);
+        template void TileRowGradientsAvx2<32>(const float* const*, uint32_t, TileAccumulators*);
+    }
+}
+
+#endif // NAS_ARCH_X86
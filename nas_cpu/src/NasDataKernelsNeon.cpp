@@ -0,0 +1,133 @@
+//----------------------------------------------------------------------------------
+// File:        NasDataKernelsNeon.cpp
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+// NEON is part of the AArch64 baseline, no runtime detection is needed.
+
+#include "NasDataKernels.h"
+#include "NasCommon.h"
+
+#if NAS_ARCH_ARM64
+
+#include <arm_neon.h>
+
+namespace nas
+{
+    namespace kernels
+    {
+        void ConvertRowNeon(const Rgba8* src, uint32_t count, const LuminanceTables& tables, float* dst)
+        {
+            uint32_t x = 0;
+            for (; x + 4 <= count; x += 4)
+            {
+                // No gather instruction: look the channels up one by one, add in vectors
+                float r[4], g[4], b[4];
+                for (uint32_t i = 0; i < 4; i++)
+                {
+                    r[i] = tables.r[src[x + i].r];
+                    g[i] = tables.g[src[x + i].g];
+                    b[i] = tables.b[src[x + i].b];
+                }
+
+                vst1q_f32(dst + x, vaddq_f32(vaddq_f32(vld1q_f32(r), vld1q_f32(g)), vld1q_f32(b)));
+            }
+
+            for (; x < count; x++)
+                dst[x] = (tables.r[src[x].r] + tables.g[src[x].g]) + tables.b[src[x].b];
+        }
+
+        template<uint32_t TileSize>
+        void TileRowGradientsNeon(const float* const* rows, uint32_t tileCount, TileAccumulators* tiles)
+        {
+            using Layout = TileLayout<TileSize>;
+
+            // Checkerboard: only pixels with even (x + y) contribute
+            const uint32_t evenLanes[4] = { 0xffffffff, 0, 0xffffffff, 0 };
+            const uint32_t oddLanes[4] = { 0, 0xffffffff, 0, 0xffffffff };
+            const uint32x4_t maskEven = vld1q_u32(evenLanes);
+            const uint32x4_t maskOdd = vld1q_u32(oddLanes);
+
+            for (uint32_t tile = 0; tile < tileCount; tile++)
+            {
+                const uint32_t base = tile * TileSize;
+                float32x4_t maxX = vdupq_n_f32(0.f);
+                float32x4_t maxY = vdupq_n_f32(0.f);
+
+                for (uint32_t y = 0; y < TileSize; y++)
+                {
+                    const float* r0 = rows[y] + base;
+                    const float* r1 = rows[y + 1] + base;
+                    const uint32x4_t mask = (y & 1) ? maskOdd : maskEven;
+
+                    for (uint32_t x = 0; x < TileSize; x += 4)
+                    {
+                        float32x4_t center = vld1q_f32(r0 + x);
+                        float32x4_t dx = vabdq_f32(vld1q_f32(r0 + x + 1), center);
+                        float32x4_t dy = vabdq_f32(vld1q_f32(r1 + x), center);
+
+                        maxX = vmaxq_f32(maxX, vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(dx), mask)));
+                        maxY = vmaxq_f32(maxY, vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(dy), mask)));
+                    }
+                }
+
+                tiles[tile].errorX = vmaxvq_f32(maxX);
+                tiles[tile].errorY = vmaxvq_f32(maxY);
+
+                for (uint32_t blockY = 0; blockY < Layout::groupSizeY; blockY++)
+                {
+                    const float* a = rows[blockY * c_BlockSizeY + 0] + base;
+                    const float* b = rows[blockY * c_BlockSizeY + 1] + base;
+                    const float* c = rows[blockY * c_BlockSizeY + 2] + base;
+                    const float* d = rows[blockY * c_BlockSizeY + 3] + base;
+
+                    // 8 columns = 4 blocks per iteration
+                    for (uint32_t x = 0; x < TileSize; x += 8)
+                    {
+                        float32x4_t ac0 = vaddq_f32(vld1q_f32(a + x), vld1q_f32(c + x));
+                        float32x4_t ac1 = vaddq_f32(vld1q_f32(a + x + 4), vld1q_f32(c + x + 4));
+                        float32x4_t bd0 = vaddq_f32(vld1q_f32(b + x), vld1q_f32(d + x));
+                        float32x4_t bd1 = vaddq_f32(vld1q_f32(b + x + 4), vld1q_f32(d + x + 4));
+
+                        float32x4_t sum = vaddq_f32(vuzp1q_f32(ac0, ac1), vuzp2q_f32(ac0, ac1));
+                        sum = vaddq_f32(vaddq_f32(sum, vuzp1q_f32(bd0, bd1)), vuzp2q_f32(bd0, bd1));
+                        vst1q_f32(tiles[tile].blockAverages + blockY * Layout::groupSizeX + x / c_BlockSizeX, vmulq_n_f32(sum, 0.125f));
+                    }
+                }
+            }
+        }
+
+        template void TileRowGradientsNeon<8>(const float* const*, uint32_t, TileAccumulators*);
+        template void TileRowGradientsNeon<16>(const float* const*, uint32_t, TileAccumulators*);
+        template void TileRowGradientsNeon<32>(const float* const*, uint32_t, TileAccumulators*);
+    }
+}
+
+#endif // NAS_ARCH_ARM64
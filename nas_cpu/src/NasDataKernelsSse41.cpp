@@ -0,0 +1,146 @@
+//----------------------------------------------------------------------------------
+// File:        NasDataKernelsSse41.cpp
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+// Compiled with SSE4.1 code generation, only called after runtime detection.
+
+#include "NasDataKernels.h"
+#include "NasCommon.h"
+
+#if NAS_ARCH_X86
+
+#include <smmintrin.h>
+
+namespace nas
+{
+    namespace kernels
+    {
+        static float HorizontalMax(__m128 value)
+        {
+            value = _mm_max_ps(value, _mm_movehl_ps(value, value));
+            value = _mm_max_ss(value, _mm_shuffle_ps(value, value, 1));
+            return _mm_cvtss_f32(value);
+        }
+
+        void ConvertRowSse41(const Rgba8* src, uint32_t count, const LuminanceTables& tables, float* dst)
+        {
+            const __m128i byteMask = _mm_set1_epi32(0xff);
+
+            uint32_t x = 0;
+            for (; x + 4 <= count; x += 4)
+            {
+                __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+                __m128i r = _mm_and_si128(pixels, byteMask);
+                __m128i g = _mm_and_si128(_mm_srli_epi32(pixels, 8), byteMask);
+                __m128i b = _mm_and_si128(_mm_srli_epi32(pixels, 16), byteMask);
+
+                // No gather before AVX2: look the channels up one by one
+                __m128 lr = _mm_setr_ps(tables.r[_mm_extract_epi32(r, 0)], tables.r[_mm_extract_epi32(r, 1)], tables.r[_mm_extract_epi32(r, 2)], tables.r[_mm_extract_epi32(r, 3)]);
+                __m128 lg = _mm_setr_ps(tables.g[_mm_extract_epi32(g, 0)], tables.g[_mm_extract_epi32(g, 1)], tables.g[_mm_extract_epi32(g, 2)], tables.g[_mm_extract_epi32(g, 3)]);
+                __m128 lb = _mm_setr_ps(tables.b[_mm_extract_epi32(b, 0)], tables.b[_mm_extract_epi32(b, 1)], tables.b[_mm_extract_epi32(b, 2)], tables.b[_mm_extract_epi32(b, 3)]);
+
+                _mm_storeu_ps(dst + x, _mm_add_ps(_mm_add_ps(lr, lg), lb));
+            }
+
+            for (; x < count; x++)
+                dst[x] = (tables.r[src[x].r] + tables.g[src[x].g]) + tables.b[src[x].b];
+        }
+
+        template<uint32_t TileSize>
+        void TileRowGradientsSse41(const float* const* rows, uint32_t tileCount, TileAccumulators* tiles)
+        {
+            using Layout = TileLayout<TileSize>;
+
+            // abs() combined with the checkerboard: only pixels with even (x + y) contribute
+            const __m128 maskEven = _mm_castsi128_ps(_mm_setr_epi32(0x7fffffff, 0, 0x7fffffff, 0));
+            const __m128 maskOdd = _mm_castsi128_ps(_mm_setr_epi32(0, 0x7fffffff, 0, 0x7fffffff));
+            const __m128 eighth = _mm_set1_ps(0.125f);
+
+            for (uint32_t tile = 0; tile < tileCount; tile++)
+            {
+                const uint32_t base = tile * TileSize;
+                __m128 maxX = _mm_setzero_ps();
+                __m128 maxY = _mm_setzero_ps();
+
+                for (uint32_t y = 0; y < TileSize; y++)
+                {
+                    const float* r0 = rows[y] + base;
+                    const float* r1 = rows[y + 1] + base;
+                    const __m128 mask = (y & 1) ? maskOdd : maskEven;
+
+                    for (uint32_t x = 0; x < TileSize; x += 4)
+                    {
+                        __m128 center = _mm_loadu_ps(r0 + x);
+                        __m128 right = _mm_loadu_ps(r0 + x + 1);
+                        __m128 below = _mm_loadu_ps(r1 + x);
+
+                        maxX = _mm_max_ps(maxX, _mm_and_ps(_mm_sub_ps(right, center), mask));
+                        maxY = _mm_max_ps(maxY, _mm_and_ps(_mm_sub_ps(below, center), mask));
+                    }
+                }
+
+                tiles[tile].errorX = HorizontalMax(maxX);
+                tiles[tile].errorY = HorizontalMax(maxY);
+
+                for (uint32_t blockY = 0; blockY < Layout::groupSizeY; blockY++)
+                {
+                    const float* a = rows[blockY * c_BlockSizeY + 0] + base;
+                    const float* b = rows[blockY * c_BlockSizeY + 1] + base;
+                    const float* c = rows[blockY * c_BlockSizeY + 2] + base;
+                    const float* d = rows[blockY * c_BlockSizeY + 3] + base;
+
+                    // 8 columns = 4 blocks per iteration
+                    for (uint32_t x = 0; x < TileSize; x += 8)
+                    {
+                        __m128 ac0 = _mm_add_ps(_mm_loadu_ps(a + x), _mm_loadu_ps(c + x));
+                        __m128 ac1 = _mm_add_ps(_mm_loadu_ps(a + x + 4), _mm_loadu_ps(c + x + 4));
+                        __m128 bd0 = _mm_add_ps(_mm_loadu_ps(b + x), _mm_loadu_ps(d + x));
+                        __m128 bd1 = _mm_add_ps(_mm_loadu_ps(b + x + 4), _mm_loadu_ps(d + x + 4));
+
+                        __m128 acEven = _mm_shuffle_ps(ac0, ac1, _MM_SHUFFLE(2, 0, 2, 0));
+                        __m128 acOdd = _mm_shuffle_ps(ac0, ac1, _MM_SHUFFLE(3, 1, 3, 1));
+                        __m128 bdEven = _mm_shuffle_ps(bd0, bd1, _MM_SHUFFLE(2, 0, 2, 0));
+                        __m128 bdOdd = _mm_shuffle_ps(bd0, bd1, _MM_SHUFFLE(3, 1, 3, 1));
+
+                        __m128 sum = _mm_add_ps(_mm_add_ps(_mm_add_ps(acEven, acOdd), bdEven), bdOdd);
+                        _mm_storeu_ps(tiles[tile].blockAverages + blockY * Layout::groupSizeX + x / c_BlockSizeX, _mm_mul_ps(sum, eighth));
+                    }
+                }
+            }
+        }
+
+        template void TileRowGradientsSse41<8>(const float* const*, uint32_t, TileAccumulators*);
+        template void TileRowGradientsSse41<16>(const float* const*, uint32_t, TileAccumulators*);
+        template void TileRowGradientsSse41<32>(const float* const*, uint32_t, TileAccumulators*);
+    }
+}
+
+#endif // NAS_ARCH_X86
@@ -0,0 +1,537 @@
+//----------------------------------------------------------------------------------
+// File:        NasPipeline.cpp
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include "NasTile.h"
+
+#include <nas/ErrorScalers.h>
+
+#include <donut/core/math/math.h>
+
+using namespace donut::math;
+
+#include "Compute_cb.h"  // requires donut::math
+
+#include <cassert>
+#include <cstring>
+#include <functional>
+
+static_assert(int(nas::ErrorMetric::Max) == NAS_ERROR_METRIC_MAX && int(nas::ErrorMetric::L2) == NAS_ERROR_METRIC_L2
+    && int(nas::ErrorMetric::Percentile) == NAS_ERROR_METRIC_PERCENTILE, "ErrorMetric must match the ERROR_METRIC permutations");
+
+namespace nas
+{
+    const char* GetErrorMetricName(ErrorMetric metric)
+    {
+        switch (metric)
+        {
+        case ErrorMetric::Max: return "max";
+        case ErrorMetric::L2: return "l2";
+        case ErrorMetric::Percentile: return "percentile";
+        default: return "unknown";
+        }
+    }
+
+    bool ParseErrorMetricName(const char* name, ErrorMetric& result)
+    {
+        for (ErrorMetric metric : { ErrorMetric::Max, ErrorMetric::L2, ErrorMetric::Percentile })
+        {
+            if (strcmp(name, GetErrorMetricName(metric)) == 0)
+            {
+                result = metric;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    static float SrgbToLinear(float value)
+    {
+        return value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    const LuminanceTables& GetLuminanceTables(ColorEncoding encoding)
+    {
+        struct Tables
+        {
+            LuminanceTables srgb;
+            LuminanceTables linear;
+
+            Tables()
+            {
+                for (int i = 0; i < 256; i++)
+                {
+                    float unorm = float(i) / 255.f;
+                    float decoded = SrgbToLinear(unorm);
+
+                    linear.r[i] = unorm * c_LumaWeightR;
+                    linear.g[i] = unorm * c_LumaWeightG;
+                    linear.b[i] = unorm * c_LumaWeightB;
+                    srgb.r[i] = decoded * c_LumaWeightR;
+                    srgb.g[i] = decoded * c_LumaWeightG;
+                    srgb.b[i] = decoded * c_LumaWeightB;
+                }
+            }
+        };
+
+        static const Tables tables;
+        return encoding == ColorEncoding::Srgb ? tables.srgb : tables.linear;
+    }
+
+    BlockNasData EvaluateBlock(const ColorView& prevFrameColors, const LuminanceTables& tables, int x, int y)
+    {
+        // Same sample pattern as the shader:
+        // l0.x  l0.y
+        // l0.z  l0.w  l2.x
+        // l1.x  l1.y
+        // l1.z  l1.w  l2.y
+        //       l2.z
+        float4 l0, l1;
+        float3 l2;
+        l0.x = LoadLuminance(prevFrameColors, tables, x + 0, y + 0);
+        l0.y = LoadLuminance(prevFrameColors, tables, x + 1, y + 0);
+        l0.z = LoadLuminance(prevFrameColors, tables, x + 0, y + 1);
+        l0.w = LoadLuminance(prevFrameColors, tables, x + 1, y + 1);
+        l1.x = LoadLuminance(prevFrameColors, tables, x + 0, y + 2);
+        l1.y = LoadLuminance(prevFrameColors, tables, x + 1, y + 2);
+        l1.z = LoadLuminance(prevFrameColors, tables, x + 0, y + 3);
+        l1.w = LoadLuminance(prevFrameColors, tables, x + 1, y + 3);
+        l2.x = LoadLuminance(prevFrameColors, tables, x + 2, y + 1);
+        l2.y = LoadLuminance(prevFrameColors, tables, x + 2, y + 3);
+        l2.z = LoadLuminance(prevFrameColors, tables, x + 1, y + 4);
+
+        const float4 dx = float4(fabsf(l0.y - l0.x), fabsf(l2.x - l0.w), fabsf(l1.y - l1.x), fabsf(l2.y - l1.w));
+        const float4 dy = float4(fabsf(l0.z - l0.x), fabsf(l1.y - l0.w), fabsf(l1.z - l1.x), fabsf(l2.z - l1.w));
+
+        BlockNasData block;
+        block.maxDx = std::max(std::max(dx.x, dx.y), std::max(dx.z, dx.w));
+        block.maxDy = std::max(std::max(dy.x, dy.y), std::max(dy.z, dy.w));
+        block.meanSqDx = dot(dx, dx) / 4;
+        block.meanSqDy = dot(dy, dy) / 4;
+        block.avgLuma = ((l0.x + l1.x) + (l0.y + l1.y) + (l0.z + l1.z) + (l0.w + l1.w)) / 8;
+        return block;
+    }
+
+    template<uint32_t TileSize>
+    NasTileData ComputeTileNasData(
+        const ColorView& prevFrameColors,
+        const LuminanceTables& tables,
+        const ComputeNASDataConstants& constants,
+        uint32_t tileX,
+        uint32_t tileY,
+        ErrorMetric metric)
+    {
+        float lumaSum = 0.f;
+        float errX = 0.f;
+        float errY = 0.f;
+
+        using Layout = TileLayout<TileSize>;
+
+        // Block maxima of the percentile metric, in thread order
+        float blockErrorsX[Layout::threads];
+        float blockErrorsY[Layout::threads];
+        uint32_t blockIndex = 0;
+
+        // Emulate the threads of one group, each thread loading a 2x4 pixel block
+        for (uint32_t threadY = 0; threadY < Layout::groupSizeY; threadY++)
+        {
+            for (uint32_t threadX = 0; threadX < Layout::groupSizeX; threadX++)
+            {
+                int x = int(tileX * TileSize + threadX * c_BlockSizeX);
+                int y = int(tileY * TileSize + threadY * c_BlockSizeY);
+
+                BlockNasData block = EvaluateBlock(prevFrameColors, tables, x, y);
+
+                // Block average luma, summed over the group in thread order
+                lumaSum += block.avgLuma;
+
+                if (metric == ErrorMetric::L2)
+                {
+                    errX += block.meanSqDx;
+                    errY += block.meanSqDy;
+                }
+                else
+                {
+                    errX = std::max(errX, block.maxDx);
+                    errY = std::max(errY, block.maxDy);
+                }
+
+                blockErrorsX[blockIndex] = block.maxDx;
+                blockErrorsY[blockIndex] = block.maxDy;
+                blockIndex++;
+            }
+        }
+
+        if (metric == ErrorMetric::L2)
+        {
+            errX = sqrtf(errX / float(Layout::threads));
+            errY = sqrtf(errY / float(Layout::threads));
+        }
+        else if (metric == ErrorMetric::Percentile)
+        {
+            // The same element as the rank selection of the shader, ties have equal values
+            constexpr uint32_t rank = Layout::threads / NAS_ERROR_PERCENTILE_DIVISOR;
+            std::nth_element(blockErrorsX, blockErrorsX + rank, blockErrorsX + Layout::threads, std::greater<float>());
+            std::nth_element(blockErrorsY, blockErrorsY + rank, blockErrorsY + Layout::threads, std::greater<float>());
+            errX = blockErrorsX[rank];
+            errY = blockErrorsY[rank];
+        }
+
+        float avgLuma = lumaSum / float(Layout::threads) + constants.brightnessSensitivity;
+        avgLuma = fabsf(avgLuma);
+
+        return EncodeTileError(errX / avgLuma, errY / avgLuma);
+    }
+
+    void ComputeNASDataRows(
+        const ColorView& prevFrameColors,
+        ColorEncoding encoding,
+        const ComputeNASDataConstants& constants,
+        const NasDataView& nasData,
+        uint32_t tileSize,
+        ErrorMetric metric,
+        uint32_t tileRowBegin,
+        uint32_t tileRowEnd)
+    {
+        assert(nasData.width == GetTileCount(prevFrameColors.width, tileSize));
+        assert(nasData.height == GetTileCount(prevFrameColors.height, tileSize));
+        assert(tileRowBegin <= tileRowEnd && tileRowEnd <= nasData.height);
+
+        const LuminanceTables& tables = GetLuminanceTables(encoding);
+
+        DispatchTileSize(tileSize, [&](auto size)
+        {
+            for (uint32_t tileY = tileRowBegin; tileY < tileRowEnd; tileY++)
+            {
+                for (uint32_t tileX = 0; tileX < nasData.width; tileX++)
+                {
+                    nasData.At(tileX, tileY) = ComputeTileNasData<size>(prevFrameColors, tables, constants, tileX, tileY, metric);
+                }
+            }
+        });
+    }
+
+    void ComputeNASData(
+        const ColorView& prevFrameColors,
+        ColorEncoding encoding,
+        const ComputeNASDataConstants& constants,
+        const NasDataView& nasData,
+        uint32_t tileSize,
+        ErrorMetric metric)
+    {
+        ComputeNASDataRows(prevFrameColors, encoding, constants, nasData, tileSize, metric, 0, nasData.height);
+    }
+
+    template<uint32_t TileSize>
+    float ComputeTileMinDepth(const DepthView& depth, uint32_t tileX, uint32_t tileY)
+    {
+        using Layout = TileLayout<TileSize>;
+
+        // Sparse min depth: four of the eight samples of each 2x4 thread block
+        float minDepth = 1.f;
+        for (uint32_t threadY = 0; threadY < Layout::groupSizeY; threadY++)
+        {
+            for (uint32_t threadX = 0; threadX < Layout::groupSizeX; threadX++)
+            {
+                int x = int(tileX * TileSize + threadX * c_BlockSizeX);
+                int y = int(tileY * TileSize + threadY * c_BlockSizeY);
+
+                minDepth = std::min(minDepth, LoadDepth(depth, x + 0, y + 0));
+                minDepth = std::min(minDepth, LoadDepth(depth, x + 1, y + 1));
+                minDepth = std::min(minDepth, LoadDepth(depth, x + 0, y + 2));
+                minDepth = std::min(minDepth, LoadDepth(depth, x + 1, y + 3));
+            }
+        }
+        return minDepth;
+    }
+
+    template<uint32_t TileSize>
+    void ReprojectTile(
+        const AdaptiveShadingConstants& constants,
+        uint32_t tileX,
+        uint32_t tileY,
+        float minDepth,
+        float2& prevWindowPos,
+        float2& motion)
+    {
+        const float4x4& reprojection = constants.reprojectionMatrix;
+
+        // Reproject the tile center at min depth into the previous frame
+        float2 currWindowPos = float2((float(tileX) + 0.5f) * TileSize, (float(tileY) + 0.5f) * TileSize);
+        float2 currUv = float2(currWindowPos.x * constants.sourceTextureSizeInv.x, currWindowPos.y * constants.sourceTextureSizeInv.y);
+
+        float4 clipPos = float4(currUv.x * 2 - 1, 1 - currUv.y * 2, minDepth, 1.f);
+        float4 prevClipPos;
+        for (int col = 0; col < 4; col++)
+        {
+            prevClipPos[col] = clipPos.x * reprojection[0][col] + clipPos.y * reprojection[1][col]
+                + clipPos.z * reprojection[2][col] + clipPos.w * reprojection[3][col];
+        }
+
+        float2 mVec = float2(0.f, 0.f);
+        prevWindowPos = currWindowPos;
+
+        if (prevClipPos.w > 0)
+        {
+            float prevUvX = 0.5f + (prevClipPos.x / prevClipPos.w) * 0.5f;
+            float prevUvY = 0.5f - (prevClipPos.y / prevClipPos.w) * 0.5f;
+
+            prevWindowPos.x = prevUvX * float(constants.previousViewSize.x) + float(constants.previousViewOrigin.x);
+            prevWindowPos.y = prevUvY * float(constants.previousViewSize.y) + float(constants.previousViewOrigin.y);
+            mVec = float2(prevWindowPos.x - currWindowPos.x, prevWindowPos.y - currWindowPos.y);
+        }
+
+        motion = float2(fabsf(mVec.x) * constants.motionSensitivity, fabsf(mVec.y) * constants.motionSensitivity);
+    }
+
+    uint8_t SelectShadingRate(float2 diff, float2 mVec, float threshold)
+    {
+        // Error scalers (equations from the I3D 2019 paper), interpolated from a table
+        // bhv for half rate, bqv for quarter rate
+        float2 diff2, diff4;
+        for (int i = 0; i < 2; i++)
+        {
+            float bhv = GetHalfRateErrorScaler(mVec[i]);
+            float bqv = GetQuarterRateErrorScaler(mVec[i]);
+            diff2[i] = diff[i] * bhv;
+            diff4[i] = diff[i] * bqv;
+        }
+
+        uint8_t shadingRate = 0;
+        shadingRate |= (diff2.x >= threshold) ? 0 : ((diff4.x > threshold) ? 0x4 : 0x8);
+        shadingRate |= (diff2.y >= threshold) ? 0 : ((diff4.y > threshold) ? 0x1 : 0x2);
+
+        // Disable 4x4 shading rate (low quality, limited perf gain)
+        if (shadingRate == ShadingRate_4x4)
+        {
+            shadingRate = (diff2.x > diff2.y) ? ShadingRate_2x4 : ShadingRate_4x2;
+        }
+        // Disable 4x1 or 1x4 shading rate (unsupported)
+        else if (shadingRate == 0x8)
+        {
+            shadingRate = ShadingRate_2x1;
+        }
+        else if (shadingRate == 0x2)
+        {
+            shadingRate = ShadingRate_1x2;
+        }
+
+        return shadingRate;
+    }
+
+    void ComputeShadingRateRows(
+        const DepthView& depth,
+        const ConstNasDataView& nasData,
+        const AdaptiveShadingConstants& constants,
+        const RateView& rates,
+        uint32_t tileSize,
+        uint32_t tileRowBegin,
+        uint32_t tileRowEnd)
+    {
+        assert(rates.width == GetTileCount(depth.width, tileSize));
+        assert(rates.height == GetTileCount(depth.height, tileSize));
+        assert(tileRowBegin <= tileRowEnd && tileRowEnd <= rates.height);
+
+        auto fetch = [&nasData](uint32_t x, uint32_t y) { return DecodeTileError(nasData.At(x, y)); };
+
+        DispatchTileSize(tileSize, [&](auto size)
+        {
+            for (uint32_t tileY = tileRowBegin; tileY < tileRowEnd; tileY++)
+            {
+                for (uint32_t tileX = 0; tileX < rates.width; tileX++)
+                {
+                    float minDepth = ComputeTileMinDepth<size>(depth, tileX, tileY);
+
+                    float2 prevWindowPos, mVec;
+                    ReprojectTile<size>(constants, tileX, tileY, minDepth, prevWindowPos, mVec);
+
+                    float2 diff = SampleNasData(nasData.width, nasData.height,
+                        prevWindowPos.x * constants.sourceTextureSizeInv.x,
+                        prevWindowPos.y * constants.sourceTextureSizeInv.y,
+                        fetch);
+
+                    rates.At(tileX, tileY) = SelectShadingRate(diff, mVec, constants.errorSensitivity);
+                }
+            }
+        });
+    }
+
+    void ComputeShadingRate(
+        const DepthView& depth,
+        const ConstNasDataView& nasData,
+        const AdaptiveShadingConstants& constants,
+        const RateView& rates,
+        uint32_t tileSize)
+    {
+        ComputeShadingRateRows(depth, nasData, constants, rates, tileSize, 0, rates.height);
+    }
+
+    void SmoothShadingRateRows(
+        const ConstRateView& input,
+        const RateView& output,
+        uint32_t radius,
+        uint32_t tileRowBegin,
+        uint32_t tileRowEnd)
+    {
+        assert(input.width == output.width && input.height == output.height);
+        assert(radius >= 1 && radius <= c_MaxSmoothingRadius);
+        assert(tileRowBegin <= tileRowEnd && tileRowEnd <= output.height);
+
+        for (uint32_t y = tileRowBegin; y < tileRowEnd; y++)
+        {
+            for (uint32_t x = 0; x < input.width; x++)
+            {
+                // Out-of-bounds neighbors read as 0 (1x1), same as the texture loads in the shader
+                uint8_t flags = 0;
+                for (int offset = 1; offset <= int(radius); offset++)
+                {
+                    flags |= GetSmoothingFlags(LoadRate(input, int(x) - offset, int(y)));
+                    flags |= GetSmoothingFlags(LoadRate(input, int(x) + offset, int(y)));
+                    flags |= GetSmoothingFlags(LoadRate(input, int(x), int(y) - offset));
+                    flags |= GetSmoothingFlags(LoadRate(input, int(x), int(y) + offset));
+                }
+
+                output.At(x, y) = ApplySmoothingFlags(input.At(x, y), flags);
+            }
+        }
+    }
+
+    void SmoothShadingRate(
+        const ConstRateView& input,
+        const RateView& output,
+        uint32_t radius)
+    {
+        SmoothShadingRateRows(input, output, radius, 0, output.height);
+    }
+
+    void SmoothShadingRateSeparable(
+        const ConstRateView& input,
+        const RateView& temp,
+        const RateView& output,
+        uint32_t radius)
+    {
+        assert(input.width == temp.width && input.height == temp.height);
+        assert(input.width == output.width && input.height == output.height);
+        assert(radius >= 1 && radius <= c_MaxSmoothingRadius);
+
+        // Row pass: rate in the low bits, flags of the row neighbors above
+        for (uint32_t y = 0; y < input.height; y++)
+        {
+            for (uint32_t x = 0; x < input.width; x++)
+            {
+                uint8_t flags = 0;
+                for (int offset = 1; offset <= int(radius); offset++)
+                {
+                    flags |= GetSmoothingFlags(LoadRate(input, int(x) - offset, int(y)));
+                    flags |= GetSmoothingFlags(LoadRate(input, int(x) + offset, int(y)));
+                }
+
+                temp.At(x, y) = input.At(x, y) | flags;
+            }
+        }
+
+        // Column pass
+        for (uint32_t y = 0; y < input.height; y++)
+        {
+            for (uint32_t x = 0; x < input.width; x++)
+            {
+                const uint8_t center = temp.At(x, y);
+
+                uint8_t flags = center & (c_SmoothFlagX1 | c_SmoothFlagY1);
+                for (int offset = 1; offset <= int(radius); offset++)
+                {
+                    flags |= GetSmoothingFlags(LoadRate(temp, int(x), int(y) - offset) & c_SmoothRateMask);
+                    flags |= GetSmoothingFlags(LoadRate(temp, int(x), int(y) + offset) & c_SmoothRateMask);
+                }
+
+                output.At(x, y) = ApplySmoothingFlags(center & c_SmoothRateMask, flags);
+            }
+        }
+    }
+
+    void PrepareOutputs(const PipelineInputs& inputs, PipelineOutputs& outputs)
+    {
+        uint32_t tilesX = GetTileCount(inputs.depth.width, inputs.tileSize);
+        uint32_t tilesY = GetTileCount(inputs.depth.height, inputs.tileSize);
+
+        if (outputs.nasData.GetWidth() != tilesX || outputs.nasData.GetHeight() != tilesY)
+            outputs.nasData.Resize(tilesX, tilesY);
+        if (outputs.rates.GetWidth() != tilesX || outputs.rates.GetHeight() != tilesY)
+            outputs.rates.Resize(tilesX, tilesY);
+    }
+
+    void RunPipeline(const PipelineInputs& inputs, PipelineOutputs& outputs)
+    {
+        assert(inputs.dataConstants && inputs.rateConstants);
+        assert(IsSupportedTileSize(inputs.tileSize));
+
+        PrepareOutputs(inputs, outputs);
+
+        ComputeNASDataVectorized(inputs.prevFrameColors, inputs.colorEncoding, *inputs.dataConstants, outputs.nasData.View(),
+            inputs.instructionSet, inputs.tileSize, inputs.errorMetric);
+        ComputeShadingRate(inputs.depth, outputs.nasData.View(), *inputs.rateConstants, outputs.rates.View(), inputs.tileSize);
+
+        if (inputs.enableSmoothing)
+        {
+            Image<uint8_t> unsmoothed = outputs.rates;
+            SmoothShadingRate(unsmoothed.View(), outputs.rates.View(), inputs.smoothingRadius);
+        }
+    }
+
+    uint32_t CountRateDifferences(const ConstRateView& a, const ConstRateView& b)
+    {
+        assert(a.width == b.width && a.height == b.height);
+
+        uint32_t differences = 0;
+        for (uint32_t y = 0; y < a.height; y++)
+        {
+            for (uint32_t x = 0; x < a.width; x++)
+            {
+                if (a.At(x, y) != b.At(x, y))
+                    differences++;
+            }
+        }
+        return differences;
+    }
+
+    // Instantiations used by the fused pipeline
+#define NAS_INSTANTIATE_TILE_HELPERS(TILE_SIZE) \
+    template NasTileData ComputeTileNasData<TILE_SIZE>(const ColorView&, const LuminanceTables&, const ComputeNASDataConstants&, uint32_t, uint32_t, ErrorMetric); \
+    template float ComputeTileMinDepth<TILE_SIZE>(const DepthView&, uint32_t, uint32_t); \
+    template void ReprojectTile<TILE_SIZE>(const AdaptiveShadingConstants&, uint32_t, uint32_t, float, float2&, float2&);
+
+    NAS_INSTANTIATE_TILE_HELPERS(8)
+    NAS_INSTANTIATE_TILE_HELPERS(16)
+    NAS_INSTANTIATE_TILE_HELPERS(32)
+
+#undef NAS_INSTANTIATE_TILE_HELPERS
+}
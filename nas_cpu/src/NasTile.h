@@ -0,0 +1,176 @@
+//----------------------------------------------------------------------------------
+// File:        NasTile.h
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#pragma once
+
+// Per-tile building blocks of the three passes, the CPU versions of adaptive_shading/NASCommon.hlsli.
+// The reference implementation runs them over the whole tile grid, the fused implementation over
+// the tiles of one group.
+
+#include "NasCommon.h"
+
+#include <donut/core/math/math.h>
+
+namespace nas
+{
+    // The tile helpers are instantiated for every size in c_TileSizes in NasPipeline.cpp
+
+    // Derivatives and average luma of the 2x4 pixel block of one ComputeNASData.hlsl thread
+    struct BlockNasData
+    {
+        float maxDx;
+        float maxDy;
+        float meanSqDx;     // mean squared derivatives, for the L2 metric
+        float meanSqDy;
+        float avgLuma;
+    };
+
+    BlockNasData EvaluateBlock(const ColorView& prevFrameColors, const LuminanceTables& tables, int x, int y);
+
+    // NAS data of one tile, the work of one ComputeNASData.hlsl group
+    template<uint32_t TileSize>
+    NasTileData ComputeTileNasData(
+        const ColorView& prevFrameColors,
+        const LuminanceTables& tables,
+        const ComputeNASDataConstants& constants,
+        uint32_t tileX,
+        uint32_t tileY,
+        ErrorMetric metric = ErrorMetric::Max);
+
+    // Sparse minimum depth of a tile, like the groupMinDepth reduction in ComputeShadingRate.hlsl
+    template<uint32_t TileSize>
+    float ComputeTileMinDepth(const DepthView& depth, uint32_t tileX, uint32_t tileY);
+
+    // Reprojects the tile center at minDepth into the previous frame.
+    // Returns the previous window position and the scaled absolute motion of the tile.
+    template<uint32_t TileSize>
+    void ReprojectTile(
+        const AdaptiveShadingConstants& constants,
+        uint32_t tileX,
+        uint32_t tileY,
+        float minDepth,
+        donut::math::float2& prevWindowPos,
+        donut::math::float2& motion);
+
+    // Rate selection of ComputeShadingRate.hlsl from the sampled error and the motion
+    uint8_t SelectShadingRate(donut::math::float2 diff, donut::math::float2 motion, float threshold);
+
+    // Neighbor flags of SmoothShadingRate.hlsl, stored above the rate by the separable row pass
+    constexpr uint8_t c_SmoothFlagX1 = 0x10;
+    constexpr uint8_t c_SmoothFlagY1 = 0x20;
+    constexpr uint8_t c_SmoothRateMask = 0xf;
+
+    // Which of the center tile's 4x rates a neighbor with rate SR relaxes
+    inline uint8_t GetSmoothingFlags(uint8_t SR)
+    {
+        return (((SR & 0x3) == 0) ? c_SmoothFlagX1 : 0) | (((SR & 0xc) == 0) ? c_SmoothFlagY1 : 0);
+    }
+
+    inline uint8_t ApplySmoothingFlags(uint8_t centerSR, uint8_t flags)
+    {
+        // Check all tiles that contain 4x shading rate in either X or Y
+        if (centerSR & 0xa)
+        {
+            // if an neighboring tile has 1x rate and current tile is 4x in X
+            if ((flags & c_SmoothFlagX1) && (centerSR & 0x8))
+                centerSR ^= 0xc;  // increase the X shading rate from 4x to 2x
+
+            // if an neighboring tile has 1x rate and current tile is 4x in Y
+            if ((flags & c_SmoothFlagY1) && (centerSR & 0x2))
+                centerSR ^= 0x3;  // increase the Y shading rate from 4x to 2x
+        }
+
+        return centerSR;
+    }
+
+    // The four texels and filter weights of a bilinear sample of a width x height surface
+    // with a wrapping sampler, like s_Sampler in the shader
+    struct BilinearFootprint
+    {
+        uint32_t x0, x1;
+        uint32_t y0, y1;
+        float fracX, fracY;
+    };
+
+    inline BilinearFootprint GetBilinearFootprint(uint32_t width, uint32_t height, float u, float v)
+    {
+        float texelX = u * float(width) - 0.5f;
+        float texelY = v * float(height) - 0.5f;
+        float baseX = floorf(texelX);
+        float baseY = floorf(texelY);
+
+        auto wrap = [](float coord, uint32_t size)
+        {
+            float wrapped = coord - floorf(coord / float(size)) * float(size);
+            return std::min(uint32_t(std::max(wrapped, 0.f)), size - 1);
+        };
+
+        BilinearFootprint footprint;
+        footprint.x0 = wrap(baseX, width);
+        footprint.x1 = wrap(baseX + 1.f, width);
+        footprint.y0 = wrap(baseY, height);
+        footprint.y1 = wrap(baseY + 1.f, height);
+        footprint.fracX = roundf((texelX - baseX) * c_FilterWeightScale) / c_FilterWeightScale;
+        footprint.fracY = roundf((texelY - baseY) * c_FilterWeightScale) / c_FilterWeightScale;
+        return footprint;
+    }
+
+    // Bilinear sample of a NAS data surface. fetch(x, y) returns the decoded texel at wrapped tile coordinates.
+    template<typename FetchFunc>
+    donut::math::float2 SampleNasData(const BilinearFootprint& footprint, const FetchFunc& fetch)
+    {
+        donut::math::float2 t00 = fetch(footprint.x0, footprint.y0);
+        donut::math::float2 t10 = fetch(footprint.x1, footprint.y0);
+        donut::math::float2 t01 = fetch(footprint.x0, footprint.y1);
+        donut::math::float2 t11 = fetch(footprint.x1, footprint.y1);
+
+        donut::math::float2 result;
+        for (int i = 0; i < 2; i++)
+        {
+            float top = t00[i] + (t10[i] - t00[i]) * footprint.fracX;
+            float bottom = t01[i] + (t11[i] - t01[i]) * footprint.fracX;
+            result[i] = top + (bottom - top) * footprint.fracY;
+        }
+        return result;
+    }
+
+    template<typename FetchFunc>
+    donut::math::float2 SampleNasData(uint32_t width, uint32_t height, float u, float v, const FetchFunc& fetch)
+    {
+        return SampleNasData(GetBilinearFootprint(width, height, u, v), fetch);
+    }
+
+    inline donut::math::float2 DecodeTileError(const NasTileData& texel)
+    {
+        return donut::math::float2(HalfToFloat(texel.errorX), HalfToFloat(texel.errorY));
+    }
+}
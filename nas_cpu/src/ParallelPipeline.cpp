@@ -0,0 +1,135 @@
+//----------------------------------------------------------------------------------
+// File:        ParallelPipeline.cpp
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include <nas/ParallelPipeline.h>
+#include "NasCommon.h"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+
+namespace nas
+{
+    // Bands per thread when the band size is automatic, enough for stealing to even out the load
+    constexpr uint32_t c_BandsPerThread = 4;
+
+    typedef std::chrono::steady_clock Clock;
+
+    static int64_t ElapsedNanoseconds(Clock::time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    }
+
+    static double NanosecondsToMilliseconds(int64_t ns)
+    {
+        return double(ns) * 1e-6;
+    }
+
+    ParallelPipeline::ParallelPipeline(uint32_t threadCount)
+        : m_Scheduler(threadCount)
+    {
+    }
+
+    void ParallelPipeline::Run(const PipelineInputs& inputs, PipelineOutputs& outputs)
+    {
+        assert(inputs.dataConstants && inputs.rateConstants);
+
+        const Clock::time_point start = Clock::now();
+
+        PrepareOutputs(inputs, outputs);
+
+        const uint32_t tileRows = outputs.rates.GetHeight();
+        const uint32_t rowsPerBand = m_TileRowsPerBand
+            ? m_TileRowsPerBand
+            : std::max(tileRows / (GetThreadCount() * c_BandsPerThread), 1u);
+        const uint32_t bandCount = (tileRows + rowsPerBand - 1) / rowsPerBand;
+
+        auto bandBegin = [tileRows, rowsPerBand](uint32_t band) { return std::min(band * rowsPerBand, tileRows); };
+        auto bandEnd = [tileRows, rowsPerBand](uint32_t band) { return std::min((band + 1) * rowsPerBand, tileRows); };
+
+        std::atomic<int64_t> nasDataTime(0);
+        std::atomic<int64_t> shadingRateTime(0);
+        std::atomic<int64_t> smoothingTime(0);
+
+        const NasDataView nasData = outputs.nasData.View();
+
+        m_Scheduler.ParallelFor(bandCount, [&](uint32_t band)
+        {
+            Clock::time_point bandStart = Clock::now();
+            ComputeNASDataVectorizedRows(inputs.prevFrameColors, inputs.colorEncoding, *inputs.dataConstants,
+                nasData, inputs.instructionSet, inputs.tileSize, inputs.errorMetric, bandBegin(band), bandEnd(band));
+            nasDataTime += ElapsedNanoseconds(bandStart);
+        });
+
+        // Smoothing reads the unsmoothed rates, so they go to a separate surface
+        if (inputs.enableSmoothing && (m_UnsmoothedRates.GetWidth() != outputs.rates.GetWidth() || m_UnsmoothedRates.GetHeight() != tileRows))
+            m_UnsmoothedRates.Resize(outputs.rates.GetWidth(), tileRows);
+
+        const RateView rates = inputs.enableSmoothing ? m_UnsmoothedRates.View() : outputs.rates.View();
+
+        // Smoothing a band reads up to smoothingRadius tile rows of the bands around it
+        const uint32_t bandReach = (inputs.smoothingRadius + rowsPerBand - 1) / rowsPerBand;
+        auto firstNeighbor = [bandReach](uint32_t band) { return band > bandReach ? band - bandReach : 0; };
+        auto lastNeighbor = [bandReach, bandCount](uint32_t band) { return std::min(band + bandReach, bandCount - 1); };
+
+        // Number of unfinished bands among the neighbors (and self) of each band
+        std::unique_ptr<std::atomic<uint32_t>[]> pendingNeighbors(new std::atomic<uint32_t>[bandCount]);
+        for (uint32_t band = 0; band < bandCount; band++)
+            pendingNeighbors[band] = lastNeighbor(band) - firstNeighbor(band) + 1;
+
+        m_Scheduler.ParallelFor(bandCount, [&](uint32_t band)
+        {
+            Clock::time_point bandStart = Clock::now();
+            ComputeShadingRateRows(inputs.depth, nasData, *inputs.rateConstants, rates, inputs.tileSize, bandBegin(band), bandEnd(band));
+            shadingRateTime += ElapsedNanoseconds(bandStart);
+
+            if (!inputs.enableSmoothing)
+                return;
+
+            // Whoever finishes the last band of a neighborhood smooths it
+            for (uint32_t neighbor = firstNeighbor(band); neighbor <= lastNeighbor(band); neighbor++)
+            {
+                if (pendingNeighbors[neighbor].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    Clock::time_point smoothStart = Clock::now();
+                    SmoothShadingRateRows(rates, outputs.rates.View(), inputs.smoothingRadius, bandBegin(neighbor), bandEnd(neighbor));
+                    smoothingTime += ElapsedNanoseconds(smoothStart);
+                }
+            }
+        });
+
+        m_Timings.nasDataMs = NanosecondsToMilliseconds(nasDataTime);
+        m_Timings.shadingRateMs = NanosecondsToMilliseconds(shadingRateTime);
+        m_Timings.smoothingMs = NanosecondsToMilliseconds(smoothingTime);
+        m_Timings.totalMs = NanosecondsToMilliseconds(ElapsedNanoseconds(start));
+    }
+}
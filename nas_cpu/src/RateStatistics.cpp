@@ -0,0 +1,93 @@
+//----------------------------------------------------------------------------------
+// File:        RateStatistics.cpp
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include <nas/RateStatistics.h>
+
+#include <algorithm>
+#include <cassert>
+
+namespace nas
+{
+    const char* GetShadingRateName(uint8_t rate)
+    {
+        switch (rate)
+        {
+        case ShadingRate_1x1: return "1x1";
+        case ShadingRate_1x2: return "1x2";
+        case ShadingRate_2x1: return "2x1";
+        case ShadingRate_2x2: return "2x2";
+        case ShadingRate_2x4: return "2x4";
+        case ShadingRate_4x2: return "4x2";
+        case ShadingRate_4x4: return "4x4";
+        default: return "invalid";
+        }
+    }
+
+    void RateStatistics::Accumulate(const RateStatistics& other)
+    {
+        for (int rate = 0; rate < 16; rate++)
+            tileCounts[rate] += other.tileCounts[rate];
+
+        pixels += other.pixels;
+        coarsePixels += other.coarsePixels;
+        invocations += other.invocations;
+    }
+
+    RateStatistics ComputeRateStatistics(const ConstRateView& rates, uint32_t width, uint32_t height, uint32_t tileSize)
+    {
+        assert(rates.width == GetTileCount(width, tileSize) && rates.height == GetTileCount(height, tileSize));
+
+        RateStatistics stats;
+
+        for (uint32_t tileY = 0; tileY < rates.height; tileY++)
+        {
+            uint32_t tileHeight = std::min(tileSize, height - tileY * tileSize);
+
+            for (uint32_t tileX = 0; tileX < rates.width; tileX++)
+            {
+                uint32_t tileWidth = std::min(tileSize, width - tileX * tileSize);
+                uint8_t rate = rates.At(tileX, tileY);
+
+                uint32_t rateWidth = GetShadingRateWidth(rate);
+                uint32_t rateHeight = GetShadingRateHeight(rate);
+
+                stats.tileCounts[rate & 0xf]++;
+                stats.pixels += tileWidth * tileHeight;
+                if (rate != ShadingRate_1x1)
+                    stats.coarsePixels += tileWidth * tileHeight;
+                stats.invocations += ((tileWidth + rateWidth - 1) / rateWidth) * ((tileHeight + rateHeight - 1) / rateHeight);
+            }
+        }
+
+        return stats;
+    }
+}
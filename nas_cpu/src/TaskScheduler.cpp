@@ -0,0 +1,167 @@
+//----------------------------------------------------------------------------------
+// File:        TaskScheduler.cpp
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include <nas/TaskScheduler.h>
+
+#include <algorithm>
+#include <cassert>
+
+namespace nas
+{
+    TaskScheduler::TaskScheduler(uint32_t threadCount)
+    {
+        if (threadCount == 0)
+            threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+        for (uint32_t worker = 0; worker < threadCount; worker++)
+            m_Queues.push_back(std::make_unique<WorkQueue>());
+
+        for (uint32_t worker = 1; worker < threadCount; worker++)
+            m_Threads.emplace_back(&TaskScheduler::WorkerMain, this, worker);
+    }
+
+    TaskScheduler::~TaskScheduler()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stop = true;
+        }
+        m_WakeCondition.notify_all();
+
+        for (std::thread& thread : m_Threads)
+            thread.join();
+    }
+
+    bool TaskScheduler::PopLocal(uint32_t worker, uint32_t& index)
+    {
+        WorkQueue& queue = *m_Queues[worker];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (queue.begin == queue.end)
+            return false;
+
+        index = queue.begin++;
+        return true;
+    }
+
+    bool TaskScheduler::Steal(uint32_t worker, uint32_t& index)
+    {
+        const uint32_t queueCount = GetThreadCount();
+
+        for (uint32_t offset = 1; offset < queueCount; offset++)
+        {
+            WorkQueue& victim = *m_Queues[(worker + offset) % queueCount];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+
+            if (victim.begin != victim.end)
+            {
+                index = --victim.end;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void TaskScheduler::RunWorker(uint32_t worker)
+    {
+        // No new work is added during a ParallelFor, so empty queues mean we are done
+        uint32_t index;
+        while (PopLocal(worker, index) || Steal(worker, index))
+            (*m_Func)(index);
+    }
+
+    void TaskScheduler::WorkerMain(uint32_t worker)
+    {
+        uint64_t generation = 0;
+
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_WakeCondition.wait(lock, [this, generation]() { return m_Stop || m_Generation != generation; });
+
+                if (m_Stop)
+                    return;
+
+                generation = m_Generation;
+            }
+
+            RunWorker(worker);
+
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                if (--m_ActiveWorkers == 0)
+                    m_DoneCondition.notify_one();
+            }
+        }
+    }
+
+    void TaskScheduler::ParallelFor(uint32_t count, const std::function<void(uint32_t index)>& func)
+    {
+        assert(!m_Func && "TaskScheduler::ParallelFor calls must not be nested");
+
+        if (count == 0)
+            return;
+
+        const uint32_t threadCount = GetThreadCount();
+
+        if (threadCount == 1 || count == 1)
+        {
+            for (uint32_t index = 0; index < count; index++)
+                func(index);
+            return;
+        }
+
+        for (uint32_t worker = 0; worker < threadCount; worker++)
+        {
+            WorkQueue& queue = *m_Queues[worker];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.begin = uint32_t(uint64_t(count) * worker / threadCount);
+            queue.end = uint32_t(uint64_t(count) * (worker + 1) / threadCount);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Func = &func;
+            m_ActiveWorkers = threadCount - 1;
+            m_Generation++;
+        }
+        m_WakeCondition.notify_all();
+
+        RunWorker(0);
+
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_DoneCondition.wait(lock, [this]() { return m_ActiveWorkers == 0; });
+        m_Func = nullptr;
+    }
+}
@@ -0,0 +1,245 @@
+//----------------------------------------------------------------------------------
+// File:        WaveEmulation.cpp
+// Site:        http://developer.nvidia.com/
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//----------------------------------------------------------------------------------
+
+#include <nas/WaveEmulation.h>
+
+#include "NasTile.h"
+
+using namespace donut::math;
+
+#include "Compute_cb.h"  // requires donut::math
+
+#include <cassert>
+#include <cstring>
+
+namespace nas
+{
+    const char* GetReductionVariantName(ReductionVariant variant)
+    {
+        switch (variant)
+        {
+        case ReductionVariant::Groupshared: return "groupshared";
+        case ReductionVariant::Wave32: return "wave32";
+        case ReductionVariant::Wave64: return "wave64";
+        default: return "unknown";
+        }
+    }
+
+    uint32_t GetReductionWaveSize(ReductionVariant variant)
+    {
+        switch (variant)
+        {
+        case ReductionVariant::Wave32: return 32;
+        case ReductionVariant::Wave64: return 64;
+        default: return 0;
+        }
+    }
+
+    ReductionVariant SelectReductionVariant(uint32_t minLanes, uint32_t maxLanes)
+    {
+        if (minLanes == maxLanes && minLanes == 32)
+            return ReductionVariant::Wave32;
+        if (minLanes == maxLanes && minLanes == 64)
+            return ReductionVariant::Wave64;
+
+        return ReductionVariant::Groupshared;
+    }
+
+    // Pairwise sum, the order of the groupshared reduction in ComputeNASData.hlsl
+    static float PairwiseSum(float* values, uint32_t count)
+    {
+        for (uint32_t stride = 1; stride < count; stride *= 2)
+        {
+            for (uint32_t i = 0; i + stride < count; i += 2 * stride)
+                values[i] += values[i + stride];
+        }
+        return count ? values[0] : 0.f;
+    }
+
+    WaveEmulator::WaveEmulator(uint32_t laneCount)
+        : m_LaneCount(laneCount)
+    {
+        assert(laneCount >= 4 && laneCount <= c_MaxLanes);
+    }
+
+    float WaveEmulator::ActiveSum(const float* laneValues, uint32_t activeLanes) const
+    {
+        assert(activeLanes <= m_LaneCount);
+
+        float partial[c_MaxLanes];
+        memcpy(partial, laneValues, activeLanes * sizeof(float));
+        return PairwiseSum(partial, activeLanes);
+    }
+
+    float WaveEmulator::ActiveMax(const float* laneValues, uint32_t activeLanes) const
+    {
+        assert(activeLanes <= m_LaneCount);
+
+        float result = activeLanes ? laneValues[0] : 0.f;
+        for (uint32_t lane = 1; lane < activeLanes; lane++)
+            result = std::max(result, laneValues[lane]);
+        return result;
+    }
+
+    template<uint32_t TileSize>
+    static NasTileData ComputeTileNasDataEmulated(
+        const ColorView& prevFrameColors,
+        const LuminanceTables& tables,
+        const ComputeNASDataConstants& constants,
+        ReductionVariant variant,
+        uint32_t tileX,
+        uint32_t tileY)
+    {
+        using Layout = TileLayout<TileSize>;
+
+        // Per-thread values in SV_GroupIndex order
+        float luma[Layout::threads];
+        float maxDx[Layout::threads];
+        float maxDy[Layout::threads];
+
+        for (uint32_t threadY = 0; threadY < Layout::groupSizeY; threadY++)
+        {
+            for (uint32_t threadX = 0; threadX < Layout::groupSizeX; threadX++)
+            {
+                const uint32_t groupIndex = threadY * Layout::groupSizeX + threadX;
+                BlockNasData block = EvaluateBlock(prevFrameColors, tables,
+                    int(tileX * TileSize + threadX * c_BlockSizeX), int(tileY * TileSize + threadY * c_BlockSizeY));
+
+                luma[groupIndex] = block.avgLuma;
+                maxDx[groupIndex] = block.maxDx;
+                maxDy[groupIndex] = block.maxDy;
+            }
+        }
+
+        float lumaSum, errX, errY;
+
+        const uint32_t waveSize = GetReductionWaveSize(variant);
+        if (waveSize)
+        {
+            // Wave intrinsics per wave, then the wave results combined by thread 0
+            const WaveEmulator wave(waveSize);
+            const uint32_t waveCount = wave.GetWaveCount(Layout::threads);
+
+            float waveLuma[Layout::threads];
+            float waveMaxDx[Layout::threads];
+            float waveMaxDy[Layout::threads];
+
+            for (uint32_t waveIndex = 0; waveIndex < waveCount; waveIndex++)
+            {
+                const uint32_t firstLane = waveIndex * waveSize;
+                const uint32_t activeLanes = std::min(waveSize, Layout::threads - firstLane);
+
+                waveLuma[waveIndex] = wave.ActiveSum(luma + firstLane, activeLanes);
+                waveMaxDx[waveIndex] = wave.ActiveMax(maxDx + firstLane, activeLanes);
+                waveMaxDy[waveIndex] = wave.ActiveMax(maxDy + firstLane, activeLanes);
+            }
+
+            lumaSum = PairwiseSum(waveLuma, waveCount);
+            errX = *std::max_element(waveMaxDx, waveMaxDx + waveCount);
+            errY = *std::max_element(waveMaxDy, waveMaxDy + waveCount);
+        }
+        else
+        {
+            // Groupshared tree, one step per barrier
+            lumaSum = PairwiseSum(luma, Layout::threads);
+            errX = *std::max_element(maxDx, maxDx + Layout::threads);
+            errY = *std::max_element(maxDy, maxDy + Layout::threads);
+        }
+
+        float avgLuma = lumaSum / float(Layout::threads) + constants.brightnessSensitivity;
+        avgLuma = fabsf(avgLuma);
+
+        return EncodeTileError(errX / avgLuma, errY / avgLuma);
+    }
+
+    void ComputeNASDataEmulated(
+        const ColorView& prevFrameColors,
+        ColorEncoding encoding,
+        const ComputeNASDataConstants& constants,
+        const NasDataView& nasData,
+        ReductionVariant variant,
+        uint32_t tileSize)
+    {
+        assert(nasData.width == GetTileCount(prevFrameColors.width, tileSize));
+        assert(nasData.height == GetTileCount(prevFrameColors.height, tileSize));
+
+        const LuminanceTables& tables = GetLuminanceTables(encoding);
+
+        DispatchTileSize(tileSize, [&](auto size)
+        {
+            for (uint32_t tileY = 0; tileY < nasData.height; tileY++)
+            {
+                for (uint32_t tileX = 0; tileX < nasData.width; tileX++)
+                {
+                    nasData.At(tileX, tileY) = ComputeTileNasDataEmulated<size>(prevFrameColors, tables, constants, variant, tileX, tileY);
+                }
+            }
+        });
+    }
+
+    uint32_t CountReductionVariantDifferences(
+        const ColorView& prevFrameColors,
+        ColorEncoding encoding,
+        const ComputeNASDataConstants& constants,
+        uint32_t tileSize)
+    {
+        const uint32_t tilesX = GetTileCount(prevFrameColors.width, tileSize);
+        const uint32_t tilesY = GetTileCount(prevFrameColors.height, tileSize);
+
+        Image<NasTileData> reference(tilesX, tilesY);
+        Image<NasTileData> variantData(tilesX, tilesY);
+
+        ComputeNASDataEmulated(prevFrameColors, encoding, constants, reference.View(), c_ReductionVariants[0], tileSize);
+
+        uint32_t differences = 0;
+        for (ReductionVariant variant : c_ReductionVariants)
+        {
+            if (variant == c_ReductionVariants[0])
+                continue;
+
+            ComputeNASDataEmulated(prevFrameColors, encoding, constants, variantData.View(), variant, tileSize);
+
+            for (uint32_t y = 0; y < tilesY; y++)
+            {
+                for (uint32_t x = 0; x < tilesX; x++)
+                {
+                    const NasTileData& a = reference.At(x, y);
+                    const NasTileData& b = variantData.At(x, y);
+                    if (a.errorX != b.errorX || a.errorY != b.errorY)
+                        differences++;
+                }
+            }
+        }
+
+        return differences;
+    }
+}